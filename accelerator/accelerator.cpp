@@ -26,7 +26,7 @@ struct accelerator::impl
 	{
 	}
 
-	std::unique_ptr<core::image_mixer> create_image_mixer(const int channel_id)
+	std::unique_ptr<core::image_mixer> create_image_mixer(const int channel_id, core::color_space color_space, core::color_transfer color_transfer)
 	{
 		try
 		{
@@ -37,6 +37,9 @@ struct accelerator::impl
 				if(!ogl_device_)
 					ogl_device_.reset(new ogl::device());
 
+				if(color_space != core::color_space::unspecified || color_transfer != core::color_transfer::unspecified)
+					CASPAR_LOG(warning) << L"Channel " << channel_id << L" color-space and color-transfer are only supported by the cpu accelerator.";
+
 				return std::make_unique<ogl::image_mixer>(
 						spl::make_shared_ptr(ogl_device_),
 						env::properties().get(L"configuration.mixer.blend-modes", false),
@@ -50,7 +53,11 @@ struct accelerator::impl
 			if(path_ == L"gpu" || path_ == L"ogl")
 				CASPAR_LOG_CURRENT_EXCEPTION();
 		}
-		return std::make_unique<cpu::image_mixer>(channel_id);
+		return std::make_unique<cpu::image_mixer>(
+				channel_id,
+				env::properties().get(L"configuration.mixer.cpu-bit-depth", 8),
+				color_space,
+				color_transfer);
 	}
 };
 
@@ -63,9 +70,9 @@ accelerator::~accelerator()
 {
 }
 
-std::unique_ptr<core::image_mixer> accelerator::create_image_mixer(const int channel_id)
+std::unique_ptr<core::image_mixer> accelerator::create_image_mixer(const int channel_id, core::color_space color_space, core::color_transfer color_transfer)
 {
-	return impl_->create_image_mixer(channel_id);
+	return impl_->create_image_mixer(channel_id, color_space, color_transfer);
 }
 
 std::shared_ptr<ogl::device> accelerator::get_ogl_device() const
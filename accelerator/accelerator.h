@@ -5,6 +5,7 @@
 
 #include <core/fwd.h>
 #include <core/video_format.h>
+#include <core/frame/color_space.h>
 
 #include <boost/noncopyable.hpp>
 
@@ -16,7 +17,10 @@ public:
 	accelerator(const std::wstring& path, const core::video_format_repository format_repository);
 	~accelerator();
 
-	std::unique_ptr<core::image_mixer> create_image_mixer(int channel_id);
+	std::unique_ptr<core::image_mixer> create_image_mixer(
+			int channel_id,
+			core::color_space color_space = core::color_space::unspecified,
+			core::color_transfer color_transfer = core::color_transfer::unspecified);
 
 	std::shared_ptr<ogl::device> get_ogl_device() const;
 private:
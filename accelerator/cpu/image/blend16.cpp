@@ -0,0 +1,207 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../../StdAfx.h"
+
+#include "blend16.h"
+
+#include <algorithm>
+
+#ifdef WIN32
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#define CASPAR_TARGET_AVX2
+#else
+#define CASPAR_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace caspar { namespace accelerator { namespace cpu {
+
+namespace {
+
+// C(S, D) = min(S, S[A]) + round(D * (0xFFFF - S[A]) / 0xFFFF)
+// round(X / 0xFFFF) = (T + (T >> 16)) >> 16, T = X + 0x8000, exact for all 16 bit products.
+inline std::uint16_t blend16(std::uint16_t d, std::uint16_t s, std::uint16_t a)
+{
+	std::uint32_t t = static_cast<std::uint32_t>(d) * (0xFFFF - a) + 0x8000;
+	std::uint32_t r = (std::min(s, a) + ((t + (t >> 16)) >> 16));
+
+	return static_cast<std::uint16_t>(std::min<std::uint32_t>(r, 0xFFFF));
+}
+
+void blend16_c(std::uint16_t* dest, const std::uint16_t* source, std::size_t count)
+{
+	for (std::size_t n = 0; n < count; n += 4)
+	{
+		auto a = source[n + 3];
+
+		for (std::size_t c = 0; c < 4; ++c)
+			dest[n + c] = blend16(dest[n + c], source[n + c], a);
+	}
+}
+
+void blend16_sse(std::uint16_t* dest, const std::uint16_t* source, std::size_t count)
+{
+	const auto one		= _mm_set1_epi16(-1);
+	const auto half		= _mm_set1_epi32(0x8000);
+
+	std::size_t n = 0;
+
+	for (; n + 8 <= count; n += 8)
+	{
+		auto s		= _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + n));
+		auto d		= _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest + n));
+
+		auto a		= _mm_shufflehi_epi16(_mm_shufflelo_epi16(s, 0xFF), 0xFF);
+		auto inv	= _mm_sub_epi16(one, a);
+		s			= _mm_min_epu16(s, a); // Overflow guard, see the 8 bit kernel.
+
+		auto lo		= _mm_mullo_epi16(d, inv);
+		auto hi		= _mm_mulhi_epu16(d, inv);
+
+		auto t0		= _mm_add_epi32(_mm_unpacklo_epi16(lo, hi), half);
+		auto t1		= _mm_add_epi32(_mm_unpackhi_epi16(lo, hi), half);
+
+		t0			= _mm_srli_epi32(_mm_add_epi32(t0, _mm_srli_epi32(t0, 16)), 16);
+		t1			= _mm_srli_epi32(_mm_add_epi32(t1, _mm_srli_epi32(t1, 16)), 16);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + n), _mm_adds_epu16(s, _mm_packus_epi32(t0, t1)));
+	}
+
+	blend16_c(dest + n, source + n, count - n);
+}
+
+CASPAR_TARGET_AVX2 void blend16_avx2(std::uint16_t* dest, const std::uint16_t* source, std::size_t count)
+{
+	const auto one		= _mm256_set1_epi16(-1);
+	const auto half		= _mm256_set1_epi32(0x8000);
+
+	std::size_t n = 0;
+
+	for (; n + 16 <= count; n += 16)
+	{
+		auto s		= _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + n));
+		auto d		= _mm256_loadu_si256(reinterpret_cast<const __m256i*>(dest + n));
+
+		auto a		= _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(s, 0xFF), 0xFF);
+		auto inv	= _mm256_sub_epi16(one, a);
+		s			= _mm256_min_epu16(s, a);
+
+		auto lo		= _mm256_mullo_epi16(d, inv);
+		auto hi		= _mm256_mulhi_epu16(d, inv);
+
+		// Unpack and pack both work within 128 bit lanes so the order is preserved.
+		auto t0		= _mm256_add_epi32(_mm256_unpacklo_epi16(lo, hi), half);
+		auto t1		= _mm256_add_epi32(_mm256_unpackhi_epi16(lo, hi), half);
+
+		t0			= _mm256_srli_epi32(_mm256_add_epi32(t0, _mm256_srli_epi32(t0, 16)), 16);
+		t1			= _mm256_srli_epi32(_mm256_add_epi32(t1, _mm256_srli_epi32(t1, 16)), 16);
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + n), _mm256_adds_epu16(s, _mm256_packus_epi32(t0, t1)));
+	}
+
+	blend16_sse(dest + n, source + n, count - n);
+}
+
+bool detect_avx2()
+{
+#if defined(_MSC_VER)
+	int info[4];
+
+	__cpuid(info, 1);
+
+	bool os_saves_ymm = (info[2] & (1 << 27)) && (_xgetbv(0) & 0x6) == 0x6;
+
+	if (!os_saves_ymm)
+		return false;
+
+	__cpuidex(info, 7, 0);
+
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+
+}
+
+bool blend16_uses_avx2()
+{
+	static const bool avx2 = detect_avx2();
+
+	return avx2;
+}
+
+void blend16(std::uint16_t* dest, const std::uint16_t* source, std::size_t count)
+{
+	if (blend16_uses_avx2())
+		blend16_avx2(dest, source, count);
+	else
+		blend16_sse(dest, source, count);
+}
+
+void expand8to16(std::uint16_t* dest, const std::uint8_t* source, std::size_t count)
+{
+	const auto zero = _mm_setzero_si128();
+
+	std::size_t n = 0;
+
+	for (; n + 16 <= count; n += 16)
+	{
+		auto s	= _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + n));
+		auto lo	= _mm_unpacklo_epi8(s, zero);
+		auto hi	= _mm_unpackhi_epi8(s, zero);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + n + 0), _mm_or_si128(lo, _mm_slli_epi16(lo, 8)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + n + 8), _mm_or_si128(hi, _mm_slli_epi16(hi, 8)));
+	}
+
+	for (; n < count; ++n)
+		dest[n] = static_cast<std::uint16_t>(source[n] * 257);
+}
+
+void reduce16to8(std::uint8_t* dest, const std::uint16_t* source, std::size_t count)
+{
+	// round(X / 257) = (((X * 0xFF01) >> 16) + 0x80) >> 8, exact for all 16 bit X.
+	const auto scale	= _mm_set1_epi16(static_cast<short>(0xFF01));
+	const auto half		= _mm_set1_epi16(0x80);
+
+	std::size_t n = 0;
+
+	for (; n + 16 <= count; n += 16)
+	{
+		auto s0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + n + 0));
+		auto s1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + n + 8));
+
+		s0 = _mm_srli_epi16(_mm_add_epi16(_mm_mulhi_epu16(s0, scale), half), 8);
+		s1 = _mm_srli_epi16(_mm_add_epi16(_mm_mulhi_epu16(s1, scale), half), 8);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + n), _mm_packus_epi16(s0, s1));
+	}
+
+	for (; n < count; ++n)
+		dest[n] = static_cast<std::uint8_t>((((source[n] * 0xFF01u) >> 16) + 0x80) >> 8);
+}
+
+}}}
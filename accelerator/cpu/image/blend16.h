@@ -0,0 +1,43 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace caspar { namespace accelerator { namespace cpu {
+
+// 16 bits per component premultiplied bgra kernels. Counts are in components,
+// i.e. four per pixel.
+
+// dest = source + dest * (1 - source[A]), correctly rounded.
+void blend16(std::uint16_t* dest, const std::uint16_t* source, std::size_t count);
+
+// Exact 8 -> 16 bit expansion (x * 257).
+void expand8to16(std::uint16_t* dest, const std::uint8_t* source, std::size_t count);
+
+// Rounded 16 -> 8 bit reduction (x / 257).
+void reduce16to8(std::uint8_t* dest, const std::uint16_t* source, std::size_t count);
+
+// Whether blend16 uses 256 bit wide vectors on this machine.
+bool blend16_uses_avx2();
+
+}}}
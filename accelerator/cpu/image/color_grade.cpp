@@ -0,0 +1,376 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../../StdAfx.h"
+
+#include "color_grade.h"
+#include "blend16.h"
+
+#include <core/frame/color_lut.h>
+
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <array>
+
+#ifdef WIN32
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#define CASPAR_TARGET_AVX2
+#else
+#define CASPAR_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace caspar { namespace accelerator { namespace cpu {
+
+namespace {
+
+// A lookup table with its domain folded into a scale and offset to grid
+// coordinates. Strides are in floats.
+struct grade_table
+{
+	const float*			table;
+	int						size;
+	int						stride_g;
+	int						stride_b;
+	float					max_index;
+	std::array<float, 3>	scale;
+	std::array<float, 3>	offset;
+	float					weight;
+};
+
+// The scalar and AVX2 kernels do the same float operations in the same order
+// and give identical results.
+struct grade_tables
+{
+	float						identity	= 1.0f;
+	int							count		= 0;
+	std::array<grade_table, 2>	tables;
+
+	explicit grade_tables(const core::color_grade& grade)
+	{
+		double identity_weight = 1.0;
+
+		if (grade.lut)
+		{
+			add(*grade.lut, grade.mix);
+			identity_weight -= grade.mix;
+		}
+
+		if (grade.from)
+		{
+			add(*grade.from, grade.from_mix);
+			identity_weight -= grade.from_mix;
+		}
+
+		identity = static_cast<float>(identity_weight);
+	}
+
+	void add(const core::color_lut& lut, double weight)
+	{
+		auto& t = tables[count++];
+
+		t.table		= lut.table.data();
+		t.size		= lut.size;
+		t.stride_g	= lut.size * 3;
+		t.stride_b	= lut.size * lut.size * 3;
+		t.max_index	= static_cast<float>(lut.size - 1);
+		t.weight	= static_cast<float>(weight);
+
+		for (int n = 0; n < 3; ++n)
+		{
+			auto scale = (lut.size - 1) / (static_cast<double>(lut.domain_max[n]) - lut.domain_min[n]);
+
+			t.scale[n]	= static_cast<float>(scale);
+			t.offset[n]	= static_cast<float>(-lut.domain_min[n] * scale);
+		}
+	}
+};
+
+inline float grid_coordinate(const grade_table& t, int axis, float value, int& index)
+{
+	auto x = std::min(std::max(value * t.scale[axis] + t.offset[axis], 0.0f), t.max_index);
+
+	index = std::min(static_cast<int>(x), t.size - 2);
+
+	return x - static_cast<float>(index);
+}
+
+// Splits the grid cell into six tetrahedra along its diagonal and picks the
+// one holding the point by the order of the fractions, walking from the base
+// corner along the largest fraction first.
+inline void tetrahedral(const grade_table& t, float r, float g, float b, float& out_r, float& out_g, float& out_b)
+{
+	int ir, ig, ib;
+
+	auto fr = grid_coordinate(t, 0, r, ir);
+	auto fg = grid_coordinate(t, 1, g, ig);
+	auto fb = grid_coordinate(t, 2, b, ib);
+
+	auto r_ge_g		= fr >= fg;
+	auto g_ge_b		= fg >= fb;
+	auto r_ge_b		= fr >= fb;
+
+	auto step_max	= r_ge_g && r_ge_b ? 3 : g_ge_b ? t.stride_g : t.stride_b;
+	auto step_min	= r_ge_b && g_ge_b ? t.stride_b : !r_ge_g && !r_ge_b ? 3 : t.stride_g;
+	auto corner		= 3 + t.stride_g + t.stride_b;
+
+	auto high		= std::max(std::max(fr, fg), fb);
+	auto low		= std::min(std::min(fr, fg), fb);
+	auto middle		= std::max(std::min(fr, fg), std::min(std::max(fr, fg), fb));
+
+	auto w0			= 1.0f - high;
+	auto w1			= high - middle;
+	auto w2			= middle - low;
+	auto w3			= low;
+
+	auto p0			= t.table + ir * 3 + ig * t.stride_g + ib * t.stride_b;
+	auto p1			= p0 + step_max;
+	auto p2			= p0 + corner - step_min;
+	auto p3			= p0 + corner;
+
+	out_r += t.weight * (((w0 * p0[0] + w1 * p1[0]) + w2 * p2[0]) + w3 * p3[0]);
+	out_g += t.weight * (((w0 * p0[1] + w1 * p1[1]) + w2 * p2[1]) + w3 * p3[1]);
+	out_b += t.weight * (((w0 * p0[2] + w1 * p1[2]) + w2 * p2[2]) + w3 * p3[2]);
+}
+
+inline int premultiply(float value, float alpha)
+{
+	return static_cast<int>(std::min(std::max(value, 0.0f), 1.0f) * alpha + 0.5f);
+}
+
+template<typename T>
+void grade_c(const grade_tables& t, const T* source, T* dest, std::size_t count)
+{
+	for (std::size_t n = 0; n < count * 4; n += 4)
+	{
+		if (source[n + 3] == 0)
+		{
+			std::copy(source + n, source + n + 4, dest + n);
+			continue;
+		}
+
+		float a				= source[n + 3];
+		float unpremultiply	= 1.0f / a;
+
+		auto r = std::min(source[n + 2] * unpremultiply, 1.0f);
+		auto g = std::min(source[n + 1] * unpremultiply, 1.0f);
+		auto b = std::min(source[n + 0] * unpremultiply, 1.0f);
+
+		auto out_r = t.identity * r;
+		auto out_g = t.identity * g;
+		auto out_b = t.identity * b;
+
+		for (int k = 0; k < t.count; ++k)
+			tetrahedral(t.tables[k], r, g, b, out_r, out_g, out_b);
+
+		dest[n + 0] = static_cast<T>(premultiply(out_b, a));
+		dest[n + 1] = static_cast<T>(premultiply(out_g, a));
+		dest[n + 2] = static_cast<T>(premultiply(out_r, a));
+		dest[n + 3] = source[n + 3];
+	}
+}
+
+CASPAR_TARGET_AVX2 inline __m256 grid_coordinate_avx2(const grade_table& t, int axis, __m256 value, __m256i& index)
+{
+	auto x = _mm256_min_ps(_mm256_max_ps(_mm256_add_ps(_mm256_mul_ps(value, _mm256_set1_ps(t.scale[axis])), _mm256_set1_ps(t.offset[axis])), _mm256_setzero_ps()), _mm256_set1_ps(t.max_index));
+
+	index = _mm256_min_epi32(_mm256_cvttps_epi32(x), _mm256_set1_epi32(t.size - 2));
+
+	return _mm256_sub_ps(x, _mm256_cvtepi32_ps(index));
+}
+
+CASPAR_TARGET_AVX2 inline __m256 vertex_avx2(const float* table, __m256i p0, __m256i p1, __m256i p2, __m256i p3, __m256 w0, __m256 w1, __m256 w2, __m256 w3)
+{
+	auto v = _mm256_mul_ps(w0, _mm256_i32gather_ps(table, p0, 4));
+
+	v = _mm256_add_ps(v, _mm256_mul_ps(w1, _mm256_i32gather_ps(table, p1, 4)));
+	v = _mm256_add_ps(v, _mm256_mul_ps(w2, _mm256_i32gather_ps(table, p2, 4)));
+
+	return _mm256_add_ps(v, _mm256_mul_ps(w3, _mm256_i32gather_ps(table, p3, 4)));
+}
+
+CASPAR_TARGET_AVX2 void tetrahedral_avx2(const grade_table& t, __m256 r, __m256 g, __m256 b, __m256& out_r, __m256& out_g, __m256& out_b)
+{
+	__m256i ir, ig, ib;
+
+	auto fr			= grid_coordinate_avx2(t, 0, r, ir);
+	auto fg			= grid_coordinate_avx2(t, 1, g, ig);
+	auto fb			= grid_coordinate_avx2(t, 2, b, ib);
+
+	auto r_ge_g		= _mm256_castps_si256(_mm256_cmp_ps(fr, fg, _CMP_GE_OQ));
+	auto g_ge_b		= _mm256_castps_si256(_mm256_cmp_ps(fg, fb, _CMP_GE_OQ));
+	auto r_ge_b		= _mm256_castps_si256(_mm256_cmp_ps(fr, fb, _CMP_GE_OQ));
+
+	auto step_r		= _mm256_set1_epi32(3);
+	auto step_g		= _mm256_set1_epi32(t.stride_g);
+	auto step_b		= _mm256_set1_epi32(t.stride_b);
+
+	auto r_max		= _mm256_and_si256(r_ge_g, r_ge_b);
+	auto r_min		= _mm256_andnot_si256(_mm256_or_si256(r_ge_g, r_ge_b), _mm256_set1_epi32(-1));
+	auto b_min		= _mm256_and_si256(r_ge_b, g_ge_b);
+
+	auto step_max	= _mm256_blendv_epi8(_mm256_blendv_epi8(step_b, step_g, g_ge_b), step_r, r_max);
+	auto step_min	= _mm256_blendv_epi8(_mm256_blendv_epi8(step_g, step_r, r_min), step_b, b_min);
+	auto corner		= _mm256_set1_epi32(3 + t.stride_g + t.stride_b);
+
+	auto high		= _mm256_max_ps(_mm256_max_ps(fr, fg), fb);
+	auto low		= _mm256_min_ps(_mm256_min_ps(fr, fg), fb);
+	auto middle		= _mm256_max_ps(_mm256_min_ps(fr, fg), _mm256_min_ps(_mm256_max_ps(fr, fg), fb));
+
+	auto w0			= _mm256_sub_ps(_mm256_set1_ps(1.0f), high);
+	auto w1			= _mm256_sub_ps(high, middle);
+	auto w2			= _mm256_sub_ps(middle, low);
+	auto w3			= low;
+
+	auto p0			= _mm256_add_epi32(_mm256_add_epi32(_mm256_mullo_epi32(ir, step_r), _mm256_mullo_epi32(ig, step_g)), _mm256_mullo_epi32(ib, step_b));
+	auto p1			= _mm256_add_epi32(p0, step_max);
+	auto p2			= _mm256_sub_epi32(_mm256_add_epi32(p0, corner), step_min);
+	auto p3			= _mm256_add_epi32(p0, corner);
+	auto weight		= _mm256_set1_ps(t.weight);
+
+	out_r = _mm256_add_ps(out_r, _mm256_mul_ps(weight, vertex_avx2(t.table + 0, p0, p1, p2, p3, w0, w1, w2, w3)));
+	out_g = _mm256_add_ps(out_g, _mm256_mul_ps(weight, vertex_avx2(t.table + 1, p0, p1, p2, p3, w0, w1, w2, w3)));
+	out_b = _mm256_add_ps(out_b, _mm256_mul_ps(weight, vertex_avx2(t.table + 2, p0, p1, p2, p3, w0, w1, w2, w3)));
+}
+
+CASPAR_TARGET_AVX2 inline __m256i premultiply_avx2(__m256 value, __m256 alpha)
+{
+	auto clamped = _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()), _mm256_set1_ps(1.0f));
+
+	return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(clamped, alpha), _mm256_set1_ps(0.5f)));
+}
+
+// Eight pixels with one component per 32 bit lane.
+CASPAR_TARGET_AVX2 void grade_pixels_avx2(const grade_tables& t, __m256i& bi, __m256i& gi, __m256i& ri, __m256i ai)
+{
+	const auto one = _mm256_set1_ps(1.0f);
+
+	auto a				= _mm256_cvtepi32_ps(ai);
+	auto transparent	= _mm256_cmpeq_epi32(ai, _mm256_setzero_si256());
+	auto unpremultiply	= _mm256_div_ps(one, _mm256_max_ps(a, one)); // Transparent pixels are restored below.
+
+	auto r = _mm256_min_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(ri), unpremultiply), one);
+	auto g = _mm256_min_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(gi), unpremultiply), one);
+	auto b = _mm256_min_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(bi), unpremultiply), one);
+
+	auto identity	= _mm256_set1_ps(t.identity);
+	auto out_r		= _mm256_mul_ps(identity, r);
+	auto out_g		= _mm256_mul_ps(identity, g);
+	auto out_b		= _mm256_mul_ps(identity, b);
+
+	for (int k = 0; k < t.count; ++k)
+		tetrahedral_avx2(t.tables[k], r, g, b, out_r, out_g, out_b);
+
+	ri = _mm256_blendv_epi8(premultiply_avx2(out_r, a), ri, transparent);
+	gi = _mm256_blendv_epi8(premultiply_avx2(out_g, a), gi, transparent);
+	bi = _mm256_blendv_epi8(premultiply_avx2(out_b, a), bi, transparent);
+}
+
+CASPAR_TARGET_AVX2 void grade_avx2(const grade_tables& t, const std::uint8_t* source, std::uint8_t* dest, std::size_t count)
+{
+	const auto mask = _mm256_set1_epi32(0xFF);
+
+	std::size_t n = 0;
+
+	for (; n + 8 <= count; n += 8)
+	{
+		auto pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + n * 4));
+
+		auto b = _mm256_and_si256(pixels, mask);
+		auto g = _mm256_and_si256(_mm256_srli_epi32(pixels, 8), mask);
+		auto r = _mm256_and_si256(_mm256_srli_epi32(pixels, 16), mask);
+		auto a = _mm256_srli_epi32(pixels, 24);
+
+		grade_pixels_avx2(t, b, g, r, a);
+
+		pixels = _mm256_or_si256(_mm256_or_si256(b, _mm256_slli_epi32(g, 8)), _mm256_or_si256(_mm256_slli_epi32(r, 16), _mm256_slli_epi32(a, 24)));
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + n * 4), pixels);
+	}
+
+	grade_c(t, source + n * 4, dest + n * 4, count - n);
+}
+
+CASPAR_TARGET_AVX2 void grade_avx2(const grade_tables& t, const std::uint16_t* source, std::uint16_t* dest, std::size_t count)
+{
+	const auto mask		= _mm256_set1_epi32(0xFFFF);
+	const auto split	= _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	const auto merge	= _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	std::size_t n = 0;
+
+	for (; n + 8 <= count; n += 8)
+	{
+		// Four pixels per register as bg and ra pairs, regrouped to one pair per pixel and lane.
+		auto v0 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + n * 4)), split);
+		auto v1 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + n * 4 + 16)), split);
+
+		auto bg = _mm256_permute2x128_si256(v0, v1, 0x20);
+		auto ra = _mm256_permute2x128_si256(v0, v1, 0x31);
+
+		auto b = _mm256_and_si256(bg, mask);
+		auto g = _mm256_srli_epi32(bg, 16);
+		auto r = _mm256_and_si256(ra, mask);
+		auto a = _mm256_srli_epi32(ra, 16);
+
+		grade_pixels_avx2(t, b, g, r, a);
+
+		bg = _mm256_or_si256(b, _mm256_slli_epi32(g, 16));
+		ra = _mm256_or_si256(r, _mm256_slli_epi32(a, 16));
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + n * 4), _mm256_permutevar8x32_epi32(_mm256_permute2x128_si256(bg, ra, 0x20), merge));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + n * 4 + 16), _mm256_permutevar8x32_epi32(_mm256_permute2x128_si256(bg, ra, 0x31), merge));
+	}
+
+	grade_c(t, source + n * 4, dest + n * 4, count - n);
+}
+
+template<typename T>
+void grade(const core::color_grade& grade, const T* source, T* dest, std::size_t count)
+{
+	const grade_tables t(grade);
+
+	tbb::parallel_for(tbb::blocked_range<std::size_t>(0, count, 16384), [&](const tbb::blocked_range<std::size_t>& r)
+	{
+		if (blend16_uses_avx2())
+			grade_avx2(t, source + r.begin() * 4, dest + r.begin() * 4, r.size());
+		else
+			grade_c(t, source + r.begin() * 4, dest + r.begin() * 4, r.size());
+	});
+}
+
+}
+
+void color_grade(const core::color_grade& grade, const std::uint8_t* source, std::uint8_t* dest, std::size_t count)
+{
+	cpu::grade(grade, source, dest, count);
+}
+
+void color_grade(const core::color_grade& grade, const std::uint16_t* source, std::uint16_t* dest, std::size_t count)
+{
+	cpu::grade(grade, source, dest, count);
+}
+
+}}}
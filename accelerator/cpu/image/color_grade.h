@@ -0,0 +1,36 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <core/frame/frame_transform.h>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace caspar { namespace accelerator { namespace cpu {
+
+// Grades premultiplied bgra images through the 3D lookup tables of a colour
+// grade with tetrahedral interpolation, weighted against the input by the mix
+// amounts. Counts are in pixels and source may equal dest.
+void color_grade(const core::color_grade& grade, const std::uint8_t* source, std::uint8_t* dest, std::size_t count);
+void color_grade(const core::color_grade& grade, const std::uint16_t* source, std::uint16_t* dest, std::size_t count);
+
+}}}
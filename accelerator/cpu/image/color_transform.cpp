@@ -0,0 +1,600 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "../../StdAfx.h"
+
+#include "color_transform.h"
+#include "blend16.h"
+
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+#ifdef WIN32
+#include <intrin.h>
+#else
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER)
+#define CASPAR_TARGET_AVX2
+#else
+#define CASPAR_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace caspar { namespace accelerator { namespace cpu {
+
+namespace {
+
+const double	reference_white	= 203.0;	// cd/m2, ITU-R BT.2408.
+const double	pq_peak			= 10000.0;
+const double	hlg_peak		= 1000.0;	// The nominal display of ITU-R BT.2100.
+const double	hlg_gamma		= 1.2;
+const double	tone_map_knee	= 0.75;		// Of the target peak.
+const int		lut_size		= 65536;
+
+const double	pq_m1			= 2610.0 / 16384.0;
+const double	pq_m2			= 2523.0 / 4096.0 * 128.0;
+const double	pq_c1			= 3424.0 / 4096.0;
+const double	pq_c2			= 2413.0 / 4096.0 * 32.0;
+const double	pq_c3			= 2392.0 / 4096.0 * 32.0;
+
+const double	hlg_a			= 0.17883277;
+const double	hlg_b			= 1.0 - 4.0 * hlg_a;
+const double	hlg_c			= 0.5 - hlg_a * std::log(4.0 * hlg_a);
+
+typedef std::array<double, 9> matrix3;
+
+// Signal to linear light. HLG gives scene light, the OOTF is applied on the
+// luminance afterwards.
+double decode(core::color_transfer transfer, double signal)
+{
+	switch (transfer)
+	{
+	case core::color_transfer::pq:
+	{
+		auto p = std::pow(signal, 1.0 / pq_m2);
+
+		return std::pow(std::max(p - pq_c1, 0.0) / (pq_c2 - pq_c3 * p), 1.0 / pq_m1) * pq_peak / reference_white;
+	}
+	case core::color_transfer::hlg:
+		return signal <= 0.5 ? signal * signal / 3.0 : (std::exp((signal - hlg_c) / hlg_a) + hlg_b) / 12.0;
+	default:
+		return std::pow(signal, 2.4);
+	}
+}
+
+double encode(core::color_transfer transfer, double linear)
+{
+	switch (transfer)
+	{
+	case core::color_transfer::pq:
+	{
+		auto p = std::pow(linear * reference_white / pq_peak, pq_m1);
+
+		return std::pow((pq_c1 + pq_c2 * p) / (1.0 + pq_c3 * p), pq_m2);
+	}
+	case core::color_transfer::hlg:
+		return linear <= 1.0 / 12.0 ? std::sqrt(3.0 * linear) : hlg_a * std::log(12.0 * linear - hlg_b) + hlg_c;
+	default:
+		return std::pow(linear, 1.0 / 2.4);
+	}
+}
+
+// Brightest displayed value, relative to reference white.
+double display_peak(core::color_transfer transfer)
+{
+	switch (transfer)
+	{
+	case core::color_transfer::pq:	return pq_peak / reference_white;
+	case core::color_transfer::hlg:	return hlg_peak / reference_white;
+	default:						return 1.0;
+	}
+}
+
+matrix3 multiply(const matrix3& a, const matrix3& b)
+{
+	matrix3 result;
+
+	for (int row = 0; row < 3; ++row)
+		for (int col = 0; col < 3; ++col)
+			result[row * 3 + col] = a[row * 3] * b[col] + a[row * 3 + 1] * b[3 + col] + a[row * 3 + 2] * b[6 + col];
+
+	return result;
+}
+
+matrix3 invert(const matrix3& m)
+{
+	auto det =	m[0] * (m[4] * m[8] - m[5] * m[7]) -
+				m[1] * (m[3] * m[8] - m[5] * m[6]) +
+				m[2] * (m[3] * m[7] - m[4] * m[6]);
+
+	return matrix3 {{
+		(m[4] * m[8] - m[5] * m[7]) / det, (m[2] * m[7] - m[1] * m[8]) / det, (m[1] * m[5] - m[2] * m[4]) / det,
+		(m[5] * m[6] - m[3] * m[8]) / det, (m[0] * m[8] - m[2] * m[6]) / det, (m[2] * m[3] - m[0] * m[5]) / det,
+		(m[3] * m[7] - m[4] * m[6]) / det, (m[1] * m[6] - m[0] * m[7]) / det, (m[0] * m[4] - m[1] * m[3]) / det
+	}};
+}
+
+// Linear rgb to CIE XYZ for D65 white, the middle row being the luminance.
+matrix3 rgb_to_xyz(core::color_space space)
+{
+	std::array<double, 6> xy = space == core::color_space::bt2020
+			? std::array<double, 6> {{ 0.708, 0.292, 0.170, 0.797, 0.131, 0.046 }}
+			: std::array<double, 6> {{ 0.640, 0.330, 0.300, 0.600, 0.150, 0.060 }};
+
+	const double white_x = 0.3127;
+	const double white_y = 0.3290;
+
+	matrix3 primaries;
+
+	for (int n = 0; n < 3; ++n)
+	{
+		primaries[n]		= xy[n * 2] / xy[n * 2 + 1];
+		primaries[3 + n]	= 1.0;
+		primaries[6 + n]	= (1.0 - xy[n * 2] - xy[n * 2 + 1]) / xy[n * 2 + 1];
+	}
+
+	auto scale = multiply(invert(primaries), matrix3 {{ white_x / white_y, 0, 0, 1.0, 0, 0, (1.0 - white_x - white_y) / white_y, 0, 0 }});
+
+	for (int row = 0; row < 3; ++row)
+		for (int col = 0; col < 3; ++col)
+			primaries[row * 3 + col] *= scale[col * 3];
+
+	return primaries;
+}
+
+// Lookups of linear values are indexed by the square root of the value
+// relative to the peak, which spends the entries where the eye needs them.
+inline int lut_index(float value, float inv_peak, float scale)
+{
+	auto s = std::sqrt(std::min(std::max(value * inv_peak, 0.0f), 1.0f));
+
+	return static_cast<int>(s * scale + 0.5f);
+}
+
+inline double lut_value(int index, double peak)
+{
+	auto s = index / static_cast<double>(lut_size - 1);
+
+	return s * s * peak;
+}
+
+// The scalar and AVX2 kernels do the same float operations in the same order
+// and give identical results.
+struct lookup_tables
+{
+	float						max_value;
+	float						lut_scale			= static_cast<float>(lut_size - 1);
+
+	std::vector<float>			decode;
+
+	bool						source_ootf			= false;
+	std::array<float, 3>		source_luma;
+	std::vector<float>			source_gain;
+
+	bool						convert_primaries	= false;
+	std::array<float, 9>		primaries;
+	std::array<float, 3>		target_luma;
+
+	bool						tone_map			= false;
+	float						tone_inv_peak		= 1.0f;
+	std::vector<float>			tone_ratio;
+
+	bool						target_ootf			= false;
+	float						target_inv_peak		= 1.0f;
+	std::vector<float>			target_gain;
+
+	float						encode_inv_peak;
+	float						encode_scale;
+	std::vector<std::uint16_t>	encode;
+
+	lookup_tables(core::color_space from_space, core::color_transfer from_transfer, core::color_space to_space, core::color_transfer to_transfer, int bit_depth);
+
+	void apply(float& r, float& g, float& b) const
+	{
+		if (source_ootf)
+		{
+			auto y		= (source_luma[0] * r + source_luma[1] * g) + source_luma[2] * b;
+			auto gain	= source_gain[lut_index(y, 1.0f, lut_scale)];
+
+			r *= gain;
+			g *= gain;
+			b *= gain;
+		}
+
+		if (convert_primaries)
+		{
+			auto r2		= (primaries[0] * r + primaries[1] * g) + primaries[2] * b;
+			auto g2		= (primaries[3] * r + primaries[4] * g) + primaries[5] * b;
+			auto b2		= (primaries[6] * r + primaries[7] * g) + primaries[8] * b;
+
+			// Desaturate out of gamut colours towards their luminance.
+			auto y		= std::max((target_luma[0] * r2 + target_luma[1] * g2) + target_luma[2] * b2, 0.0f);
+			auto low	= std::min(std::min(r2, g2), b2);
+			auto t		= low < 0.0f ? y / std::max(y - low, 1e-20f) : 1.0f;
+
+			r = y + (r2 - y) * t;
+			g = y + (g2 - y) * t;
+			b = y + (b2 - y) * t;
+		}
+
+		if (tone_map)
+		{
+			auto ratio	= tone_ratio[lut_index(std::max(std::max(r, g), b), tone_inv_peak, lut_scale)];
+
+			r *= ratio;
+			g *= ratio;
+			b *= ratio;
+		}
+
+		if (target_ootf)
+		{
+			auto y		= (target_luma[0] * r + target_luma[1] * g) + target_luma[2] * b;
+			auto gain	= target_gain[lut_index(y, target_inv_peak, lut_scale)];
+
+			r *= gain;
+			g *= gain;
+			b *= gain;
+		}
+	}
+};
+
+template<typename T>
+void transform_c(const lookup_tables& t, const T* source, T* dest, std::size_t count)
+{
+	for (std::size_t n = 0; n < count * 4; n += 4)
+	{
+		if (source[n + 3] == 0)
+		{
+			std::copy(source + n, source + n + 4, dest + n);
+			continue;
+		}
+
+		float a				= source[n + 3];
+		float unpremultiply	= t.max_value / a;
+		float premultiply	= a / t.max_value;
+
+		auto r = t.decode[static_cast<int>(std::min(source[n + 2] * unpremultiply + 0.5f, t.max_value))];
+		auto g = t.decode[static_cast<int>(std::min(source[n + 1] * unpremultiply + 0.5f, t.max_value))];
+		auto b = t.decode[static_cast<int>(std::min(source[n + 0] * unpremultiply + 0.5f, t.max_value))];
+
+		t.apply(r, g, b);
+
+		dest[n + 0] = static_cast<T>(static_cast<int>(t.encode[lut_index(b, t.encode_inv_peak, t.encode_scale)] * premultiply + 0.5f));
+		dest[n + 1] = static_cast<T>(static_cast<int>(t.encode[lut_index(g, t.encode_inv_peak, t.encode_scale)] * premultiply + 0.5f));
+		dest[n + 2] = static_cast<T>(static_cast<int>(t.encode[lut_index(r, t.encode_inv_peak, t.encode_scale)] * premultiply + 0.5f));
+		dest[n + 3] = source[n + 3];
+	}
+}
+
+CASPAR_TARGET_AVX2 inline __m256i lut_index_avx2(__m256 value, float inv_peak, float scale)
+{
+	auto s = _mm256_sqrt_ps(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(value, _mm256_set1_ps(inv_peak)), _mm256_setzero_ps()), _mm256_set1_ps(1.0f)));
+
+	return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(s, _mm256_set1_ps(scale)), _mm256_set1_ps(0.5f)));
+}
+
+CASPAR_TARGET_AVX2 inline __m256 luma_avx2(const std::array<float, 3>& weights, __m256 r, __m256 g, __m256 b)
+{
+	return _mm256_add_ps(
+			_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(weights[0]), r), _mm256_mul_ps(_mm256_set1_ps(weights[1]), g)),
+			_mm256_mul_ps(_mm256_set1_ps(weights[2]), b));
+}
+
+CASPAR_TARGET_AVX2 inline __m256 row_avx2(const float* row, __m256 r, __m256 g, __m256 b)
+{
+	return _mm256_add_ps(
+			_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(row[0]), r), _mm256_mul_ps(_mm256_set1_ps(row[1]), g)),
+			_mm256_mul_ps(_mm256_set1_ps(row[2]), b));
+}
+
+CASPAR_TARGET_AVX2 inline __m256 decode_avx2(const lookup_tables& t, __m256i component, __m256 unpremultiply)
+{
+	auto index = _mm256_cvttps_epi32(_mm256_min_ps(
+			_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(component), unpremultiply), _mm256_set1_ps(0.5f)),
+			_mm256_set1_ps(t.max_value)));
+
+	return _mm256_i32gather_ps(t.decode.data(), index, 4);
+}
+
+CASPAR_TARGET_AVX2 inline __m256i encode_avx2(const lookup_tables& t, __m256 linear, __m256 premultiply)
+{
+	auto index		= lut_index_avx2(linear, t.encode_inv_peak, t.encode_scale);
+	auto encoded	= _mm256_and_si256(_mm256_i32gather_epi32(reinterpret_cast<const int*>(t.encode.data()), index, 2), _mm256_set1_epi32(0xFFFF));
+
+	return _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(encoded), premultiply), _mm256_set1_ps(0.5f)));
+}
+
+CASPAR_TARGET_AVX2 inline void scale_avx2(__m256& r, __m256& g, __m256& b, __m256 factor)
+{
+	r = _mm256_mul_ps(r, factor);
+	g = _mm256_mul_ps(g, factor);
+	b = _mm256_mul_ps(b, factor);
+}
+
+// Eight pixels with one component per 32 bit lane.
+CASPAR_TARGET_AVX2 void transform_pixels_avx2(const lookup_tables& t, __m256i& bi, __m256i& gi, __m256i& ri, __m256i ai)
+{
+	const auto zero			= _mm256_setzero_ps();
+	const auto one			= _mm256_set1_ps(1.0f);
+	const auto max_value	= _mm256_set1_ps(t.max_value);
+
+	auto a				= _mm256_cvtepi32_ps(ai);
+	auto transparent	= _mm256_cmpeq_epi32(ai, _mm256_setzero_si256());
+	auto opaque			= _mm256_movemask_ps(_mm256_cmp_ps(a, max_value, _CMP_EQ_OQ)) == 0xFF;
+	auto unpremultiply	= opaque ? one : _mm256_div_ps(max_value, _mm256_max_ps(a, one)); // Transparent pixels are restored below.
+	auto premultiply	= opaque ? one : _mm256_div_ps(a, max_value);
+
+	auto r = decode_avx2(t, ri, unpremultiply);
+	auto g = decode_avx2(t, gi, unpremultiply);
+	auto b = decode_avx2(t, bi, unpremultiply);
+
+	if (t.source_ootf)
+	{
+		auto index = lut_index_avx2(luma_avx2(t.source_luma, r, g, b), 1.0f, t.lut_scale);
+
+		scale_avx2(r, g, b, _mm256_i32gather_ps(t.source_gain.data(), index, 4));
+	}
+
+	if (t.convert_primaries)
+	{
+		auto r2		= row_avx2(&t.primaries[0], r, g, b);
+		auto g2		= row_avx2(&t.primaries[3], r, g, b);
+		auto b2		= row_avx2(&t.primaries[6], r, g, b);
+
+		auto y		= _mm256_max_ps(luma_avx2(t.target_luma, r2, g2, b2), zero);
+		auto low	= _mm256_min_ps(_mm256_min_ps(r2, g2), b2);
+		auto s		= _mm256_div_ps(y, _mm256_max_ps(_mm256_sub_ps(y, low), _mm256_set1_ps(1e-20f)));
+		auto f		= _mm256_blendv_ps(one, s, _mm256_cmp_ps(low, zero, _CMP_LT_OQ));
+
+		r = _mm256_add_ps(y, _mm256_mul_ps(_mm256_sub_ps(r2, y), f));
+		g = _mm256_add_ps(y, _mm256_mul_ps(_mm256_sub_ps(g2, y), f));
+		b = _mm256_add_ps(y, _mm256_mul_ps(_mm256_sub_ps(b2, y), f));
+	}
+
+	if (t.tone_map)
+	{
+		auto index = lut_index_avx2(_mm256_max_ps(_mm256_max_ps(r, g), b), t.tone_inv_peak, t.lut_scale);
+
+		scale_avx2(r, g, b, _mm256_i32gather_ps(t.tone_ratio.data(), index, 4));
+	}
+
+	if (t.target_ootf)
+	{
+		auto index = lut_index_avx2(luma_avx2(t.target_luma, r, g, b), t.target_inv_peak, t.lut_scale);
+
+		scale_avx2(r, g, b, _mm256_i32gather_ps(t.target_gain.data(), index, 4));
+	}
+
+	ri = _mm256_blendv_epi8(encode_avx2(t, r, premultiply), ri, transparent);
+	gi = _mm256_blendv_epi8(encode_avx2(t, g, premultiply), gi, transparent);
+	bi = _mm256_blendv_epi8(encode_avx2(t, b, premultiply), bi, transparent);
+}
+
+CASPAR_TARGET_AVX2 void transform_avx2(const lookup_tables& t, const std::uint8_t* source, std::uint8_t* dest, std::size_t count)
+{
+	const auto mask = _mm256_set1_epi32(0xFF);
+
+	std::size_t n = 0;
+
+	for (; n + 8 <= count; n += 8)
+	{
+		auto pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + n * 4));
+
+		auto b = _mm256_and_si256(pixels, mask);
+		auto g = _mm256_and_si256(_mm256_srli_epi32(pixels, 8), mask);
+		auto r = _mm256_and_si256(_mm256_srli_epi32(pixels, 16), mask);
+		auto a = _mm256_srli_epi32(pixels, 24);
+
+		transform_pixels_avx2(t, b, g, r, a);
+
+		pixels = _mm256_or_si256(_mm256_or_si256(b, _mm256_slli_epi32(g, 8)), _mm256_or_si256(_mm256_slli_epi32(r, 16), _mm256_slli_epi32(a, 24)));
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + n * 4), pixels);
+	}
+
+	transform_c(t, source + n * 4, dest + n * 4, count - n);
+}
+
+CASPAR_TARGET_AVX2 void transform_avx2(const lookup_tables& t, const std::uint16_t* source, std::uint16_t* dest, std::size_t count)
+{
+	const auto mask		= _mm256_set1_epi32(0xFFFF);
+	const auto split	= _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7);
+	const auto merge	= _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+	std::size_t n = 0;
+
+	for (; n + 8 <= count; n += 8)
+	{
+		// Four pixels per register as bg and ra pairs, regrouped to one pair per pixel and lane.
+		auto v0 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + n * 4)), split);
+		auto v1 = _mm256_permutevar8x32_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + n * 4 + 16)), split);
+
+		auto bg = _mm256_permute2x128_si256(v0, v1, 0x20);
+		auto ra = _mm256_permute2x128_si256(v0, v1, 0x31);
+
+		auto b = _mm256_and_si256(bg, mask);
+		auto g = _mm256_srli_epi32(bg, 16);
+		auto r = _mm256_and_si256(ra, mask);
+		auto a = _mm256_srli_epi32(ra, 16);
+
+		transform_pixels_avx2(t, b, g, r, a);
+
+		bg = _mm256_or_si256(b, _mm256_slli_epi32(g, 16));
+		ra = _mm256_or_si256(r, _mm256_slli_epi32(a, 16));
+
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + n * 4), _mm256_permutevar8x32_epi32(_mm256_permute2x128_si256(bg, ra, 0x20), merge));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + n * 4 + 16), _mm256_permutevar8x32_epi32(_mm256_permute2x128_si256(bg, ra, 0x31), merge));
+	}
+
+	transform_c(t, source + n * 4, dest + n * 4, count - n);
+}
+
+template<typename T>
+void transform(const lookup_tables& t, const T* source, T* dest, std::size_t count)
+{
+	tbb::parallel_for(tbb::blocked_range<std::size_t>(0, count, 16384), [&](const tbb::blocked_range<std::size_t>& r)
+	{
+		if (blend16_uses_avx2())
+			transform_avx2(t, source + r.begin() * 4, dest + r.begin() * 4, r.size());
+		else
+			transform_c(t, source + r.begin() * 4, dest + r.begin() * 4, r.size());
+	});
+}
+
+lookup_tables::lookup_tables(core::color_space from_space, core::color_transfer from_transfer, core::color_space to_space, core::color_transfer to_transfer, int bit_depth)
+{
+	max_value = bit_depth > 8 ? 65535.0f : 255.0f;
+
+	decode.resize(static_cast<int>(max_value) + 1);
+
+	for (int n = 0; n < static_cast<int>(decode.size()); ++n)
+		decode[n] = static_cast<float>(cpu::decode(from_transfer, n / static_cast<double>(max_value)));
+
+	auto from_xyz		= rgb_to_xyz(from_space);
+	auto to_xyz			= rgb_to_xyz(to_space);
+	auto source_peak	= display_peak(from_transfer);
+	auto target_peak	= display_peak(to_transfer);
+
+	for (int n = 0; n < 3; ++n)
+	{
+		source_luma[n] = static_cast<float>(from_xyz[3 + n]);
+		target_luma[n] = static_cast<float>(to_xyz[3 + n]);
+	}
+
+	if (from_transfer == core::color_transfer::hlg)
+	{
+		source_ootf = true;
+		source_gain.resize(lut_size);
+
+		for (int n = 1; n < lut_size; ++n)
+			source_gain[n] = static_cast<float>(hlg_peak / reference_white * std::pow(lut_value(n, 1.0), hlg_gamma - 1.0));
+	}
+
+	if ((from_space == core::color_space::bt2020) != (to_space == core::color_space::bt2020))
+	{
+		auto matrix = multiply(invert(to_xyz), from_xyz);
+
+		convert_primaries = true;
+
+		for (int n = 0; n < 9; ++n)
+			primaries[n] = static_cast<float>(matrix[n]);
+	}
+
+	if (source_peak > target_peak * 1.0001)
+	{
+		// Linear up to the knee, then an exponential shoulder towards the target peak.
+		auto knee = tone_map_knee * target_peak;
+
+		// A primaries conversion can take components above the source peak.
+		auto domain = source_peak;
+
+		if (convert_primaries)
+		{
+			for (int row = 0; row < 3; ++row)
+				domain = std::max(domain, source_peak * (std::max(primaries[row * 3], 0.0f) + std::max(primaries[row * 3 + 1], 0.0f) + std::max(primaries[row * 3 + 2], 0.0f)));
+		}
+
+		tone_map		= true;
+		tone_inv_peak	= static_cast<float>(1.0 / domain);
+		tone_ratio.resize(lut_size);
+
+		for (int n = 0; n < lut_size; ++n)
+		{
+			auto m = lut_value(n, domain);
+			auto f = m <= knee ? m : knee + (target_peak - knee) * (1.0 - std::exp(-(m - knee) / (target_peak - knee)));
+
+			tone_ratio[n] = static_cast<float>(m > 0.0 ? f / m : 1.0);
+		}
+	}
+
+	auto encode_peak = target_peak;
+
+	if (to_transfer == core::color_transfer::hlg)
+	{
+		// The inverse OOTF gives scene light in the 0 to 1 range.
+		target_ootf		= true;
+		target_inv_peak	= static_cast<float>(1.0 / target_peak);
+		target_gain.resize(lut_size);
+		encode_peak		= 1.0;
+
+		for (int n = 1; n < lut_size; ++n)
+			target_gain[n] = static_cast<float>(reference_white / hlg_peak * std::pow(lut_value(n, 1.0), (1.0 - hlg_gamma) / hlg_gamma));
+
+		target_gain[0] = target_gain[1];
+	}
+
+	auto encode_size = bit_depth > 8 ? lut_size : 4096;
+
+	encode_inv_peak	= static_cast<float>(1.0 / encode_peak);
+	encode_scale	= static_cast<float>(encode_size - 1);
+	encode.resize(encode_size + 1); // The AVX2 kernel reads 32 bits at the last entry.
+
+	for (int n = 0; n < encode_size; ++n)
+	{
+		auto s		= n / static_cast<double>(encode_size - 1);
+		auto value	= cpu::encode(to_transfer, s * s * encode_peak) * max_value + 0.5;
+
+		encode[n] = static_cast<std::uint16_t>(std::min(std::max(value, 0.0), static_cast<double>(max_value)));
+	}
+}
+
+}
+
+struct color_transform::impl
+{
+	lookup_tables tables;
+
+	impl(core::color_space from_space, core::color_transfer from_transfer, core::color_space to_space, core::color_transfer to_transfer, int bit_depth)
+		: tables(from_space, from_transfer, to_space, to_transfer, bit_depth)
+	{
+	}
+};
+
+color_transform::color_transform(
+		core::color_space from_space,
+		core::color_transfer from_transfer,
+		core::color_space to_space,
+		core::color_transfer to_transfer,
+		int bit_depth)
+	: impl_(new impl(from_space, from_transfer, to_space, to_transfer, bit_depth))
+{
+}
+
+color_transform::~color_transform()
+{
+}
+
+void color_transform::operator()(const std::uint8_t* source, std::uint8_t* dest, std::size_t count) const
+{
+	transform(impl_->tables, source, dest, count);
+}
+
+void color_transform::operator()(const std::uint16_t* source, std::uint16_t* dest, std::size_t count) const
+{
+	transform(impl_->tables, source, dest, count);
+}
+
+}}}
@@ -0,0 +1,58 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <common/memory.h>
+
+#include <core/frame/color_space.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace caspar { namespace accelerator { namespace cpu {
+
+// Converts premultiplied bgra images between resolved colour spaces and
+// transfer functions. The colour is decoded to linear light with SDR reference
+// white at 1.0 (203 cd/m2, ITU-R BT.2408), converted between the primaries
+// with out of gamut colours desaturated towards their luminance, tone mapped
+// when the source peak is above the target peak and encoded again. Counts are
+// in pixels and source may equal dest.
+class color_transform : boost::noncopyable
+{
+public:
+	color_transform(
+			core::color_space from_space,
+			core::color_transfer from_transfer,
+			core::color_space to_space,
+			core::color_transfer to_transfer,
+			int bit_depth);
+	~color_transform();
+
+	void operator()(const std::uint8_t* source, std::uint8_t* dest, std::size_t count) const;
+	void operator()(const std::uint16_t* source, std::uint16_t* dest, std::size_t count) const;
+private:
+	struct impl;
+	spl::unique_ptr<impl> impl_;
+};
+
+}}}
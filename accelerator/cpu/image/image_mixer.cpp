@@ -22,6 +22,9 @@
 #include "../../StdAfx.h"
 
 #include "image_mixer.h"
+#include "blend16.h"
+#include "color_grade.h"
+#include "color_transform.h"
 
 #include "../util/xmm.h"
 
@@ -29,7 +32,9 @@
 #include <common/gl/gl_check.h>
 #include <common/future.h>
 #include <common/array.h>
+#include <common/except.h>
 
+#include <core/frame/color_space.h>
 #include <core/frame/frame.h>
 #include <core/frame/frame_transform.h>
 #include <core/frame/pixel_format.h>
@@ -43,14 +48,19 @@
 #include <tbb/parallel_for_each.h>
 #include <tbb/concurrent_queue.h>
 
+#include <boost/lexical_cast.hpp>
 #include <boost/range/algorithm_ext/erase.hpp>
 #include <boost/thread/future.hpp>
 
 #include <algorithm>
 #include <cstdint>
+#include <limits>
 #include <vector>
+#include <map>
+#include <mutex>
 #include <set>
 #include <array>
+#include <tuple>
 
 #if defined(_MSC_VER)
 #pragma warning (push)
@@ -147,10 +157,26 @@ static void kernel(uint8_t* dest, const uint8_t* source, size_t count)
 
 class image_renderer
 {
+	// Images are converted once per source colour space.
+	typedef std::tuple<std::array<const uint8_t*, 4>, core::color_space, core::color_transfer>			source_key;
+	typedef std::tuple<core::color_space, core::color_transfer, core::color_space, core::color_transfer>	color_key;
+
 	tbb::concurrent_unordered_map<int64_t, tbb::concurrent_bounded_queue<std::shared_ptr<SwsContext>>>	sws_devices_;
 	tbb::concurrent_bounded_queue<spl::shared_ptr<buffer>>												temp_buffers_;
 	core::video_format_desc																				format_desc_;
+	const int																							bit_depth_;
+	const core::color_space																				color_space_;
+	const core::color_transfer																			color_transfer_;
+	std::mutex																							color_transforms_mutex_;
+	std::map<color_key, std::shared_ptr<color_transform>>												color_transforms_;
 public:
+	image_renderer(int bit_depth, core::color_space color_space, core::color_transfer color_transfer)
+		: bit_depth_(bit_depth)
+		, color_space_(color_space)
+		, color_transfer_(color_transfer)
+	{
+	}
+
 	std::future<array<const std::uint8_t>> operator()(std::vector<item> items, const core::video_format_desc& format_desc)
 	{
 		if (format_desc != format_desc_)
@@ -159,7 +185,11 @@ public:
 			sws_devices_.clear();
 		}
 
-		convert(items, format_desc.width, format_desc.height);
+		if (bit_depth_ > 8)
+			return render16(std::move(items), format_desc);
+
+		convert(items, format_desc.width, format_desc.height, core::pixel_format::bgra);
+		grade(items, format_desc.width, format_desc.height, core::pixel_format::bgra);
 
 		auto result = spl::make_shared<buffer>(format_desc.size, 0);
 		if(format_desc.field_mode != core::field_mode::progressive)
@@ -179,16 +209,76 @@ public:
 
 private:
 
-	void draw(std::vector<item> items, uint8_t* dest, std::size_t width, std::size_t height, core::field_mode field_mode)
+	// Mixes into a bgra16 plane placed after the 8-bit bgra plane in the same buffer.
+	std::future<array<const std::uint8_t>> render16(std::vector<item> items, const core::video_format_desc& format_desc)
+	{
+		convert(items, format_desc.width, format_desc.height, core::pixel_format::bgra16);
+		grade(items, format_desc.width, format_desc.height, core::pixel_format::bgra16);
+
+		auto size16	= format_desc.size * 2;
+		auto result	= spl::make_shared<buffer>(format_desc.size + size16, 0);
+		auto dest8	= result->data();
+		auto dest16	= reinterpret_cast<uint16_t*>(result->data() + format_desc.size);
+
+		if(format_desc.field_mode != core::field_mode::progressive)
+		{
+			draw16(items, dest16, format_desc.width, format_desc.height, core::field_mode::upper);
+			draw16(items, dest16, format_desc.width, format_desc.height, core::field_mode::lower);
+		}
+		else
+		{
+			draw16(items, dest16, format_desc.width, format_desc.height, core::field_mode::progressive);
+		}
+
+		auto line = format_desc.width * 4;
+
+		tbb::parallel_for(tbb::blocked_range<std::size_t>(0, format_desc.height), [&](const tbb::blocked_range<std::size_t>& r)
+		{
+			for(auto y = r.begin(); y != r.end(); ++y)
+				reduce16to8(dest8 + y*line, dest16 + y*line, line);
+		});
+
+		temp_buffers_.clear();
+
+		return make_ready_future(array<const std::uint8_t>(result->data(), result->size(), true, result));
+	}
+
+	static void remove_empty_items(std::vector<item>& items, core::field_mode field_mode)
 	{
 		for (auto& item : items)
 			item.transform.field_mode &= field_mode;
 
-		// Remove empty items.
 		boost::range::remove_erase_if(items, [&](const item& item)
 		{
 			return item.transform.field_mode == core::field_mode::empty;
 		});
+	}
+
+	void draw16(std::vector<item> items, uint16_t* dest, std::size_t width, std::size_t height, core::field_mode field_mode)
+	{
+		remove_empty_items(items, field_mode);
+
+		if(items.empty())
+			return;
+
+		auto start = field_mode == core::field_mode::lower ? 1 : 0;
+		auto step  = field_mode == core::field_mode::progressive ? 1 : 2;
+
+		tbb::parallel_for(tbb::blocked_range<std::size_t>(0, height/step), [&](const tbb::blocked_range<std::size_t>& r)
+		{
+			for(auto i = r.begin(); i != r.end(); ++i)
+			{
+				auto y = i*step+start;
+
+				for(auto& item : items)
+					blend16(dest + y*width*4, reinterpret_cast<const uint16_t*>(item.data.at(0)) + y*width*4, width*4);
+			}
+		});
+	}
+
+	void draw(std::vector<item> items, uint8_t* dest, std::size_t width, std::size_t height, core::field_mode field_mode)
+	{
+		remove_empty_items(items, field_mode);
 
 		if(items.empty())
 			return;
@@ -220,23 +310,86 @@ private:
 		});
 	}
 
-	void convert(std::vector<item>& source_items, int width, int height)
+	static source_key get_source_key(const item& item)
+	{
+		auto space		= item.transform.color_space != core::color_space::unspecified ? item.transform.color_space : item.pix_desc.color_space;
+		auto transfer	= item.transform.color_transfer != core::color_transfer::unspecified ? item.transform.color_transfer : item.pix_desc.color_transfer;
+
+		return source_key(
+				item.data,
+				core::resolve_color_space(space, item.pix_desc.planes.at(0).height),
+				core::resolve_color_transfer(transfer));
+	}
+
+	std::shared_ptr<color_transform> get_color_transform(core::color_space from_space, core::color_transfer from_transfer, core::color_space to_space, core::color_transfer to_transfer)
+	{
+		if (!core::needs_color_transform(from_space, from_transfer, to_space, to_transfer))
+			return nullptr;
+
+		std::lock_guard<std::mutex> lock(color_transforms_mutex_);
+
+		auto& transform = color_transforms_[color_key(from_space, from_transfer, to_space, to_transfer)];
+
+		if (!transform)
+			transform = std::make_shared<color_transform>(from_space, from_transfer, to_space, to_transfer, bit_depth_);
+
+		return transform;
+	}
+
+	static void transform_color(const color_transform& transform, const uint8_t* source, uint8_t* dest, std::size_t count, core::pixel_format format)
+	{
+		if (format == core::pixel_format::bgra16)
+			transform(reinterpret_cast<const uint16_t*>(source), reinterpret_cast<uint16_t*>(dest), count);
+		else
+			transform(source, dest, count);
+	}
+
+	void convert(std::vector<item>& source_items, int width, int height, core::pixel_format target)
 	{
-		std::set<std::array<const uint8_t*, 4>> buffers;
+		const auto target_stride	= target == core::pixel_format::bgra16 ? 8 : 4;
+		const auto target_pix_fmt	= target == core::pixel_format::bgra16 ? AVPixelFormat::AV_PIX_FMT_BGRA64LE : AVPixelFormat::AV_PIX_FMT_BGRA;
+		const auto color_space		= core::resolve_color_space(color_space_, height);
+		const auto color_transfer	= core::resolve_color_transfer(color_transfer_);
+
+		std::set<source_key> sources;
 
 		for (auto& item : source_items)
-			buffers.insert(item.data);
+			sources.insert(get_source_key(item));
 
 		auto dest_items = source_items;
 
-		tbb::parallel_for_each(buffers.begin(), buffers.end(), [&](const std::array<const uint8_t*, 4>& data)
+		tbb::parallel_for_each(sources.begin(), sources.end(), [&](const source_key& source)
 		{
-			auto pix_desc = std::find_if(source_items.begin(), source_items.end(), [&](const item& item){return item.data == data;})->pix_desc;
+			const auto& data	= std::get<0>(source);
+			auto pix_desc		= std::find_if(source_items.begin(), source_items.end(), [&](const item& item){return get_source_key(item) == source;})->pix_desc;
+			auto transform		= get_color_transform(std::get<1>(source), std::get<2>(source), color_space, color_transfer);
+
+			bool same_size =	pix_desc.planes.at(0).width == width &&
+								pix_desc.planes.at(0).height == height;
+
+			if(pix_desc.format == target && same_size && !transform)
+				return;
 
-			if(pix_desc.format == core::pixel_format::bgra &&
-				pix_desc.planes.at(0).width == width &&
-				pix_desc.planes.at(0).height == height)
+			auto dest_frame = spl::make_shared<buffer>(width*height*target_stride);
+			temp_buffers_.push(dest_frame);
+
+			if(pix_desc.format == target && same_size)
+			{
+				transform_color(*transform, data.at(0), dest_frame->data(), width*height, target);
+				replace(source_items, dest_items, source, dest_frame, target, width, height, target_stride);
 				return;
+			}
+
+			if(target == core::pixel_format::bgra16 && pix_desc.format == core::pixel_format::bgra && same_size)
+			{
+				expand8to16(reinterpret_cast<uint16_t*>(dest_frame->data()), data.at(0), width*height*4);
+
+				if(transform)
+					transform_color(*transform, dest_frame->data(), dest_frame->data(), width*height, target);
+
+				replace(source_items, dest_items, source, dest_frame, target, width, height, target_stride);
+				return;
+			}
 
 			std::array<uint8_t*, 4> data2 = {};
 			for(std::size_t n = 0; n < data.size(); ++n)
@@ -247,7 +400,8 @@ private:
 
 			int64_t key = ((static_cast<int64_t>(input_av_frame->width)	 << 32) & 0xFFFF00000000) |
 						  ((static_cast<int64_t>(input_av_frame->height) << 16) & 0xFFFF0000) |
-						  ((static_cast<int64_t>(input_av_frame->format) <<  8) & 0xFF00);
+						  ((static_cast<int64_t>(input_av_frame->format) <<  8) & 0xFF00) |
+						  ((static_cast<int64_t>(std::get<1>(source))	 <<  0) & 0xFF);
 
 			auto& pool = sws_devices_[key];
 
@@ -255,50 +409,138 @@ private:
 			if(!pool.try_pop(sws_device))
 			{
 				double param;
-				sws_device.reset(sws_getContext(input_av_frame->width, input_av_frame->height, static_cast<AVPixelFormat>(input_av_frame->format), width, height, AVPixelFormat::AV_PIX_FMT_BGRA, SWS_BILINEAR, nullptr, nullptr, &param), sws_freeContext);
+				auto flags = target == core::pixel_format::bgra16 ? SWS_BILINEAR | SWS_ACCURATE_RND | SWS_FULL_CHR_H_INT : SWS_BILINEAR;
+				sws_device.reset(sws_getContext(input_av_frame->width, input_av_frame->height, static_cast<AVPixelFormat>(input_av_frame->format), width, height, target_pix_fmt, flags, nullptr, nullptr, &param), sws_freeContext);
+
+				// Without a working colour space the sws default BT.601 matrix
+				// is kept for every format, as before colour spaces existed.
+				if(sws_device && color_space_ != core::color_space::unspecified)
+					ffmpeg::set_sws_color_space(sws_device.get(), std::get<1>(source), input_av_frame->height);
 			}
 
 			if(!sws_device)
 				CASPAR_THROW_EXCEPTION(operation_failed() << msg_info("Could not create software scaling device.") << boost::errinfo_api_function("sws_getContext"));
 
-			auto dest_frame = spl::make_shared<buffer>(width*height*4);
-			temp_buffers_.push(dest_frame);
-
 			{
 				auto dest_av_frame = ffmpeg::create_frame();
-				avpicture_fill(reinterpret_cast<AVPicture*>(dest_av_frame.get()), dest_frame->data(), AVPixelFormat::AV_PIX_FMT_BGRA, width, height);
+				avpicture_fill(reinterpret_cast<AVPicture*>(dest_av_frame.get()), dest_frame->data(), target_pix_fmt, width, height);
 
 				sws_scale(sws_device.get(), input_av_frame->data, input_av_frame->linesize, 0, input_av_frame->height, dest_av_frame->data, dest_av_frame->linesize);
 				pool.push(sws_device);
 			}
 
-			for(std::size_t n = 0; n < source_items.size(); ++n)
-			{
-				if(source_items[n].data == data)
-				{
-					dest_items[n].data.fill(0);
-					dest_items[n].data[0]			= dest_frame->data();
-					dest_items[n].pix_desc			= core::pixel_format_desc(core::pixel_format::bgra);
-					dest_items[n].pix_desc.planes	= { core::pixel_format_desc::plane(width, height, 4) };
-					dest_items[n].transform			= source_items[n].transform;
-				}
-			}
+			if(transform)
+				transform_color(*transform, dest_frame->data(), dest_frame->data(), width*height, target);
+
+			replace(source_items, dest_items, source, dest_frame, target, width, height, target_stride);
 		});
 
 		source_items = std::move(dest_items);
 	}
+
+	static bool same_grade(const core::color_grade& lhs, const core::color_grade& rhs)
+	{
+		return lhs.lut == rhs.lut && lhs.mix == rhs.mix && lhs.from == rhs.from && lhs.from_mix == rhs.from_mix;
+	}
+
+	// Runs after convert() so that every item is a full frame in the target format.
+	// Images are graded once per lookup table settings.
+	void grade(std::vector<item>& items, int width, int height, core::pixel_format target)
+	{
+		const auto target_stride = target == core::pixel_format::bgra16 ? 8 : 4;
+
+		std::vector<std::pair<const uint8_t*, core::color_grade>>	grades;
+		std::vector<std::size_t>									item_grades(items.size(), std::numeric_limits<std::size_t>::max());
+
+		for (std::size_t n = 0; n < items.size(); ++n)
+		{
+			const auto& grade = items[n].transform.grade;
+
+			if (!grade.lut && !grade.from)
+				continue;
+
+			auto it = std::find_if(grades.begin(), grades.end(), [&](const std::pair<const uint8_t*, core::color_grade>& other)
+			{
+				return other.first == items[n].data.at(0) && same_grade(other.second, grade);
+			});
+
+			item_grades[n] = it - grades.begin();
+
+			if (it == grades.end())
+				grades.push_back(std::make_pair(items[n].data.at(0), grade));
+		}
+
+		std::vector<const uint8_t*> dest_data;
+
+		for (auto& entry : grades)
+		{
+			auto dest_frame = spl::make_shared<buffer>(width*height*target_stride);
+			temp_buffers_.push(dest_frame);
+			dest_data.push_back(dest_frame->data());
+
+			if (target == core::pixel_format::bgra16)
+				color_grade(entry.second, reinterpret_cast<const uint16_t*>(entry.first), reinterpret_cast<uint16_t*>(dest_frame->data()), width*height);
+			else
+				color_grade(entry.second, entry.first, dest_frame->data(), width*height);
+		}
+
+		for (std::size_t n = 0; n < items.size(); ++n)
+		{
+			if (item_grades[n] < dest_data.size())
+				items[n].data[0] = dest_data[item_grades[n]];
+		}
+	}
+
+	static void replace(
+			const std::vector<item>& source_items,
+			std::vector<item>& dest_items,
+			const source_key& source,
+			const spl::shared_ptr<buffer>& dest_frame,
+			core::pixel_format format,
+			int width,
+			int height,
+			int stride)
+	{
+		for(std::size_t n = 0; n < source_items.size(); ++n)
+		{
+			if(get_source_key(source_items[n]) == source)
+			{
+				dest_items[n].data.fill(0);
+				dest_items[n].data[0]			= dest_frame->data();
+				dest_items[n].pix_desc			= core::pixel_format_desc(format);
+				dest_items[n].pix_desc.planes	= { core::pixel_format_desc::plane(width, height, stride) };
+				dest_items[n].transform			= source_items[n].transform;
+			}
+		}
+	}
 };
 
 struct image_mixer::impl : boost::noncopyable
 {
+	const int							bit_depth_;
+	const core::color_space				color_space_;
+	const core::color_transfer			color_transfer_;
 	image_renderer						renderer_;
 	std::vector<core::image_transform>	transform_stack_;
 	std::vector<item>					items_; // layer/stream/items
 public:
-	impl(int channel_id)
-		: transform_stack_(1)
+	impl(int channel_id, int bit_depth, core::color_space color_space, core::color_transfer color_transfer)
+		: bit_depth_(bit_depth)
+		, color_space_(color_space)
+		, color_transfer_(color_transfer)
+		, renderer_(bit_depth, color_space, color_transfer)
+		, transform_stack_(1)
 	{
-		CASPAR_LOG(info) << L"Initialized Streaming SIMD Extensions Accelerated CPU Image Mixer for channel " << channel_id;
+		if (bit_depth != 8 && bit_depth != 16)
+			CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Unsupported cpu mixer bit depth " + boost::lexical_cast<std::wstring>(bit_depth) + L". Use 8 or 16."));
+
+		if (bit_depth > 8)
+			CASPAR_LOG(info) << L"Initialized " << (blend16_uses_avx2() ? L"AVX2" : L"SSE4.1") << L" Accelerated 16-bit CPU Image Mixer for channel " << channel_id;
+		else
+			CASPAR_LOG(info) << L"Initialized Streaming SIMD Extensions Accelerated CPU Image Mixer for channel " << channel_id;
+
+		if (color_space != core::color_space::unspecified || color_transfer != core::color_transfer::unspecified)
+			CASPAR_LOG(info) << L"CPU Image Mixer for channel " << channel_id << L" mixes in " << core::get_color_space(color_space) << L" " << core::get_color_transfer(color_transfer);
 	}
 
 	void push(const core::frame_transform& transform)
@@ -323,8 +565,23 @@ public:
 		item item;
 		item.pix_desc	= frame.pixel_format_desc();
 		item.transform	= transform_stack_.back();
-		for(int n = 0; n < item.pix_desc.planes.size(); ++n)
-			item.data.at(n) = frame.image_data(n).begin();
+
+		if(item.pix_desc.format == core::pixel_format::bgra && item.pix_desc.planes.size() > 1)
+		{
+			// Mixed frame with a bgra16 copy, e.g. routed from another channel.
+			auto plane = bit_depth_ > 8 ? 1 : 0;
+
+			item.pix_desc					= core::pixel_format_desc(plane == 1 ? core::pixel_format::bgra16 : core::pixel_format::bgra);
+			item.pix_desc.planes			= { frame.pixel_format_desc().planes.at(plane) };
+			item.pix_desc.color_space		= frame.pixel_format_desc().color_space;
+			item.pix_desc.color_transfer	= frame.pixel_format_desc().color_transfer;
+			item.data.at(0)			= frame.image_data(plane).begin();
+		}
+		else
+		{
+			for(int n = 0; n < item.pix_desc.planes.size(); ++n)
+				item.data.at(n) = frame.image_data(n).begin();
+		}
 
 		items_.push_back(item);
 	}
@@ -358,12 +615,17 @@ public:
 #endif
 };
 
-image_mixer::image_mixer(int channel_id) : impl_(new impl(channel_id)){}
+image_mixer::image_mixer(int channel_id, int bit_depth, core::color_space color_space, core::color_transfer color_transfer) : impl_(new impl(channel_id, bit_depth, color_space, color_transfer)){}
 image_mixer::~image_mixer(){}
 void image_mixer::push(const core::frame_transform& transform){impl_->push(transform);}
 void image_mixer::visit(const core::const_frame& frame){impl_->visit(frame);}
 void image_mixer::pop(){impl_->pop();}
 int image_mixer::get_max_frame_size() { return std::numeric_limits<int>::max(); }
+int image_mixer::get_mixing_bit_depth() { return impl_->bit_depth_; }
+core::color_space image_mixer::get_working_color_space() const { return impl_->color_space_; }
+core::color_transfer image_mixer::get_working_color_transfer() const { return impl_->color_transfer_; }
+bool image_mixer::supports_ycbcr_passthrough() const { return true; }
+bool image_mixer::supports_color_grading() const { return true; }
 std::future<array<const std::uint8_t>> image_mixer::operator()(const core::video_format_desc& format_desc, bool /* straighten_alpha */){return impl_->render(format_desc);}
 core::mutable_frame image_mixer::create_frame(const void* tag, const core::pixel_format_desc& desc, const core::audio_channel_layout& channel_layout) {return impl_->create_frame(tag, desc, channel_layout);}
 
@@ -2,6 +2,7 @@
 
 #include <common/forward.h>
 #include <common/memory.h>
+#include <common/memory_accounting.h>
 
 #include <core/mixer/image/blend_modes.h>
 #include <core/mixer/image/image_mixer.h>
@@ -13,7 +14,7 @@
 
 namespace caspar { namespace accelerator { namespace cpu {
 	
-typedef cache_aligned_vector<uint8_t> buffer;
+typedef accounted_vector<uint8_t> buffer;
 
 class image_mixer final : public core::image_mixer
 {
@@ -23,7 +24,11 @@ public:
 
 	// Constructors
 
-	image_mixer(int channel_id);
+	image_mixer(
+			int channel_id,
+			int bit_depth,
+			core::color_space color_space = core::color_space::unspecified,
+			core::color_transfer color_transfer = core::color_transfer::unspecified);
 	~image_mixer();
 
 	// Methods	
@@ -43,6 +48,11 @@ public:
 
 	// Properties
 	int get_max_frame_size() override;
+	int get_mixing_bit_depth() override;
+	core::color_space get_working_color_space() const override;
+	core::color_transfer get_working_color_transfer() const override;
+	bool supports_ycbcr_passthrough() const override;
+	bool supports_color_grading() const override;
 private:
 	struct impl;
 	spl::unique_ptr<impl> impl_;
@@ -323,6 +323,10 @@ public:
 		item.transform	= transform_stack_.back();
 		item.geometry	= frame.geometry();
 
+		// Only the 8-bit plane of a mixed frame carrying a bgra16 copy is used.
+		if (item.pix_desc.format == core::pixel_format::bgra && item.pix_desc.planes.size() > 1)
+			item.pix_desc.planes.resize(1);
+
 
 		auto textures_ptr = boost::any_cast<std::shared_ptr<std::vector<future_texture>>>(frame.opaque());
 		if (textures_ptr) {
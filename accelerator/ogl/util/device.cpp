@@ -34,6 +34,7 @@
 #include <common/future.h>
 #include <common/array.h>
 #include <common/memory.h>
+#include <common/memory_accounting.h>
 #include <common/gl/gl_check.h>
 #include <common/timer.h>
 
@@ -337,7 +338,9 @@ struct device::impl : public std::enable_shared_from_this<impl>
 
 	array<std::uint8_t> create_array(std::size_t size)
 	{		
-		auto buf = create_buffer(size, buffer::usage::write_only);
+		auto pooled = create_buffer(size, buffer::usage::write_only);
+		auto charge = charge_memory(current_memory_account(), pooled->size());
+		auto buf = spl::shared_ptr<buffer>(pooled.get(), [pooled, charge](buffer*) { });
 		return array<std::uint8_t>(buf->data(), buf->size(), false, buf);
 	}
 
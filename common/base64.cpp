@@ -26,9 +26,8 @@
 #include <vector>
 #include <algorithm>
 #include <cstring>
+#include <cstdint>
 
-#include <boost/archive/iterators/insert_linebreaks.hpp>
-#include <boost/archive/iterators/base64_from_binary.hpp>
 #include <boost/archive/iterators/binary_from_base64.hpp>
 #include <boost/archive/iterators/transform_width.hpp>
 #include <boost/archive/iterators/remove_whitespace.hpp>
@@ -41,38 +40,59 @@ namespace caspar {
 
 std::string to_base64(const char* data, size_t length)
 {
-	using namespace boost::archive::iterators;
-
-	// From http://www.webbiscuit.co.uk/2012/04/02/base64-encoder-and-boost/
-		
-	typedef
-		insert_linebreaks<         // insert line breaks every 76 characters
-			base64_from_binary<    // convert binary values to base64 characters
-				transform_width<   // retrieve 6 bit integers from a sequence of 8 bit bytes
-					const unsigned char *,
-					6,
-					8
-				>
-			>,
-			76
-		>
-		base64_iterator; // compose all the above operations in to a new iterator
-	std::vector<char> bytes;
-	bytes.resize(length);
-	std::memcpy(bytes.data(), data, length);
+	// Encodes one 3 byte group at a time straight into the preallocated
+	// result. Produces the same output as the boost archive iterators used
+	// previously, that is a line break every 76 characters (19 groups).
 
-	int padding = 0;
+	static const char ALPHABET[] =
+			"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	static const size_t GROUPS_PER_LINE = 76 / 4;
+
+	auto input		= reinterpret_cast<const unsigned char*>(data);
+	auto groups		= (length + 2) / 3;
+	auto linebreaks	= groups > 0 ? (groups - 1) / GROUPS_PER_LINE : 0;
+
+	std::string result;
+	result.resize(groups * 4 + linebreaks);
+
+	auto output		= &result[0];
+	auto whole		= length / 3;
 
-	while (bytes.size() % 3 != 0)
+	for (size_t group = 0; group < whole; ++group)
 	{
-		++padding;
-		bytes.push_back(0x00);
+		if (group > 0 && group % GROUPS_PER_LINE == 0)
+			*output++ = '\n';
+
+		uint32_t bits = (input[0] << 16) | (input[1] << 8) | input[2];
+
+		output[0] = ALPHABET[(bits >> 18) & 0x3F];
+		output[1] = ALPHABET[(bits >> 12) & 0x3F];
+		output[2] = ALPHABET[(bits >> 6) & 0x3F];
+		output[3] = ALPHABET[bits & 0x3F];
+
+		input	+= 3;
+		output	+= 4;
 	}
 
-	std::string result(base64_iterator(bytes.data()), base64_iterator(bytes.data() + length));
-	result.insert(result.end(), padding, '=');
+	auto remaining = length - whole * 3;
+
+	if (remaining > 0)
+	{
+		if (whole > 0 && whole % GROUPS_PER_LINE == 0)
+			*output++ = '\n';
+
+		uint32_t bits = input[0] << 16;
+
+		if (remaining == 2)
+			bits |= input[1] << 8;
+
+		output[0] = ALPHABET[(bits >> 18) & 0x3F];
+		output[1] = ALPHABET[(bits >> 12) & 0x3F];
+		output[2] = remaining == 2 ? ALPHABET[(bits >> 6) & 0x3F] : '=';
+		output[3] = '=';
+	}
 
-	return std::move(result);
+	return result;
 }
 
 std::vector<unsigned char> from_base64(const std::string& data)
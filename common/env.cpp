@@ -43,6 +43,7 @@
 
 namespace caspar { namespace env {
 
+std::wstring configuration;
 std::wstring initial;
 std::wstring media;
 std::wstring log;
@@ -114,6 +115,7 @@ void configure(const std::wstring& filename)
 {
 	try
 	{
+		configuration = filename;
 		initial = clean_path(boost::filesystem::initial_path().wstring());
 
 		boost::filesystem::wifstream file(initial + L"/" + filename);
@@ -146,6 +148,12 @@ void configure(const std::wstring& filename)
 	ensure_writable(thumbnail);
 }
 
+const std::wstring& configuration_file()
+{
+	check_is_configured();
+	return configuration;
+}
+
 const std::wstring& initial_folder()
 {
 	check_is_configured();
@@ -209,6 +217,12 @@ const boost::property_tree::wptree& properties()
 	return pt;
 }
 
+void set_property(const std::wstring& path, const std::wstring& value)
+{
+	check_is_configured();
+	pt.put(path, value);
+}
+
 void log_configuration_warnings()
 {
 	if (pt.empty())
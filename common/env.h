@@ -29,6 +29,7 @@ namespace caspar { namespace env {
 
 void configure(const std::wstring& filename);
 
+const std::wstring& configuration_file();
 const std::wstring& initial_folder();
 const std::wstring& media_folder();
 const std::wstring& log_folder();
@@ -39,6 +40,7 @@ const std::wstring& font_folder();
 const std::wstring& version();
 
 const boost::property_tree::wptree& properties();
+void set_property(const std::wstring& path, const std::wstring& value);
 
 void log_configuration_warnings();
 
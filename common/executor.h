@@ -22,6 +22,7 @@
 #pragma once
 
 #include "os/general_protection_fault.h"
+#include "os/threading.h"
 #include "except.h"
 #include "log.h"
 #include "blocking_bounded_queue_adapter.h"
@@ -132,6 +133,14 @@ public:
 			func();
 	}
 
+	void set_priority(thread_priority priority)
+	{
+		begin_invoke([=]
+		{
+			set_priority_of_current_thread(priority);
+		}, task_priority::higher_priority);
+	}
+
 	void set_capacity(function_queue_t::size_type capacity)
 	{
 		execution_queue_.set_capacity(capacity);
@@ -0,0 +1,134 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "stdafx.h"
+
+#include "hash.h"
+
+#include <cstring>
+
+namespace caspar {
+
+namespace {
+
+const std::uint64_t PRIME1 = 11400714785074694791ULL;
+const std::uint64_t PRIME2 = 14029467366897019727ULL;
+const std::uint64_t PRIME3 = 1609587929392839161ULL;
+const std::uint64_t PRIME4 = 9650029242287828579ULL;
+const std::uint64_t PRIME5 = 2870177450012600261ULL;
+
+inline std::uint64_t rotl(std::uint64_t x, int r)
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+inline std::uint64_t read64(const std::uint8_t* p)
+{
+	std::uint64_t v;
+	std::memcpy(&v, p, sizeof(v));
+	return v; // Little endian on every supported platform.
+}
+
+inline std::uint32_t read32(const std::uint8_t* p)
+{
+	std::uint32_t v;
+	std::memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+inline std::uint64_t xx_round(std::uint64_t acc, std::uint64_t input)
+{
+	acc += input * PRIME2;
+	acc  = rotl(acc, 31);
+	return acc * PRIME1;
+}
+
+inline std::uint64_t merge_round(std::uint64_t acc, std::uint64_t val)
+{
+	acc ^= xx_round(0, val);
+	return acc * PRIME1 + PRIME4;
+}
+
+}
+
+std::uint64_t xxhash64(const void* data, std::size_t size, std::uint64_t seed)
+{
+	auto p		= static_cast<const std::uint8_t*>(data);
+	auto end	= p + size;
+	std::uint64_t h;
+
+	if (size >= 32)
+	{
+		auto limit		= end - 32;
+		std::uint64_t v1	= seed + PRIME1 + PRIME2;
+		std::uint64_t v2	= seed + PRIME2;
+		std::uint64_t v3	= seed;
+		std::uint64_t v4	= seed - PRIME1;
+
+		// Four independent lanes keep the multipliers busy.
+		do
+		{
+			v1 = xx_round(v1, read64(p));
+			v2 = xx_round(v2, read64(p + 8));
+			v3 = xx_round(v3, read64(p + 16));
+			v4 = xx_round(v4, read64(p + 24));
+			p += 32;
+		} while (p <= limit);
+
+		h = rotl(v1, 1) + rotl(v2, 7) + rotl(v3, 12) + rotl(v4, 18);
+		h = merge_round(h, v1);
+		h = merge_round(h, v2);
+		h = merge_round(h, v3);
+		h = merge_round(h, v4);
+	}
+	else
+		h = seed + PRIME5;
+
+	h += static_cast<std::uint64_t>(size);
+
+	for (; p + 8 <= end; p += 8)
+	{
+		h ^= xx_round(0, read64(p));
+		h  = rotl(h, 27) * PRIME1 + PRIME4;
+	}
+
+	if (p + 4 <= end)
+	{
+		h ^= static_cast<std::uint64_t>(read32(p)) * PRIME1;
+		h  = rotl(h, 23) * PRIME2 + PRIME3;
+		p += 4;
+	}
+
+	for (; p < end; ++p)
+	{
+		h ^= *p * PRIME5;
+		h  = rotl(h, 11) * PRIME1;
+	}
+
+	h ^= h >> 33;
+	h *= PRIME2;
+	h ^= h >> 29;
+	h *= PRIME3;
+	h ^= h >> 32;
+
+	return h;
+}
+
+}
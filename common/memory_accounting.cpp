@@ -0,0 +1,505 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "stdafx.h"
+
+#include "memory_accounting.h"
+
+#include "os/huge_pages.h"
+
+#include <tbb/cache_aligned_allocator.h>
+
+#include <boost/thread/tss.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+
+#include <iterator>
+#include <limits>
+#include <map>
+#include <new>
+#include <set>
+
+namespace caspar {
+
+class memory_account_registry
+{
+	boost::mutex												mutex_;
+	std::map<void*, std::weak_ptr<memory_account>>				accounts_;
+	std::map<int, spl::shared_ptr<channel_memory>>				channels_;
+	tbb::atomic<std::int64_t>									global_budget_;
+	tbb::atomic<std::int64_t>									total_usage_;
+public:
+	memory_account_registry()
+	{
+		global_budget_	= 0;
+		total_usage_	= 0;
+	}
+
+	static memory_account_registry& get_instance()
+	{
+		static memory_account_registry instance;
+
+		return instance;
+	}
+
+	spl::shared_ptr<channel_memory> get_channel(int video_channel)
+	{
+		boost::lock_guard<boost::mutex> lock(mutex_);
+
+		auto found = channels_.find(video_channel);
+
+		if (found != channels_.end())
+			return found->second;
+
+		auto channel = spl::make_shared<channel_memory>();
+		channel->usage	= 0;
+		channel->budget	= 0;
+		channels_.insert(std::make_pair(video_channel, channel));
+
+		return channel;
+	}
+
+	void add(const std::shared_ptr<memory_account>& account)
+	{
+		boost::lock_guard<boost::mutex> lock(mutex_);
+		accounts_.insert(std::make_pair(account.get(), account));
+	}
+
+	void remove(memory_account* account)
+	{
+		boost::lock_guard<boost::mutex> lock(mutex_);
+		accounts_.erase(account);
+	}
+
+	std::vector<spl::shared_ptr<memory_account>> get_accounts()
+	{
+		boost::lock_guard<boost::mutex> lock(mutex_);
+
+		std::vector<spl::shared_ptr<memory_account>> result;
+
+		for (auto& account : accounts_)
+		{
+			auto strong = account.second.lock();
+
+			if (strong)
+				result.push_back(spl::make_shared_ptr(strong));
+		}
+
+		return result;
+	}
+
+	tbb::atomic<std::int64_t>& global_budget()	{ return global_budget_; }
+	tbb::atomic<std::int64_t>& total_usage()	{ return total_usage_; }
+};
+
+static bool is_budget_exceeded(const channel_memory* channel)
+{
+	auto& registry		= memory_account_registry::get_instance();
+	auto global_budget	= registry.global_budget().load();
+
+	if (global_budget > 0 && registry.total_usage() > global_budget)
+		return true;
+
+	if (!channel)
+		return false;
+
+	auto channel_budget = channel->budget.load();
+
+	return channel_budget > 0 && channel->usage > channel_budget;
+}
+
+memory_account::memory_account(std::wstring owner, int video_channel, int layer)
+	: owner_(std::move(owner))
+	, video_channel_(video_channel)
+	, layer_(layer)
+	, channel_(memory_account_registry::get_instance().get_channel(video_channel))
+{
+	usage_	= 0;
+	peak_	= 0;
+}
+
+void memory_account::charge(std::size_t bytes)
+{
+	auto usage = usage_.fetch_and_add(static_cast<std::int64_t>(bytes)) + static_cast<std::int64_t>(bytes);
+	channel_->usage += static_cast<std::int64_t>(bytes);
+	memory_account_registry::get_instance().total_usage() += static_cast<std::int64_t>(bytes);
+
+	auto peak = peak_.load();
+
+	while (usage > peak)
+	{
+		auto previous = peak_.compare_and_swap(usage, peak);
+
+		if (previous == peak)
+			break;
+
+		peak = previous;
+	}
+}
+
+void memory_account::release(std::size_t bytes)
+{
+	usage_ -= static_cast<std::int64_t>(bytes);
+	channel_->usage -= static_cast<std::int64_t>(bytes);
+	memory_account_registry::get_instance().total_usage() -= static_cast<std::int64_t>(bytes);
+}
+
+bool memory_account::is_budget_exceeded() const
+{
+	return caspar::is_budget_exceeded(video_channel_ < 0 ? nullptr : channel_.get());
+}
+
+spl::shared_ptr<memory_account> create_memory_account(std::wstring owner, int video_channel, int layer)
+{
+	std::shared_ptr<memory_account> account(new memory_account(std::move(owner), video_channel, layer), [](memory_account* p)
+	{
+		memory_account_registry::get_instance().remove(p);
+		delete p;
+	});
+
+	memory_account_registry::get_instance().add(account);
+
+	return spl::make_shared_ptr(account);
+}
+
+std::vector<spl::shared_ptr<memory_account>> get_memory_accounts()
+{
+	return memory_account_registry::get_instance().get_accounts();
+}
+
+std::shared_ptr<memory_account>& current_memory_account_for_thread()
+{
+	static boost::thread_specific_ptr<std::shared_ptr<memory_account>> accounts;
+
+	auto local = accounts.get();
+
+	if (!local)
+	{
+		local = new std::shared_ptr<memory_account>;
+		accounts.reset(local);
+	}
+
+	return *local;
+}
+
+std::shared_ptr<memory_account> current_memory_account()
+{
+	return current_memory_account_for_thread();
+}
+
+scoped_memory_account::scoped_memory_account(std::shared_ptr<memory_account> account)
+	: saved_(std::move(account))
+{
+	std::swap(saved_, current_memory_account_for_thread());
+}
+
+scoped_memory_account::~scoped_memory_account()
+{
+	current_memory_account_for_thread() = std::move(saved_);
+}
+
+std::shared_ptr<void> charge_memory(const std::shared_ptr<memory_account>& account, std::size_t bytes)
+{
+	if (!account || bytes == 0)
+		return nullptr;
+
+	account->charge(bytes);
+
+	return std::shared_ptr<void>(nullptr, [account, bytes](void*)
+	{
+		account->release(bytes);
+	});
+}
+
+void set_global_memory_budget(std::int64_t bytes)
+{
+	memory_account_registry::get_instance().global_budget() = bytes;
+}
+
+void set_channel_memory_budget(int video_channel, std::int64_t bytes)
+{
+	memory_account_registry::get_instance().get_channel(video_channel)->budget = bytes;
+}
+
+std::int64_t global_memory_budget()
+{
+	return memory_account_registry::get_instance().global_budget();
+}
+
+std::int64_t channel_memory_budget(int video_channel)
+{
+	return memory_account_registry::get_instance().get_channel(video_channel)->budget;
+}
+
+std::int64_t total_memory_usage()
+{
+	return memory_account_registry::get_instance().total_usage();
+}
+
+std::int64_t channel_memory_usage(int video_channel)
+{
+	return memory_account_registry::get_instance().get_channel(video_channel)->usage;
+}
+
+bool is_memory_budget_exceeded(int video_channel)
+{
+	if (video_channel < 0)
+		return is_budget_exceeded(nullptr);
+
+	return is_budget_exceeded(memory_account_registry::get_instance().get_channel(video_channel).get());
+}
+
+// Keeps the huge page mappings of freed allocations around, so that frames of
+// the same size can reuse them without faulting in new pages.
+class huge_page_pool
+{
+	boost::mutex							mutex_;
+	huge_page_mode							mode_				= huge_page_mode::off;
+	std::int64_t							max_cached_			= 0;
+	std::multimap<std::size_t, void*>		free_;
+	std::set<void*>							hugetlb_mappings_;
+	tbb::atomic<std::size_t>				min_size_;
+	huge_page_usage							usage_;
+public:
+	huge_page_pool()
+	{
+		min_size_ = std::numeric_limits<std::size_t>::max();
+	}
+
+	static huge_page_pool& get_instance()
+	{
+		static huge_page_pool instance;
+
+		return instance;
+	}
+
+	void configure(huge_page_mode mode, std::int64_t max_cached)
+	{
+		std::vector<std::pair<std::size_t, void*>> trimmed;
+
+		{
+			boost::lock_guard<boost::mutex> lock(mutex_);
+
+			mode_				= mode;
+			max_cached_			= max_cached;
+			usage_.mode			= mode;
+			usage_.page_size	= mode == huge_page_mode::off ? 0 : static_cast<std::int64_t>(detail::huge_page_size());
+
+			// Smaller allocations would waste most of the page.
+			min_size_			= mode == huge_page_mode::off ? std::numeric_limits<std::size_t>::max() : detail::huge_page_size() / 2;
+
+			trim(trimmed);
+		}
+
+		for (auto& mapping : trimmed)
+			detail::unmap_huge_pages(mapping.second, mapping.first);
+	}
+
+	/**
+	 * Returns the size of the mapping in mapped_size, which is what has to be
+	 * given back on deallocate. Returns nullptr for allocations that are
+	 * better served by the ordinary allocator.
+	 *
+	 * The mutex only guards the free list and the statistics. Mapping and
+	 * prefaulting a frame sized region takes milliseconds, so it is done
+	 * without holding it.
+	 */
+	void* allocate(std::size_t bytes, std::size_t& mapped_size)
+	{
+		if (bytes < min_size_)
+			return nullptr;
+
+		auto page_size	= detail::huge_page_size();
+		auto hugetlb	= false;
+
+		mapped_size = (bytes + page_size - 1) / page_size * page_size;
+
+		{
+			boost::lock_guard<boost::mutex> lock(mutex_);
+
+			if (mode_ == huge_page_mode::off)
+				return nullptr;
+
+			auto found = free_.find(mapped_size);
+
+			if (found != free_.end())
+			{
+				auto p = found->second;
+				free_.erase(found);
+
+				usage_.cached -= mapped_size;
+				usage_.in_use += mapped_size;
+				++usage_.reused;
+
+				return p;
+			}
+
+			hugetlb = mode_ == huge_page_mode::hugetlb;
+		}
+
+		auto fallbacks	= 0;
+		auto p			= detail::map_huge_pages(mapped_size, hugetlb);
+
+		if (!p && hugetlb)
+		{
+			++fallbacks;
+			hugetlb	= false;
+			p		= detail::map_huge_pages(mapped_size, false);
+		}
+
+		if (!p)
+			++fallbacks;
+
+		boost::lock_guard<boost::mutex> lock(mutex_);
+
+		usage_.fallbacks += fallbacks;
+
+		if (!p)
+			return nullptr;
+
+		if (hugetlb)
+		{
+			hugetlb_mappings_.insert(p);
+			usage_.hugetlb += mapped_size;
+		}
+
+		usage_.mapped += mapped_size;
+		usage_.in_use += mapped_size;
+
+		return p;
+	}
+
+	void deallocate(void* p, std::size_t mapped_size)
+	{
+		{
+			boost::lock_guard<boost::mutex> lock(mutex_);
+
+			usage_.in_use -= mapped_size;
+
+			if (mode_ != huge_page_mode::off && usage_.cached + static_cast<std::int64_t>(mapped_size) <= max_cached_)
+			{
+				free_.insert(std::make_pair(mapped_size, p));
+				usage_.cached += mapped_size;
+				return;
+			}
+
+			forget(p, mapped_size);
+		}
+
+		detail::unmap_huge_pages(p, mapped_size);
+	}
+
+	huge_page_usage usage()
+	{
+		boost::lock_guard<boost::mutex> lock(mutex_);
+
+		return usage_;
+	}
+private:
+	// Called with the mutex held, the trimmed mappings are unmapped by the caller.
+	void trim(std::vector<std::pair<std::size_t, void*>>& trimmed)
+	{
+		while (!free_.empty() && (mode_ == huge_page_mode::off || usage_.cached > max_cached_))
+		{
+			auto largest = std::prev(free_.end());
+
+			usage_.cached -= largest->first;
+			forget(largest->second, largest->first);
+			trimmed.push_back(*largest);
+			free_.erase(largest);
+		}
+	}
+
+	// Called with the mutex held, before the mapping is unmapped.
+	void forget(void* p, std::size_t mapped_size)
+	{
+		if (hugetlb_mappings_.erase(p) > 0)
+			usage_.hugetlb -= mapped_size;
+
+		usage_.mapped -= mapped_size;
+	}
+};
+
+void configure_huge_pages(huge_page_mode mode, std::int64_t max_cached_bytes)
+{
+	huge_page_pool::get_instance().configure(mode, max_cached_bytes);
+}
+
+huge_page_usage get_huge_page_usage()
+{
+	return huge_page_pool::get_instance().usage();
+}
+
+// Every accounted allocation is prefixed with a header remembering which
+// account to release it from. The header occupies a whole cache line to keep
+// the returned pointer cache aligned.
+
+struct allocation_header
+{
+	std::shared_ptr<memory_account>	account;
+	std::size_t						size;
+	std::size_t						mapped_size;	// 0 unless backed by huge pages.
+};
+
+static const std::size_t ALLOCATION_HEADER_SIZE = 64;
+
+static_assert(sizeof(allocation_header) <= ALLOCATION_HEADER_SIZE, "allocation_header does not fit in header space");
+
+void* allocate_accounted(std::size_t bytes)
+{
+	auto account		= current_memory_account();
+	std::size_t mapped_size	= 0;
+	auto base			= static_cast<std::uint8_t*>(huge_page_pool::get_instance().allocate(bytes + ALLOCATION_HEADER_SIZE, mapped_size));
+
+	if (!base)
+	{
+		mapped_size	= 0;
+		base		= tbb::cache_aligned_allocator<std::uint8_t>().allocate(bytes + ALLOCATION_HEADER_SIZE);
+	}
+
+	if (account)
+		account->charge(bytes);
+
+	new (base) allocation_header { std::move(account), bytes, mapped_size };
+
+	return base + ALLOCATION_HEADER_SIZE;
+}
+
+void deallocate_accounted(void* p)
+{
+	if (!p)
+		return;
+
+	auto base	= static_cast<std::uint8_t*>(p) - ALLOCATION_HEADER_SIZE;
+	auto header	= reinterpret_cast<allocation_header*>(base);
+	auto size			= header->size;
+	auto mapped_size	= header->mapped_size;
+
+	if (header->account)
+		header->account->release(size);
+
+	header->~allocation_header();
+
+	if (mapped_size > 0)
+		huge_page_pool::get_instance().deallocate(base, mapped_size);
+	else
+		tbb::cache_aligned_allocator<std::uint8_t>().deallocate(base, size + ALLOCATION_HEADER_SIZE);
+}
+
+}
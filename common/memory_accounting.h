@@ -0,0 +1,192 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "memory.h"
+
+#include <tbb/atomic.h>
+
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace caspar {
+
+/**
+ * The usage and budget of one video channel, shared by the accounts of the
+ * channel so that they read them without looking the channel up.
+ */
+struct channel_memory
+{
+	tbb::atomic<std::int64_t>	usage;
+	tbb::atomic<std::int64_t>	budget;		// 0 means unlimited.
+};
+
+/**
+ * Tracks the number of bytes currently held by one owner, for example a
+ * producer on a layer or the mixer of a channel.
+ */
+class memory_account : boost::noncopyable
+{
+public:
+	// Constructors
+
+	memory_account(std::wstring owner, int video_channel, int layer);
+
+	// Methods
+
+	void charge(std::size_t bytes);
+	void release(std::size_t bytes);
+
+	// Properties
+
+	const std::wstring& owner() const			{ return owner_; }
+	int video_channel() const					{ return video_channel_; }
+	int layer() const							{ return layer_; }
+	std::int64_t usage() const					{ return usage_; }
+	std::int64_t peak() const					{ return peak_; }
+
+	// Whether the global budget or the budget of the channel of the account is
+	// exceeded. Only reads atomics, so it is cheap enough to ask per packet.
+	bool is_budget_exceeded() const;
+private:
+	const std::wstring								owner_;
+	const int										video_channel_;
+	const int										layer_;
+	const spl::shared_ptr<channel_memory>			channel_;
+	tbb::atomic<std::int64_t>						usage_;
+	tbb::atomic<std::int64_t>						peak_;
+};
+
+spl::shared_ptr<memory_account> create_memory_account(std::wstring owner, int video_channel = -1, int layer = -1);
+std::vector<spl::shared_ptr<memory_account>> get_memory_accounts();
+
+/**
+ * The account that allocations made on the calling thread are charged to.
+ * May be null, in which case the allocations are not accounted.
+ */
+std::shared_ptr<memory_account> current_memory_account();
+
+class scoped_memory_account : boost::noncopyable
+{
+	std::shared_ptr<memory_account> saved_;
+public:
+	explicit scoped_memory_account(std::shared_ptr<memory_account> account);
+	~scoped_memory_account();
+};
+
+/**
+ * Charges an account for memory not allocated through accounted_allocator,
+ * like pooled GPU buffers or AVPackets. The bytes are released when the
+ * returned token is destroyed.
+ */
+std::shared_ptr<void> charge_memory(const std::shared_ptr<memory_account>& account, std::size_t bytes);
+
+// Budgets. A budget of 0 means unlimited.
+
+void set_global_memory_budget(std::int64_t bytes);
+void set_channel_memory_budget(int video_channel, std::int64_t bytes);
+std::int64_t global_memory_budget();
+std::int64_t channel_memory_budget(int video_channel);
+std::int64_t total_memory_usage();
+std::int64_t channel_memory_usage(int video_channel);
+bool is_memory_budget_exceeded(int video_channel);
+
+// Huge pages. Large accounted allocations, like video frames, can be backed
+// by huge pages to reduce TLB misses. Freed mappings are kept for reuse.
+
+enum class huge_page_mode
+{
+	off,
+	transparent,
+	hugetlb
+};
+
+struct huge_page_usage
+{
+	huge_page_mode	mode			= huge_page_mode::off;
+	std::int64_t	page_size		= 0;
+	std::int64_t	mapped			= 0;
+	std::int64_t	in_use			= 0;
+	std::int64_t	cached			= 0;
+	std::int64_t	hugetlb			= 0;
+	std::int64_t	reused			= 0;
+	std::int64_t	fallbacks		= 0;
+};
+
+void configure_huge_pages(huge_page_mode mode, std::int64_t max_cached_bytes);
+huge_page_usage get_huge_page_usage();
+
+void* allocate_accounted(std::size_t bytes);
+void deallocate_accounted(void* p);
+
+/**
+ * Cache aligned allocator charging the account current on the allocating
+ * thread. The account is remembered per allocation so the memory can be
+ * released from any thread.
+ *
+ * Each allocation costs a thread local lookup, a shared_ptr copy and a cache
+ * line of header, so it is meant for frame sized buffers only.
+ */
+template<typename T>
+class accounted_allocator
+{
+public:
+	typedef T value_type;
+
+	accounted_allocator()
+	{
+	}
+
+	template<typename T2>
+	accounted_allocator(const accounted_allocator<T2>&)
+	{
+	}
+
+	T* allocate(std::size_t n)
+	{
+		return static_cast<T*>(allocate_accounted(n * sizeof(T)));
+	}
+
+	void deallocate(T* p, std::size_t)
+	{
+		deallocate_accounted(p);
+	}
+};
+
+template<typename T1, typename T2>
+bool operator==(const accounted_allocator<T1>&, const accounted_allocator<T2>&)
+{
+	return true;
+}
+
+template<typename T1, typename T2>
+bool operator!=(const accounted_allocator<T1>&, const accounted_allocator<T2>&)
+{
+	return false;
+}
+
+template<typename T>
+using accounted_vector = std::vector<T, accounted_allocator<T>>;
+
+}
@@ -0,0 +1,62 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <boost/chrono/duration.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace caspar {
+
+/**
+ * A copy of the running executable started with the given arguments. A line
+ * based control channel is connected to the child on file descriptor 3,
+ * leaving its standard streams to the console and the log.
+ *
+ * The child is terminated when the object is destroyed.
+ */
+class child_process final : boost::noncopyable
+{
+public:
+	explicit child_process(const std::vector<std::string>& args);
+	~child_process();
+
+	void write_line(const std::string& line);
+
+	// Returns false on timeout or when the child has closed the channel.
+	bool read_line(std::string& line, boost::chrono::milliseconds timeout);
+
+	bool is_running();
+	void kill();
+	int pid() const;
+
+	// Used by the child.
+	static bool read_control_line(std::string& line);
+	static void write_control_line(const std::string& line);
+private:
+	struct impl;
+	std::unique_ptr<impl> impl_;
+};
+
+}
@@ -0,0 +1,39 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+
+namespace caspar { namespace detail {
+
+std::size_t huge_page_size();
+
+/**
+ * Maps prefaulted memory backed by huge pages. With hugetlb the pages are
+ * taken from the reserved huge page pool, otherwise the kernel is asked to
+ * back the mapping with transparent huge pages when possible.
+ *
+ * size must be a multiple of huge_page_size(). Returns nullptr on failure.
+ */
+void* map_huge_pages(std::size_t size, bool hugetlb);
+void unmap_huge_pages(void* p, std::size_t size);
+
+}}
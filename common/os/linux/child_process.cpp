@@ -0,0 +1,202 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../../stdafx.h"
+
+#include "../child_process.h"
+
+#include "../../except.h"
+#include "../../log.h"
+
+#include <boost/chrono/system_clocks.hpp>
+
+#include <cerrno>
+#include <cstring>
+
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace caspar {
+
+namespace {
+
+const int CONTROL_FD = 3;
+
+bool read_line_from(int fd, std::string& buffer, std::string& line, int timeout_millis)
+{
+	while (true)
+	{
+		auto end = buffer.find('\n');
+
+		if (end != std::string::npos)
+		{
+			line = buffer.substr(0, end);
+			buffer.erase(0, end + 1);
+			return true;
+		}
+
+		pollfd pfd;
+		pfd.fd		= fd;
+		pfd.events	= POLLIN;
+
+		if (poll(&pfd, 1, timeout_millis) <= 0)
+			return false;
+
+		char data[4096];
+		auto size = recv(fd, data, sizeof(data), 0);
+
+		if (size <= 0)
+			return false;
+
+		buffer.append(data, size);
+	}
+}
+
+void write_line_to(int fd, const std::string& line)
+{
+	auto data = line + "\n";
+
+	for (std::size_t offset = 0; offset < data.size();)
+	{
+		auto size = send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+
+		if (size <= 0)
+			CASPAR_THROW_EXCEPTION(io_error() << msg_info(std::string("Control channel closed: ") + std::strerror(errno)));
+
+		offset += size;
+	}
+}
+
+}
+
+struct child_process::impl
+{
+	pid_t		pid_		= -1;
+	int			socket_		= -1;
+	bool		exited_		= false;
+	std::string	buffer_;
+
+	explicit impl(const std::vector<std::string>& args)
+	{
+		int sockets[2];
+
+		if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) == -1)
+			CASPAR_THROW_EXCEPTION(io_error() << msg_info(std::string("socketpair failed: ") + std::strerror(errno)));
+
+		std::vector<char*> argv;
+		std::string executable = "/proc/self/exe";
+		argv.push_back(&executable[0]);
+
+		auto args_copy = args;
+		for (auto& arg : args_copy)
+			argv.push_back(&arg[0]);
+
+		argv.push_back(nullptr);
+
+		posix_spawn_file_actions_t actions;
+		posix_spawn_file_actions_init(&actions);
+		posix_spawn_file_actions_adddup2(&actions, sockets[1], CONTROL_FD);
+
+		auto result = posix_spawn(&pid_, executable.c_str(), &actions, nullptr, argv.data(), environ);
+
+		posix_spawn_file_actions_destroy(&actions);
+		close(sockets[1]);
+
+		if (result != 0)
+		{
+			close(sockets[0]);
+			CASPAR_THROW_EXCEPTION(io_error() << msg_info(std::string("Failed to start child process: ") + std::strerror(result)));
+		}
+
+		socket_ = sockets[0];
+	}
+
+	~impl()
+	{
+		// Closing the control channel asks the child to exit.
+		close(socket_);
+
+		auto deadline = boost::chrono::steady_clock::now() + boost::chrono::seconds(2);
+
+		while (is_running() && boost::chrono::steady_clock::now() < deadline)
+			usleep(10000);
+
+		if (is_running())
+		{
+			CASPAR_LOG(warning) << L"[child_process] " << pid_ << L" did not exit, killing it.";
+			kill();
+		}
+	}
+
+	bool is_running()
+	{
+		if (exited_)
+			return false;
+
+		int status;
+		auto result = waitpid(pid_, &status, WNOHANG);
+
+		if (result == pid_ || (result == -1 && errno == ECHILD))
+			exited_ = true;
+
+		return !exited_;
+	}
+
+	void kill()
+	{
+		if (!is_running())
+			return;
+
+		::kill(pid_, SIGKILL);
+		waitpid(pid_, nullptr, 0);
+		exited_ = true;
+	}
+};
+
+child_process::child_process(const std::vector<std::string>& args) : impl_(new impl(args)) {}
+child_process::~child_process() {}
+void child_process::write_line(const std::string& line) { write_line_to(impl_->socket_, line); }
+bool child_process::read_line(std::string& line, boost::chrono::milliseconds timeout)
+{
+	return read_line_from(impl_->socket_, impl_->buffer_, line, static_cast<int>(timeout.count()));
+}
+bool child_process::is_running() { return impl_->is_running(); }
+void child_process::kill() { impl_->kill(); }
+int child_process::pid() const { return impl_->pid_; }
+
+bool child_process::read_control_line(std::string& line)
+{
+	static std::string buffer;
+	return read_line_from(CONTROL_FD, buffer, line, -1);
+}
+
+void child_process::write_control_line(const std::string& line)
+{
+	write_line_to(CONTROL_FD, line);
+}
+
+}
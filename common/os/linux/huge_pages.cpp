@@ -0,0 +1,115 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../huge_pages.h"
+
+#include <boost/lexical_cast.hpp>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace caspar { namespace detail {
+
+std::size_t read_huge_page_size()
+{
+	std::ifstream meminfo("/proc/meminfo");
+	std::string line;
+
+	while (std::getline(meminfo, line))
+	{
+		static const std::string KEY = "Hugepagesize:";
+
+		if (line.compare(0, KEY.size(), KEY) != 0)
+			continue;
+
+		try
+		{
+			auto value = line.substr(KEY.size());
+			auto kb = boost::lexical_cast<std::size_t>(value.substr(value.find_first_not_of(' '), value.find(" kB") - value.find_first_not_of(' ')));
+
+			return kb * 1024;
+		}
+		catch (...)
+		{
+			break;
+		}
+	}
+
+	return 2 * 1024 * 1024;
+}
+
+std::size_t huge_page_size()
+{
+	static const std::size_t size = read_huge_page_size();
+
+	return size;
+}
+
+void* map_huge_pages(std::size_t size, bool hugetlb)
+{
+	if (hugetlb)
+	{
+		auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+
+		return p == MAP_FAILED ? nullptr : p;
+	}
+
+	// Over-allocate so that the mapping can be trimmed to a huge page
+	// boundary, otherwise the kernel can not use huge pages for the edges.
+	auto alignment	= huge_page_size();
+	auto raw		= mmap(nullptr, size + alignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (raw == MAP_FAILED)
+		return nullptr;
+
+	auto begin		= reinterpret_cast<std::uintptr_t>(raw);
+	auto aligned	= (begin + alignment - 1) & ~(alignment - 1);
+	auto end		= begin + size + alignment;
+
+	if (aligned > begin)
+		munmap(raw, aligned - begin);
+
+	if (end > aligned + size)
+		munmap(reinterpret_cast<void*>(aligned + size), end - aligned - size);
+
+	auto p = reinterpret_cast<std::uint8_t*>(aligned);
+
+	madvise(p, size, MADV_HUGEPAGE);
+
+	// Prefault after madvise, so that the faults are served with huge pages
+	// up front instead of on the real time threads.
+	static const std::size_t page_size = sysconf(_SC_PAGESIZE);
+
+	for (std::size_t offset = 0; offset < size; offset += page_size)
+		p[offset] = 0;
+
+	return p;
+}
+
+void unmap_huge_pages(void* p, std::size_t size)
+{
+	munmap(p, size);
+}
+
+}}
@@ -0,0 +1,246 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../../stdafx.h"
+
+#include "../shared_frame_ring.h"
+
+#include "../../except.h"
+
+#include <boost/chrono/system_clocks.hpp>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+namespace caspar {
+
+namespace {
+
+const std::uint32_t	RING_MAGIC	= 0x43475246; // "CGRF"
+const std::size_t	ALIGNMENT	= 4096;
+
+struct ring_header
+{
+	std::uint32_t				magic;
+	std::uint32_t				slot_count;
+	std::uint64_t				slot_size;
+	alignas(64) std::atomic<std::uint32_t>	written;
+	alignas(64) std::atomic<std::uint32_t>	read;
+};
+
+static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(int), "futex word must be 32 bit");
+
+std::size_t align(std::size_t size)
+{
+	return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+// Waits while *word == expected, at most until the deadline. The futexes are
+// shared between processes so the private variants can not be used.
+void futex_wait(std::atomic<std::uint32_t>& word, std::uint32_t expected, boost::chrono::steady_clock::time_point deadline)
+{
+	auto remaining = boost::chrono::duration_cast<boost::chrono::nanoseconds>(deadline - boost::chrono::steady_clock::now()).count();
+
+	if (remaining <= 0)
+		return;
+
+	timespec timeout;
+	timeout.tv_sec	= remaining / 1000000000;
+	timeout.tv_nsec	= remaining % 1000000000;
+
+	syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAIT, static_cast<int>(expected), &timeout, nullptr, 0);
+}
+
+void futex_wake(std::atomic<std::uint32_t>& word)
+{
+	syscall(SYS_futex, reinterpret_cast<int*>(&word), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+}
+
+struct shared_frame_ring::impl
+{
+	std::string		name_;
+	bool			owner_;
+	void*			mapping_		= MAP_FAILED;
+	std::size_t		mapping_size_	= 0;
+	ring_header*	header_			= nullptr;
+	char*			slots_			= nullptr;
+
+	impl(const std::string& name, bool owner, std::size_t slot_count, std::size_t slot_size)
+		: name_(name)
+		, owner_(owner)
+	{
+		int fd = owner
+				? shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600)
+				: shm_open(name.c_str(), O_RDWR, 0600);
+
+		if (fd == -1)
+			CASPAR_THROW_EXCEPTION(io_error() << msg_info("Failed to open shared memory " + name + ": " + std::strerror(errno)));
+
+		if (owner)
+		{
+			mapping_size_ = align(sizeof(ring_header)) + slot_count * align(slot_size);
+
+			if (ftruncate(fd, mapping_size_) == -1)
+			{
+				auto error = errno;
+				close(fd);
+				shm_unlink(name.c_str());
+				CASPAR_THROW_EXCEPTION(io_error() << msg_info("Failed to size shared memory " + name + ": " + std::strerror(error)));
+			}
+		}
+		else
+		{
+			struct stat info;
+			fstat(fd, &info);
+			mapping_size_ = info.st_size;
+		}
+
+		mapping_ = mmap(nullptr, mapping_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+
+		if (mapping_ == MAP_FAILED)
+		{
+			if (owner)
+				shm_unlink(name.c_str());
+
+			CASPAR_THROW_EXCEPTION(io_error() << msg_info("Failed to map shared memory " + name + ": " + std::strerror(errno)));
+		}
+
+		header_ = static_cast<ring_header*>(mapping_);
+
+		if (owner)
+		{
+			header_->magic		= RING_MAGIC;
+			header_->slot_count	= static_cast<std::uint32_t>(slot_count);
+			header_->slot_size	= align(slot_size);
+			new (&header_->written) std::atomic<std::uint32_t>(0);
+			new (&header_->read) std::atomic<std::uint32_t>(0);
+		}
+		else if (mapping_size_ < sizeof(ring_header) || header_->magic != RING_MAGIC)
+		{
+			munmap(mapping_, mapping_size_);
+			CASPAR_THROW_EXCEPTION(io_error() << msg_info("Not a frame ring: " + name));
+		}
+
+		slots_ = static_cast<char*>(mapping_) + align(sizeof(ring_header));
+	}
+
+	~impl()
+	{
+		munmap(mapping_, mapping_size_);
+
+		if (owner_)
+			shm_unlink(name_.c_str());
+	}
+
+	char* slot(std::uint32_t index) const
+	{
+		return slots_ + (index % header_->slot_count) * header_->slot_size;
+	}
+
+	void* begin_write(boost::chrono::milliseconds timeout)
+	{
+		auto deadline	= boost::chrono::steady_clock::now() + timeout;
+		auto written	= header_->written.load(std::memory_order_relaxed);
+
+		while (true)
+		{
+			auto read = header_->read.load(std::memory_order_acquire);
+
+			if (written - read < header_->slot_count)
+				return slot(written);
+
+			if (boost::chrono::steady_clock::now() >= deadline)
+				return nullptr;
+
+			futex_wait(header_->read, read, deadline);
+		}
+	}
+
+	void end_write()
+	{
+		header_->written.fetch_add(1, std::memory_order_release);
+		futex_wake(header_->written);
+	}
+
+	const void* begin_read(boost::chrono::milliseconds timeout)
+	{
+		auto deadline	= boost::chrono::steady_clock::now() + timeout;
+		auto read		= header_->read.load(std::memory_order_relaxed);
+
+		while (true)
+		{
+			auto written = header_->written.load(std::memory_order_acquire);
+
+			if (written != read)
+				return slot(read);
+
+			if (boost::chrono::steady_clock::now() >= deadline)
+				return nullptr;
+
+			futex_wait(header_->written, written, deadline);
+		}
+	}
+
+	void end_read()
+	{
+		header_->read.fetch_add(1, std::memory_order_release);
+		futex_wake(header_->read);
+	}
+
+	void clear()
+	{
+		header_->read.store(header_->written.load(std::memory_order_acquire), std::memory_order_release);
+		futex_wake(header_->read);
+	}
+};
+
+std::unique_ptr<shared_frame_ring> shared_frame_ring::create(const std::string& name, std::size_t slot_count, std::size_t slot_size)
+{
+	return std::unique_ptr<shared_frame_ring>(new shared_frame_ring(std::unique_ptr<impl>(new impl(name, true, slot_count, slot_size))));
+}
+
+std::unique_ptr<shared_frame_ring> shared_frame_ring::open(const std::string& name)
+{
+	return std::unique_ptr<shared_frame_ring>(new shared_frame_ring(std::unique_ptr<impl>(new impl(name, false, 0, 0))));
+}
+
+shared_frame_ring::shared_frame_ring(std::unique_ptr<impl> impl) : impl_(std::move(impl)) {}
+shared_frame_ring::~shared_frame_ring() {}
+void* shared_frame_ring::begin_write(boost::chrono::milliseconds timeout) { return impl_->begin_write(timeout); }
+void shared_frame_ring::end_write() { impl_->end_write(); }
+const void* shared_frame_ring::begin_read(boost::chrono::milliseconds timeout) { return impl_->begin_read(timeout); }
+void shared_frame_ring::end_read() { impl_->end_read(); }
+void shared_frame_ring::clear() { impl_->clear(); }
+std::size_t shared_frame_ring::slot_size() const { return impl_->header_->slot_size; }
+std::size_t shared_frame_ring::slot_count() const { return impl_->header_->slot_count; }
+
+}
@@ -22,16 +22,141 @@
 #include "../../stdafx.h"
 
 #include "../threading.h"
+#include "../../log.h"
 
+#include <tbb/atomic.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <alloca.h>
+#include <pthread.h>
+#include <sched.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
 #include <sys/syscall.h>
 #include <sys/types.h>
 
 namespace caspar {
 
+namespace {
+
+tbb::atomic<bool> g_realtime;
+tbb::atomic<bool> g_lock_memory;
+tbb::atomic<bool> g_warned_realtime;
+tbb::atomic<bool> g_warned_nice;
+
+const std::size_t PREFAULTED_STACK_SIZE = 256 * 1024;
+
+int fifo_priority(thread_priority priority)
+{
+	switch (priority)
+	{
+	case thread_priority::CHANNEL:	return 30;
+	case thread_priority::OUTPUT:	return 25;
+	case thread_priority::MIXER:	return 20;
+	default:						return 0;
+	}
+}
+
+int nice_level(thread_priority priority)
+{
+	switch (priority)
+	{
+	case thread_priority::LOW:		return 10;
+	case thread_priority::DECODER:	return -5;
+	case thread_priority::MIXER:	return -10;
+	case thread_priority::OUTPUT:	return -12;
+	case thread_priority::CHANNEL:	return -15;
+	default:						return 0;
+	}
+}
+
+int max_fifo_priority()
+{
+	// Privileged processes are not bound by RLIMIT_RTPRIO.
+	if (geteuid() == 0)
+		return sched_get_priority_max(SCHED_FIFO);
+
+	rlimit limit;
+
+	if (getrlimit(RLIMIT_RTPRIO, &limit) != 0)
+		return 0;
+
+	return static_cast<int>(std::min<rlim_t>(limit.rlim_cur, sched_get_priority_max(SCHED_FIFO)));
+}
+
+// Touches the top of the stack so that a locked real-time thread does not
+// page fault the first time its call depth grows.
+void prefault_stack()
+{
+	volatile char* stack = static_cast<volatile char*>(alloca(PREFAULTED_STACK_SIZE));
+
+	for (std::size_t n = 0; n < PREFAULTED_STACK_SIZE; n += 4096)
+		stack[n] = 0;
+}
+
+bool try_set_realtime(thread_priority priority)
+{
+	auto wanted = fifo_priority(priority);
+
+	if (!g_realtime || wanted == 0)
+		return false;
+
+	auto allowed = std::min(wanted, max_fifo_priority());
+
+	if (allowed > 0)
+	{
+		sched_param param;
+		param.sched_priority = allowed;
+
+		if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0)
+		{
+			if (g_lock_memory)
+				prefault_stack();
+
+			return true;
+		}
+	}
+
+	if (g_warned_realtime.compare_and_swap(true, false) == false)
+		CASPAR_LOG(warning) << L"[threading] Real-time scheduling not permitted (RLIMIT_RTPRIO is " << max_fifo_priority()
+							<< L"). Raise rtprio in /etc/security/limits.conf or grant CAP_SYS_NICE. Using nice levels instead.";
+
+	return false;
+}
+
+}
+
+void configure_thread_priorities(bool realtime, bool lock_memory)
+{
+	g_realtime		= realtime;
+	g_lock_memory	= false;
+
+	if (lock_memory)
+	{
+		if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0)
+			g_lock_memory = true;
+		else
+			CASPAR_LOG(warning) << L"[threading] Could not lock memory: " << std::strerror(errno)
+								<< L". Raise memlock in /etc/security/limits.conf or grant CAP_IPC_LOCK.";
+	}
+}
+
 void set_priority_of_current_thread(thread_priority priority)
 {
-	// TODO: implement
+	if (try_set_realtime(priority))
+		return;
+
+	// Only available to privileged processes or within RLIMIT_NICE for
+	// negative levels, in which case the thread is left at the default.
+	if (setpriority(PRIO_PROCESS, static_cast<id_t>(get_current_thread_id()), nice_level(priority)) != 0
+		&& g_warned_nice.compare_and_swap(true, false) == false)
+	{
+		CASPAR_LOG(debug) << L"[threading] Could not change nice level: " << std::strerror(errno);
+	}
 }
 
 std::int64_t get_current_thread_id()
@@ -0,0 +1,68 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <boost/chrono/duration.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace caspar {
+
+/**
+ * Single producer, single consumer ring of fixed size slots in named shared
+ * memory, for handing frames between two processes without copying through a
+ * pipe. Waiting is done with futexes on Linux.
+ *
+ * The creating side owns the name and removes it when destroyed, the other
+ * side opens it by name.
+ */
+class shared_frame_ring final : boost::noncopyable
+{
+public:
+	static std::unique_ptr<shared_frame_ring> create(const std::string& name, std::size_t slot_count, std::size_t slot_size);
+	static std::unique_ptr<shared_frame_ring> open(const std::string& name);
+
+	~shared_frame_ring();
+
+	// Writer. Returns nullptr when the reader has not freed a slot within the timeout.
+	void*		begin_write(boost::chrono::milliseconds timeout);
+	void		end_write();
+
+	// Reader. Returns nullptr when no slot was written within the timeout.
+	const void*	begin_read(boost::chrono::milliseconds timeout);
+	void		end_read();
+
+	// Drops everything written but not yet read.
+	void		clear();
+
+	std::size_t	slot_size() const;
+	std::size_t	slot_count() const;
+private:
+	struct impl;
+	explicit shared_frame_ring(std::unique_ptr<impl> impl);
+	std::unique_ptr<impl> impl_;
+};
+
+}
@@ -25,11 +25,25 @@
 
 namespace caspar {
 
+// Scheduling tiers, from background work up to the channel tick that paces
+// everything else.
 enum class thread_priority
 {
-	LOW
+	LOW,		// Thumbnails, media scanning and diagnostics.
+	NORMAL,
+	DECODER,	// Producers decoding ahead of the channel.
+	MIXER,		// Stage and mixer.
+	OUTPUT,		// Output and consumers.
+	CHANNEL		// Channel tick.
 };
 
+/**
+ * Lets set_priority_of_current_thread() use real-time scheduling for the MIXER,
+ * OUTPUT and CHANNEL tiers (SCHED_FIFO on Linux, limited by RLIMIT_RTPRIO),
+ * and optionally locks all current and future memory of the process into RAM.
+ * Call once at startup before any channel is created.
+ */
+void configure_thread_priorities(bool realtime, bool lock_memory);
 void set_priority_of_current_thread(thread_priority priority);
 std::int64_t get_current_thread_id();
 
@@ -0,0 +1,47 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../../stdafx.h"
+
+#include "../child_process.h"
+
+#include "../../except.h"
+
+namespace caspar {
+
+// Out of process producers are only implemented on Linux.
+
+struct child_process::impl {};
+
+child_process::child_process(const std::vector<std::string>& args)
+{
+	CASPAR_THROW_EXCEPTION(not_supported() << msg_info("Child processes are not supported on Windows"));
+}
+
+child_process::~child_process() {}
+void child_process::write_line(const std::string& line) {}
+bool child_process::read_line(std::string& line, boost::chrono::milliseconds timeout) { return false; }
+bool child_process::is_running() { return false; }
+void child_process::kill() {}
+int child_process::pid() const { return -1; }
+bool child_process::read_control_line(std::string& line) { return false; }
+void child_process::write_control_line(const std::string& line) {}
+
+}
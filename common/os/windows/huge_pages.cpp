@@ -0,0 +1,65 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../../stdafx.h"
+
+#include "../huge_pages.h"
+
+#include "windows.h"
+
+#include <cstdint>
+
+namespace caspar { namespace detail {
+
+std::size_t huge_page_size()
+{
+	static const std::size_t size = ::GetLargePageMinimum() > 0 ? ::GetLargePageMinimum() : 2 * 1024 * 1024;
+
+	return size;
+}
+
+void* map_huge_pages(std::size_t size, bool hugetlb)
+{
+	// Large pages require the SeLockMemoryPrivilege and are always committed
+	// up front. There is no transparent huge page equivalent so without them
+	// only the prefaulting and the reuse of the mappings remain.
+	if (hugetlb)
+		return ::VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+
+	auto p = static_cast<std::uint8_t*>(::VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+
+	if (!p)
+		return nullptr;
+
+	SYSTEM_INFO info;
+	::GetSystemInfo(&info);
+
+	for (std::size_t offset = 0; offset < size; offset += info.dwPageSize)
+		p[offset] = 0;
+
+	return p;
+}
+
+void unmap_huge_pages(void* p, std::size_t)
+{
+	::VirtualFree(p, 0, MEM_RELEASE);
+}
+
+}}
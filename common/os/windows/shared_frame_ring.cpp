@@ -0,0 +1,52 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../../stdafx.h"
+
+#include "../shared_frame_ring.h"
+
+#include "../../except.h"
+
+namespace caspar {
+
+// Out of process producers are only implemented on Linux.
+
+std::unique_ptr<shared_frame_ring> shared_frame_ring::create(const std::string& name, std::size_t slot_count, std::size_t slot_size)
+{
+	CASPAR_THROW_EXCEPTION(not_supported() << msg_info("Shared frame rings are not supported on Windows"));
+}
+
+std::unique_ptr<shared_frame_ring> shared_frame_ring::open(const std::string& name)
+{
+	CASPAR_THROW_EXCEPTION(not_supported() << msg_info("Shared frame rings are not supported on Windows"));
+}
+
+struct shared_frame_ring::impl {};
+shared_frame_ring::shared_frame_ring(std::unique_ptr<impl> impl) : impl_(std::move(impl)) {}
+shared_frame_ring::~shared_frame_ring() {}
+void* shared_frame_ring::begin_write(boost::chrono::milliseconds timeout) { return nullptr; }
+void shared_frame_ring::end_write() {}
+const void* shared_frame_ring::begin_read(boost::chrono::milliseconds timeout) { return nullptr; }
+void shared_frame_ring::end_read() {}
+void shared_frame_ring::clear() {}
+std::size_t shared_frame_ring::slot_size() const { return 0; }
+std::size_t shared_frame_ring::slot_count() const { return 0; }
+
+}
@@ -25,12 +25,42 @@
 
 #include "windows.h"
 
+#include <tbb/atomic.h>
+
 namespace caspar {
-	
+
+namespace {
+
+tbb::atomic<bool> g_realtime;
+
+}
+
+void configure_thread_priorities(bool realtime, bool lock_memory)
+{
+	// Locking all memory of a process is not supported on Windows.
+	g_realtime = realtime;
+}
+
 void set_priority_of_current_thread(thread_priority priority)
 {
-	if (priority == thread_priority::LOW)
+	switch (priority)
+	{
+	case thread_priority::LOW:
 		SetThreadPriority(GetCurrentThread(), BELOW_NORMAL_PRIORITY_CLASS);
+		break;
+	case thread_priority::DECODER:
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_ABOVE_NORMAL);
+		break;
+	case thread_priority::MIXER:
+	case thread_priority::OUTPUT:
+		SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST);
+		break;
+	case thread_priority::CHANNEL:
+		SetThreadPriority(GetCurrentThread(), g_realtime ? THREAD_PRIORITY_TIME_CRITICAL : THREAD_PRIORITY_HIGHEST);
+		break;
+	default:
+		break;
+	}
 }
 
 std::int64_t get_current_thread_id()
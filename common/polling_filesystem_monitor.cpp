@@ -233,6 +233,7 @@ public:
 	{
 		running_ = true;
 		reemmit_all_ = false;
+		executor_.set_priority(thread_priority::LOW);
 	}
 
 	void start()
@@ -49,7 +49,8 @@ private:
 	{
 		using namespace boost::chrono;
 
-		return duration_cast<milliseconds>(high_resolution_clock::now().time_since_epoch()).count();
+		// Monotonic, so that elapsed times survive wall clock adjustments.
+		return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
 	}
 };
 
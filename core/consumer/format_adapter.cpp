@@ -0,0 +1,188 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../StdAfx.h"
+
+#include "format_adapter.h"
+
+#include "../frame/audio_channel_layout.h"
+#include "../frame/frame.h"
+#include "../frame/image_scaler.h"
+#include "../frame/pixel_format.h"
+#include "../video_format.h"
+
+#include <common/cache_aligned_vector.h>
+#include <common/except.h>
+#include <common/executor.h>
+#include <common/future.h>
+
+#include <boost/lexical_cast.hpp>
+#include <boost/rational.hpp>
+
+#include <algorithm>
+#include <deque>
+
+namespace caspar { namespace core {
+
+struct format_adapter::impl : boost::noncopyable
+{
+	const video_format_desc							channel_format_desc_;
+	const video_format_desc							format_desc_;
+	const boost::rational<std::int64_t>				frames_per_input_;
+	boost::rational<std::int64_t>					pending_frames_;
+	std::deque<std::int32_t>						audio_;
+	std::size_t										cadence_index_		= 0;
+	const_frame										last_input_			= const_frame::empty();
+	std::shared_future<std::vector<const_frame>>	last_result_;
+	executor										executor_;
+
+	impl(const video_format_desc& channel_format_desc, const video_format_desc& format_desc)
+		: channel_format_desc_(channel_format_desc)
+		, format_desc_(format_desc)
+		, frames_per_input_(
+				static_cast<std::int64_t>(format_desc.framerate.numerator()) * channel_format_desc.framerate.denominator(),
+				static_cast<std::int64_t>(format_desc.framerate.denominator()) * channel_format_desc.framerate.numerator())
+		, executor_(L"format_adapter[" + channel_format_desc.name + L"->" + format_desc.name + L"]")
+	{
+		validate(channel_format_desc_, format_desc_);
+	}
+
+	static void validate(const video_format_desc& channel_format_desc, const video_format_desc& format_desc)
+	{
+		if (channel_format_desc.field_count != 1 || format_desc.field_count != 1)
+			CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Only progressive formats can be adapted: " + channel_format_desc.name + L" to " + format_desc.name));
+
+		if (channel_format_desc.audio_sample_rate != format_desc.audio_sample_rate)
+			CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Formats with different audio sample rates cannot be adapted: " + channel_format_desc.name + L" to " + format_desc.name));
+	}
+
+	std::shared_future<std::vector<const_frame>> operator()(const const_frame& frame)
+	{
+		if (last_input_ == frame && last_result_.valid())
+			return last_result_;
+
+		last_input_		= frame;
+		last_result_	= executor_.begin_invoke([=]
+		{
+			return adapt(frame);
+		}).share();
+
+		return last_result_;
+	}
+
+	std::vector<const_frame> adapt(const const_frame& frame)
+	{
+		auto num_channels = std::max(frame.audio_channel_layout().num_channels, 1);
+
+		audio_.insert(audio_.end(), frame.audio_data().begin(), frame.audio_data().end());
+		pending_frames_ += frames_per_input_;
+
+		std::vector<const_frame> result;
+
+		if (pending_frames_ < 1)
+			return result;
+
+		auto image = scale(frame);
+
+		while (pending_frames_ >= 1)
+		{
+			pending_frames_ -= 1;
+			result.push_back(image.with_audio(next_audio(num_channels)));
+		}
+
+		// Drops audio the cadence cannot keep up with, like when the channel
+		// frame rate is not an exact multiple of the cadence.
+		auto max_samples = static_cast<std::size_t>(*std::max_element(format_desc_.audio_cadence.begin(), format_desc_.audio_cadence.end())) * num_channels * 2;
+
+		if (audio_.size() > max_samples)
+			audio_.erase(audio_.begin(), audio_.begin() + (audio_.size() - max_samples));
+
+		return result;
+	}
+
+	audio_buffer next_audio(int num_channels)
+	{
+		auto samples	= static_cast<std::size_t>(format_desc_.audio_cadence.at(cadence_index_++ % format_desc_.audio_cadence.size())) * num_channels;
+		auto buffer		= spl::make_shared<mutable_audio_buffer>(samples, 0);
+		auto available	= std::min(samples, audio_.size());
+
+		std::copy(audio_.begin(), audio_.begin() + available, buffer->begin());
+		audio_.erase(audio_.begin(), audio_.begin() + available);
+
+		auto& audio = *buffer;
+		return audio_buffer(audio.data(), audio.size(), true, std::move(buffer));
+	}
+
+	const_frame scale(const const_frame& frame) const
+	{
+		// The passthrough planes are at the channel format, they are dropped
+		// whether or not the image is rescaled.
+		if (frame.width() == static_cast<std::size_t>(format_desc_.width) && frame.height() == static_cast<std::size_t>(format_desc_.height))
+			return frame.with_passthrough(const_frame::empty());
+
+		auto high_bit_depth	= frame.pixel_format_desc().planes.size() > 1;
+		auto size			= static_cast<std::size_t>(format_desc_.width) * format_desc_.height * 4;
+		auto source			= frame.image_data(0);
+		auto buffer			= std::make_shared<cache_aligned_vector<std::uint8_t>>(high_bit_depth ? size * 3 : size);
+
+		scale_bgra(
+				source.begin(),
+				static_cast<int>(frame.width()),
+				static_cast<int>(frame.height()),
+				buffer->data(),
+				format_desc_.width,
+				format_desc_.height);
+
+		auto desc = pixel_format_desc(pixel_format::bgra);
+		desc.planes.push_back(pixel_format_desc::plane(format_desc_.width, format_desc_.height, 4));
+		desc.color_space	= frame.pixel_format_desc().color_space;
+		desc.color_transfer	= frame.pixel_format_desc().color_transfer;
+
+		if (high_bit_depth)
+		{
+			scale_bgra16(
+					reinterpret_cast<const std::uint16_t*>(frame.image_data(1).begin()),
+					static_cast<int>(frame.width()),
+					static_cast<int>(frame.height()),
+					reinterpret_cast<std::uint16_t*>(buffer->data() + size),
+					format_desc_.width,
+					format_desc_.height);
+
+			desc.planes.push_back(pixel_format_desc::plane(format_desc_.width, format_desc_.height, 8));
+		}
+
+		auto image = make_ready_future(array<const std::uint8_t>(buffer->data(), buffer->size(), true, buffer)).share();
+
+		return const_frame(std::move(image), frame.audio_data(), this, desc, frame.audio_channel_layout())
+				.with_origin(frame.since_created());
+	}
+};
+
+format_adapter::format_adapter(const video_format_desc& channel_format_desc, const video_format_desc& format_desc)
+	: impl_(new impl(channel_format_desc, format_desc))
+{
+}
+format_adapter::~format_adapter(){}
+void format_adapter::validate(const video_format_desc& channel_format_desc, const video_format_desc& format_desc) { impl::validate(channel_format_desc, format_desc); }
+std::shared_future<std::vector<const_frame>> format_adapter::operator()(const const_frame& frame) { return (*impl_)(frame); }
+const video_format_desc& format_adapter::channel_format_desc() const { return impl_->channel_format_desc_; }
+const video_format_desc& format_adapter::format_desc() const { return impl_->format_desc_; }
+
+}}
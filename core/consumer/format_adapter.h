@@ -0,0 +1,73 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "../fwd.h"
+
+#include <common/memory.h>
+
+#include <future>
+#include <vector>
+
+namespace caspar { namespace core {
+
+// Converts the frames of a channel to the video format of consumers that do
+// not run at the format of the channel. Frames are dropped or repeated to
+// follow the frame rate, the audio is resliced to the cadence of the target
+// format and images are rescaled on the worker of the adapter.
+//
+// Adapted frames always carry the bgra image, and the bgra16 plane when the
+// channel mixes at a higher bit depth. The ycbcr passthrough of the channel is
+// not carried, so adapted consumers always encode from the mixed image.
+class format_adapter final
+{
+	format_adapter(const format_adapter&);
+	format_adapter& operator=(const format_adapter&);
+public:
+
+	// Static Members
+
+	// Throws a user_error if the frames of the channel format cannot be adapted
+	// to the format, without building an adapter. Interlaced formats and
+	// formats with another audio sample rate are not supported.
+	static void validate(const video_format_desc& channel_format_desc, const video_format_desc& format_desc);
+
+	// Constructors
+
+	format_adapter(const video_format_desc& channel_format_desc, const video_format_desc& format_desc);
+	~format_adapter();
+
+	// Methods
+
+	// Called once per channel frame by each port that shares the adapter, the
+	// frame is converted once and the result is shared between the ports.
+	std::shared_future<std::vector<const_frame>> operator()(const const_frame& frame);
+
+	// Properties
+
+	const video_format_desc& channel_format_desc() const;
+	const video_format_desc& format_desc() const;
+private:
+	struct impl;
+	spl::unique_ptr<impl> impl_;
+};
+
+}}
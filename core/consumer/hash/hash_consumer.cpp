@@ -0,0 +1,496 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../../StdAfx.h"
+
+#include "hash_consumer.h"
+
+#include "../frame_consumer.h"
+#include "../../frame/audio_channel_layout.h"
+#include "../../frame/frame.h"
+#include "../../frame/pixel_format.h"
+#include "../../help/help_sink.h"
+#include "../../module_dependencies.h"
+#include "../../monitor/monitor.h"
+#include "../../video_format.h"
+
+#include <common/env.h>
+#include <common/executor.h>
+#include <common/future.h>
+#include <common/hash.h>
+#include <common/param.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+#include <mutex>
+
+namespace caspar { namespace core { namespace hash {
+
+// Frames are written to <path>.frames as this header followed by the bgra
+// bytes of the first image plane and the 32-bit audio samples.
+struct frame_record_header
+{
+	std::uint64_t	frame;
+	std::uint32_t	image_size;
+	std::uint32_t	audio_samples;
+};
+
+std::wstring to_hex(std::uint64_t value)
+{
+	wchar_t buffer[17];
+	std::swprintf(buffer, 17, L"%016llx", static_cast<unsigned long long>(value));
+	return buffer;
+}
+
+bool is_empty(const array<const std::uint8_t>& image, const audio_buffer& audio)
+{
+	return std::all_of(image.begin(), image.end(), [](std::uint8_t b) { return b == 0; })
+		&& std::all_of(audio.begin(), audio.end(), [](std::int32_t s) { return s == 0; });
+}
+
+double psnr(const std::vector<char>& reference, const std::uint8_t* image, std::size_t size)
+{
+	if (reference.size() != size)
+		return std::numeric_limits<double>::quiet_NaN();
+
+	double squared_error = 0.0;
+
+	for (std::size_t n = 0; n < size; ++n)
+	{
+		int diff		= static_cast<std::uint8_t>(reference[n]) - image[n];
+		squared_error	+= diff * diff;
+	}
+
+	if (squared_error == 0.0)
+		return std::numeric_limits<double>::infinity();
+
+	return 10.0 * std::log10(255.0 * 255.0 * size / squared_error);
+}
+
+std::int64_t max_audio_difference(const std::vector<std::int32_t>& reference, const audio_buffer& audio)
+{
+	if (reference.size() != audio.size())
+		return std::numeric_limits<std::int64_t>::max();
+
+	std::int64_t result = 0;
+
+	for (std::size_t n = 0; n < audio.size(); ++n)
+		result = std::max(result, std::abs(static_cast<std::int64_t>(reference[n]) - audio.data()[n]));
+
+	return result >> 16; // In 16-bit sample steps.
+}
+
+class hash_consumer : public frame_consumer
+{
+	monitor::subject				monitor_subject_;
+	const std::wstring				path_;
+	const std::wstring				reference_path_;
+	const double					psnr_tolerance_;
+	const std::int64_t				audio_tolerance_;
+	const bool						fast_;
+	int								channel_index_		= -1;
+
+	boost::filesystem::ofstream		hashes_;
+	boost::filesystem::ofstream		frames_;
+	boost::filesystem::ifstream		reference_hashes_;
+	boost::filesystem::ifstream		reference_frames_;
+	bool							started_			= false;
+	std::int64_t					frame_number_		= 0;
+
+	mutable std::mutex				stats_mutex_;
+	std::int64_t					compared_			= 0;
+	std::int64_t					identical_			= 0;
+	std::int64_t					within_tolerance_	= 0;
+	std::int64_t					diverged_			= 0;
+	std::int64_t					first_divergence_	= -1;
+	double							lowest_psnr_		= std::numeric_limits<double>::infinity();
+
+	executor						executor_			{ L"hash_consumer" };
+public:
+	hash_consumer(std::wstring path, std::wstring reference_path, double psnr_tolerance, std::int64_t audio_tolerance, bool fast)
+		: path_(std::move(path))
+		, reference_path_(std::move(reference_path))
+		, psnr_tolerance_(psnr_tolerance)
+		, audio_tolerance_(audio_tolerance)
+		, fast_(fast)
+	{
+		executor_.set_capacity(8);
+	}
+
+	~hash_consumer()
+	{
+		executor_.stop();
+		executor_.join();
+
+		if (!reference_path_.empty())
+			CASPAR_LOG(info) << print() << L" " << summary();
+	}
+
+	void initialize(
+			const video_format_desc& format_desc,
+			const audio_channel_layout& channel_layout,
+			int channel_index) override
+	{
+		channel_index_ = channel_index;
+
+		executor_.invoke([=]
+		{
+			if (!hashes_.is_open())
+				open();
+
+			hashes_ << "# " << u8(format_desc.name) << " " << format_desc.width << "x" << format_desc.height
+					<< " " << channel_layout.num_channels << "ch\n";
+		});
+	}
+
+	std::future<bool> send(frame_timecode timecode, const_frame frame) override
+	{
+		executor_.begin_invoke([=]
+		{
+			try
+			{
+				process(frame);
+			}
+			catch (...)
+			{
+				CASPAR_LOG_CURRENT_EXCEPTION();
+			}
+		});
+
+		return make_ready_future(true);
+	}
+
+	monitor::subject& monitor_output() override
+	{
+		return monitor_subject_;
+	}
+
+	std::wstring print() const override
+	{
+		return L"hash[" + boost::lexical_cast<std::wstring>(channel_index_) + L"|" + path_ + L"]";
+	}
+
+	std::wstring name() const override
+	{
+		return L"hash";
+	}
+
+	boost::property_tree::wptree info() const override
+	{
+		boost::property_tree::wptree info;
+		info.add(L"type", L"hash-consumer");
+		info.add(L"path", path_);
+		info.add(L"fast", fast_);
+
+		if (!reference_path_.empty())
+		{
+			std::lock_guard<std::mutex> lock(stats_mutex_);
+			info.add(L"reference", reference_path_);
+			info.add(L"compared", compared_);
+			info.add(L"identical", identical_);
+			info.add(L"within-tolerance", within_tolerance_);
+			info.add(L"diverged", diverged_);
+			info.add(L"first-divergence", first_divergence_);
+		}
+
+		return info;
+	}
+
+	bool has_synchronization_clock() const override
+	{
+		return false;
+	}
+
+	int buffer_depth() const override
+	{
+		return -1;
+	}
+
+	int index() const override
+	{
+		return 80000;
+	}
+
+	int64_t presentation_frame_age_millis() const override
+	{
+		return 0;
+	}
+private:
+	void open()
+	{
+		boost::filesystem::create_directories(boost::filesystem::path(path_).parent_path());
+
+		hashes_.open(path_ + L".hashes", std::ios::out | std::ios::trunc);
+
+		if (!hashes_)
+			CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Could not create " + path_ + L".hashes"));
+
+		if (!fast_)
+			frames_.open(path_ + L".frames", std::ios::out | std::ios::trunc | std::ios::binary);
+
+		if (reference_path_.empty())
+			return;
+
+		reference_hashes_.open(reference_path_ + L".hashes");
+
+		if (!reference_hashes_)
+			CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Could not open reference " + reference_path_ + L".hashes"));
+
+		if (boost::filesystem::exists(reference_path_ + L".frames"))
+			reference_frames_.open(reference_path_ + L".frames", std::ios::in | std::ios::binary);
+		else
+			CASPAR_LOG(info) << print() << L" No reference frames, differing frames will be reported without PSNR.";
+	}
+
+	void process(const const_frame& frame)
+	{
+		auto image = frame.image_data();
+		auto& audio = frame.audio_data();
+
+		// Channels usually show a few black frames before the tested content
+		// starts, skip them so that runs line up.
+		if (!started_ && is_empty(image, audio))
+			return;
+
+		started_ = true;
+
+		auto number			= frame_number_++;
+		auto image_hash		= xxhash64(image.begin(), image.size());
+		auto audio_hash		= xxhash64(audio.begin(), audio.size() * sizeof(std::int32_t));
+
+		for (std::size_t plane = 1; plane < frame.pixel_format_desc().planes.size(); ++plane)
+		{
+			auto data	= frame.image_data(static_cast<int>(plane));
+			image_hash	= xxhash64(data.begin(), data.size(), image_hash);
+		}
+
+		hashes_ << number << "\t" << u8(to_hex(image_hash)) << "\t" << u8(to_hex(audio_hash)) << "\n";
+
+		if (frames_.is_open())
+		{
+			frame_record_header header = { static_cast<std::uint64_t>(number), static_cast<std::uint32_t>(image.size()), static_cast<std::uint32_t>(audio.size()) };
+			frames_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+			frames_.write(reinterpret_cast<const char*>(image.begin()), image.size());
+			frames_.write(reinterpret_cast<const char*>(audio.begin()), audio.size() * sizeof(std::int32_t));
+		}
+
+		if (reference_hashes_.is_open())
+			compare(number, image_hash, audio_hash, image, audio);
+
+		monitor_subject_ << monitor::message("/frame") % number;
+	}
+
+	void compare(
+			std::int64_t number,
+			std::uint64_t image_hash,
+			std::uint64_t audio_hash,
+			const array<const std::uint8_t>& image,
+			const audio_buffer& audio)
+	{
+		std::string line;
+
+		while (std::getline(reference_hashes_, line) && (line.empty() || line[0] == '#'))
+			;
+
+		if (!reference_hashes_)
+		{
+			CASPAR_LOG(info) << print() << L" Reference ended at frame " << number << L". " << summary();
+			reference_hashes_.close();
+			reference_frames_.close();
+			return;
+		}
+
+		auto first_tab			= line.find('\t');
+		auto second_tab			= line.find('\t', first_tab + 1);
+		auto reference_image	= std::stoull(line.substr(first_tab + 1, second_tab - first_tab - 1), nullptr, 16);
+		auto reference_audio	= std::stoull(line.substr(second_tab + 1), nullptr, 16);
+		bool image_equal		= reference_image == image_hash;
+		bool audio_equal		= reference_audio == audio_hash;
+
+		std::vector<char>			reference_pixels;
+		std::vector<std::int32_t>	reference_samples;
+		bool						have_reference_data = false;
+
+		if (reference_frames_.is_open())
+		{
+			frame_record_header header;
+
+			if (reference_frames_.read(reinterpret_cast<char*>(&header), sizeof(header)))
+			{
+				if (image_equal && audio_equal)
+					reference_frames_.seekg(header.image_size + header.audio_samples * sizeof(std::int32_t), std::ios::cur);
+				else
+				{
+					reference_pixels.resize(header.image_size);
+					reference_samples.resize(header.audio_samples);
+					reference_frames_.read(reference_pixels.data(), reference_pixels.size());
+					reference_frames_.read(reinterpret_cast<char*>(reference_samples.data()), reference_samples.size() * sizeof(std::int32_t));
+					have_reference_data = static_cast<bool>(reference_frames_);
+				}
+			}
+		}
+
+		double			frame_psnr			= image_equal ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN();
+		std::int64_t	audio_difference	= audio_equal ? 0 : std::numeric_limits<std::int64_t>::max();
+
+		if (have_reference_data)
+		{
+			if (!image_equal)
+				frame_psnr = psnr(reference_pixels, image.begin(), image.size());
+
+			if (!audio_equal)
+				audio_difference = max_audio_difference(reference_samples, audio);
+		}
+
+		bool image_ok = image_equal || (psnr_tolerance_ > 0.0 && frame_psnr >= psnr_tolerance_);
+		bool audio_ok = audio_equal || audio_difference <= audio_tolerance_;
+
+		std::lock_guard<std::mutex> lock(stats_mutex_);
+
+		++compared_;
+
+		if (image_equal && audio_equal)
+			++identical_;
+		else if (image_ok && audio_ok)
+			++within_tolerance_;
+		else
+		{
+			++diverged_;
+
+			if (first_divergence_ < 0)
+			{
+				first_divergence_ = number;
+
+				CASPAR_LOG(warning) << print() << L" First divergence at frame " << number
+						<< L": image " << (image_equal ? L"identical" : L"PSNR " + describe_psnr(frame_psnr))
+						<< L", audio " << (audio_equal ? L"identical" : L"max difference " + describe_audio(audio_difference));
+			}
+
+			monitor_subject_ << monitor::message("/diverged") % diverged_;
+		}
+
+		if (!image_equal && !std::isnan(frame_psnr))
+			lowest_psnr_ = std::min(lowest_psnr_, frame_psnr);
+	}
+
+	static std::wstring describe_psnr(double value)
+	{
+		return std::isnan(value) ? L"unknown" : boost::lexical_cast<std::wstring>(std::round(value * 100.0) / 100.0) + L" dB";
+	}
+
+	static std::wstring describe_audio(std::int64_t value)
+	{
+		return value == std::numeric_limits<std::int64_t>::max() ? L"unknown" : boost::lexical_cast<std::wstring>(value);
+	}
+
+	std::wstring summary() const
+	{
+		std::lock_guard<std::mutex> lock(stats_mutex_);
+
+		return L"Compared " + boost::lexical_cast<std::wstring>(compared_) + L" frames against " + reference_path_
+				+ L": " + boost::lexical_cast<std::wstring>(identical_) + L" identical, "
+				+ boost::lexical_cast<std::wstring>(within_tolerance_) + L" within tolerance, "
+				+ boost::lexical_cast<std::wstring>(diverged_) + L" diverged"
+				+ (first_divergence_ < 0 ? L"" : L" (first at frame " + boost::lexical_cast<std::wstring>(first_divergence_) + L")")
+				+ (std::isinf(lowest_psnr_) ? L"" : L", lowest PSNR " + describe_psnr(lowest_psnr_))
+				+ L".";
+	}
+};
+
+std::wstring resolve_path(const std::wstring& path)
+{
+	if (path.empty() || boost::filesystem::path(path).is_absolute())
+		return path;
+
+	return env::data_folder() + path;
+}
+
+void describe_consumer(core::help_sink& sink, const core::help_repository& repo)
+{
+	sink.short_description(L"Writes per frame hashes of a channel and optionally compares them to a reference run.");
+	sink.syntax(L"HASH {[path:string]|yyyyMMddTHHmmss} {REFERENCE [reference:string]} {PSNR [min_db:float]} {AUDIO_TOLERANCE [max_difference:int]} {FAST}");
+	sink.para()
+		->text(L"Writes an XXH64 hash of the image planes and of the audio of every frame to ")
+		->code(L"path.hashes")->text(L", numbered from the first frame that is not silent black. Unless ")
+		->code(L"FAST")->text(L" is given the raw frames are also written to ")
+		->code(L"path.frames")->text(L" so that later runs can measure how much they differ. Relative paths are resolved against the ")
+		->code(L"data")->text(L" folder.");
+	sink.para()
+		->text(L"With ")->code(L"REFERENCE")->text(L" each frame is also compared with the same frame of an earlier run. The first diverging frame is logged, with its PSNR when the reference has frames. ")
+		->code(L"PSNR")->text(L" accepts differing images down to the given PSNR and ")
+		->code(L"AUDIO_TOLERANCE")->text(L" differing audio up to the given difference in 16-bit sample steps, for lossy paths. A summary is logged when the consumer is removed.");
+	sink.para()->text(L"Examples:");
+	sink.example(L">> ADD 1 HASH golden", L"records data/golden.hashes and data/golden.frames.");
+	sink.example(L">> ADD 1 HASH candidate REFERENCE golden PSNR 50", L"compares against the recording above, accepting frames down to 50 dB.");
+	sink.example(L">> ADD 1 HASH soak FAST", L"records hashes only, for long runs.");
+}
+
+spl::shared_ptr<core::frame_consumer> create_consumer(
+		const std::vector<std::wstring>& params,
+		core::interaction_sink*,
+		std::vector<spl::shared_ptr<video_channel>> channels)
+{
+	if (params.size() < 1 || !boost::iequals(params.at(0), L"HASH"))
+		return core::frame_consumer::empty();
+
+	std::wstring path;
+
+	if (params.size() > 1 && !boost::iequals(params.at(1), L"REFERENCE") && !boost::iequals(params.at(1), L"PSNR")
+			&& !boost::iequals(params.at(1), L"AUDIO_TOLERANCE") && !boost::iequals(params.at(1), L"FAST"))
+		path = params.at(1);
+	else
+		path = boost::posix_time::to_iso_wstring(boost::posix_time::second_clock::local_time());
+
+	return spl::make_shared<hash_consumer>(
+			resolve_path(path),
+			resolve_path(get_param(L"REFERENCE", params)),
+			get_param(L"PSNR", params, 0.0),
+			get_param(L"AUDIO_TOLERANCE", params, static_cast<std::int64_t>(0)),
+			contains_param(L"FAST", params));
+}
+
+spl::shared_ptr<core::frame_consumer> create_preconfigured_consumer(
+		const boost::property_tree::wptree& ptree,
+		core::interaction_sink*,
+		std::vector<spl::shared_ptr<video_channel>> channels)
+{
+	return spl::make_shared<hash_consumer>(
+			resolve_path(ptree.get(L"path", boost::posix_time::to_iso_wstring(boost::posix_time::second_clock::local_time()))),
+			resolve_path(ptree.get(L"reference", L"")),
+			ptree.get(L"psnr", 0.0),
+			ptree.get(L"audio-tolerance", static_cast<std::int64_t>(0)),
+			ptree.get(L"fast", false));
+}
+
+void init(module_dependencies dependencies)
+{
+	dependencies.consumer_registry->register_consumer_factory(L"Hash Consumer", &create_consumer, &describe_consumer);
+	dependencies.consumer_registry->register_preconfigured_consumer_factory(L"hash", &create_preconfigured_consumer);
+}
+
+}}}
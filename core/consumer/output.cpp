@@ -27,6 +27,7 @@
 
 #include "output.h"
 
+#include "format_adapter.h"
 #include "frame_consumer.h"
 #include "port.h"
 
@@ -45,6 +46,7 @@
 #include <common/timer.h>
 
 #include <boost/lexical_cast.hpp>
+#include <boost/optional.hpp>
 #include <boost/property_tree/ptree.hpp>
 
 #include <functional>
@@ -61,6 +63,8 @@ struct output::impl
 	std::map<int, port>					ports_;
 	prec_timer							sync_timer_;
 	std::map<int, int64_t>				send_to_consumers_delays_;
+	std::map<int, video_format_desc>	port_formats_;
+	std::map<std::wstring, std::weak_ptr<format_adapter>>	adapters_;
 	executor							executor_					{ L"output " + boost::lexical_cast<std::wstring>(channel_index_) };
 public:
         impl(spl::shared_ptr<diagnostics::graph>      graph,
@@ -73,6 +77,7 @@ public:
 		, channel_layout_(channel_layout)
 	{
 		graph_->set_color("consume-time", diagnostics::color(1.0f, 0.4f, 0.0f, 0.8f));
+		executor_.set_priority(thread_priority::OUTPUT);
 	}
 
 	void add(int index, spl::shared_ptr<frame_consumer> consumer)
@@ -83,12 +88,59 @@ public:
 
 		executor_.begin_invoke([this, index, consumer]
 		{
-			port p(index, channel_index_, std::move(consumer));
+			port p(index, channel_index_, format_desc_, std::move(consumer));
 			p.monitor_output().attach_parent(monitor_subject_);
 			ports_.insert(std::make_pair(index, std::move(p)));
 		}, task_priority::high_priority);
 	}
 
+	void add(int index, spl::shared_ptr<frame_consumer> consumer, const video_format_desc& format_desc)
+	{
+		remove(index);
+
+		// Fails early when the formats cannot be adapted.
+		if (format_desc != format_desc_)
+			format_adapter::validate(format_desc_, format_desc);
+
+		consumer->initialize(format_desc, channel_layout_, channel_index_);
+
+		// The adapter is taken in the same task as the port is built, so it
+		// matches the channel format even if that changed in between.
+		executor_.begin_invoke([this, index, consumer, format_desc]
+		{
+			try
+			{
+				port p(index, channel_index_, format_desc_, std::move(consumer), get_adapter(format_desc_, format_desc));
+				p.monitor_output().attach_parent(monitor_subject_);
+				ports_.insert(std::make_pair(index, std::move(p)));
+				port_formats_[index] = format_desc;
+			}
+			catch(...)
+			{
+				CASPAR_LOG_CURRENT_EXCEPTION();
+				CASPAR_LOG(error) << print() << L" Could not add " << consumer->print() << L".";
+			}
+		}, task_priority::high_priority);
+	}
+
+	// Consumers asking for the same format share an adapter, so each frame is
+	// only converted once per format.
+	std::shared_ptr<format_adapter> get_adapter(const video_format_desc& channel_format_desc, const video_format_desc& format_desc)
+	{
+		if (format_desc == channel_format_desc)
+			return nullptr;
+
+		auto adapter = adapters_[format_desc.name].lock();
+
+		if (!adapter)
+		{
+			adapter = std::make_shared<format_adapter>(channel_format_desc, format_desc);
+			adapters_[format_desc.name] = adapter;
+		}
+
+		return adapter;
+	}
+
 	void add(const spl::shared_ptr<frame_consumer>& consumer)
 	{
 		add(consumer->index(), consumer);
@@ -103,6 +155,7 @@ public:
 			{
 				ports_.erase(it);
 				send_to_consumers_delays_.erase(index);
+				port_formats_.erase(index);
 			}
 		}, task_priority::high_priority);
 	}
@@ -119,22 +172,38 @@ public:
 			if(format_desc_ == format_desc && channel_layout_ == channel_layout)
 				return;
 
-			auto it = ports_.begin();
-			while(it != ports_.end())
+			// Consumers are reinitialized here on the output executor, one
+			// after another, since some of them create thread affine resources
+			// like GL contexts and driver handles in initialize().
+			std::vector<int> failed;
+
+			adapters_.clear();
+
+			for (auto& p : ports_)
 			{
 				try
 				{
-					it->second.change_channel_format(format_desc, channel_layout);
-					++it;
+					auto port_format = port_formats_.find(p.first);
+					auto adapter = port_format != port_formats_.end()
+							? get_adapter(format_desc, port_format->second)
+							: nullptr;
+
+					p.second.change_channel_format(format_desc, channel_layout, std::move(adapter));
 				}
 				catch(...)
 				{
 					CASPAR_LOG_CURRENT_EXCEPTION();
-					send_to_consumers_delays_.erase(it->first);
-					ports_.erase(it++);
+					failed.push_back(p.first);
 				}
 			}
 
+			for (auto index : failed)
+			{
+				send_to_consumers_delays_.erase(index);
+				port_formats_.erase(index);
+				ports_.erase(index);
+			}
+
 			format_desc_ = format_desc;
 			channel_layout_ = channel_layout;
 		});
@@ -192,6 +261,7 @@ public:
 						CASPAR_LOG_CURRENT_EXCEPTION();
 						CASPAR_LOG(error) << "Failed to recover consumer: " << port.print() << L". Removing it.";
 						send_to_consumers_delays_.erase(it->first);
+						port_formats_.erase(it->first);
 						it = ports_.erase(it);
 					}
 				}
@@ -213,13 +283,22 @@ public:
 					if (!it->second.get())
 					{
 						send_to_consumers_delays_.erase(it->first);
+						port_formats_.erase(it->first);
 						ports_.erase(it->first);
 					}
+					else
+					{
+						auto port = ports_.find(it->first);
+
+						if (port != ports_.end())
+							port->second.record_latency();
+					}
 				}
 				catch (...)
 				{
 					CASPAR_LOG_CURRENT_EXCEPTION();
 					send_to_consumers_delays_.erase(it->first);
+					port_formats_.erase(it->first);
 					ports_.erase(it->first);
 				}
 			}
@@ -251,8 +330,13 @@ public:
 			boost::property_tree::wptree info;
 			for (auto& port : ports_)
 			{
-				info.add_child(L"consumers.consumer", port.second.info())
-					.add(L"index", port.first);
+				auto& consumer = info.add_child(L"consumers.consumer", port.second.info());
+				consumer.add(L"index", port.first);
+
+				auto port_format = port_formats_.find(port.first);
+
+				if (port_format != port_formats_.end())
+					consumer.add(L"video-mode", port_format->second.name);
 			}
 			return info;
 		}, task_priority::high_priority));
@@ -276,6 +360,7 @@ public:
 				child.add(L"age-at-arrival", sendoff_age);
 				child.add(L"presentation-time", presentation_time);
 				child.add(L"age-at-presentation", total_age);
+				child.add_child(L"latency", port.second.latency_info());
 
 				info.add_child(L"consumer", child);
 			}
@@ -283,6 +368,31 @@ public:
 		}, task_priority::high_priority));
 	}
 
+	bool set_sync_offset(int index, double offset_millis)
+	{
+		return executor_.invoke([=]
+		{
+			auto it = ports_.find(index);
+			if (it == ports_.end())
+				return false;
+
+			it->second.sync_offset(offset_millis);
+			return true;
+		}, task_priority::high_priority);
+	}
+
+	boost::optional<double> get_sync_offset(int index)
+	{
+		return executor_.invoke([=]() -> boost::optional<double>
+		{
+			auto it = ports_.find(index);
+			if (it == ports_.end())
+				return boost::none;
+
+			return it->second.sync_offset();
+		}, task_priority::high_priority);
+	}
+
 	std::vector<spl::shared_ptr<const frame_consumer>> get_consumers()
 	{
 		return executor_.invoke([=]
@@ -305,12 +415,15 @@ output::output(spl::shared_ptr<diagnostics::graph>     graph,
 {
 }
 void output::add(int index, const spl::shared_ptr<frame_consumer>& consumer) { impl_->add(index, consumer); }
+void output::add(int index, const spl::shared_ptr<frame_consumer>& consumer, const video_format_desc& format_desc) { impl_->add(index, consumer, format_desc); }
 void output::add(const spl::shared_ptr<frame_consumer>& consumer){impl_->add(consumer);}
 void output::remove(int index){impl_->remove(index);}
 void output::remove(const spl::shared_ptr<frame_consumer>& consumer){impl_->remove(consumer);}
 std::future<boost::property_tree::wptree> output::info() const{return impl_->info();}
 std::future<boost::property_tree::wptree> output::delay_info() const{ return impl_->delay_info(); }
 std::vector<spl::shared_ptr<const frame_consumer>> output::get_consumers() const { return impl_->get_consumers(); }
+bool output::set_sync_offset(int index, double offset_millis) { return impl_->set_sync_offset(index, offset_millis); }
+boost::optional<double> output::get_sync_offset(int index) const { return impl_->get_sync_offset(index); }
 std::future<void> output::operator()(frame_timecode                    timecode,
                                      const_frame                       frame,
                                      const video_format_desc&          format_desc,
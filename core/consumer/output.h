@@ -28,6 +28,7 @@
 #include <common/future_fwd.h>
 #include <common/memory.h>
 
+#include <boost/optional.hpp>
 #include <boost/property_tree/ptree_fwd.hpp>
 
 #include <future>
@@ -59,9 +60,17 @@ public:
 
   void add(const spl::shared_ptr<frame_consumer>& consumer);
   void add(int index, const spl::shared_ptr<frame_consumer>& consumer);
+  // Adds a consumer that runs at another format than the channel, frames are
+  // converted by an adapter shared by the consumers with the same format.
+  void add(int index, const spl::shared_ptr<frame_consumer>& consumer, const video_format_desc& format_desc);
   void remove(const spl::shared_ptr<frame_consumer>& consumer);
   void remove(int index);
 
+  // Audio/video sync offset of a consumer in milliseconds, positive delays the audio.
+  // Returns false if there is no consumer with the index.
+  bool set_sync_offset(int index, double offset_millis);
+  boost::optional<double> get_sync_offset(int index) const;
+
   monitor::subject& monitor_output();
 
   // Properties
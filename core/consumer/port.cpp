@@ -2,10 +2,23 @@
 
 #include "port.h"
 
+#include "format_adapter.h"
 #include "frame_consumer.h"
+#include "../frame/audio_channel_layout.h"
 #include "../frame/frame.h"
+#include "../latency.h"
+#include "../mixer/audio/audio_delay_line.h"
+#include "../video_format.h"
+
+#include <common/executor.h>
+#include <common/future.h>
+#include <common/memory.h>
+
 #include <boost/lexical_cast.hpp>
+#include <boost/property_tree/ptree.hpp>
 
+#include <cmath>
+#include <deque>
 #include <future>
 
 namespace caspar { namespace core {
@@ -16,25 +29,153 @@ struct port::impl
 	spl::shared_ptr<monitor::subject>	monitor_subject_ = spl::make_shared<monitor::subject>("/port/" + boost::lexical_cast<std::string>(index_));
 	spl::shared_ptr<frame_consumer>		consumer_;
 	int									channel_index_;
+	video_format_desc					format_desc_;
+	double								sync_offset_	= 0.0;
+	audio_delay_line<int32_t>			audio_delay_;
+	std::deque<const_frame>				delayed_video_;
+	latency_histogram					latency_;
+	std::shared_ptr<format_adapter>		adapter_;
+	std::unique_ptr<executor>			adapted_sends_;	// Last, pending sends refer to the members above.
 public:
-	impl(int index, int channel_index, spl::shared_ptr<frame_consumer> consumer)
+	impl(int index, int channel_index, const video_format_desc& format_desc, spl::shared_ptr<frame_consumer> consumer, std::shared_ptr<format_adapter> adapter)
 		: index_(index)
 		, consumer_(std::move(consumer))
 		, channel_index_(channel_index)
+		, format_desc_(adapter ? adapter->format_desc() : format_desc)
 	{
 		consumer_->monitor_output().attach_parent(monitor_subject_);
+		set_adapter(std::move(adapter));
 	}
 
 	void change_channel_format(const core::video_format_desc&           format_desc,
-                                   const audio_channel_layout&              channel_layout)
+                                   const audio_channel_layout&              channel_layout,
+                                   std::shared_ptr<format_adapter>          adapter)
 	{
-		consumer_->initialize(format_desc, channel_layout, channel_index_);
+		if (adapted_sends_)
+			adapted_sends_->wait();
+
+		auto consumer_format_desc = adapter ? adapter->format_desc() : format_desc;
+
+		consumer_->initialize(consumer_format_desc, channel_layout, channel_index_);
+		format_desc_ = consumer_format_desc;
+		set_adapter(std::move(adapter));
+		delayed_video_.clear();
+		latency_.clear();
+	}
+
+	void set_adapter(std::shared_ptr<format_adapter> adapter)
+	{
+		adapter_ = std::move(adapter);
+
+		if (adapter_ && !adapted_sends_)
+			adapted_sends_.reset(new executor(L"port " + boost::lexical_cast<std::wstring>(index_) + L" " + adapter_->format_desc().name));
 	}
 
 	std::future<bool> send(frame_timecode timecode, const_frame frame)
 	{
 		*monitor_subject_ << monitor::message("/type") % consumer_->name();
-		return consumer_->send(timecode, std::move(frame));
+
+		if (!adapter_)
+			return consumer_->send(timecode, delay(std::move(frame)));
+
+		// The adapter may turn a channel frame into none or several frames,
+		// which are sent one after another once the consumer is ready.
+		auto frames	= (*adapter_)(frame);
+		auto fps	= static_cast<uint8_t>(std::round(format_desc_.fps));
+
+		return adapted_sends_->begin_invoke([=]
+		{
+			auto frame_timecode = timecode == frame_timecode::empty() ? timecode : timecode.with_fps(fps);
+
+			for (auto& adapted : frames.get())
+			{
+				if (!consumer_->send(frame_timecode, delay(adapted)).get())
+					return false;
+
+				if (frame_timecode != frame_timecode::empty())
+					frame_timecode += 1;
+			}
+
+			return true;
+		});
+	}
+
+	// Compensates for lip-sync errors in downstream devices. Positive offsets
+	// delay the audio, negative offsets delay the video by whole frames and the
+	// audio by the remainder.
+	const_frame delay(const_frame frame)
+	{
+		auto delays = split_sync_offset(sync_offset_, format_desc_.fps, format_desc_.audio_sample_rate);
+
+		if (delays.video_frames > 0 || !delayed_video_.empty())
+		{
+			delayed_video_.push_back(frame);
+
+			// A shorter delay is caught up by skipping one extra frame per
+			// frame instead of jumping, a longer one repeats the oldest frame
+			// until enough frames are held back.
+			for (int n = 0; n < 2 && delayed_video_.size() > static_cast<size_t>(delays.video_frames) + 1; ++n)
+				delayed_video_.pop_front();
+
+			auto video = delayed_video_.front();
+
+			if (delays.video_frames == 0 && delayed_video_.size() == 1)
+				delayed_video_.clear();
+
+			frame = video.with_audio(frame.audio_data());
+		}
+
+		const auto num_channels = frame.audio_channel_layout().num_channels;
+
+		if (num_channels < 1 || frame.audio_data().empty())
+			return frame;
+
+		audio_delay_.configure(format_desc_.audio_sample_rate, num_channels);
+
+		if (delays.audio_samples == 0 && audio_delay_.idle())
+			return frame;
+
+		auto audio_owner = spl::make_shared<mutable_audio_buffer>(frame.audio_data().begin(), frame.audio_data().end());
+		audio_delay_.process(audio_owner->data(), audio_owner->size() / num_channels, delays.audio_samples);
+
+		auto& audio = *audio_owner;
+		return frame.with_audio(caspar::array<int32_t>(audio.data(), audio.size(), true, std::move(audio_owner)));
+	}
+
+	// Samples the age of the frame last presented by the consumer, which is the
+	// latency from the production of its youngest content to presentation.
+	void record_latency()
+	{
+		auto age = consumer_->presentation_frame_age_millis();
+
+		if (age <= 0)
+			return;
+
+		latency_.add(age);
+		*monitor_subject_ << monitor::message("/latency") % age;
+	}
+
+	boost::property_tree::wptree latency_info() const
+	{
+		return latency_.info(format_desc_.fps);
+	}
+
+	// Adapted ports apply the delay on their send executor, so the offset is
+	// only touched there.
+	void sync_offset(double offset_millis)
+	{
+		if (adapter_)
+			adapted_sends_->begin_invoke([=] { sync_offset_ = offset_millis; }, task_priority::high_priority);
+		else
+			sync_offset_ = offset_millis;
+	}
+
+	double sync_offset() const
+	{
+		if (adapter_)
+			return adapted_sends_->invoke([=] { return sync_offset_; }, task_priority::high_priority);
+
+		return sync_offset_;
 	}
 	std::wstring print() const
 	{
@@ -51,9 +192,10 @@ public:
 		return consumer_->buffer_depth();
 	}
 
+	// Adapted consumers run at another frame rate and follow the channel clock.
 	bool has_synchronization_clock() const
 	{
-		return consumer_->has_synchronization_clock();
+		return consumer_->has_synchronization_clock() && !adapter_;
 	}
 
 	boost::property_tree::wptree info() const
@@ -72,21 +214,26 @@ public:
 	}
 };
 
-port::port(int index, int channel_index, spl::shared_ptr<frame_consumer> consumer) : impl_(new impl(index, channel_index, std::move(consumer))){}
+port::port(int index, int channel_index, const video_format_desc& format_desc, spl::shared_ptr<frame_consumer> consumer, std::shared_ptr<format_adapter> adapter) : impl_(new impl(index, channel_index, format_desc, std::move(consumer), std::move(adapter))){}
 port::port(port&& other) : impl_(std::move(other.impl_)){}
 port::~port(){}
 port& port::operator=(port&& other){impl_ = std::move(other.impl_); return *this;}
 std::future<bool> port::send(frame_timecode timecode, const_frame frame) { return impl_->send(timecode, std::move(frame)); }
+void port::sync_offset(double offset_millis) { impl_->sync_offset(offset_millis); }
+void port::record_latency() { impl_->record_latency(); }
+double port::sync_offset() const { return impl_->sync_offset(); }
 monitor::subject& port::monitor_output() { return *impl_->monitor_subject_; }
 void              port::change_channel_format(const core::video_format_desc&          format_desc,
-                                 const audio_channel_layout&             channel_layout)
+                                 const audio_channel_layout&             channel_layout,
+                                 std::shared_ptr<format_adapter>         adapter)
 {
-    impl_->change_channel_format(format_desc, channel_layout);
+    impl_->change_channel_format(format_desc, channel_layout, std::move(adapter));
 }
 int                          port::buffer_depth() const { return impl_->buffer_depth(); }
 std::wstring port::print() const{ return impl_->print();}
 bool port::has_synchronization_clock() const{return impl_->has_synchronization_clock();}
 boost::property_tree::wptree port::info() const{return impl_->info();}
 int64_t port::presentation_frame_age_millis() const{ return impl_->presentation_frame_age_millis(); }
+boost::property_tree::wptree port::latency_info() const{ return impl_->latency_info(); }
 spl::shared_ptr<const frame_consumer> port::consumer() const { return impl_->consumer(); }
 }}
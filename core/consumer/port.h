@@ -20,7 +20,9 @@ public:
 
 	// Constructors
 
-	port(int index, int channel_index, spl::shared_ptr<frame_consumer> consumer);
+	// Consumers that run at another format than the channel are given an
+	// adapter that converts the frames of the channel.
+	port(int index, int channel_index, const video_format_desc& format_desc, spl::shared_ptr<frame_consumer> consumer, std::shared_ptr<format_adapter> adapter = nullptr);
 	port(port&& other);
 	~port();
 
@@ -29,18 +31,23 @@ public:
 	port& operator=(port&& other);
 
 	std::future<bool> send(frame_timecode timecode, const_frame frame);
+	void sync_offset(double offset_millis);
+	void record_latency();
 
 	monitor::subject& monitor_output();
 
 	// Properties
 
 	void                                  change_channel_format(const video_format_desc&                 format_desc,
-                                                                    const audio_channel_layout&              channel_layout);
+                                                                    const audio_channel_layout&              channel_layout,
+                                                                    std::shared_ptr<format_adapter>          adapter = nullptr);
 	std::wstring print() const;
 	int buffer_depth() const;
 	bool has_synchronization_clock() const;
 	boost::property_tree::wptree info() const;
 	int64_t presentation_frame_age_millis() const;
+	boost::property_tree::wptree latency_info() const;
+	double sync_offset() const;
 	spl::shared_ptr<const frame_consumer> consumer() const;
 private:
 	struct impl;
@@ -0,0 +1,177 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../StdAfx.h"
+
+#include "color_conversion.h"
+
+#include "pixel_format.h"
+
+#include <tbb/parallel_for.h>
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <array>
+
+namespace caspar { namespace core {
+
+namespace {
+
+// Studio range to full range contributions in 16.16 fixed point.
+struct conversion_tables
+{
+	std::array<int, 256> y;
+	std::array<int, 256> cr_r;
+	std::array<int, 256> cb_g;
+	std::array<int, 256> cr_g;
+	std::array<int, 256> cb_b;
+
+	// The same factors for _mm_mulhi_epi16 on values shifted up by 6 bits,
+	// giving results with 2 fractional bits.
+	std::int16_t simd_y;
+	std::int16_t simd_cr_r;
+	std::int16_t simd_cb_g;
+	std::int16_t simd_cr_g;
+	std::int16_t simd_cb_b;
+
+	conversion_tables(double kr, double kb)
+	{
+		auto kg = 1.0 - kr - kb;
+
+		simd_y		= static_cast<std::int16_t>(255.0 / 219.0 * 4096.0 + 0.5);
+		simd_cr_r	= static_cast<std::int16_t>(255.0 / 224.0 * 2.0 * (1.0 - kr) * 4096.0 + 0.5);
+		simd_cb_g	= static_cast<std::int16_t>(-255.0 / 224.0 * 2.0 * (1.0 - kb) * kb / kg * 4096.0 - 0.5);
+		simd_cr_g	= static_cast<std::int16_t>(-255.0 / 224.0 * 2.0 * (1.0 - kr) * kr / kg * 4096.0 - 0.5);
+		simd_cb_b	= static_cast<std::int16_t>(255.0 / 224.0 * 2.0 * (1.0 - kb) * 4096.0 + 0.5);
+
+		for (int n = 0; n < 256; ++n)
+		{
+			auto luma	= (n - 16) * 255.0 / 219.0;
+			auto chroma	= (n - 128) * 255.0 / 224.0;
+
+			y[n]	= static_cast<int>(luma * 65536.0 + 32768.0);
+			cr_r[n]	= static_cast<int>(chroma * 2.0 * (1.0 - kr) * 65536.0);
+			cb_g[n]	= static_cast<int>(-chroma * 2.0 * (1.0 - kb) * kb / kg * 65536.0);
+			cr_g[n]	= static_cast<int>(-chroma * 2.0 * (1.0 - kr) * kr / kg * 65536.0);
+			cb_b[n]	= static_cast<int>(chroma * 2.0 * (1.0 - kb) * 65536.0);
+		}
+	}
+};
+
+inline std::uint8_t clamp(int value)
+{
+	return static_cast<std::uint8_t>(std::min(255, std::max(0, value >> 16)));
+}
+
+// 16 pixels of a line with horizontally halved chroma, the common 4:2:2 and 4:2:0 case.
+inline void convert16_x2(const conversion_tables& tables, const std::uint8_t* luma, const std::uint8_t* cb, const std::uint8_t* cr, std::uint8_t* out)
+{
+	const auto zero		= _mm_setzero_si128();
+	const auto alpha	= _mm_set1_epi8(-1);
+	const auto round	= _mm_set1_epi16(2);
+
+	auto y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(luma));
+	auto u = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cb));
+	auto v = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(cr));
+
+	u = _mm_unpacklo_epi8(u, u);
+	v = _mm_unpacklo_epi8(v, v);
+
+	__m128i b[2], g[2], r[2];
+
+	for (int half = 0; half < 2; ++half)
+	{
+		auto y16 = half == 0 ? _mm_unpacklo_epi8(y, zero) : _mm_unpackhi_epi8(y, zero);
+		auto u16 = half == 0 ? _mm_unpacklo_epi8(u, zero) : _mm_unpackhi_epi8(u, zero);
+		auto v16 = half == 0 ? _mm_unpacklo_epi8(v, zero) : _mm_unpackhi_epi8(v, zero);
+
+		y16 = _mm_slli_epi16(_mm_sub_epi16(y16, _mm_set1_epi16(16)), 6);
+		u16 = _mm_slli_epi16(_mm_sub_epi16(u16, _mm_set1_epi16(128)), 6);
+		v16 = _mm_slli_epi16(_mm_sub_epi16(v16, _mm_set1_epi16(128)), 6);
+
+		auto l = _mm_add_epi16(_mm_mulhi_epi16(y16, _mm_set1_epi16(tables.simd_y)), round);
+
+		b[half] = _mm_srai_epi16(_mm_add_epi16(l, _mm_mulhi_epi16(u16, _mm_set1_epi16(tables.simd_cb_b))), 2);
+		g[half] = _mm_srai_epi16(_mm_add_epi16(l, _mm_add_epi16(_mm_mulhi_epi16(u16, _mm_set1_epi16(tables.simd_cb_g)), _mm_mulhi_epi16(v16, _mm_set1_epi16(tables.simd_cr_g)))), 2);
+		r[half] = _mm_srai_epi16(_mm_add_epi16(l, _mm_mulhi_epi16(v16, _mm_set1_epi16(tables.simd_cr_r))), 2);
+	}
+
+	auto b8 = _mm_packus_epi16(b[0], b[1]);
+	auto g8 = _mm_packus_epi16(g[0], g[1]);
+	auto r8 = _mm_packus_epi16(r[0], r[1]);
+
+	auto bg_lo = _mm_unpacklo_epi8(b8, g8);
+	auto bg_hi = _mm_unpackhi_epi8(b8, g8);
+	auto ra_lo = _mm_unpacklo_epi8(r8, alpha);
+	auto ra_hi = _mm_unpackhi_epi8(r8, alpha);
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out) + 0, _mm_unpacklo_epi16(bg_lo, ra_lo));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out) + 1, _mm_unpackhi_epi16(bg_lo, ra_lo));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out) + 2, _mm_unpacklo_epi16(bg_hi, ra_hi));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(out) + 3, _mm_unpackhi_epi16(bg_hi, ra_hi));
+}
+
+}
+
+void ycbcr_to_bgra(const pixel_format_desc& desc, const std::uint8_t* const planes[3], std::uint8_t* destination)
+{
+	static const conversion_tables bt601(0.299, 0.114);
+	static const conversion_tables bt709(0.2126, 0.0722);
+	static const conversion_tables bt2020(0.2627, 0.0593);
+
+	auto space			= resolve_color_space(desc.color_space, desc.planes.at(0).height);
+	const auto& tables	= space == color_space::bt2020 ? bt2020 : (space == color_space::bt709 ? bt709 : bt601);
+	auto width			= desc.planes.at(0).width;
+	auto height			= desc.planes.at(0).height;
+	auto chroma_width	= desc.planes.at(1).width;
+	auto chroma_height	= desc.planes.at(1).height;
+	auto x_shift		= chroma_width * 4 <= width ? 2 : (chroma_width * 2 <= width ? 1 : 0);
+	auto y_shift		= chroma_height * 2 <= height ? 1 : 0;
+
+	tbb::parallel_for(0, height, [&](int y)
+	{
+		auto luma	= planes[0] + y * desc.planes.at(0).linesize;
+		auto cb		= planes[1] + (y >> y_shift) * desc.planes.at(1).linesize;
+		auto cr		= planes[2] + (y >> y_shift) * desc.planes.at(2).linesize;
+		auto out	= destination + y * width * 4;
+		int x		= 0;
+
+		if (x_shift == 1)
+		{
+			for (; x + 16 <= width; x += 16)
+				convert16_x2(tables, luma + x, cb + x / 2, cr + x / 2, out + x * 4);
+		}
+
+		for (; x < width; ++x)
+		{
+			auto l = tables.y[luma[x]];
+			auto u = cb[x >> x_shift];
+			auto v = cr[x >> x_shift];
+
+			out[x * 4 + 0] = clamp(l + tables.cb_b[u]);
+			out[x * 4 + 1] = clamp(l + tables.cb_g[u] + tables.cr_g[v]);
+			out[x * 4 + 2] = clamp(l + tables.cr_r[v]);
+			out[x * 4 + 3] = 255;
+		}
+	});
+}
+
+}}
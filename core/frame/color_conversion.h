@@ -0,0 +1,37 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+
+namespace caspar { namespace core {
+
+struct pixel_format_desc;
+
+/**
+ * Converts an 8-bit planar ycbcr image to opaque bgra. The chroma subsampling
+ * is taken from the plane sizes and the matrix from the colour space of the
+ * image, which like in the gpu mixer defaults to BT.709 above 700 lines and
+ * BT.601 below. Only the matrix is applied, not a transfer conversion.
+ */
+void ycbcr_to_bgra(const pixel_format_desc& desc, const std::uint8_t* const planes[3], std::uint8_t* destination);
+
+}}
@@ -0,0 +1,170 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+
+#include "../StdAfx.h"
+
+#include "color_lut.h"
+
+#include <common/env.h>
+#include <common/except.h>
+#include <common/os/filesystem.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <sstream>
+
+namespace caspar { namespace core {
+
+std::shared_ptr<const color_lut> read_color_lut(const std::wstring& name, std::istream& stream)
+{
+	auto lut	= std::make_shared<color_lut>();
+	lut->name	= name;
+
+	std::string	line;
+	int			line_number	= 0;
+	std::size_t	expected	= 0;
+
+	auto fail = [&](const std::wstring& message)
+	{
+		CASPAR_THROW_EXCEPTION(user_error() << msg_info(name + L":" + boost::lexical_cast<std::wstring>(line_number) + L" " + message));
+	};
+
+	while (std::getline(stream, line))
+	{
+		++line_number;
+
+		if (!line.empty() && line.back() == '\r')
+			line.pop_back();
+
+		auto start = line.find_first_not_of(" \t");
+
+		if (start == std::string::npos || line[start] == '#')
+			continue;
+
+		std::istringstream words(line.substr(start));
+		std::string keyword;
+
+		if (std::isdigit(static_cast<unsigned char>(line[start])) || line[start] == '-' || line[start] == '.')
+		{
+			float r, g, b;
+
+			if (!(words >> r >> g >> b))
+				fail(L"Invalid table entry.");
+
+			if (expected == 0)
+				fail(L"Table entries before LUT_3D_SIZE.");
+
+			if (lut->table.size() >= expected)
+				fail(L"Too many table entries.");
+
+			lut->table.push_back(r);
+			lut->table.push_back(g);
+			lut->table.push_back(b);
+
+			continue;
+		}
+
+		words >> keyword;
+
+		if (keyword == "LUT_3D_SIZE")
+		{
+			if (!(words >> lut->size) || lut->size < 2 || lut->size > 256)
+				fail(L"LUT_3D_SIZE must be between 2 and 256.");
+
+			expected = static_cast<std::size_t>(lut->size) * lut->size * lut->size * 3;
+			lut->table.reserve(expected);
+		}
+		else if (keyword == "DOMAIN_MIN")
+		{
+			if (!(words >> lut->domain_min[0] >> lut->domain_min[1] >> lut->domain_min[2]))
+				fail(L"Invalid DOMAIN_MIN.");
+		}
+		else if (keyword == "DOMAIN_MAX")
+		{
+			if (!(words >> lut->domain_max[0] >> lut->domain_max[1] >> lut->domain_max[2]))
+				fail(L"Invalid DOMAIN_MAX.");
+		}
+		else if (keyword == "LUT_1D_SIZE" || keyword == "LUT_1D_INPUT_RANGE")
+			fail(L"1D lookup tables are not supported.");
+		else if (keyword != "TITLE" && keyword != "LUT_3D_INPUT_RANGE")
+			fail(L"Unknown keyword " + boost::lexical_cast<std::wstring>(keyword.c_str()) + L".");
+	}
+
+	if (expected == 0 || lut->table.size() != expected)
+		CASPAR_THROW_EXCEPTION(user_error() << msg_info(name + L" does not hold a complete 3D lookup table."));
+
+	for (int n = 0; n < 3; ++n)
+	{
+		if (!(lut->domain_max[n] > lut->domain_min[n]))
+			CASPAR_THROW_EXCEPTION(user_error() << msg_info(name + L" has an empty domain."));
+	}
+
+	return lut;
+}
+
+std::shared_ptr<const color_lut> load_color_lut(const std::wstring& name)
+{
+	struct cached_lut
+	{
+		std::time_t							write_time;
+		std::shared_ptr<const color_lut>	lut;
+	};
+
+	static std::mutex							mutex;
+	static std::map<std::wstring, cached_lut>	cache;
+
+	auto path = name;
+
+	if (!boost::iends_with(path, L".cube"))
+		path += L".cube";
+
+	auto found = find_case_insensitive(env::media_folder() + path);
+
+	if (!found)
+		CASPAR_THROW_EXCEPTION(file_not_found() << msg_info(L"Could not find lookup table " + path));
+
+	auto write_time = boost::filesystem::last_write_time(*found);
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto& cached = cache[*found];
+
+	if (cached.lut && cached.write_time == write_time)
+		return cached.lut;
+
+	boost::filesystem::ifstream stream(boost::filesystem::path(*found), std::ios::binary);
+
+	if (!stream)
+		CASPAR_THROW_EXCEPTION(file_read_error() << msg_info(L"Could not open lookup table " + *found));
+
+	cached.lut			= read_color_lut(name, stream);
+	cached.write_time	= write_time;
+
+	return cached.lut;
+}
+
+}}
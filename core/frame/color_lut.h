@@ -0,0 +1,49 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <array>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace caspar { namespace core {
+
+// A 3D colour lookup table from a .cube file. The table holds size^3 rgb
+// entries with red changing fastest, mapping the domain_min to domain_max
+// cube of the input.
+struct color_lut final
+{
+	std::wstring			name;
+	int						size		= 0;
+	std::array<float, 3>	domain_min	= {{ 0.0f, 0.0f, 0.0f }};
+	std::array<float, 3>	domain_max	= {{ 1.0f, 1.0f, 1.0f }};
+	std::vector<float>		table;
+};
+
+std::shared_ptr<const color_lut> read_color_lut(const std::wstring& name, std::istream& stream);
+
+// Loads a .cube file relative to the media folder. Loaded tables are shared
+// and only read again when the file has changed.
+std::shared_ptr<const color_lut> load_color_lut(const std::wstring& name);
+
+}}
@@ -0,0 +1,101 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../StdAfx.h"
+
+#include "color_space.h"
+
+#include <boost/algorithm/string/predicate.hpp>
+
+namespace caspar { namespace core {
+
+color_space get_color_space(const std::wstring& str)
+{
+	if (boost::iequals(str, L"bt601") || boost::iequals(str, L"601"))
+		return color_space::bt601;
+	else if (boost::iequals(str, L"bt709") || boost::iequals(str, L"709"))
+		return color_space::bt709;
+	else if (boost::iequals(str, L"bt2020") || boost::iequals(str, L"2020"))
+		return color_space::bt2020;
+
+	return color_space::unspecified;
+}
+
+std::wstring get_color_space(color_space space)
+{
+	switch (space)
+	{
+	case color_space::bt601:
+		return L"bt601";
+	case color_space::bt709:
+		return L"bt709";
+	case color_space::bt2020:
+		return L"bt2020";
+	default:
+		return L"unspecified";
+	}
+}
+
+color_transfer get_color_transfer(const std::wstring& str)
+{
+	if (boost::iequals(str, L"sdr") || boost::iequals(str, L"bt1886"))
+		return color_transfer::sdr;
+	else if (boost::iequals(str, L"pq") || boost::iequals(str, L"st2084"))
+		return color_transfer::pq;
+	else if (boost::iequals(str, L"hlg"))
+		return color_transfer::hlg;
+
+	return color_transfer::unspecified;
+}
+
+std::wstring get_color_transfer(color_transfer transfer)
+{
+	switch (transfer)
+	{
+	case color_transfer::sdr:
+		return L"sdr";
+	case color_transfer::pq:
+		return L"pq";
+	case color_transfer::hlg:
+		return L"hlg";
+	default:
+		return L"unspecified";
+	}
+}
+
+color_space resolve_color_space(color_space space, int height)
+{
+	if (space != color_space::unspecified)
+		return space;
+
+	return height > 700 ? color_space::bt709 : color_space::bt601;
+}
+
+color_transfer resolve_color_transfer(color_transfer transfer)
+{
+	return transfer == color_transfer::unspecified ? color_transfer::sdr : transfer;
+}
+
+bool needs_color_transform(color_space from_space, color_transfer from_transfer, color_space to_space, color_transfer to_transfer)
+{
+	return (from_space == color_space::bt2020) != (to_space == color_space::bt2020) || from_transfer != to_transfer;
+}
+
+}}
@@ -0,0 +1,62 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <string>
+
+namespace caspar { namespace core {
+
+// Primaries and ycbcr matrix of an image. BT.601 and BT.709 are treated as
+// sharing primaries, as is common broadcast practice, and only differ in
+// their matrix.
+enum class color_space
+{
+	unspecified = 0,
+	bt601,
+	bt709,
+	bt2020
+};
+
+// Transfer function of an image, sdr being the BT.1886 display gamma.
+enum class color_transfer
+{
+	unspecified = 0,
+	sdr,
+	pq,
+	hlg
+};
+
+color_space get_color_space(const std::wstring& str);
+std::wstring get_color_space(color_space space);
+color_transfer get_color_transfer(const std::wstring& str);
+std::wstring get_color_transfer(color_transfer transfer);
+
+// Unspecified colour spaces are decided by the image height the way the
+// mixers always have, BT.709 above 700 lines and BT.601 below. Unspecified
+// transfer functions are sdr.
+color_space resolve_color_space(color_space space, int height);
+color_transfer resolve_color_transfer(color_transfer transfer);
+
+// Whether resolved images differ in more than their ycbcr matrix, that is
+// whether mixing one in the other needs a primaries or transfer conversion.
+bool needs_color_transform(color_space from_space, color_transfer from_transfer, color_space to_space, color_transfer to_transfer);
+
+}}
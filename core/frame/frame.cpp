@@ -122,6 +122,7 @@ struct const_frame::impl : boost::noncopyable
 	mutable tbb::atomic<int64_t>										recorded_age_;
 	std::shared_future<array<const std::uint8_t>>						key_only_on_demand_;
 	boost::any															opaque_;
+	std::shared_ptr<const_frame>										passthrough_;
 
 	impl(const void* tag)
 		: audio_data_(0, 0, true, 0)
@@ -144,6 +145,7 @@ struct const_frame::impl : boost::noncopyable
 		, since_created_timer_(other.since_created_timer_)
 		, should_record_age_(other.should_record_age_)
 		, key_only_on_demand_(other.key_only_on_demand_)
+		, passthrough_(other.passthrough_)
 	{
 		recorded_age_ = other.recorded_age_;
 	}
@@ -166,11 +168,32 @@ struct const_frame::impl : boost::noncopyable
 		if (desc.format != core::pixel_format::bgra)
 			CASPAR_THROW_EXCEPTION(not_implemented());
 
-		future_buffers_.push_back(image);
+		if (desc.planes.size() < 2)
+			future_buffers_.push_back(image);
+		else
+		{
+			// The planes are laid out back to back in the same buffer.
+			int offset = 0;
+
+			for (auto& plane : desc.planes)
+			{
+				auto size = plane.size;
+
+				future_buffers_.push_back(std::async(std::launch::deferred, [image, offset, size]
+				{
+					auto all = image.get();
+					return array<const std::uint8_t>(all.begin() + offset, size, true, all);
+				}).share());
+
+				offset += size;
+			}
+		}
 
-		key_only_on_demand_ = std::async(std::launch::deferred, [image]
+		auto fill_future = future_buffers_.front();
+
+		key_only_on_demand_ = std::async(std::launch::deferred, [fill_future]
 		{
-			auto fill	= image.get();
+			auto fill	= fill_future.get();
 			auto key	= cache_aligned_vector<std::uint8_t>(fill.size());
 
 			aligned_memshfl(key.data(), fill.data(), fill.size(), 0x0F0F0F0F, 0x0B0B0B0B, 0x07070707, 0x03030303);
@@ -211,7 +234,12 @@ struct const_frame::impl : boost::noncopyable
 
 	spl::shared_ptr<impl> key_only() const
 	{
-		return spl::make_shared<impl>(key_only_on_demand_, audio_data_, tag_, desc_, channel_layout_, since_created_timer_);
+		auto key_desc = desc_;
+
+		if (key_desc.planes.size() > 1)
+			key_desc.planes.resize(1);
+
+		return spl::make_shared<impl>(key_only_on_demand_, audio_data_, tag_, key_desc, channel_layout_, since_created_timer_);
 	}
 
 	std::size_t width() const
@@ -288,7 +316,37 @@ const_frame const_frame::with_geometry(const frame_geometry& g) const
 
 	return copy;
 }
+const_frame const_frame::with_audio(core::audio_buffer audio_data) const
+{
+	const_frame copy(*impl_);
+
+	copy.impl_->audio_data_ = std::move(audio_data);
+
+	return copy;
+}
+const const_frame& const_frame::passthrough() const
+{
+	return impl_->passthrough_ ? *impl_->passthrough_ : empty();
+}
+const_frame const_frame::with_passthrough(const const_frame& source) const
+{
+	const_frame copy(*impl_);
+
+	copy.impl_->passthrough_ = std::make_shared<const_frame>(source);
+
+	return copy;
+}
 int64_t const_frame::get_age_millis() const { return impl_->get_age_millis(); }
+caspar::timer const_frame::since_created() const { return impl_->since_created_timer_; }
+const_frame const_frame::with_origin(const caspar::timer& since_created) const
+{
+	const_frame copy(*impl_);
+
+	copy.impl_->since_created_timer_	= since_created;
+	copy.impl_->should_record_age_		= false;
+
+	return copy;
+}
 const_frame const_frame::key_only() const
 {
 	auto result		= const_frame();
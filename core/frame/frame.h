@@ -125,8 +125,21 @@ public:
 
 	const core::frame_geometry& geometry() const;
 	const_frame with_geometry(const frame_geometry& g) const;
+	const_frame with_audio(core::audio_buffer audio_data) const;
+
+	// The untouched source of a mix that is a single untransformed full raster
+	// frame, typically decoder ycbcr planes, so that consumers can skip their
+	// colour conversion. Empty otherwise.
+	const const_frame& passthrough() const;
+	const_frame with_passthrough(const const_frame& source) const;
 	int64_t get_age_millis() const;
 
+	// The moment the content of the frame was produced. Mixed frames carry the
+	// origin of their youngest source, so that the age seen by a consumer is
+	// the latency from production to presentation.
+	caspar::timer since_created() const;
+	const_frame with_origin(const caspar::timer& since_created) const;
+
 	bool operator==(const const_frame& other);
 	bool operator!=(const const_frame& other);
 	bool operator<(const const_frame& other);
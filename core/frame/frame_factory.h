@@ -22,6 +22,7 @@
 #pragma once
 
 #include "frame.h"
+#include "color_space.h"
 #include "../fwd.h"
 
 #include <common/memory.h>
@@ -61,6 +62,15 @@ public:
 	// Properties
 
 	virtual int get_max_frame_size() = 0;
+
+	// Bits per component used when mixing. Producers may hand over
+	// pixel_format::bgra16 frames when this is greater than 8.
+	virtual int get_mixing_bit_depth() { return 8; }
+
+	// The colour space and transfer function of the mixed image. Frames in
+	// other colour spaces are converted, unspecified follows the video format.
+	virtual core::color_space get_working_color_space() const { return core::color_space::unspecified; }
+	virtual core::color_transfer get_working_color_transfer() const { return core::color_transfer::unspecified; }
 };
 
 }}
\ No newline at end of file
@@ -108,6 +108,15 @@ image_transform& image_transform::operator*=(const image_transform &other)
 	blend_mode							 = std::max(blend_mode, other.blend_mode);
 	layer_depth							+= other.layer_depth;
 
+	if (other.color_space != core::color_space::unspecified)
+		color_space						 = other.color_space;
+
+	if (other.color_transfer != core::color_transfer::unspecified)
+		color_transfer					 = other.color_transfer;
+
+	if (other.grade.lut || other.grade.from)
+		grade							 = other.grade;
+
 	return *this;
 }
 
@@ -180,6 +189,22 @@ image_transform image_transform::tween(double time, const image_transform& sourc
 	result.use_mipmap						= source.use_mipmap | dest.use_mipmap;
 	result.blend_mode						= std::max(source.blend_mode, dest.blend_mode);
 	result.layer_depth						= dest.layer_depth;
+	result.color_space						= dest.color_space;
+	result.color_transfer					= dest.color_transfer;
+	result.grade.lut						= dest.grade.lut;
+
+	if (source.grade.lut == dest.grade.lut)
+	{
+		result.grade.mix					= do_tween(time, source.grade.mix,							dest.grade.mix,							duration, tween);
+		result.grade.from					= source.grade.from;
+		result.grade.from_mix				= do_tween(time, source.grade.from_mix,						0.0,									duration, tween);
+	}
+	else
+	{
+		result.grade.mix					= do_tween(time, 0.0,										dest.grade.mix,							duration, tween);
+		result.grade.from					= source.grade.lut;
+		result.grade.from_mix				= do_tween(time, source.grade.mix,							0.0,									duration, tween);
+	}
 
 	do_tween_rectangle(source.crop, dest.crop, result.crop, time, duration, tween);
 	do_tween_corners(source.perspective, dest.perspective, result.perspective, time, duration, tween);
@@ -228,6 +253,12 @@ bool operator==(const image_transform& lhs, const image_transform& rhs)
 		lhs.use_mipmap == rhs.use_mipmap &&
 		lhs.blend_mode == rhs.blend_mode &&
 		lhs.layer_depth == rhs.layer_depth &&
+		lhs.color_space == rhs.color_space &&
+		lhs.color_transfer == rhs.color_transfer &&
+		lhs.grade.lut == rhs.grade.lut &&
+		lhs.grade.from == rhs.grade.from &&
+		eq(lhs.grade.mix, rhs.grade.mix) &&
+		eq(lhs.grade.from_mix, rhs.grade.from_mix) &&
 		lhs.chroma.enable == rhs.chroma.enable &&
 		lhs.chroma.show_mask == rhs.chroma.show_mask &&
 		eq(lhs.chroma.target_hue, rhs.chroma.target_hue) &&
@@ -252,6 +283,14 @@ audio_transform& audio_transform::operator*=(const audio_transform &other)
 {
 	volume	 *= other.volume;
 	is_still |= other.is_still;
+	sync_offset += other.sync_offset;
+
+	if (other.compressor.enabled)
+		compressor = other.compressor;
+
+	if (other.limiter.enabled)
+		limiter = other.limiter;
+
 	return *this;
 }
 
@@ -265,13 +304,16 @@ audio_transform audio_transform::tween(double time, const audio_transform& sourc
 	audio_transform result;
 	result.is_still			= source.is_still | dest.is_still;
 	result.volume			= do_tween(time, source.volume,				dest.volume,			duration, tween);
+	result.sync_offset		= dest.sync_offset;
+	result.compressor		= dest.compressor;
+	result.limiter			= dest.limiter;
 
 	return result;
 }
 
 bool operator==(const audio_transform& lhs, const audio_transform& rhs)
 {
-	return eq(lhs.volume, rhs.volume) && lhs.is_still == rhs.is_still;
+	return eq(lhs.volume, rhs.volume) && lhs.is_still == rhs.is_still && eq(lhs.sync_offset, rhs.sync_offset) && lhs.compressor == rhs.compressor && lhs.limiter == rhs.limiter;
 }
 
 bool operator!=(const audio_transform& lhs, const audio_transform& rhs)
@@ -25,14 +25,20 @@
 #include <common/env.h>
 
 #include <core/video_format.h>
+#include <core/frame/color_space.h>
 #include <core/mixer/image/blend_modes.h>
+#include <core/mixer/audio/audio_dynamics.h>
 
 #include <boost/array.hpp>
 #include <boost/optional.hpp>
 #include <boost/property_tree/ptree.hpp>
 
+#include <memory>
+
 namespace caspar { namespace core {
 
+struct color_lut;
+
 struct chroma
 {
 	enum class legacy_type
@@ -70,6 +76,16 @@ struct corners final
 	boost::array<double, 2> ll = boost::array<double, 2> { { 0.0, 1.0 } };
 };
 
+// A 3D lookup table grade. While tweening to another table the outgoing one
+// is kept in from, the input is weighted by what is left of mix and from_mix.
+struct color_grade final
+{
+	std::shared_ptr<const color_lut>	lut;
+	double								mix			= 1.0;
+	std::shared_ptr<const color_lut>	from;
+	double								from_mix	= 0.0;
+};
+
 struct rectangle final
 {
 	boost::array<double, 2> ul = boost::array<double, 2> { { 0.0, 0.0 } };
@@ -105,6 +121,12 @@ struct image_transform final
 	core::blend_mode		blend_mode			= core::blend_mode::normal;
 	int						layer_depth			= 0;
 
+	// Overrides the colour space and transfer function of the frames, e.g.
+	// when the decoder metadata is missing or wrong.
+	core::color_space		color_space			= core::color_space::unspecified;
+	core::color_transfer	color_transfer		= core::color_transfer::unspecified;
+	core::color_grade		grade;
+
 	image_transform& operator*=(const image_transform &other);
 	image_transform operator*(const image_transform &other) const;
 
@@ -116,8 +138,11 @@ bool operator!=(const image_transform& lhs, const image_transform& rhs);
 
 struct audio_transform final
 {
-	double	volume		= 1.0;
-	bool	is_still	= false;
+	double			volume		= 1.0;
+	bool			is_still	= false;
+	double			sync_offset	= 0.0; // Milliseconds, positive delays the audio against the video.
+	audio_dynamics	compressor;
+	audio_dynamics	limiter;
 
 	audio_transform& operator*=(const audio_transform &other);
 	audio_transform operator*(const audio_transform &other) const;
@@ -0,0 +1,222 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../StdAfx.h"
+
+#include "image_scaler.h"
+
+#include <common/cache_aligned_vector.h>
+
+#include <tbb/parallel_for.h>
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace caspar { namespace core {
+
+namespace {
+
+// Weights have 7 fractional bits so that weighted 8-bit values stay within
+// signed 16-bit lanes.
+const int WEIGHT_ONE = 128;
+
+struct sample
+{
+	int first;
+	int second;
+	int weight;
+};
+
+std::vector<sample> sample_positions(int source_size, int size)
+{
+	std::vector<sample> result(size);
+
+	for (int n = 0; n < size; ++n)
+	{
+		auto position	= std::max(0.0, (n + 0.5) * source_size / size - 0.5);
+		auto first		= std::min(static_cast<int>(position), source_size - 1);
+
+		result[n].first		= first;
+		result[n].second	= std::min(first + 1, source_size - 1);
+		result[n].weight	= static_cast<int>((position - first) * WEIGHT_ONE + 0.5);
+	}
+
+	return result;
+}
+
+std::int32_t load_pixel(const std::uint8_t* pixel)
+{
+	std::int32_t result;
+	std::memcpy(&result, pixel, sizeof(result));
+	return result;
+}
+
+void scale_row(const std::uint8_t* source, const std::vector<sample>& columns, const std::vector<__m128i>& weights, std::uint8_t* destination)
+{
+	auto zero	= _mm_setzero_si128();
+	auto round	= _mm_set1_epi16(WEIGHT_ONE / 2);
+
+	for (std::size_t x = 0; x < columns.size(); ++x)
+	{
+		auto first	= _mm_cvtsi32_si128(load_pixel(source + columns[x].first * 4));
+		auto second	= _mm_cvtsi32_si128(load_pixel(source + columns[x].second * 4));
+		auto pair	= _mm_unpacklo_epi8(_mm_unpacklo_epi32(first, second), zero);
+		auto sum	= _mm_mullo_epi16(pair, weights[x]);
+
+		sum = _mm_add_epi16(sum, _mm_srli_si128(sum, 8));
+		sum = _mm_srli_epi16(_mm_add_epi16(sum, round), 7);
+
+		auto result = _mm_cvtsi128_si32(_mm_packus_epi16(sum, zero));
+		std::memcpy(destination + x * 4, &result, sizeof(result));
+	}
+}
+
+void blend_rows(const std::uint8_t* first, const std::uint8_t* second, int weight, std::uint8_t* destination, int count)
+{
+	auto zero			= _mm_setzero_si128();
+	auto round			= _mm_set1_epi16(WEIGHT_ONE / 2);
+	auto first_weight	= _mm_set1_epi16(static_cast<std::int16_t>(WEIGHT_ONE - weight));
+	auto second_weight	= _mm_set1_epi16(static_cast<std::int16_t>(weight));
+	int n				= 0;
+
+	for (; n + 16 <= count; n += 16)
+	{
+		auto a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first + n));
+		auto b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(second + n));
+
+		auto lo = _mm_add_epi16(
+				_mm_mullo_epi16(_mm_unpacklo_epi8(a, zero), first_weight),
+				_mm_mullo_epi16(_mm_unpacklo_epi8(b, zero), second_weight));
+		auto hi = _mm_add_epi16(
+				_mm_mullo_epi16(_mm_unpackhi_epi8(a, zero), first_weight),
+				_mm_mullo_epi16(_mm_unpackhi_epi8(b, zero), second_weight));
+
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, round), 7);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, round), 7);
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + n), _mm_packus_epi16(lo, hi));
+	}
+
+	for (; n < count; ++n)
+		destination[n] = static_cast<std::uint8_t>((first[n] * (WEIGHT_ONE - weight) + second[n] * weight + WEIGHT_ONE / 2) >> 7);
+}
+
+}
+
+void scale_bgra(
+		const std::uint8_t* source,
+		int source_width,
+		int source_height,
+		std::uint8_t* destination,
+		int width,
+		int height)
+{
+	if (source_width == width && source_height == height)
+	{
+		std::memcpy(destination, source, static_cast<std::size_t>(width) * height * 4);
+		return;
+	}
+
+	auto columns	= sample_positions(source_width, width);
+	auto rows		= sample_positions(source_height, height);
+
+	std::vector<__m128i> weights(width);
+
+	for (int x = 0; x < width; ++x)
+	{
+		auto first	= static_cast<std::int16_t>(WEIGHT_ONE - columns[x].weight);
+		auto second	= static_cast<std::int16_t>(columns[x].weight);
+
+		weights[x] = _mm_setr_epi16(first, first, first, first, second, second, second, second);
+	}
+
+	// Horizontal pass over the source rows that are sampled, then a vertical
+	// pass between pairs of them.
+	std::vector<bool> used(source_height, false);
+
+	for (auto& row : rows)
+		used[row.first] = used[row.second] = true;
+
+	cache_aligned_vector<std::uint8_t> scaled_rows(static_cast<std::size_t>(source_height) * width * 4);
+
+	tbb::parallel_for(0, source_height, [&](int y)
+	{
+		if (used[y])
+			scale_row(source + static_cast<std::size_t>(y) * source_width * 4, columns, weights, scaled_rows.data() + static_cast<std::size_t>(y) * width * 4);
+	});
+
+	tbb::parallel_for(0, height, [&](int y)
+	{
+		blend_rows(
+				scaled_rows.data() + static_cast<std::size_t>(rows[y].first) * width * 4,
+				scaled_rows.data() + static_cast<std::size_t>(rows[y].second) * width * 4,
+				rows[y].weight,
+				destination + static_cast<std::size_t>(y) * width * 4,
+				width * 4);
+	});
+}
+
+void scale_bgra16(
+		const std::uint16_t* source,
+		int source_width,
+		int source_height,
+		std::uint16_t* destination,
+		int width,
+		int height)
+{
+	if (source_width == width && source_height == height)
+	{
+		std::memcpy(destination, source, static_cast<std::size_t>(width) * height * 4 * sizeof(std::uint16_t));
+		return;
+	}
+
+	auto columns	= sample_positions(source_width, width);
+	auto rows		= sample_positions(source_height, height);
+
+	tbb::parallel_for(0, height, [&](int y)
+	{
+		auto first	= source + static_cast<std::size_t>(rows[y].first) * source_width * 4;
+		auto second	= source + static_cast<std::size_t>(rows[y].second) * source_width * 4;
+		auto weight	= rows[y].weight;
+		auto dest	= destination + static_cast<std::size_t>(y) * width * 4;
+
+		for (int x = 0; x < width; ++x)
+		{
+			auto left			= columns[x].first * 4;
+			auto right			= columns[x].second * 4;
+			auto column_weight	= columns[x].weight;
+
+			for (int c = 0; c < 4; ++c)
+			{
+				auto top	= first[left + c] * (WEIGHT_ONE - column_weight) + first[right + c] * column_weight;
+				auto bottom	= second[left + c] * (WEIGHT_ONE - column_weight) + second[right + c] * column_weight;
+				auto value	= static_cast<std::int64_t>(top) * (WEIGHT_ONE - weight) + static_cast<std::int64_t>(bottom) * weight;
+
+				dest[x * 4 + c] = static_cast<std::uint16_t>((value + WEIGHT_ONE * WEIGHT_ONE / 2) >> 14);
+			}
+		}
+	});
+}
+
+}}
@@ -0,0 +1,51 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+
+namespace caspar { namespace core {
+
+/**
+ * Rescales a bgra image with bilinear filtering. Intended for moderate ratios
+ * like 1080 to 720 lines, larger reductions alias since no prefilter is applied.
+ */
+void scale_bgra(
+		const std::uint8_t* source,
+		int source_width,
+		int source_height,
+		std::uint8_t* destination,
+		int width,
+		int height);
+
+/**
+ * Rescales a bgra16 image, as in the high bit depth plane of a mixed frame,
+ * with the same filter as scale_bgra.
+ */
+void scale_bgra16(
+		const std::uint16_t* source,
+		int source_width,
+		int source_height,
+		std::uint16_t* destination,
+		int width,
+		int height);
+
+}}
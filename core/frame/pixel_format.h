@@ -21,6 +21,7 @@
 
 #pragma once
 
+#include "color_space.h"
 #include "../video_format.h"
 
 #include <cstddef>
@@ -40,6 +41,7 @@ enum class pixel_format
 	luma,
 	bgr,
 	rgb,
+	bgra16, // Premultiplied, 16 bits per component, little endian (stride 8).
 	count,
 	invalid,
 };
@@ -80,6 +82,8 @@ struct pixel_format_desc final
 	
 	pixel_format		format;
 	std::vector<plane>	planes;
+	core::color_space	color_space		= core::color_space::unspecified;
+	core::color_transfer	color_transfer	= core::color_transfer::unspecified;
 };
 
 }}
\ No newline at end of file
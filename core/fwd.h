@@ -28,6 +28,7 @@ FORWARD3(caspar, accelerator, ogl, class device);
 FORWARD2(caspar, core, class stage);
 FORWARD2(caspar, core, class mixer);
 FORWARD2(caspar, core, class output);
+FORWARD2(caspar, core, class format_adapter);
 FORWARD2(caspar, core, class image_mixer);
 FORWARD2(caspar, core, struct video_format_desc);
 FORWARD2(caspar, core, class frame_factory);
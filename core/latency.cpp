@@ -0,0 +1,166 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "StdAfx.h"
+
+#include "latency.h"
+
+#include "diagnostics/call_context.h"
+
+#include <common/except.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/property_tree/ptree.hpp>
+
+#include <tbb/spin_mutex.h>
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace caspar { namespace core {
+
+namespace {
+
+tbb::spin_mutex& profiles_mutex()
+{
+	static tbb::spin_mutex mutex;
+	return mutex;
+}
+
+std::map<int, latency_profile>& profiles()
+{
+	static std::map<int, latency_profile> profiles;
+	return profiles;
+}
+
+}
+
+latency_profile get_latency_profile(const std::wstring& name)
+{
+	if (name.empty() || boost::iequals(name, L"normal"))
+		return latency_profile::normal;
+	else if (boost::iequals(name, L"low"))
+		return latency_profile::low;
+
+	CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Invalid latency profile: " + name));
+}
+
+std::wstring get_latency_profile(latency_profile profile)
+{
+	return profile == latency_profile::low ? L"low" : L"normal";
+}
+
+void set_channel_latency_profile(int video_channel, latency_profile profile)
+{
+	tbb::spin_mutex::scoped_lock lock(profiles_mutex());
+	profiles()[video_channel] = profile;
+}
+
+latency_profile get_channel_latency_profile(int video_channel)
+{
+	tbb::spin_mutex::scoped_lock lock(profiles_mutex());
+	auto it = profiles().find(video_channel);
+
+	return it == profiles().end() ? latency_profile::normal : it->second;
+}
+
+latency_profile get_current_latency_profile()
+{
+	return get_channel_latency_profile(diagnostics::call_context::for_thread().video_channel);
+}
+
+latency_histogram::latency_histogram(std::size_t window)
+	: samples_(std::max<std::size_t>(window, 1))
+{
+}
+
+void latency_histogram::add(std::int64_t millis)
+{
+	samples_[next_] = millis;
+	next_			= (next_ + 1) % samples_.size();
+	count_			= std::min(count_ + 1, samples_.size());
+}
+
+void latency_histogram::clear()
+{
+	next_	= 0;
+	count_	= 0;
+}
+
+std::size_t latency_histogram::count() const
+{
+	return count_;
+}
+
+std::int64_t latency_histogram::percentile(double fraction) const
+{
+	if (count_ == 0)
+		return 0;
+
+	std::vector<std::int64_t> sorted(samples_.begin(), samples_.begin() + count_);
+	auto rank = static_cast<std::size_t>(std::ceil(fraction * count_));
+	auto nth = sorted.begin() + std::min(std::max<std::size_t>(rank, 1), count_) - 1;
+
+	std::nth_element(sorted.begin(), nth, sorted.end());
+
+	return *nth;
+}
+
+boost::property_tree::wptree latency_histogram::info(double fps) const
+{
+	boost::property_tree::wptree info;
+
+	info.add(L"samples", count_);
+
+	if (count_ == 0)
+		return info;
+
+	std::vector<std::int64_t> sorted(samples_.begin(), samples_.begin() + count_);
+	std::sort(sorted.begin(), sorted.end());
+
+	double sum = 0.0;
+
+	for (auto sample : sorted)
+		sum += sample;
+
+	auto at = [&](double fraction)
+	{
+		auto rank = static_cast<std::size_t>(std::ceil(fraction * count_));
+		return static_cast<double>(sorted.at(std::min(std::max<std::size_t>(rank, 1), count_) - 1));
+	};
+
+	auto add = [&](const std::wstring& name, double millis)
+	{
+		info.add(L"millis." + name, millis);
+		info.add(L"frames." + name, std::round(millis * fps / 10.0) / 100.0);
+	};
+
+	add(L"min",		static_cast<double>(sorted.front()));
+	add(L"mean",	std::round(sum / count_ * 10.0) / 10.0);
+	add(L"p50",		at(0.5));
+	add(L"p95",		at(0.95));
+	add(L"p99",		at(0.99));
+	add(L"max",		static_cast<double>(sorted.back()));
+
+	return info;
+}
+
+}}
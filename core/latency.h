@@ -0,0 +1,71 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <boost/property_tree/ptree_fwd.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace caspar { namespace core {
+
+// How deep the internal queues and buffers of a channel are. The low profile
+// keeps only what is needed to absorb scheduling jitter.
+enum class latency_profile
+{
+	normal,
+	low
+};
+
+latency_profile get_latency_profile(const std::wstring& name);
+std::wstring get_latency_profile(latency_profile profile);
+
+void set_channel_latency_profile(int video_channel, latency_profile profile);
+latency_profile get_channel_latency_profile(int video_channel);
+
+// The profile of the channel in the call context of the calling thread, for
+// producers and consumers that size their buffers before they are attached.
+latency_profile get_current_latency_profile();
+
+// Keeps the latencies of the last frames and describes their distribution.
+class latency_histogram
+{
+public:
+	explicit latency_histogram(std::size_t window = 512);
+
+	void add(std::int64_t millis);
+	void clear();
+
+	std::size_t count() const;
+	std::int64_t percentile(double fraction) const;
+
+	// Minimum, mean, median, 95th, 99th percentile and maximum in milliseconds
+	// and in frames of the given rate.
+	boost::property_tree::wptree info(double fps) const;
+private:
+	std::vector<std::int64_t>	samples_;
+	std::size_t					next_		= 0;
+	std::size_t					count_		= 0;
+};
+
+}}
@@ -0,0 +1,158 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <common/cache_aligned_vector.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+namespace caspar { namespace core {
+
+struct sync_offset_delays
+{
+	int video_frames	= 0;
+	int audio_samples	= 0;
+};
+
+const double MAX_SYNC_OFFSET_MILLIS = 2000.0;
+
+// Splits an audio/video sync offset in milliseconds, where a positive offset
+// delays the audio, into a video delay in whole frames and a non-negative audio
+// delay in samples. Negative offsets are realized by delaying the video and
+// delaying the audio by the remainder. The offset is clamped to
+// MAX_SYNC_OFFSET_MILLIS, which bounds the number of frames held back.
+inline sync_offset_delays split_sync_offset(double offset_millis, double fps, int sample_rate)
+{
+	sync_offset_delays result;
+
+	offset_millis = std::max(-MAX_SYNC_OFFSET_MILLIS, std::min(MAX_SYNC_OFFSET_MILLIS, offset_millis));
+
+	if (offset_millis < 0.0)
+		result.video_frames = static_cast<int>(std::ceil(-offset_millis * fps / 1000.0 - 1.0e-9));
+
+	auto audio_seconds		= offset_millis / 1000.0 + result.video_frames / fps;
+	result.audio_samples	= std::max(0, static_cast<int>(std::round(audio_seconds * sample_rate)));
+
+	return result;
+}
+
+// Sample accurate delay of interleaved audio, backed by a ring buffer that is
+// allocated once when a delay is first set (or the format changes) and is
+// reused from then on. When the delay changes the output crossfades from the
+// old to the new read position over the processed block.
+template<typename T>
+class audio_delay_line final
+{
+public:
+	static const int MAX_DELAY_SECONDS = 2;
+
+	void configure(int sample_rate, int num_channels)
+	{
+		if (sample_rate == sample_rate_ && num_channels == num_channels_)
+			return;
+
+		sample_rate_	= sample_rate;
+		num_channels_	= num_channels;
+		capacity_		= static_cast<std::size_t>(sample_rate) * (MAX_DELAY_SECONDS + 1);
+		buffer_.clear();
+		write_pos_		= 0;
+		delay_			= 0;
+	}
+
+	int max_delay() const
+	{
+		return sample_rate_ * MAX_DELAY_SECONDS;
+	}
+
+	// True when the input currently passes through unchanged.
+	bool idle() const
+	{
+		return delay_ == 0;
+	}
+
+	// Delays num_frames sample frames in place by delay sample frames.
+	void process(T* samples, std::size_t num_frames, int delay)
+	{
+		delay = std::max(0, std::min(delay, max_delay()));
+
+		if (delay == 0 && delay_ == 0)
+			return;
+
+		if (num_channels_ < 1 || num_frames == 0 || num_frames > capacity_ - max_delay())
+			return;
+
+		if (buffer_.empty())
+			buffer_.assign(capacity_ * num_channels_, T());
+		else if (cold_)
+			std::fill(buffer_.begin(), buffer_.end(), T());
+
+		cold_ = false;
+
+		const std::size_t channels = num_channels_;
+
+		for (std::size_t n = 0; n < num_frames; ++n)
+		{
+			auto pos = (write_pos_ + n) % capacity_;
+			std::copy(samples + n * channels, samples + (n + 1) * channels, buffer_.begin() + pos * channels);
+		}
+
+		const std::size_t from	= delay_;
+		const std::size_t to	= delay;
+
+		for (std::size_t n = 0; n < num_frames; ++n)
+		{
+			auto to_pos		= (write_pos_ + n + capacity_ - to) % capacity_;
+			auto* out		= samples + n * channels;
+			auto* to_data	= buffer_.data() + to_pos * channels;
+
+			if (from == to)
+			{
+				std::copy(to_data, to_data + channels, out);
+				continue;
+			}
+
+			auto from_pos	= (write_pos_ + n + capacity_ - from) % capacity_;
+			auto* from_data	= buffer_.data() + from_pos * channels;
+			auto weight		= static_cast<double>(n + 1) / static_cast<double>(num_frames);
+
+			for (std::size_t ch = 0; ch < channels; ++ch)
+				out[ch] = static_cast<T>(from_data[ch] * (1.0 - weight) + to_data[ch] * weight);
+		}
+
+		write_pos_	= (write_pos_ + num_frames) % capacity_;
+		delay_		= delay;
+
+		// Nothing buffered is needed anymore. Start from silence if a delay is set again.
+		cold_		= delay == 0;
+	}
+private:
+	int								sample_rate_	= 0;
+	int								num_channels_	= 0;
+	std::size_t						capacity_		= 0;
+	cache_aligned_vector<T>			buffer_;
+	std::size_t						write_pos_		= 0;
+	int								delay_			= 0;
+	bool							cold_			= false;
+};
+
+}}
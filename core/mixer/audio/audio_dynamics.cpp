@@ -0,0 +1,230 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../../StdAfx.h"
+
+#include "audio_dynamics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace caspar { namespace core {
+
+namespace {
+
+const double	FULL_SCALE		= 2147483648.0;
+const double	DB_PER_LOG		= 20.0 / std::log(10.0);
+const double	LOG_PER_DB		= std::log(10.0) / 20.0;
+const int		BLOCK_FRAMES	= 64;
+
+double time_to_coef(double milliseconds, int sample_rate)
+{
+	if (milliseconds <= 0.0)
+		return 0.0;
+
+	return std::exp(-1000.0 / (milliseconds * sample_rate));
+}
+
+}
+
+audio_dynamics audio_dynamics::compressor(double threshold, double ratio, double attack, double release, double makeup)
+{
+	audio_dynamics result;
+	result.enabled		= true;
+	result.threshold	= threshold;
+	result.ratio		= std::max(1.0, ratio);
+	result.attack		= std::max(0.0, attack);
+	result.release		= std::max(0.0, release);
+	result.makeup		= makeup;
+	return result;
+}
+
+audio_dynamics audio_dynamics::limiter(double ceiling, double release, double lookahead)
+{
+	audio_dynamics result;
+	result.enabled		= true;
+	result.threshold	= ceiling;
+	result.ratio		= std::numeric_limits<double>::infinity();
+	result.lookahead	= std::max(0.0, lookahead);
+	result.attack		= result.lookahead / 3.0; // Reaches ~95% of the reduction by the time the peak leaves the delay line.
+	result.release		= std::max(0.0, release);
+	return result;
+}
+
+bool operator==(const audio_dynamics& lhs, const audio_dynamics& rhs)
+{
+	if (!lhs.enabled && !rhs.enabled)
+		return true;
+
+	return lhs.enabled == rhs.enabled
+		&& lhs.threshold == rhs.threshold
+		&& lhs.ratio == rhs.ratio
+		&& lhs.attack == rhs.attack
+		&& lhs.release == rhs.release
+		&& lhs.lookahead == rhs.lookahead
+		&& lhs.makeup == rhs.makeup;
+}
+
+bool operator!=(const audio_dynamics& lhs, const audio_dynamics& rhs)
+{
+	return !(lhs == rhs);
+}
+
+void audio_dynamics_processor::configure(const audio_dynamics& settings, int sample_rate, int num_channels)
+{
+	if (settings == settings_ && sample_rate == sample_rate_ && num_channels == num_channels_)
+		return;
+
+	auto delay_frames = static_cast<std::size_t>(std::round(settings.lookahead * sample_rate / 1000.0));
+
+	bool reallocate = delay_frames != delay_frames_ || num_channels != num_channels_ || requested_.empty();
+
+	settings_			= settings;
+	sample_rate_		= sample_rate;
+	num_channels_		= num_channels;
+	threshold_level_	= FULL_SCALE * std::exp(settings.threshold * LOG_PER_DB);
+	slope_				= settings.is_limiter() ? 1.0 : 1.0 - 1.0 / settings.ratio;
+	attack_coef_		= time_to_coef(settings.attack, sample_rate);
+	release_coef_		= time_to_coef(settings.release, sample_rate);
+	makeup_gain_		= std::exp(settings.makeup * LOG_PER_DB);
+
+	if (reallocate)
+	{
+		delay_frames_ = delay_frames;
+		delay_.assign(delay_frames * num_channels, 0.0);
+		requested_.assign(delay_frames + 1, 0.0);
+		max_index_.assign(delay_frames + 1, 0);
+		reset();
+	}
+}
+
+void audio_dynamics_processor::reset()
+{
+	std::fill(delay_.begin(), delay_.end(), 0.0);
+	std::fill(requested_.begin(), requested_.end(), 0.0);
+	envelope_		= 0.0;
+	write_pos_		= 0;
+	frame_count_	= 0;
+	max_head_		= 0;
+	max_size_		= 0;
+}
+
+double audio_dynamics_processor::take_gain_reduction()
+{
+	auto result = gain_reduction_;
+	gain_reduction_ = 0.0;
+	return result;
+}
+
+void audio_dynamics_processor::process(double* samples, std::size_t num_frames)
+{
+	if (!settings_.enabled || num_channels_ < 1)
+		return;
+
+	const int			channels	= num_channels_;
+	const std::size_t	window		= delay_frames_ + 1;
+	const bool			brickwall	= settings_.is_limiter();
+
+	double peak[BLOCK_FRAMES];
+	double gain[BLOCK_FRAMES];
+
+	for (std::size_t offset = 0; offset < num_frames; offset += BLOCK_FRAMES)
+	{
+		const int	block	= static_cast<int>(std::min<std::size_t>(BLOCK_FRAMES, num_frames - offset));
+		double*		data	= samples + offset * channels;
+
+		// Channel linked peak detection.
+
+		for (int n = 0; n < block; ++n)
+			peak[n] = 0.0;
+
+		for (int ch = 0; ch < channels; ++ch)
+			for (int n = 0; n < block; ++n)
+				peak[n] = std::max(peak[n], std::abs(data[n * channels + ch]));
+
+		// Gain computer, lookahead peak hold and envelope. This part is a
+		// recurrence over time and stays scalar.
+
+		for (int n = 0; n < block; ++n)
+		{
+			double requested = 0.0;
+
+			if (peak[n] > threshold_level_)
+				requested = std::log(peak[n] / threshold_level_) * DB_PER_LOG * slope_;
+
+			const std::size_t index = frame_count_++;
+			requested_[index % window] = requested;
+
+			while (max_size_ > 0 && max_index_[max_head_] + delay_frames_ < index)
+			{
+				max_head_ = (max_head_ + 1) % window;
+				--max_size_;
+			}
+
+			while (max_size_ > 0 && requested_[max_index_[(max_head_ + max_size_ - 1) % window] % window] <= requested)
+				--max_size_;
+
+			max_index_[(max_head_ + max_size_++) % window] = index;
+
+			const double target	= requested_[max_index_[max_head_] % window];
+			const double coef	= target > envelope_ ? attack_coef_ : release_coef_;
+
+			envelope_ = target + coef * (envelope_ - target);
+
+			if (envelope_ < 1.0e-6)
+				envelope_ = 0.0;
+
+			double reduction = envelope_;
+
+			// The limiter never lets the delayed sample pass above the ceiling,
+			// regardless of how far the attack ramp has come.
+			if (brickwall)
+				reduction = std::max(reduction, requested_[(index + 1) % window]);
+
+			gain_reduction_	= std::max(gain_reduction_, reduction);
+			gain[n]			= reduction > 0.0 ? std::exp(-reduction * LOG_PER_DB) * makeup_gain_ : makeup_gain_;
+		}
+
+		// Lookahead delay line.
+
+		if (delay_frames_ > 0)
+		{
+			for (int n = 0; n < block; ++n)
+			{
+				double* slot = delay_.data() + write_pos_ * channels;
+				double* sample = data + n * channels;
+
+				for (int ch = 0; ch < channels; ++ch)
+					std::swap(slot[ch], sample[ch]);
+
+				if (++write_pos_ == delay_frames_)
+					write_pos_ = 0;
+			}
+		}
+
+		// Sample accurate gain.
+
+		for (int n = 0; n < block; ++n)
+			for (int ch = 0; ch < channels; ++ch)
+				data[n * channels + ch] *= gain[n];
+	}
+}
+
+}}
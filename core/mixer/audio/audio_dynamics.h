@@ -0,0 +1,89 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <common/cache_aligned_vector.h>
+
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+namespace caspar { namespace core {
+
+// Settings of a channel-linked peak compressor. A ratio of infinity turns it
+// into a limiter. Levels are in dBFS, times in milliseconds. A lookahead delays
+// the audio passing through the processor by the same amount.
+struct audio_dynamics final
+{
+	bool	enabled		= false;
+	double	threshold	= 0.0;
+	double	ratio		= 1.0;
+	double	attack		= 5.0;
+	double	release		= 100.0;
+	double	lookahead	= 0.0;
+	double	makeup		= 0.0;
+
+	static audio_dynamics compressor(double threshold, double ratio, double attack = 5.0, double release = 100.0, double makeup = 0.0);
+	static audio_dynamics limiter(double ceiling, double release = 50.0, double lookahead = 5.0);
+
+	bool is_limiter() const { return ratio == std::numeric_limits<double>::infinity(); }
+};
+
+bool operator==(const audio_dynamics& lhs, const audio_dynamics& rhs);
+bool operator!=(const audio_dynamics& lhs, const audio_dynamics& rhs);
+
+// Processes interleaved samples at 32 bit integer scale in place. Only
+// configure() allocates (and only when the lookahead or channel count
+// changes), process() is allocation free.
+class audio_dynamics_processor final
+{
+public:
+	void	configure(const audio_dynamics& settings, int sample_rate, int num_channels);
+	void	process(double* samples, std::size_t num_frames);
+	void	reset();
+
+	// Largest gain reduction in dB applied since the last call.
+	double	take_gain_reduction();
+private:
+	audio_dynamics					settings_;
+	int								sample_rate_		= 0;
+	int								num_channels_		= 0;
+
+	double							threshold_level_	= 0.0;
+	double							slope_				= 0.0;
+	double							attack_coef_		= 0.0;
+	double							release_coef_		= 0.0;
+	double							makeup_gain_		= 1.0;
+
+	double							envelope_			= 0.0;
+	double							gain_reduction_		= 0.0;
+
+	std::size_t						delay_frames_		= 0;
+	std::size_t						write_pos_			= 0;
+	std::size_t						frame_count_		= 0;
+	cache_aligned_vector<double>	delay_;
+	std::vector<double>				requested_;
+	std::vector<std::size_t>		max_index_;
+	std::size_t						max_head_			= 0;
+	std::size_t						max_size_			= 0;
+};
+
+}}
@@ -22,6 +22,8 @@
 #include "../../StdAfx.h"
 
 #include "audio_mixer.h"
+#include "audio_delay_line.h"
+#include "audio_dynamics.h"
 #include "audio_util.h"
 
 #include <core/frame/frame.h>
@@ -45,6 +47,7 @@ namespace caspar { namespace core {
 struct audio_item
 {
 	const void*				tag				= nullptr;
+	int						layer			= 0;
 	audio_transform			transform;
 	audio_buffer			audio_data;
 	audio_channel_layout	channel_layout	= audio_channel_layout::invalid();
@@ -55,6 +58,7 @@ struct audio_item
 
 	audio_item(audio_item&& other)
 		: tag(std::move(other.tag))
+		, layer(other.layer)
 		, transform(std::move(other.transform))
 		, audio_data(std::move(other.audio_data))
 		, channel_layout(std::move(other.channel_layout))
@@ -71,6 +75,10 @@ struct audio_stream
 	std::unique_ptr<audio_channel_remapper>	channel_remapper;
 	bool									remapping_failed	= false;
 	bool									is_still			= false;
+	int										layer				= 0;
+	audio_dynamics_processor				compressor;
+	audio_dynamics_processor				limiter;
+	audio_delay_line<double>				delay;
 };
 
 struct audio_mixer::impl : boost::noncopyable
@@ -84,6 +92,12 @@ struct audio_mixer::impl : boost::noncopyable
 	audio_channel_layout				channel_layout_			= audio_channel_layout::invalid();
 	float								master_volume_			= 1.0f;
 	float								previous_master_volume_	= master_volume_;
+	audio_dynamics						master_compressor_;
+	audio_dynamics						master_limiter_;
+	audio_dynamics_processor			master_compressor_processor_;
+	audio_dynamics_processor			master_limiter_processor_;
+	int									current_layer_			= 0;
+	audio_buffer_ps						dynamics_buffer_;
 	spl::shared_ptr<diagnostics::graph>	graph_;
 public:
 	impl(spl::shared_ptr<diagnostics::graph> graph)
@@ -106,6 +120,7 @@ public:
 
 		audio_item item;
 		item.tag			= frame.stream_tag();
+		item.layer			= current_layer_;
 		item.transform		= transform_stack_.top();
 		item.audio_data		= frame.audio_data();
 		item.channel_layout = frame.audio_channel_layout();
@@ -131,6 +146,31 @@ public:
 		return master_volume_;
 	}
 
+	void set_layer(int index)
+	{
+		current_layer_ = index;
+	}
+
+	void set_master_compressor(const audio_dynamics& settings)
+	{
+		master_compressor_ = settings;
+	}
+
+	audio_dynamics get_master_compressor()
+	{
+		return master_compressor_;
+	}
+
+	void set_master_limiter(const audio_dynamics& settings)
+	{
+		master_limiter_ = settings;
+	}
+
+	audio_dynamics get_master_limiter()
+	{
+		return master_limiter_;
+	}
+
 	audio_buffer mix(const video_format_desc& format_desc, const audio_channel_layout& channel_layout)
 	{
 		if(format_desc_ != format_desc || channel_layout_ != channel_layout)
@@ -142,12 +182,16 @@ public:
 		}
 
 		std::map<const void*, audio_stream>	next_audio_streams;
+		std::map<int, double>				layer_gain_reduction;
 
 		for (auto& item : items_)
 		{
 			audio_buffer_ps next_audio;
 			std::unique_ptr<audio_channel_remapper> channel_remapper;
 			bool remapping_failed = false;
+			audio_dynamics_processor compressor;
+			audio_dynamics_processor limiter;
+			audio_delay_line<double> delay;
 
 			auto next_transform = item.transform;
 			auto prev_transform = next_transform;
@@ -169,6 +213,9 @@ public:
 				next_audio = std::move(it->second.audio_data);
 				channel_remapper = std::move(it->second.channel_remapper);
 				remapping_failed = it->second.remapping_failed;
+				compressor = std::move(it->second.compressor);
+				limiter = std::move(it->second.limiter);
+				delay = std::move(it->second.delay);
 			}
 
 			if (remapping_failed)
@@ -206,16 +253,54 @@ public:
 
 			item.audio_data = channel_remapper->mix_and_rearrange(item.audio_data);
 
-			const double prev_volume = prev_transform.volume * previous_master_volume_;
-			const double next_volume = next_transform.volume * master_volume_;
+			const auto appended_from = next_audio.size();
+
+			if (next_transform.compressor.enabled || next_transform.limiter.enabled)
+			{
+				// The layer volume is applied before and the master volume after the
+				// dynamics, so that the master fader does not change how hard the layer is compressed.
+				const auto num_channels	= channel_layout_.num_channels;
+				const auto num_frames	= item.audio_data.size() / num_channels;
+				const double prev_volume = prev_transform.volume;
+				const double alpha = (next_transform.volume - prev_volume) / static_cast<double>(num_frames);
+				const double master_alpha = (master_volume_ - previous_master_volume_) / static_cast<double>(num_frames);
+
+				dynamics_buffer_.resize(item.audio_data.size());
+
+				for (size_t n = 0; n < item.audio_data.size(); ++n)
+					dynamics_buffer_[n] = item.audio_data.data()[n] * (prev_volume + (n / num_channels) * alpha);
+
+				compressor.configure(next_transform.compressor, format_desc_.audio_sample_rate, num_channels);
+				limiter.configure(next_transform.limiter, format_desc_.audio_sample_rate, num_channels);
+				compressor.process(dynamics_buffer_.data(), num_frames);
+				limiter.process(dynamics_buffer_.data(), num_frames);
 
-			// TODO: Move volume mixing into code below, in order to support audio sample counts not corresponding to frame audio samples.
-			auto alpha = (next_volume-prev_volume)/static_cast<double>(item.audio_data.size()/channel_layout_.num_channels);
+				auto& reduction = layer_gain_reduction[item.layer];
+				reduction = std::max(reduction, compressor.take_gain_reduction() + limiter.take_gain_reduction());
 
-			for(size_t n = 0; n < item.audio_data.size(); ++n)
+				for (size_t n = 0; n < dynamics_buffer_.size(); ++n)
+					next_audio.push_back(dynamics_buffer_[n] * (previous_master_volume_ + (n / num_channels) * master_alpha));
+			}
+			else
 			{
-				auto sample_multiplier = (prev_volume + (n / channel_layout_.num_channels) * alpha);
-				next_audio.push_back(item.audio_data.data()[n] * sample_multiplier);
+				const double prev_volume = prev_transform.volume * previous_master_volume_;
+				const double next_volume = next_transform.volume * master_volume_;
+
+				// TODO: Move volume mixing into code below, in order to support audio sample counts not corresponding to frame audio samples.
+				auto alpha = (next_volume-prev_volume)/static_cast<double>(item.audio_data.size()/channel_layout_.num_channels);
+
+				for(size_t n = 0; n < item.audio_data.size(); ++n)
+				{
+					auto sample_multiplier = (prev_volume + (n / channel_layout_.num_channels) * alpha);
+					next_audio.push_back(item.audio_data.data()[n] * sample_multiplier);
+				}
+			}
+
+			{ // sync offset, negative offsets are completed by the video delay in the mixer
+				const auto delays = split_sync_offset(next_transform.sync_offset, format_desc_.fps, format_desc_.audio_sample_rate);
+
+				delay.configure(format_desc_.audio_sample_rate, channel_layout_.num_channels);
+				delay.process(next_audio.data() + appended_from, (next_audio.size() - appended_from) / channel_layout_.num_channels, delays.audio_samples);
 			}
 
 			next_audio_streams[tag].prev_transform		= std::move(next_transform); // Store all active tags, inactive tags will be removed at the end.
@@ -223,6 +308,10 @@ public:
 			next_audio_streams[tag].channel_remapper	= std::move(channel_remapper);
 			next_audio_streams[tag].remapping_failed	= remapping_failed;
 			next_audio_streams[tag].is_still			= item.transform.is_still;
+			next_audio_streams[tag].layer				= item.layer;
+			next_audio_streams[tag].compressor			= std::move(compressor);
+			next_audio_streams[tag].limiter				= std::move(limiter);
+			next_audio_streams[tag].delay				= std::move(delay);
 		}
 
 		previous_master_volume_ = master_volume_;
@@ -265,6 +354,15 @@ public:
 
 		boost::range::rotate(audio_cadence_, std::begin(audio_cadence_)+1);
 
+		{ // master dynamics
+			const auto num_frames = result_ps.size() / channel_layout_.num_channels;
+
+			master_compressor_processor_.configure(master_compressor_, format_desc_.audio_sample_rate, channel_layout_.num_channels);
+			master_limiter_processor_.configure(master_limiter_, format_desc_.audio_sample_rate, channel_layout_.num_channels);
+			master_compressor_processor_.process(result_ps.data(), num_frames);
+			master_limiter_processor_.process(result_ps.data(), num_frames);
+		}
+
 		auto result_owner = spl::make_shared<mutable_audio_buffer>();
 		auto& result = *result_owner;
 		result.reserve(result_ps.size());
@@ -293,6 +391,12 @@ public:
 		const int num_channels = channel_layout_.num_channels;
 		monitor_subject_ << monitor::message("/nb_channels") % num_channels;
 
+		for (auto& reduction : layer_gain_reduction)
+			monitor_subject_ << monitor::message("/layer/" + boost::lexical_cast<std::string>(reduction.first) + "/gain_reduction") % static_cast<float>(reduction.second);
+
+		if (master_compressor_.enabled || master_limiter_.enabled)
+			monitor_subject_ << monitor::message("/master/gain_reduction") % static_cast<float>(master_compressor_processor_.take_gain_reduction() + master_limiter_processor_.take_gain_reduction());
+
 		auto max = audio_max_level_for_frame(num_channels, &result.at(0), result.size());
 		output_audio_levels(monitor_subject_, max);
 
@@ -313,6 +417,11 @@ void audio_mixer::visit(const const_frame& frame){impl_->visit(frame);}
 void audio_mixer::pop(){impl_->pop();}
 void audio_mixer::set_master_volume(float volume) { impl_->set_master_volume(volume); }
 float audio_mixer::get_master_volume() { return impl_->get_master_volume(); }
+void audio_mixer::set_master_compressor(const audio_dynamics& settings) { impl_->set_master_compressor(settings); }
+audio_dynamics audio_mixer::get_master_compressor() { return impl_->get_master_compressor(); }
+void audio_mixer::set_master_limiter(const audio_dynamics& settings) { impl_->set_master_limiter(settings); }
+audio_dynamics audio_mixer::get_master_limiter() { return impl_->get_master_limiter(); }
+void audio_mixer::set_layer(int index) { impl_->set_layer(index); }
 audio_buffer audio_mixer::operator()(const video_format_desc& format_desc, const audio_channel_layout& channel_layout){ return impl_->mix(format_desc, channel_layout); }
 monitor::subject& audio_mixer::monitor_output(){ return impl_->monitor_subject_; }
 
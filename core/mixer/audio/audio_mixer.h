@@ -27,6 +27,7 @@
 #include <common/array.h>
 
 #include <core/frame/frame_visitor.h>
+#include <core/mixer/audio/audio_dynamics.h>
 #include <core/monitor/monitor.h>
 
 #include <vector>
@@ -55,6 +56,11 @@ public:
 	audio_buffer operator()(const struct video_format_desc& format_desc, const struct audio_channel_layout& channel_layout);
 	void set_master_volume(float volume); 
 	float get_master_volume();
+	void set_master_compressor(const audio_dynamics& settings);
+	audio_dynamics get_master_compressor();
+	void set_master_limiter(const audio_dynamics& settings);
+	audio_dynamics get_master_limiter();
+	void set_layer(int index); // Layer index of the frames visited next, used for per layer monitoring.
 	monitor::subject& monitor_output();
 
 	// frame_visitor
@@ -28,6 +28,7 @@
 #include <common/memory.h>
 
 #include <core/video_format.h>
+#include <core/frame/color_space.h>
 #include <core/frame/frame_visitor.h>
 #include <core/frame/frame_factory.h>
 #include <core/frame/frame.h>
@@ -59,11 +60,21 @@ public:
 	virtual void visit(const class const_frame& frame) = 0;
 	virtual void pop() = 0;
 		
+	// When get_mixing_bit_depth() is greater than 8 the returned buffer holds the
+	// 8-bit bgra image directly followed by the same image as bgra16.
 	virtual std::future<array<const std::uint8_t>> operator()(const struct video_format_desc& format_desc, bool straighten_alpha) = 0;
 
 	virtual class mutable_frame create_frame(const void* tag, const struct pixel_format_desc& desc, const core::audio_channel_layout& channel_layout) = 0;
 
 	// Properties
+
+	// Whether a single full screen ycbcr frame is cheaper to pass through
+	// untouched than to mix. Not the case when ycbcr to bgra comes for free
+	// while mixing, since consumers then convert it on their own threads.
+	virtual bool supports_ycbcr_passthrough() const { return false; }
+
+	// Whether 3D lookup table grades in image_transform::grade are applied.
+	virtual bool supports_color_grading() const { return false; }
 };
 
 }}
\ No newline at end of file
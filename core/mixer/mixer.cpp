@@ -25,6 +25,7 @@
 
 #include "../frame/frame.h"
 
+#include "audio/audio_delay_line.h"
 #include "audio/audio_mixer.h"
 #include "image/image_mixer.h"
 
@@ -33,11 +34,16 @@
 #include <common/diagnostics/graph.h>
 #include <common/except.h>
 #include <common/future.h>
+#include <common/memory_accounting.h>
 #include <common/timer.h>
 
+#include <core/frame/color_conversion.h>
+#include <core/frame/color_space.h>
 #include <core/frame/draw_frame.h>
 #include <core/frame/frame_factory.h>
 #include <core/frame/frame_transform.h>
+#include <core/frame/frame_visitor.h>
+#include <core/frame/geometry.h>
 #include <core/frame/pixel_format.h>
 #include <core/frame/audio_channel_layout.h>
 #include <core/video_format.h>
@@ -49,11 +55,119 @@
 #include <tbb/spin_mutex.h>
 #include <tbb/atomic.h>
 
+#include <deque>
 #include <unordered_map>
 #include <vector>
 
 namespace caspar { namespace core {
 
+// Finds the frame of a mix that consists of a single 8-bit ycbcr frame
+// covering the whole raster without any transform, which the image mixer
+// would only colour convert.
+class passthrough_finder : public frame_visitor
+{
+	std::vector<image_transform>	transform_stack_	= std::vector<image_transform>(1);
+	int								frame_count_		= 0;
+	bool							untouched_			= true;
+	const_frame						frame_				= const_frame::empty();
+public:
+	void push(const frame_transform& transform) override
+	{
+		transform_stack_.push_back(transform_stack_.back() * transform.image_transform);
+	}
+
+	void visit(const const_frame& frame) override
+	{
+		const auto& desc = frame.pixel_format_desc();
+
+		if (desc.format == pixel_format::invalid || desc.planes.empty() || desc.planes.at(0).size < 16)
+			return;
+
+		auto transform = transform_stack_.back();
+
+		if (transform.field_mode == field_mode::empty)
+			return;
+
+		transform.layer_depth = 0;
+
+		const auto& geometry	= frame.geometry();
+		const auto& levels		= transform.levels;
+
+		untouched_ = untouched_
+				&& transform == image_transform()
+				&& levels.min_input == 0.0 && levels.max_input == 1.0 && levels.gamma == 1.0
+				&& levels.min_output == 0.0 && levels.max_output == 1.0
+				&& geometry.type() == frame_geometry::get_default().type()
+				&& geometry.data() == frame_geometry::get_default().data();
+
+		frame_ = frame;
+		++frame_count_;
+	}
+
+	void pop() override
+	{
+		transform_stack_.pop_back();
+	}
+
+	const_frame result(const video_format_desc& format_desc, color_space working_space, color_transfer working_transfer) const
+	{
+		if (frame_count_ != 1 || !untouched_)
+			return const_frame::empty();
+
+		const auto& desc = frame_.pixel_format_desc();
+
+		if (desc.format != pixel_format::ycbcr || desc.planes.size() != 3)
+			return const_frame::empty();
+
+		if (desc.planes.at(0).width != format_desc.width || desc.planes.at(0).height != format_desc.height)
+			return const_frame::empty();
+
+		if (needs_color_transform(
+				resolve_color_space(desc.color_space, format_desc.height),
+				resolve_color_transfer(desc.color_transfer),
+				resolve_color_space(working_space, format_desc.height),
+				resolve_color_transfer(working_transfer)))
+			return const_frame::empty();
+
+		return frame_;
+	}
+};
+
+// Finds the origin of the youngest source frame, the mix is no older than its
+// most recent content. Frames that are shown repeatedly, like stills, keep
+// aging and are only the youngest when nothing else is on the channel.
+class origin_finder : public frame_visitor
+{
+	bool			found_	= false;
+	caspar::timer	origin_;
+public:
+	void push(const frame_transform& transform) override
+	{
+	}
+
+	void visit(const const_frame& frame) override
+	{
+		if (frame.pixel_format_desc().format == pixel_format::invalid)
+			return;
+
+		auto since_created = frame.since_created();
+
+		if (!found_ || since_created.elapsed() < origin_.elapsed())
+			origin_ = since_created;
+
+		found_ = true;
+	}
+
+	void pop() override
+	{
+	}
+
+	const_frame result(const const_frame& mix) const
+	{
+		return found_ ? mix.with_origin(origin_) : mix;
+	}
+};
+
 struct mixer::impl : boost::noncopyable
 {
 	int									channel_index_;
@@ -64,6 +178,8 @@ struct mixer::impl : boost::noncopyable
 	spl::shared_ptr<image_mixer>		image_mixer_;
 
 	bool								straighten_alpha_	= false;
+	const bool							yuv_passthrough_	= env::properties().get(L"configuration.mixer.yuv-passthrough", true);
+	std::map<int, std::deque<draw_frame>>	delayed_video_;
 			
 	executor							executor_			{ L"mixer " + boost::lexical_cast<std::wstring>(channel_index_) };
 
@@ -76,6 +192,7 @@ public:
 		graph_->set_color("mix-time", diagnostics::color(1.0f, 0.0f, 0.9f, 0.8f));
 		current_mix_time_ = 0;
 		audio_mixer_.monitor_output().attach_parent(monitor_subject_);
+		executor_.set_priority(thread_priority::MIXER);
 	}
 	
 	const_frame operator()(std::map<int, draw_frame> frames, const video_format_desc& format_desc, const core::audio_channel_layout& channel_layout)
@@ -92,19 +209,65 @@ public:
 						static_cast<double>(format_desc.square_width)
 						/ static_cast<double>(format_desc.square_height));
 
+				std::map<int, std::deque<draw_frame>> delayed_video;
+				std::vector<draw_frame> videos;
+
 				for (auto& frame : frames)
 				{
+					audio_mixer_.set_layer(frame.first);
 					frame.second.accept(audio_mixer_);
-					frame.second.transform().image_transform.layer_depth = 1;
-					frame.second.accept(*image_mixer_);
+
+					auto video = delay_video(frame.first, frame.second, format_desc, delayed_video);
+					video.transform().image_transform.layer_depth = 1;
+					videos.push_back(std::move(video));
 				}
-				
-				auto image = (*image_mixer_)(format_desc, straighten_alpha_);
+
+				delayed_video_ = std::move(delayed_video);
+
 				auto audio = audio_mixer_(format_desc, channel_layout);
 
 				auto desc = core::pixel_format_desc(core::pixel_format::bgra);
 				desc.planes.push_back(core::pixel_format_desc::plane(format_desc.width, format_desc.height, 4));
-				return const_frame(std::move(image), std::move(audio), this, desc, channel_layout);
+				desc.color_space	= image_mixer_->get_working_color_space();
+				desc.color_transfer	= image_mixer_->get_working_color_transfer();
+
+				if (image_mixer_->get_mixing_bit_depth() > 8)
+					desc.planes.push_back(core::pixel_format_desc::plane(format_desc.width, format_desc.height, 8));
+
+				origin_finder origin;
+
+				for (auto& video : videos)
+					video.accept(origin);
+
+				auto passthrough = find_passthrough(videos, format_desc);
+
+				if (passthrough != const_frame::empty())
+				{
+					// Skip the image mixer, the bgra image is only converted if a consumer asks for it.
+					auto image = std::async(std::launch::deferred, [passthrough, format_desc]
+					{
+						auto buffer	= std::make_shared<accounted_vector<std::uint8_t>>(format_desc.size);
+						const std::uint8_t* const planes[3] =
+						{
+							passthrough.image_data(0).begin(),
+							passthrough.image_data(1).begin(),
+							passthrough.image_data(2).begin()
+						};
+
+						ycbcr_to_bgra(passthrough.pixel_format_desc(), planes, buffer->data());
+
+						return array<const std::uint8_t>(buffer->data(), buffer->size(), true, buffer);
+					}).share();
+
+					return origin.result(const_frame(std::move(image), std::move(audio), this, desc, channel_layout).with_passthrough(passthrough));
+				}
+
+				for (auto& video : videos)
+					video.accept(*image_mixer_);
+
+				auto image = (*image_mixer_)(format_desc, straighten_alpha_);
+
+				return origin.result(const_frame(std::move(image), std::move(audio), this, desc, channel_layout));
 			}
 			catch(...)
 			{
@@ -124,6 +287,49 @@ public:
 		return frame;
 	}
 
+	const_frame find_passthrough(const std::vector<draw_frame>& videos, const video_format_desc& format_desc) const
+	{
+		if (!yuv_passthrough_ || !image_mixer_->supports_ycbcr_passthrough() || image_mixer_->get_mixing_bit_depth() > 8)
+			return const_frame::empty();
+
+		passthrough_finder finder;
+
+		for (auto& video : videos)
+			video.accept(finder);
+
+		return finder.result(format_desc, image_mixer_->get_working_color_space(), image_mixer_->get_working_color_transfer());
+	}
+
+	// Holds back the video of layers with a negative sync offset, the audio
+	// mixer delays their audio by the remaining part of the frame.
+	draw_frame delay_video(int layer, const draw_frame& frame, const video_format_desc& format_desc, std::map<int, std::deque<draw_frame>>& delayed_video)
+	{
+		auto video_frames	= split_sync_offset(frame.transform().audio_transform.sync_offset, format_desc.fps, format_desc.audio_sample_rate).video_frames;
+		auto it				= delayed_video_.find(layer);
+
+		if (video_frames == 0 && it == delayed_video_.end())
+			return frame;
+
+		auto& queue = delayed_video[layer];
+
+		if (it != delayed_video_.end())
+			queue = std::move(it->second);
+
+		queue.push_back(frame);
+
+		// Same as the ports, a shorter delay is caught up one extra frame per
+		// frame and a longer one repeats the oldest frame.
+		for (int n = 0; n < 2 && queue.size() > static_cast<size_t>(video_frames) + 1; ++n)
+			queue.pop_front();
+
+		auto result = queue.front();
+
+		if (video_frames == 0 && queue.size() == 1)
+			delayed_video.erase(layer);
+
+		return result;
+	}
+
 	void set_master_volume(float volume)
 	{
 		executor_.begin_invoke([=]
@@ -140,6 +346,38 @@ public:
 		}, task_priority::high_priority);
 	}
 
+	void set_master_compressor(const audio_dynamics& settings)
+	{
+		executor_.begin_invoke([=]
+		{
+			audio_mixer_.set_master_compressor(settings);
+		}, task_priority::high_priority);
+	}
+
+	audio_dynamics get_master_compressor()
+	{
+		return executor_.invoke([=]
+		{
+			return audio_mixer_.get_master_compressor();
+		}, task_priority::high_priority);
+	}
+
+	void set_master_limiter(const audio_dynamics& settings)
+	{
+		executor_.begin_invoke([=]
+		{
+			audio_mixer_.set_master_limiter(settings);
+		}, task_priority::high_priority);
+	}
+
+	audio_dynamics get_master_limiter()
+	{
+		return executor_.invoke([=]
+		{
+			return audio_mixer_.get_master_limiter();
+		}, task_priority::high_priority);
+	}
+
 	void set_straight_alpha_output(bool value)
 	{
 		executor_.begin_invoke([=]
@@ -177,8 +415,13 @@ mixer::mixer(int channel_index, spl::shared_ptr<diagnostics::graph> graph, spl::
 	: impl_(new impl(channel_index, std::move(graph), std::move(image_mixer))){}
 void mixer::set_master_volume(float volume) { impl_->set_master_volume(volume); }
 float mixer::get_master_volume() { return impl_->get_master_volume(); }
+void mixer::set_master_compressor(const audio_dynamics& settings) { impl_->set_master_compressor(settings); }
+audio_dynamics mixer::get_master_compressor() { return impl_->get_master_compressor(); }
+void mixer::set_master_limiter(const audio_dynamics& settings) { impl_->set_master_limiter(settings); }
+audio_dynamics mixer::get_master_limiter() { return impl_->get_master_limiter(); }
 void mixer::set_straight_alpha_output(bool value) { impl_->set_straight_alpha_output(value); }
 bool mixer::get_straight_alpha_output() { return impl_->get_straight_alpha_output(); }
+bool mixer::supports_color_grading() const { return impl_->image_mixer_->supports_color_grading(); }
 std::future<boost::property_tree::wptree> mixer::info() const{return impl_->info();}
 std::future<boost::property_tree::wptree> mixer::delay_info() const{ return impl_->delay_info(); }
 const_frame mixer::operator()(std::map<int, draw_frame> frames, const video_format_desc& format_desc, const core::audio_channel_layout& channel_layout){ return (*impl_)(std::move(frames), format_desc, channel_layout); }
@@ -22,6 +22,7 @@
 #pragma once
 
 #include "image/blend_modes.h"
+#include "audio/audio_dynamics.h"
 
 #include <common/forward.h>
 #include <common/future_fwd.h>
@@ -56,8 +57,13 @@ public:
 
 	void set_master_volume(float volume);
 	float get_master_volume();
+	void set_master_compressor(const audio_dynamics& settings);
+	audio_dynamics get_master_compressor();
+	void set_master_limiter(const audio_dynamics& settings);
+	audio_dynamics get_master_limiter();
 	void set_straight_alpha_output(bool value);
 	bool get_straight_alpha_output();
+	bool supports_color_grading() const;
 
 	mutable_frame create_frame(const void* tag, const pixel_format_desc& desc, const core::audio_channel_layout& channel_layout);
 
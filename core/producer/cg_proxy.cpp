@@ -413,6 +413,8 @@ public:
 	uint32_t							frame_number() const override												{ return producer_->frame_number(); }
 	boost::property_tree::wptree 		info() const override														{ return producer_->info(); }
 	void								leading_producer(const spl::shared_ptr<frame_producer>& producer) override	{ return producer_->leading_producer(producer); }
+	void								on_video_format_change(const video_format_desc& format_desc) override		{ producer_->on_video_format_change(format_desc); }
+	bool								can_change_video_format(const video_format_desc& format_desc) const override	{ return producer_->can_change_video_format(format_desc); }
 	uint32_t							nb_frames() const override													{ return producer_->nb_frames(); }
 	draw_frame							last_frame()																{ return producer_->last_frame(); }
 	draw_frame							first_frame()																{ return producer_->first_frame(); }
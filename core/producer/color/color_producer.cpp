@@ -146,6 +146,11 @@ public:
 		return constraints_;
 	}
 
+	bool can_change_video_format(const video_format_desc& format_desc) const override
+	{
+		return true;
+	}
+
 	std::wstring print() const override
 	{
 		return L"color[" + colors_str_.value().get() + L"]";
@@ -24,6 +24,7 @@
 #include "cg_proxy.h"
 #include "frame_producer.h"
 
+#include "../diagnostics/call_context.h"
 #include "../frame/draw_frame.h"
 #include "../frame/frame_transform.h"
 
@@ -36,6 +37,7 @@
 #include <common/executor.h>
 #include <common/future.h>
 #include <common/memory.h>
+#include <common/memory_accounting.h>
 
 #include <boost/thread.hpp>
 
@@ -214,6 +216,7 @@ const spl::shared_ptr<frame_producer>& frame_producer::empty()
         }
         draw_frame   last_frame() { return draw_frame::empty(); }
         draw_frame   first_frame() { return draw_frame::empty(); }
+        bool         can_change_video_format(const video_format_desc& format_desc) const override { return true; }
         constraints& pixel_constraints() override
         {
             static constraints c;
@@ -265,6 +268,7 @@ void destroy_producers_synchronously()
 class destroy_producer_proxy : public frame_producer
 {
     std::shared_ptr<frame_producer> producer_;
+    std::shared_ptr<memory_account> memory_account_ = current_memory_account();
 
   public:
     destroy_producer_proxy(spl::shared_ptr<frame_producer>&& producer)
@@ -308,7 +312,11 @@ class destroy_producer_proxy : public frame_producer
         });
     }
 
-    draw_frame                   receive() override { return producer_->receive(); }
+    draw_frame receive() override
+    {
+        scoped_memory_account account(memory_account_);
+        return producer_->receive();
+    }
     std::wstring                 print() const override { return producer_->print(); }
     void                         paused(bool value) override { producer_->paused(value); }
     std::wstring                 name() const override { return producer_->name(); }
@@ -321,9 +329,21 @@ class destroy_producer_proxy : public frame_producer
     {
         return producer_->leading_producer(producer);
     }
+    void on_video_format_change(const video_format_desc& format_desc) override
+    {
+        producer_->on_video_format_change(format_desc);
+    }
+    bool can_change_video_format(const video_format_desc& format_desc) const override
+    {
+        return producer_->can_change_video_format(format_desc);
+    }
     uint32_t          nb_frames() const override { return producer_->nb_frames(); }
     draw_frame        last_frame() { return producer_->last_frame(); }
-    draw_frame        first_frame() { return producer_->first_frame(); }
+    draw_frame        first_frame()
+    {
+        scoped_memory_account account(memory_account_);
+        return producer_->first_frame();
+    }
     monitor::subject& monitor_output() override { return producer_->monitor_output(); }
     bool              collides(double x, double y) const override { return producer_->collides(x, y); }
     void on_interaction(const interaction_event::ptr& event) override { return producer_->on_interaction(event); }
@@ -408,6 +428,17 @@ spl::shared_ptr<core::frame_producer>
 frame_producer_registry::create_producer(const frame_producer_dependencies& dependencies,
                                          const std::vector<std::wstring>&   params) const
 {
+    auto& context = diagnostics::call_context::for_thread();
+
+    if (is_memory_budget_exceeded(context.video_channel))
+        CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Memory budget exceeded. Refusing to create producer on "
+                                                        + context.to_string()));
+
+    // Charge everything the producer allocates while being created and,
+    // through the destroy proxy, while producing frames.
+    scoped_memory_account account(
+        create_memory_account(L"producer[" + (params.empty() ? L"" : params.at(0)) + L"]", context.video_channel, context.layer));
+
     auto& producer_factories = impl_->producer_factories;
     auto  producer           = do_create_producer(dependencies, params, producer_factories);
     auto  key_producer       = frame_producer::empty();
@@ -101,6 +101,10 @@ public:
         virtual draw_frame                                                      first_frame()         = 0;
 	virtual constraints&						pixel_constraints() = 0;
 	virtual void								leading_producer(const spl::shared_ptr<frame_producer>&) {}
+	// Called on the channel thread when the channel changes format while the producer is loaded.
+	virtual void								on_video_format_change(const video_format_desc& format_desc) {}
+	// Whether the producer keeps working after on_video_format_change(format_desc), the channel refuses to change format otherwise.
+	virtual bool								can_change_video_format(const video_format_desc& format_desc) const { return false; }
     virtual boost::optional<int64_t> auto_play_delta() const { return boost::none; }
 };
 
@@ -31,6 +31,7 @@
 #include "../../frame/pixel_format.h"
 #include "../../monitor/monitor.h"
 #include "../../help/help_sink.h"
+#include "../../video_format.h"
 
 #include <common/future.h>
 #include <common/tweener.h>
@@ -193,8 +194,8 @@ class framerate_producer : public frame_producer_base
 	std::function<boost::rational<int>()>				get_source_framerate_;
 	boost::rational<int>								source_framerate_				= -1;
 	audio_channel_layout								source_channel_layout_			= audio_channel_layout::invalid();
-	const boost::rational<int>							original_destination_framerate_;
-	const field_mode									original_destination_fieldmode_;
+	boost::rational<int>								original_destination_framerate_;
+	field_mode											original_destination_fieldmode_;
 	field_mode											destination_fieldmode_			= field_mode::empty;
 	std::vector<int>									destination_audio_cadence_;
 	boost::rational<std::int64_t>						speed_;
@@ -249,6 +250,24 @@ public:
 		}
 	}
 
+	void on_video_format_change(const video_format_desc& format_desc) override
+	{
+		source_->on_video_format_change(format_desc);
+
+		original_destination_framerate_	= format_desc.framerate;
+		original_destination_fieldmode_	= format_desc.field_mode;
+		destination_audio_cadence_		= format_desc.audio_cadence;
+		boost::range::rotate(destination_audio_cadence_, std::end(destination_audio_cadence_) - 1);
+
+		// Forces the conversion to be recalculated on the next frame.
+		source_framerate_				= -1;
+	}
+
+	bool can_change_video_format(const video_format_desc& format_desc) const override
+	{
+		return source_->can_change_video_format(format_desc);
+	}
+
 	std::future<std::wstring> call(const std::vector<std::wstring>& params) override
 	{
 		if (!boost::iequals(params.at(0), L"framerate"))
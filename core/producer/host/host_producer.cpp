@@ -0,0 +1,610 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../../StdAfx.h"
+
+#include "host_producer.h"
+
+#include "../frame_producer.h"
+#include "../../frame/draw_frame.h"
+#include "../../frame/frame.h"
+#include "../../frame/frame_factory.h"
+#include "../../frame/pixel_format.h"
+#include "../../frame/audio_channel_layout.h"
+#include "../../mixer/mixer.h"
+#include "../../mixer/image/image_mixer.h"
+#include "../../monitor/monitor.h"
+#include "../../help/help_sink.h"
+#include "../../help/help_repository.h"
+#include "../../module_dependencies.h"
+
+#include <common/diagnostics/graph.h>
+#include <common/except.h>
+#include <common/future.h>
+#include <common/lock.h>
+#include <common/log.h>
+#include <common/utf.h>
+#include <common/env.h>
+#include <common/os/child_process.h>
+#include <common/os/general_protection_fault.h>
+#include <common/os/shared_frame_ring.h>
+
+#include <boost/algorithm/string/join.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/chrono/system_clocks.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include <tbb/atomic.h>
+#include <tbb/concurrent_queue.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+
+namespace caspar { namespace core { namespace host {
+
+namespace {
+
+// Every ring slot starts with this header, followed by the BGRA image at
+// IMAGE_OFFSET and then the interleaved 32 bit audio samples.
+struct host_frame_header
+{
+	std::uint32_t	width;
+	std::uint32_t	height;
+	std::uint32_t	audio_channels;
+	std::uint32_t	audio_samples;
+	std::int64_t	frame_number;
+};
+
+const std::size_t	IMAGE_OFFSET		= 64;
+const std::size_t	SLOT_COUNT			= 3;
+const auto			MIN_RESTART_DELAY	= boost::chrono::milliseconds(250);
+const auto			MAX_RESTART_DELAY	= boost::chrono::milliseconds(8000);
+const auto			STALL_TIMEOUT		= boost::chrono::seconds(10);
+const auto			CALL_TIMEOUT		= boost::chrono::seconds(10);
+
+static_assert(sizeof(host_frame_header) <= IMAGE_OFFSET, "host_frame_header does not fit before the image");
+
+std::size_t slot_size(const video_format_desc& format_desc, const audio_channel_layout& channel_layout)
+{
+	auto max_samples = *std::max_element(format_desc.audio_cadence.begin(), format_desc.audio_cadence.end());
+
+	return IMAGE_OFFSET + format_desc.size + max_samples * channel_layout.num_channels * sizeof(std::int32_t);
+}
+
+// Control messages are single lines of tab separated fields.
+std::string escape(const std::wstring& field)
+{
+	std::string result;
+
+	for (auto c : u8(field))
+	{
+		switch (c)
+		{
+		case '\\':	result += "\\\\";	break;
+		case '\t':	result += "\\t";	break;
+		case '\n':	result += "\\n";	break;
+		case '\r':	result += "\\r";	break;
+		default:	result += c;		break;
+		}
+	}
+
+	return result;
+}
+
+std::vector<std::wstring> split_fields(const std::string& line)
+{
+	std::vector<std::wstring> fields;
+	std::string field;
+
+	for (std::size_t i = 0; i < line.size(); ++i)
+	{
+		auto c = line[i];
+
+		if (c == '\t')
+		{
+			fields.push_back(u16(field));
+			field.clear();
+		}
+		else if (c == '\\' && i + 1 < line.size())
+		{
+			switch (line[++i])
+			{
+			case 't':	field += '\t';		break;
+			case 'n':	field += '\n';		break;
+			case 'r':	field += '\r';		break;
+			default:	field += line[i];	break;
+			}
+		}
+		else
+			field += c;
+	}
+
+	fields.push_back(u16(field));
+
+	return fields;
+}
+
+std::string create_ring_name()
+{
+	static tbb::atomic<int> counter;
+	static const auto instance = std::random_device()();
+
+	return "/casparcg-host-" + boost::lexical_cast<std::string>(instance) + "-" + boost::lexical_cast<std::string>(counter++);
+}
+
+}
+
+class host_producer : public frame_producer_base
+{
+	monitor::subject							monitor_subject_;
+	const spl::shared_ptr<core::frame_factory>	frame_factory_;
+	video_format_desc							format_desc_;
+	const audio_channel_layout					channel_layout_;
+	const std::wstring							channel_layout_name_;
+	const std::vector<std::wstring>				params_;
+	std::string									ring_name_			= create_ring_name();
+	std::unique_ptr<shared_frame_ring>			ring_;
+	boost::chrono::milliseconds					read_timeout_;
+	constraints									constraints_;
+	bool										corrupt_frame_logged_	= false;
+
+	mutable boost::mutex						process_mutex_;
+	std::shared_ptr<child_process>				process_;
+	std::mutex									call_mutex_;
+	tbb::atomic<std::int64_t>					call_id_;
+
+	int											restarts_			= 0;
+	boost::chrono::milliseconds					restart_delay_		= MIN_RESTART_DELAY;
+	boost::chrono::steady_clock::time_point		next_restart_;
+	boost::chrono::steady_clock::time_point		last_frame_time_;
+public:
+	host_producer(
+			const spl::shared_ptr<core::frame_factory>& frame_factory,
+			const video_format_desc& format_desc,
+			const audio_channel_layout& channel_layout,
+			const std::wstring& channel_layout_name,
+			const std::vector<std::wstring>& params)
+		: frame_factory_(frame_factory)
+		, format_desc_(format_desc)
+		, channel_layout_(channel_layout)
+		, channel_layout_name_(channel_layout_name)
+		, params_(params)
+		, ring_(shared_frame_ring::create(ring_name_, SLOT_COUNT, slot_size(format_desc, channel_layout)))
+		, read_timeout_(static_cast<int>(500.0 / format_desc.fps))
+		, constraints_(format_desc.width, format_desc.height)
+	{
+		call_id_ = 0;
+		start();
+
+		CASPAR_LOG(info) << print() << L" Initialized";
+	}
+
+	// frame_producer
+
+	draw_frame receive_impl() override
+	{
+		auto slot = ring_->begin_read(read_timeout_);
+
+		if (!slot)
+		{
+			supervise();
+			return draw_frame::late();
+		}
+
+		auto header			= static_cast<const host_frame_header*>(slot);
+		auto frame_number	= header->frame_number;
+		auto frame			= draw_frame::late();
+
+		if (header->width == format_desc_.width
+				&& header->height == format_desc_.height
+				&& header->audio_channels == channel_layout_.num_channels)
+			frame = copy_frame(header);
+
+		ring_->end_read();
+
+		last_frame_time_	= boost::chrono::steady_clock::now();
+		restart_delay_		= MIN_RESTART_DELAY;
+
+		monitor_subject_	<< monitor::message("/host/frame") % frame_number
+							<< monitor::message("/host/restarts") % restarts_;
+
+		return frame;
+	}
+
+	// The child mixes to the format it was started with, so it is restarted
+	// with a ring sized for the new one.
+	void on_video_format_change(const video_format_desc& format_desc) override
+	{
+		if (format_desc == format_desc_)
+			return;
+
+		CASPAR_LOG(info) << print() << L" Channel changed to " << format_desc.name << L", restarting producer host.";
+
+		lock(process_mutex_, [&] { return process_; })->kill();
+
+		format_desc_	= format_desc;
+		ring_name_		= create_ring_name();
+		ring_			= shared_frame_ring::create(ring_name_, SLOT_COUNT, slot_size(format_desc_, channel_layout_));
+		read_timeout_	= boost::chrono::milliseconds(static_cast<int>(500.0 / format_desc_.fps));
+		restart_delay_	= MIN_RESTART_DELAY;
+		constraints_.width.set(format_desc_.width);
+		constraints_.height.set(format_desc_.height);
+
+		start();
+	}
+
+	bool can_change_video_format(const video_format_desc& format_desc) const override
+	{
+		return true;
+	}
+
+	std::future<std::wstring> call(const std::vector<std::wstring>& params) override
+	{
+		auto process	= lock(process_mutex_, [&] { return process_; });
+		auto id			= boost::lexical_cast<std::string>(++call_id_);
+		auto line		= "CALL\t" + id;
+
+		for (auto& param : params)
+			line += "\t" + escape(param);
+
+		return std::async(std::launch::async, [=]
+		{
+			std::lock_guard<std::mutex> lock(call_mutex_);
+
+			process->write_line(line);
+
+			auto deadline = boost::chrono::steady_clock::now() + CALL_TIMEOUT;
+			std::string reply;
+
+			while (boost::chrono::steady_clock::now() < deadline)
+			{
+				if (!process->read_line(reply, boost::chrono::duration_cast<boost::chrono::milliseconds>(deadline - boost::chrono::steady_clock::now())))
+					break;
+
+				auto fields = split_fields(reply);
+
+				// Replies to calls that previously timed out are dropped.
+				if (fields.size() < 3 || fields.at(1) != u16(id))
+					continue;
+
+				if (fields.at(0) == L"OK")
+					return fields.at(2);
+
+				CASPAR_THROW_EXCEPTION(user_error() << msg_info(fields.at(2)));
+			}
+
+			CASPAR_THROW_EXCEPTION(timed_out() << msg_info(print() + L" Call was not answered by the producer host."));
+		});
+	}
+
+	constraints& pixel_constraints() override
+	{
+		return constraints_;
+	}
+
+	std::wstring print() const override
+	{
+		return L"host[" + boost::algorithm::join(params_, L" ") + L"|" + boost::lexical_cast<std::wstring>(pid()) + L"]";
+	}
+
+	std::wstring name() const override
+	{
+		return L"host";
+	}
+
+	boost::property_tree::wptree info() const override
+	{
+		boost::property_tree::wptree info;
+		info.add(L"type", L"host");
+		info.add(L"producer", boost::algorithm::join(params_, L" "));
+		info.add(L"pid", pid());
+		info.add(L"restarts", restarts_);
+		return info;
+	}
+
+	monitor::subject& monitor_output() override
+	{
+		return monitor_subject_;
+	}
+private:
+	int pid() const
+	{
+		return lock(process_mutex_, [&] { return process_ ? process_->pid() : -1; });
+	}
+
+	void start()
+	{
+		std::vector<std::string> args;
+		args.push_back("--producer-host");
+		args.push_back(u8(env::configuration_file()));
+		args.push_back(ring_name_);
+		args.push_back(u8(format_desc_.name));
+		args.push_back(u8(channel_layout_name_));
+
+		for (auto& param : params_)
+			args.push_back(u8(param));
+
+		auto process = std::make_shared<child_process>(args);
+
+		lock(process_mutex_, [&] { process_ = process; });
+
+		last_frame_time_	= boost::chrono::steady_clock::now();
+		next_restart_		= last_frame_time_ + restart_delay_;
+		restart_delay_		= std::min(restart_delay_ * 2, MAX_RESTART_DELAY);
+	}
+
+	// Called when no frame was available. A crashed or stalled child is
+	// replaced while the layer keeps showing the last frame.
+	void supervise()
+	{
+		auto process	= lock(process_mutex_, [&] { return process_; });
+		auto now		= boost::chrono::steady_clock::now();
+
+		if (process->is_running())
+		{
+			if (now - last_frame_time_ < STALL_TIMEOUT)
+				return;
+
+			CASPAR_LOG(warning) << print() << L" Producer host stalled, killing it.";
+			process->kill();
+		}
+
+		if (now < next_restart_)
+			return;
+
+		CASPAR_LOG(warning) << print() << L" Producer host exited, restarting it.";
+
+		ring_->clear();
+		++restarts_;
+
+		try
+		{
+			start();
+		}
+		catch (...)
+		{
+			CASPAR_LOG_CURRENT_EXCEPTION();
+			next_restart_ = now + restart_delay_;
+		}
+	}
+
+	draw_frame copy_frame(const host_frame_header* header)
+	{
+		auto max_samples = (ring_->slot_size() - IMAGE_OFFSET - format_desc_.size) / sizeof(std::int32_t);
+
+		// The header comes from the child, which may be the very thing that is broken.
+		if (header->audio_samples > max_samples
+				|| (channel_layout_.num_channels > 0 && header->audio_samples % channel_layout_.num_channels != 0))
+		{
+			if (!corrupt_frame_logged_)
+				CASPAR_LOG(warning) << print() << L" Dropping frame with invalid audio sample count " << header->audio_samples << L".";
+
+			corrupt_frame_logged_ = true;
+			return draw_frame::late();
+		}
+
+		corrupt_frame_logged_ = false;
+
+		core::pixel_format_desc desc(pixel_format::bgra);
+		desc.planes.push_back(core::pixel_format_desc::plane(format_desc_.width, format_desc_.height, 4));
+		auto frame = frame_factory_->create_frame(this, desc, channel_layout_);
+
+		auto image = reinterpret_cast<const std::uint8_t*>(header) + IMAGE_OFFSET;
+		std::memcpy(frame.image_data(0).begin(), image, frame.image_data(0).size());
+
+		auto audio = reinterpret_cast<const std::int32_t*>(image + format_desc_.size);
+		frame.audio_data().assign(audio, audio + header->audio_samples);
+
+		return draw_frame(std::move(frame));
+	}
+};
+
+void describe_producer(core::help_sink& sink, const core::help_repository& repo)
+{
+	sink.short_description(L"Runs another producer in a separate process.");
+	sink.syntax(L"HOST {CHANNEL_LAYOUT [channel_layout:string]} [producer_params:string]");
+	sink.para()->text(L"Creates the producer given by ")->code(L"producer_params")->text(L" in a child process and transfers its frames through shared memory. ")
+		->text(L"A crash, stall or memory exhaustion in the producer only affects the child, which is restarted while the layer keeps showing its last frame.");
+	sink.para()->text(L"The frames are mixed in the child to the video format of the channel and to ")->code(L"channel_layout")->text(L" (stereo by default). CALL is forwarded to the child. Only supported on Linux.");
+	sink.para()->text(L"Examples:");
+	sink.example(L">> PLAY 1-10 HOST folder/clip LOOP", L"plays a clip decoded in a separate process.");
+	sink.example(L">> PLAY 1-10 HOST CHANNEL_LAYOUT 8ch [HTML] http://www.casparcg.com", L"renders a web page in a separate process with 8 audio channels.");
+}
+
+spl::shared_ptr<frame_producer> create_producer(const frame_producer_dependencies& dependencies, const std::vector<std::wstring>& params)
+{
+	if (params.empty() || !boost::iequals(params.at(0), L"HOST"))
+		return frame_producer::empty();
+
+	std::vector<std::wstring> producer_params(params.begin() + 1, params.end());
+	std::wstring channel_layout_name = L"stereo";
+
+	if (producer_params.size() >= 2 && boost::iequals(producer_params.at(0), L"CHANNEL_LAYOUT"))
+	{
+		channel_layout_name = producer_params.at(1);
+		producer_params.erase(producer_params.begin(), producer_params.begin() + 2);
+	}
+
+	if (producer_params.empty() || boost::iequals(producer_params.at(0), L"HOST"))
+		CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"HOST requires the parameters of the producer to host."));
+
+	auto channel_layout = audio_channel_layout_repository::get_default()->get_layout(channel_layout_name);
+
+	if (!channel_layout)
+		CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Channel layout " + channel_layout_name + L" not found"));
+
+	return spl::make_shared<host_producer>(dependencies.frame_factory, dependencies.format_desc, *channel_layout, channel_layout_name, producer_params);
+}
+
+void init(module_dependencies dependencies)
+{
+	dependencies.producer_registry->register_producer_factory(L"Host Producer", &create_producer, &describe_producer);
+}
+
+int run_producer_host(
+		const std::vector<std::wstring>& args,
+		const spl::shared_ptr<const frame_producer_registry>& producer_registry,
+		const spl::shared_ptr<const cg_producer_registry>& cg_registry,
+		const video_format_repository& format_repository,
+		std::unique_ptr<image_mixer> image_mixer)
+{
+	if (args.size() < 4)
+		CASPAR_THROW_EXCEPTION(invalid_argument() << msg_info(L"Usage: --producer-host [config] [ring] [video_mode] [channel_layout] [producer_params...]"));
+
+	auto ring			= shared_frame_ring::open(u8(args.at(0)));
+	auto format_desc	= format_repository.find(args.at(1));
+	auto channel_layout	= audio_channel_layout_repository::get_default()->get_layout(args.at(2));
+
+	if (format_desc.format == video_format::invalid)
+		CASPAR_THROW_EXCEPTION(invalid_argument() << msg_info(L"Invalid video mode " + args.at(1)));
+
+	if (!channel_layout)
+		CASPAR_THROW_EXCEPTION(invalid_argument() << msg_info(L"Invalid channel layout " + args.at(2)));
+
+	std::vector<std::wstring> params(args.begin() + 3, args.end());
+	spl::shared_ptr<core::image_mixer> shared_image_mixer(std::move(image_mixer));
+	spl::shared_ptr<frame_factory> frame_factory = shared_image_mixer;
+	std::shared_ptr<frame_producer> producer = producer_registry->create_producer(
+			frame_producer_dependencies(frame_factory, {}, format_repository, format_desc, producer_registry, cg_registry),
+			params);
+
+	if (producer == frame_producer::empty())
+		CASPAR_THROW_EXCEPTION(file_not_found() << msg_info(L"No match found for " + boost::algorithm::join(params, L" ")));
+
+	auto graph = spl::make_shared<caspar::diagnostics::graph>();
+	mixer mixer(0, graph, shared_image_mixer);
+
+	// The control channel closing is the signal to exit, so the child never
+	// outlives its parent.
+	auto running	= std::make_shared<tbb::atomic<bool>>();
+	auto calls		= std::make_shared<tbb::concurrent_queue<std::vector<std::wstring>>>();
+	*running = true;
+
+	// Calls are only read here. Like on the stage they are made on the thread
+	// that receives from the producer, between two frames.
+	std::thread([running, calls]
+	{
+		ensure_gpf_handler_installed_for_thread("producer-host-control");
+
+		std::string line;
+
+		while (child_process::read_control_line(line))
+		{
+			auto fields = split_fields(line);
+
+			if (fields.size() >= 2 && fields.at(0) == L"CALL")
+				calls->push(std::vector<std::wstring>(fields.begin() + 1, fields.end()));
+		}
+
+		*running = false;
+	}).detach();
+
+	std::vector<std::pair<std::string, std::future<std::wstring>>> pending_calls;
+
+	auto reply = [](const std::string& id, std::future<std::wstring>& result)
+	{
+		try
+		{
+			child_process::write_control_line("OK\t" + id + "\t" + escape(result.get()));
+		}
+		catch (...)
+		{
+			CASPAR_LOG_CURRENT_EXCEPTION();
+			child_process::write_control_line("ERROR\t" + id + "\t" + escape(u16(boost::current_exception_diagnostic_information(true))));
+		}
+	};
+
+	CASPAR_LOG(info) << L"[producer-host] " << producer->print() << L" started.";
+
+	for (std::int64_t frame_number = 0; *running; ++frame_number)
+	{
+		std::vector<std::wstring> call;
+
+		while (calls->try_pop(call))
+		{
+			auto id = escape(call.at(0));
+
+			try
+			{
+				pending_calls.push_back(std::make_pair(id, producer->call(std::vector<std::wstring>(call.begin() + 1, call.end()))));
+			}
+			catch (...)
+			{
+				CASPAR_LOG_CURRENT_EXCEPTION();
+				child_process::write_control_line("ERROR\t" + id + "\t" + escape(u16(boost::current_exception_diagnostic_information(true))));
+			}
+		}
+
+		// Results may depend on later frames, so they are collected as they become ready.
+		for (auto it = pending_calls.begin(); it != pending_calls.end();)
+		{
+			if (it->second.wait_for(std::chrono::seconds(0)) != std::future_status::timeout)
+			{
+				reply(it->first, it->second);
+				it = pending_calls.erase(it);
+			}
+			else
+				++it;
+		}
+
+		std::map<int, draw_frame> frames;
+		frames.insert(std::make_pair(0, producer->receive()));
+
+		auto frame	= mixer(std::move(frames), format_desc, *channel_layout);
+		auto slot	= static_cast<char*>(nullptr);
+
+		while (*running && !slot)
+			slot = static_cast<char*>(ring->begin_write(boost::chrono::milliseconds(100)));
+
+		if (!slot)
+			break;
+
+		auto image		= frame.image_data();
+		auto audio		= frame.audio_data();
+		auto max_audio	= (ring->slot_size() - IMAGE_OFFSET - format_desc.size) / sizeof(std::int32_t);
+		auto header		= reinterpret_cast<host_frame_header*>(slot);
+
+		header->width			= static_cast<std::uint32_t>(frame.width());
+		header->height			= static_cast<std::uint32_t>(frame.height());
+		header->audio_channels	= channel_layout->num_channels;
+		header->audio_samples	= static_cast<std::uint32_t>(std::min(audio.size(), max_audio));
+		header->frame_number	= frame_number;
+
+		std::memcpy(slot + IMAGE_OFFSET, image.begin(), std::min(image.size(), format_desc.size));
+		std::memcpy(slot + IMAGE_OFFSET + format_desc.size, audio.begin(), header->audio_samples * sizeof(std::int32_t));
+
+		ring->end_write();
+	}
+
+	CASPAR_LOG(info) << L"[producer-host] " << producer->print() << L" exiting.";
+
+	return 0;
+}
+
+}}}
@@ -0,0 +1,48 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "../../fwd.h"
+#include "../../video_format.h"
+
+#include <common/memory.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace caspar { namespace core { namespace host {
+
+void init(module_dependencies dependencies);
+
+/**
+ * Entry point of a producer host child process (--producer-host). Creates the
+ * requested producer, mixes it to full frames and hands them to the parent
+ * through the shared frame ring until the parent goes away.
+ */
+int run_producer_host(
+		const std::vector<std::wstring>& args,
+		const spl::shared_ptr<const frame_producer_registry>& producer_registry,
+		const spl::shared_ptr<const cg_producer_registry>& cg_registry,
+		const video_format_repository& format_repository,
+		std::unique_ptr<image_mixer> image_mixer);
+
+}}}
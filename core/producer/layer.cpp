@@ -82,6 +82,7 @@ struct layer::impl
 	bool                                auto_play_          = false;
 	bool								is_paused_			= false;
 	int64_t								current_frame_age_	= 0;
+	video_format_desc					format_desc_;
 
 public:
 	impl(const int index)
@@ -187,6 +188,19 @@ public:
 	{
 		try
 		{
+			if (format_desc_ != format_desc)
+			{
+				// The producers keep running and adapt on their own threads,
+				// frames already produced in the old format are still shown.
+				if (format_desc_.format != video_format::invalid)
+				{
+					foreground_->on_video_format_change(format_desc);
+					background_->on_video_format_change(format_desc);
+				}
+
+				format_desc_ = format_desc;
+			}
+
 			*monitor_subject_ << monitor::message("/paused") % is_paused_;
 
 			caspar::timer produce_timer;
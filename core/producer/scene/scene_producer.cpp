@@ -28,6 +28,8 @@
 #include <boost/algorithm/string/split.hpp>
 #include <boost/algorithm/string.hpp>
 
+#include <tbb/task_group.h>
+
 #include "scene_producer.h"
 
 #include "../../frame/draw_frame.h"
@@ -511,17 +513,53 @@ struct scene_producer::impl
 		for (auto& timeline : timelines_)
 			timeline.second.on_frame(timeline_frame_number_.get());
 
-		std::vector<draw_frame> frames;
+		// Whether a layer is hidden is a binding as well, evaluated before
+		// any producer is received so that frames can be sized up front and
+		// the receiving tasks only ever write to their own element.
+		std::vector<layer*> visible;
 
 		for (auto& layer : layers_)
 		{
-			if (layer.hidden.get())
-				continue;
+			if (!layer.hidden.get())
+				visible.push_back(&layer);
+		}
 
-			draw_frame frame(layer.producer.get()->receive());
-			frame.transform() = get_transform(layer);
-			frames.push_back(frame);
+		std::vector<draw_frame> frames(visible.size(), draw_frame::empty());
+		std::vector<frame_transform> transforms;
+		tbb::task_group producers;
+
+		transforms.reserve(visible.size());
+
+		// Bindings are lazily evaluated and not thread safe, so they are all
+		// evaluated here in layer order, as are the producers with variables,
+		// like nested scenes, whose receive may evaluate bindings of this
+		// scene. The other producers do not touch bindings and are received
+		// concurrently.
+		try
+		{
+			for (std::size_t index = 0; index < visible.size(); ++index)
+			{
+				auto producer = visible[index]->producer.get();
+
+				if (producer->get_variables().empty())
+					producers.run([producer, index, &frames] { frames[index] = producer->receive(); });
+				else
+					frames[index] = producer->receive();
+
+				transforms.push_back(get_transform(*visible[index]));
+			}
 		}
+		catch (...)
+		{
+			producers.cancel();
+			producers.wait();
+			throw;
+		}
+
+		producers.wait();
+
+		for (std::size_t n = 0; n < frames.size(); ++n)
+			frames[n].transform() = transforms[n];
 
 		graph_->set_value("frame-time", frame_timer_.elapsed()
 			* format_desc_.fps
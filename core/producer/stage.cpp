@@ -79,6 +79,7 @@ struct stage::impl : public std::enable_shared_from_this<impl>
         , aggregator_([=](double x, double y) { return collission_detect(x, y); })
     {
         graph_->set_color("produce-time", diagnostics::color(0.0f, 1.0f, 0.0f));
+        executor_.set_priority(thread_priority::MIXER);
     }
 
     std::map<int, draw_frame> operator()(const video_format_desc& format_desc)
@@ -453,6 +454,23 @@ struct stage::impl : public std::enable_shared_from_this<impl>
                                    task_priority::high_priority));
     }
 
+    std::future<std::vector<int>> layers_refusing_format(const video_format_desc& format_desc)
+    {
+        return executor_.begin_invoke(
+            [=]() -> std::vector<int> {
+                std::vector<int> result;
+
+                for (auto& layer : layers_) {
+                    if (!layer.second.foreground()->can_change_video_format(format_desc) ||
+                        !layer.second.background()->can_change_video_format(format_desc))
+                        result.push_back(layer.first);
+                }
+
+                return result;
+            },
+            task_priority::high_priority);
+    }
+
     std::future<std::wstring> call(int index, const std::vector<std::wstring>& params)
     {
         return flatten(executor_.begin_invoke([=] { return get_layer(index).foreground()->call(params).share(); },
@@ -544,6 +562,10 @@ std::future<boost::property_tree::wptree>    stage::info() { return impl_->info(
 std::future<boost::property_tree::wptree>    stage::info(int index) { return impl_->info(index); }
 std::future<boost::property_tree::wptree>    stage::delay_info() { return impl_->delay_info(); }
 std::future<boost::property_tree::wptree>    stage::delay_info(int index) { return impl_->delay_info(index); }
+std::future<std::vector<int>> stage::layers_refusing_format(const video_format_desc& format_desc)
+{
+    return impl_->layers_refusing_format(format_desc);
+}
 std::map<int, draw_frame> stage::operator()(const video_format_desc& format_desc) { return (*impl_)(format_desc); }
 monitor::subject&                stage::monitor_output() { return *impl_->monitor_subject_; }
 void stage::on_interaction(const interaction_event::ptr& event) { impl_->on_interaction(event); }
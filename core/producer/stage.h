@@ -168,6 +168,9 @@ class stage : public stage_base
     std::future<boost::property_tree::wptree> delay_info() override;
     std::future<boost::property_tree::wptree> delay_info(int layer) override;
 
+    // The layers with a producer that cannot follow a change of the channel to format_desc.
+    std::future<std::vector<int>> layers_refusing_format(const video_format_desc& format_desc);
+
     std::future<void> execute(std::function<void()> k) override;
 
     std::unique_lock<std::mutex> get_lock() const;
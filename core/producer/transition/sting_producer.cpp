@@ -75,6 +75,22 @@ namespace caspar {
                 source_producer_ = producer;
             }
 
+            void on_video_format_change(const video_format_desc& format_desc) override
+            {
+                dest_producer_->on_video_format_change(format_desc);
+                source_producer_->on_video_format_change(format_desc);
+                mask_producer_->on_video_format_change(format_desc);
+                overlay_producer_->on_video_format_change(format_desc);
+            }
+
+            bool can_change_video_format(const video_format_desc& format_desc) const override
+            {
+                return dest_producer_->can_change_video_format(format_desc)
+                    && source_producer_->can_change_video_format(format_desc)
+                    && mask_producer_->can_change_video_format(format_desc)
+                    && overlay_producer_->can_change_video_format(format_desc);
+            }
+
             bool is_dest_running() const
             {
                 return (current_frame_ >= static_cast<uint32_t>(info_.trigger_point));
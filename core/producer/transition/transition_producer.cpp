@@ -65,6 +65,17 @@ public:
 		source_producer_ = producer;
 	}
 
+	void on_video_format_change(const video_format_desc& format_desc) override
+	{
+		dest_producer_->on_video_format_change(format_desc);
+		source_producer_->on_video_format_change(format_desc);
+	}
+
+	bool can_change_video_format(const video_format_desc& format_desc) const override
+	{
+		return dest_producer_->can_change_video_format(format_desc) && source_producer_->can_change_video_format(format_desc);
+	}
+
 	boost::optional<int64_t> auto_play_delta() const override { return info_.duration; }
             
         draw_frame first_frame() override { 
@@ -39,6 +39,7 @@
 #include <common/executor.h>
 #include <common/future.h>
 #include <common/lock.h>
+#include <common/memory_accounting.h>
 #include <common/timer.h>
 
 #include <core/diagnostics/call_context.h>
@@ -73,6 +74,8 @@ struct video_channel::impl final
         return spl::make_shared<caspar::diagnostics::graph>();
     }(index_);
 
+    const spl::shared_ptr<memory_account> mixer_memory_account_ = create_memory_account(L"mixer", index_);
+
     caspar::core::output         output_;
     std::future<void>            output_ready_for_frame_ = make_ready_future();
     spl::shared_ptr<image_mixer> image_mixer_;
@@ -110,6 +113,8 @@ struct video_channel::impl final
         graph_->set_text(print());
         caspar::diagnostics::register_graph(graph_);
 
+        executor_.set_priority(thread_priority::CHANNEL);
+
         output_.monitor_output().attach_parent(monitor_subject_);
         mixer_.monitor_output().attach_parent(monitor_subject_);
         stage_->monitor_output().attach_parent(monitor_subject_);
@@ -129,10 +134,26 @@ struct video_channel::impl final
 
     void video_format_desc(const core::video_format_desc& format_desc)
     {
+        // Loaded layers are kept, so the change is refused while one of them
+        // would be left producing in the old format.
+        if (format_desc != video_format_desc()) {
+            auto layers = stage_->layers_refusing_format(format_desc).get();
+
+            if (!layers.empty()) {
+                std::wstring indexes;
+
+                for (auto index : layers)
+                    indexes += (indexes.empty() ? L"" : L", ") + boost::lexical_cast<std::wstring>(index);
+
+                CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Cannot change " + print() + L" to " + format_desc.name +
+                                                                L" while layers " + indexes +
+                                                                L" are loaded with producers that cannot follow it, clear or reload them first."));
+            }
+        }
+
         lock(format_desc_mutex_, [&] {
             format_desc_ = format_desc;
             timecode_->change_format(format_desc);
-            stage_->clear();
         });
     }
 
@@ -145,7 +166,6 @@ struct video_channel::impl final
     {
         lock(channel_layout_mutex_, [&] {
             channel_layout_ = channel_layout;
-            stage_->clear();
         });
     }
 
@@ -201,7 +221,10 @@ struct video_channel::impl final
 
             // Mix
 
-            auto mixed_frame = mixer_(std::move(stage_frames), format_desc, channel_layout);
+            auto mixed_frame = [&] {
+                scoped_memory_account account(mixer_memory_account_);
+                return mixer_(std::move(stage_frames), format_desc, channel_layout);
+            }();
 
             // Consume
 
@@ -179,6 +179,7 @@ public:
 		, device_output_channel_(device_output_channel)
 	{
 		executor_.set_capacity(1);
+		executor_.set_priority(thread_priority::OUTPUT);
 		presentation_delay_millis_ = 0;
 
 		reserved_frames_.set_capacity(BLUEFISH_SOFTWARE_BUFFERS);
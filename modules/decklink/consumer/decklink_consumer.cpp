@@ -35,6 +35,7 @@
 #include <core/frame/frame_timecode.h>
 #include <core/help/help_repository.h>
 #include <core/help/help_sink.h>
+#include <core/latency.h>
 #include <core/mixer/audio/audio_mixer.h>
 
 #include <common/array.h>
@@ -723,6 +724,7 @@ struct decklink_consumer_proxy : public core::frame_consumer
             core::diagnostics::call_context::for_thread() = ctx;
             com_initialize();
         });
+        executor_.set_priority(thread_priority::OUTPUT);
     }
 
     ~decklink_consumer_proxy()
@@ -817,7 +819,7 @@ void describe_consumer(core::help_sink& sink, const core::help_repository& repo)
                L"If given tries to enable either internal or external keying. Not all Blackmagic cards supports this. "
                L"There is also a third experimental option (EXTERNAL_SEPARATE_DEVICE_KEY) which allocates device_index "
                L"+ 1 for synhronized key output.")
-        ->item(L"low_latency", L"Tries to enable low latency if given.")
+        ->item(L"low_latency", L"Tries to enable low latency if given, the default on channels with the low latency profile.")
         ->item(L"embedded_audio", L"Embeds the audio into the SDI signal if given.")
         ->item(L"key_only",
                L" will extract only the alpha channel from the "
@@ -856,7 +858,7 @@ spl::shared_ptr<core::frame_consumer> create_consumer(const std::vector<std::wst
     else
         config.keyer = configuration::keyer_t::default_keyer;
 
-    if (contains_param(L"LOW_LATENCY", params))
+    if (contains_param(L"LOW_LATENCY", params) || core::get_current_latency_profile() == core::latency_profile::low)
         config.latency = configuration::latency_t::low_latency;
 
     config.embedded_audio = contains_param(L"EMBEDDED_AUDIO", params);
@@ -901,6 +903,8 @@ create_preconfigured_consumer(const boost::property_tree::wptree& ptree,
         config.latency = configuration::latency_t::low_latency;
     else if (latency == L"normal")
         config.latency = configuration::latency_t::normal_latency;
+    else if (core::get_current_latency_profile() == core::latency_profile::low)
+        config.latency = configuration::latency_t::low_latency;
 
     auto channel_layout = ptree.get_optional<std::wstring>(L"channel-layout");
 
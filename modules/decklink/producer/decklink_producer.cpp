@@ -46,6 +46,7 @@
 #include <core/frame/frame_transform.h>
 #include <core/help/help_repository.h>
 #include <core/help/help_sink.h>
+#include <core/latency.h>
 #include <core/mixer/audio/audio_mixer.h>
 #include <core/monitor/monitor.h>
 #include <core/producer/frame_producer.h>
@@ -154,7 +155,7 @@ class decklink_producer
 		, format_repository_(format_repository)
         , channel_layout_(get_adjusted_channel_layout(channel_layout))
     {
-        frame_buffer_.set_capacity(2);
+        frame_buffer_.set_capacity(core::get_current_latency_profile() == core::latency_profile::low ? 1 : 2);
 
         graph_->set_color("tick-time", diagnostics::color(0.0f, 0.6f, 0.9f));
         graph_->set_color("late-frame", diagnostics::color(0.6f, 0.3f, 0.3f));
@@ -18,6 +18,8 @@
 #include <common/ptree.h>
 #include <common/param.h>
 #include <common/semaphore.h>
+#include <common/array.h>
+#include <common/cache_aligned_vector.h>
 
 #include <core/consumer/frame_consumer.h>
 #include <core/frame/frame.h>
@@ -61,9 +63,11 @@ extern "C"
 	#include <libavutil/opt.h>
 	#include <libavutil/imgutils.h>
 	#include <libavutil/parseutils.h>
+	#include <libavutil/pixdesc.h>
 	#include <libavfilter/avfilter.h>
 	#include <libavfilter/buffersink.h>
 	#include <libavfilter/buffersrc.h>
+	#include <libswscale/swscale.h>
 }
 
 #pragma warning(pop)
@@ -177,9 +181,13 @@ private:
 
 	std::map<std::string, std::string>			options_;
 	bool										mono_streams_;
+	const int									fragment_frames_;
+	int											frames_since_fragment_		= 0;
+	int											video_stream_index_			= -1;
 
 	core::video_format_desc						in_video_format_;
 	core::audio_channel_layout					in_channel_layout_			= core::audio_channel_layout::invalid();
+	int											in_bit_depth_				= 8;
 
 	std::shared_ptr<AVFormatContext>			oc_;
 	tbb::atomic<bool>							abort_request_;
@@ -196,6 +204,9 @@ private:
     AVFilterContext*							video_graph_in_;
     AVFilterContext*							video_graph_out_;
     std::shared_ptr<AVFilterGraph>				video_graph_;
+	bool										passthrough_allowed_		= false;
+	std::shared_ptr<SwsContext>					passthrough_sws_;
+	int											passthrough_sws_format_		= AVPixelFormat::AV_PIX_FMT_NONE;
 
 	executor									video_encoder_executor_;
 	executor									audio_encoder_executor_;
@@ -211,10 +222,12 @@ public:
 	ffmpeg_consumer(
 			std::string path,
 			std::string options,
-			bool mono_streams)
+			bool mono_streams,
+			int fragment_frames)
 		: path_(path)
 		, full_path_(path)
 		, mono_streams_(mono_streams)
+		, fragment_frames_(fragment_frames)
 		, audio_encoder_executor_(print() + L" audio_encoder")
 		, video_encoder_executor_(print() + L" video_encoder")
 		, write_executor_(print() + L" io")
@@ -275,7 +288,8 @@ public:
 	void initialize(
 			const core::video_format_desc& format_desc,
 			const core::audio_channel_layout& channel_layout,
-                        const core::frame_timecode& start_timecode)
+                        const core::frame_timecode& start_timecode,
+			int bit_depth)
 	{
 		try
 		{
@@ -301,6 +315,7 @@ public:
 
 			graph_->set_color("frame-time", diagnostics::color(0.1f, 1.0f, 0.1f));
 			graph_->set_color("dropped-frame", diagnostics::color(0.3f, 0.6f, 0.3f));
+			graph_->set_color("fragment", diagnostics::color(0.4f, 0.4f, 1.0f));
 			graph_->set_text(print());
 			diagnostics::register_graph(graph_);
 
@@ -352,6 +367,7 @@ public:
 
 			in_video_format_ = format_desc;
 			in_channel_layout_ = channel_layout;
+			in_bit_depth_ = bit_depth;
 
 			CASPAR_VERIFY(oc_->oformat);
 
@@ -415,6 +431,7 @@ public:
 					*video_codec,
 					video_options,
 					0);
+				video_stream_index_ = video_st_->index;
 
 				for (int i = 0; i < audio_filter_->get_num_output_pads(); ++i)
 					audio_sts_.push_back(open_encoder(
@@ -434,6 +451,9 @@ public:
 
 			// Output
 			{
+				if (fragment_frames_ > 0)
+					configure_growing_file();
+
 				AVDictionary* av_opts = nullptr;
 
 				to_dict(
@@ -548,6 +568,48 @@ public:
 
 private:
 
+	bool is_fragmentable_mov() const
+	{
+		static const std::vector<std::string> FRAGMENTABLE = { "mov", "mp4", "ismv", "ipod" };
+
+		return std::find(FRAGMENTABLE.begin(), FRAGMENTABLE.end(), oc_->oformat->name) != FRAGMENTABLE.end();
+	}
+
+	// Makes the file readable while it is still being written. QuickTime
+	// style containers are written as fragments with an empty moov, so that
+	// everything up to the last completed fragment survives a crash. Other
+	// containers (MXF, MPEG-TS...) are refused, flushing them to disk does not
+	// make their index readable before the file is closed.
+	void configure_growing_file()
+	{
+		if (!is_fragmentable_mov())
+			CASPAR_THROW_EXCEPTION(user_error() << msg_info(
+					L"GROWING_FILE is only supported for MOV and MP4 files, " + u16(oc_->oformat->name) + L" cannot be written as fragments."));
+
+		auto& movflags = options_["movflags"];
+
+		for (auto flag : { "frag_custom", "empty_moov", "default_base_moof" })
+		{
+			if (movflags.find(flag) == std::string::npos)
+				movflags += (movflags.empty() ? "" : "+") + std::string(flag);
+		}
+	}
+
+	// Called on the write executor, so the encoders never wait for the disk.
+	void flush_fragment()
+	{
+		FF(av_interleaved_write_frame(oc_.get(), nullptr));
+
+		if (oc_->oformat->flags & AVFMT_ALLOW_FLUSH)
+			FF(av_write_frame(oc_.get(), nullptr));
+
+		if (oc_->pb)
+			avio_flush(oc_->pb);
+
+		frames_since_fragment_ = 0;
+		graph_->set_tag(diagnostics::tag_severity::SILENT, "fragment");
+	}
+
 	static int interrupt_cb(void* ctx)
 	{
 		CASPAR_ASSERT(ctx);
@@ -690,7 +752,7 @@ private:
 
 		const auto vsrc_options = (boost::format("video_size=%1%x%2%:pix_fmt=%3%:time_base=%4%/%5%:pixel_aspect=%6%/%7%:frame_rate=%8%/%9%")
 			% in_video_format_.width % in_video_format_.height
-			% AVPixelFormat::AV_PIX_FMT_BGRA
+			% in_pix_fmt()
 			% in_video_format_.duration	% in_video_format_.time_scale
 			% sample_aspect_ratio.numerator() % sample_aspect_ratio.denominator()
 			% in_video_format_.time_scale % in_video_format_.duration).str();
@@ -739,6 +801,10 @@ private:
 			set_pixel_format(filt_vsink, requested_fmt);
 		}
 
+		// Without filters the graph only converts pixel format, which a
+		// passthrough frame can skip.
+		passthrough_allowed_ = filtergraph.empty();
+
 		if (in_video_format_.width < 1280)
 			video_graph_->scale_sws_opts = "out_color_matrix=bt601";
 		else
@@ -856,6 +922,30 @@ private:
 				nullptr));
 	}
 
+	AVPixelFormat in_pix_fmt() const
+	{
+		return in_bit_depth_ > 8 ? AVPixelFormat::AV_PIX_FMT_BGRA64LE : AVPixelFormat::AV_PIX_FMT_BGRA;
+	}
+
+	// The bgra16 copy of the mixed frame, or the 8-bit image expanded if the
+	// mixer did not provide one.
+	array<const std::uint8_t> high_bit_depth_image(const core::const_frame& frame) const
+	{
+		if (frame.pixel_format_desc().planes.size() > 1)
+			return frame.image_data(1);
+
+		auto source = frame.image_data();
+		auto dest	= std::make_shared<cache_aligned_vector<std::uint16_t>>(source.size());
+
+		tbb::parallel_for(tbb::blocked_range<std::size_t>(0, source.size()), [&](const tbb::blocked_range<std::size_t>& r)
+		{
+			for (auto n = r.begin(); n != r.end(); ++n)
+				(*dest)[n] = static_cast<std::uint16_t>(source.begin()[n] * 257);
+		});
+
+		return array<const std::uint8_t>(reinterpret_cast<const std::uint8_t*>(dest->data()), dest->size() * 2, true, dest);
+	}
+
 	void encode_video(core::const_frame frame_ptr, std::shared_ptr<void> token)
 	{
 		if(!video_st_)
@@ -875,7 +965,7 @@ private:
 					in_video_format_.width,
 					in_video_format_.height);
 
-			src_av_frame->format						= AVPixelFormat::AV_PIX_FMT_BGRA;
+			src_av_frame->format						= in_pix_fmt();
 			src_av_frame->width						= in_video_format_.width;
 			src_av_frame->height						= in_video_format_.height;
 			src_av_frame->sample_aspect_ratio.num	= sample_aspect_ratio.numerator();
@@ -891,10 +981,32 @@ private:
 					<< core::monitor::message("/path")	% path_
 					<< core::monitor::message("/fps")	% in_video_format_.fps;
 
+			auto passthrough_av_frame = passthrough_video(frame_ptr);
+
+			if (passthrough_av_frame)
+			{
+				passthrough_av_frame->pts					= src_av_frame->pts;
+				passthrough_av_frame->sample_aspect_ratio	= src_av_frame->sample_aspect_ratio;
+				passthrough_av_frame->interlaced_frame		= src_av_frame->interlaced_frame;
+				passthrough_av_frame->top_field_first		= src_av_frame->top_field_first;
+
+				video_encoder_executor_.begin_invoke([=]
+				{
+					encode_video_frame(passthrough_av_frame, token);
+				});
+
+				return;
+			}
+
+			auto image = frame_ptr.image_data();
+
+			if (in_bit_depth_ > 8)
+				image = high_bit_depth_image(frame_ptr);
+
 			FF(av_image_fill_arrays(
 				src_av_frame->data,
 				src_av_frame->linesize,
-				frame_ptr.image_data().begin(),
+				image.begin(),
 				static_cast<AVPixelFormat>(src_av_frame->format),
 				in_video_format_.width,
 				in_video_format_.height,
@@ -934,31 +1046,90 @@ private:
 				{
 					FF_RET(ret, "av_buffersink_get_frame");
 
-					if (filt_frame->interlaced_frame)
-					{
-						if (enc->codec->id == AV_CODEC_ID_MJPEG)
-							enc->field_order = filt_frame->top_field_first ? AV_FIELD_TT : AV_FIELD_BB;
-						else
-							enc->field_order = filt_frame->top_field_first ? AV_FIELD_TB : AV_FIELD_BT;
-					}
-					else
-						enc->field_order = AV_FIELD_PROGRESSIVE;
+					encode_video_frame(filt_frame, token);
+				}
+			});
+		}
+	}
 
-					filt_frame->quality = enc->global_quality;
+	void encode_video_frame(const std::shared_ptr<AVFrame>& frame, std::shared_ptr<void> token)
+	{
+		auto enc = video_st_->codec;
 
-					//if (!enc->me_threshold)
-						//filt_frame->pict_type = AV_PICTURE_TYPE_NONE;
+		if (frame->interlaced_frame)
+		{
+			if (enc->codec->id == AV_CODEC_ID_MJPEG)
+				enc->field_order = frame->top_field_first ? AV_FIELD_TT : AV_FIELD_BB;
+			else
+				enc->field_order = frame->top_field_first ? AV_FIELD_TB : AV_FIELD_BT;
+		}
+		else
+			enc->field_order = AV_FIELD_PROGRESSIVE;
 
-					encode_av_frame(
-						*video_st_,
-						avcodec_encode_video2,
-						filt_frame,
-						token);
+		frame->quality = enc->global_quality;
 
-					boost::this_thread::yield(); // TODO:
-				}
-			});
+		//if (!enc->me_threshold)
+			//frame->pict_type = AV_PICTURE_TYPE_NONE;
+
+		encode_av_frame(
+			*video_st_,
+			avcodec_encode_video2,
+			frame,
+			token);
+
+		boost::this_thread::yield(); // TODO:
+	}
+
+	// The ycbcr planes of a passthrough mix in the encoder pixel format, going
+	// straight from the decoder planes instead of through bgra and the filter
+	// graph. Null when the frame or the encoder does not allow it.
+	std::shared_ptr<AVFrame> passthrough_video(const core::const_frame& frame)
+	{
+		auto passthrough = frame.passthrough();
+
+		if (!passthrough_allowed_ || passthrough == core::const_frame::empty())
+			return nullptr;
+
+		const auto& desc = passthrough.pixel_format_desc();
+
+		std::array<uint8_t*, 4> data = {};
+		for (int n = 0; n < static_cast<int>(desc.planes.size()); ++n)
+			data[n] = const_cast<uint8_t*>(passthrough.image_data(n).begin());
+
+		auto source			= make_av_frame(data, desc);
+		auto enc			= video_st_->codec;
+		auto target_desc	= av_pix_fmt_desc_get(enc->pix_fmt);
+
+		if (source->width != enc->width || source->height != enc->height || !target_desc || (target_desc->flags & AV_PIX_FMT_FLAG_RGB))
+			return nullptr;
+
+		if (source->format == enc->pix_fmt)
+		{
+			// Encode the decoder planes as they are, keeping them alive until the encoder is done.
+			return std::shared_ptr<AVFrame>(source.get(), [source, passthrough](AVFrame*) { });
+		}
+
+		if (!passthrough_sws_ || passthrough_sws_format_ != source->format)
+		{
+			passthrough_sws_.reset(sws_getContext(
+					source->width, source->height, static_cast<AVPixelFormat>(source->format),
+					enc->width, enc->height, enc->pix_fmt,
+					SWS_BILINEAR, nullptr, nullptr, nullptr), sws_freeContext);
+			passthrough_sws_format_ = source->format;
+
+			if (!passthrough_sws_)
+				CASPAR_THROW_EXCEPTION(caspar_exception() << msg_info("Could not create software scaling context.") << boost::errinfo_api_function("sws_getContext"));
 		}
+
+		auto target = create_frame();
+		target->format	= enc->pix_fmt;
+		target->width	= enc->width;
+		target->height	= enc->height;
+		FF(av_frame_get_buffer(target.get(), 32));
+
+		sws_scale(passthrough_sws_.get(), source->data, source->linesize, 0, source->height, target->data, target->linesize);
+
+		return target;
 	}
 
 	void encode_audio(core::const_frame frame_ptr, std::shared_ptr<void> token)
@@ -1099,6 +1270,16 @@ private:
 	{
 		write_executor_.begin_invoke([this, pkt_ptr, token]() mutable
 		{
+			if (fragment_frames_ > 0 && pkt_ptr && pkt_ptr->stream_index == video_stream_index_)
+			{
+				// Fragments always start at a key frame so that each one can
+				// be decoded on its own.
+				if (frames_since_fragment_ >= fragment_frames_ && (pkt_ptr->flags & AV_PKT_FLAG_KEY))
+					flush_fragment();
+
+				++frames_since_fragment_;
+			}
+
 			FF(av_interleaved_write_frame(
 				oc_.get(),
 				pkt_ptr.get()));
@@ -1200,6 +1381,7 @@ struct ffmpeg_consumer_proxy : public core::frame_consumer
 	const bool							separate_key_;
 	const bool							mono_streams_;
 	const bool							compatibility_mode_;
+	const int							fragment_frames_;
 	int									consumer_index_offset_;
 
 	std::unique_ptr<ffmpeg_consumer>	consumer_;
@@ -1207,12 +1389,13 @@ struct ffmpeg_consumer_proxy : public core::frame_consumer
 
 public:
 
-	ffmpeg_consumer_proxy(const std::string& path, const std::string& options, bool separate_key, bool mono_streams, bool compatibility_mode)
+	ffmpeg_consumer_proxy(const std::string& path, const std::string& options, bool separate_key, bool mono_streams, bool compatibility_mode, int fragment_frames)
 		: path_(path)
 		, options_(options)
 		, separate_key_(separate_key)
 		, mono_streams_(mono_streams)
 		, compatibility_mode_(compatibility_mode)
+		, fragment_frames_(fragment_frames)
 		, consumer_index_offset_(crc16(path))
 	{
 	}
@@ -1220,13 +1403,15 @@ public:
     
 	void initialize(const core::video_format_desc&    format_desc,
                         const core::audio_channel_layout& channel_layout,
-                        const core::frame_timecode&       start_timecode) const 
+                        const core::frame_timecode&       start_timecode,
+                        int                               bit_depth = 8) const 
         {
-		consumer_->initialize(format_desc, channel_layout, start_timecode);
+		consumer_->initialize(format_desc, channel_layout, start_timecode, bit_depth);
 
 		if (separate_key_)
 		{
-			key_only_consumer_->initialize(format_desc, channel_layout, start_timecode);
+			// The key is only available with 8 bits.
+			key_only_consumer_->initialize(format_desc, channel_layout, start_timecode, 8);
 		}
 	}
 
@@ -1235,7 +1420,7 @@ public:
             if (consumer_)
                 CASPAR_THROW_EXCEPTION(invalid_operation() << msg_info("Cannot reinitialize ffmpeg-consumer."));
 
-            consumer_.reset(new ffmpeg_consumer(path_, options_, mono_streams_));
+            consumer_.reset(new ffmpeg_consumer(path_, options_, mono_streams_, fragment_frames_));
 
             if (separate_key_)
             {
@@ -1243,7 +1428,7 @@ public:
                 auto without_extension = u16(fill_file.parent_path().string() + "/" + fill_file.stem().string());
                 auto key_file = without_extension + L"_A" + u16(fill_file.extension().string());
 
-                key_only_consumer_.reset(new ffmpeg_consumer(u8(key_file), options_, mono_streams_));
+                key_only_consumer_.reset(new ffmpeg_consumer(u8(key_file), options_, mono_streams_, fragment_frames_));
             }
 	}
 
@@ -1313,6 +1498,10 @@ public:
 		info.add(L"path",			u16(path_));
 		info.add(L"separate_key",	separate_key_);
 		info.add(L"mono_streams",	mono_streams_);
+		info.add(L"growing_file",	fragment_frames_ > 0);
+
+		if (fragment_frames_ > 0)
+			info.add(L"fragment_frames", fragment_frames_);
 
 		return info;
 	}
@@ -1351,8 +1540,8 @@ struct ffmpeg_consumer_with_timecode_proxy : public ffmpeg_consumer_proxy
 
 public:
 
-    ffmpeg_consumer_with_timecode_proxy(const std::string& path, const std::string& options, bool separate_key, bool mono_streams, bool compatibility_mode)
-		: ffmpeg_consumer_proxy(path, options, separate_key, mono_streams, compatibility_mode)
+    ffmpeg_consumer_with_timecode_proxy(const std::string& path, const std::string& options, bool separate_key, bool mono_streams, bool compatibility_mode, int fragment_frames)
+		: ffmpeg_consumer_proxy(path, options, separate_key, mono_streams, compatibility_mode, fragment_frames)
                 , initialized_(false)
 	{
 	}
@@ -1381,9 +1570,12 @@ public:
                 {
                     initialized_ = true;
 
+                    // Encode from the bgra16 copy when the mixer provides one.
+                    auto bit_depth = frame.pixel_format_desc().planes.size() > 1 ? 16 : 8;
+
                     is_ready_= std::async(std::launch::async, [=]()
                     {
-                        ffmpeg_consumer_proxy::initialize(format_desc_, channel_layout_, timecode);
+                        ffmpeg_consumer_proxy::initialize(format_desc_, channel_layout_, timecode, bit_depth);
                     });
                     return make_ready_future(true);
                 }
@@ -1403,7 +1595,7 @@ public:
 void describe_ffmpeg_consumer(core::help_sink& sink, const core::help_repository& repo)
 {
 	sink.short_description(L"For streaming/recording the contents of a channel using FFmpeg.");
-	sink.syntax(L"FILE,STREAM [filename:string],[url:string] {-[ffmpeg_param1:string] [value1:string] {-[ffmpeg_param2:string] [value2:string] {...}}} {[separate_key:SEPARATE_KEY]} {[mono_streams:MONO_STREAMS]}");
+	sink.syntax(L"FILE,STREAM [filename:string],[url:string] {-[ffmpeg_param1:string] [value1:string] {-[ffmpeg_param2:string] [value2:string] {...}}} {[separate_key:SEPARATE_KEY]} {[mono_streams:MONO_STREAMS]} {[growing_file:GROWING_FILE] {FRAGMENT_FRAMES [fragment_frames:int]}}");
 	sink.para()->text(L"For recording or streaming the contents of a channel using FFmpeg");
 	sink.definitions()
 		->item(L"filename",			L"The filename under the media folder including the extension (decides which kind of container format that will be used).")
@@ -1411,7 +1603,9 @@ void describe_ffmpeg_consumer(core::help_sink& sink, const core::help_repository
 		->item(L"ffmpeg_paramX",		L"A parameter supported by FFmpeg. For example vcodec or acodec etc.")
 		->item(L"separate_key",		L"If defined will create two files simultaneously -- One for fill and one for key (_A will be appended).")
 		->item(L"mono_streams",		L"If defined every audio channel will be written to its own audio stream.")
-            	->item(L"no_timecode",          L"If defined the timecode metadata recorded to the file will not follow the channel timecode.");
+            	->item(L"no_timecode",          L"If defined the timecode metadata recorded to the file will not follow the channel timecode.")
+		->item(L"growing_file",		L"If defined the file can be opened by other applications while it is being recorded. Only MOV and MP4 files, which are written as fragments.")
+		->item(L"fragment_frames",	L"The minimum number of frames per fragment in growing file mode, a new fragment is started at the next key frame. Defaults to 50. Requires GROWING_FILE.");
 	sink.para()->text(L"Examples:");
 	sink.example(L">> ADD 1 FILE output.mov -vcodec dnxhd");
 	sink.example(L">> ADD 1 FILE output.mov -vcodec prores");
@@ -1419,6 +1613,7 @@ void describe_ffmpeg_consumer(core::help_sink& sink, const core::help_repository
 	sink.example(L">> ADD 1 FILE output.mov -vcodec libx264 -preset ultrafast -tune fastdecode -crf 25");
 	sink.example(L">> ADD 1 FILE output.mov -vcodec dnxhd SEPARATE_KEY", L"for creating output.mov with fill and output_A.mov with key/alpha");
 	sink.example(L">> ADD 1 FILE output.mxf -vcodec dnxhd MONO_STREAMS", L"for creating output.mxf with every audio channel encoded in its own mono stream.");
+	sink.example(L">> ADD 1 FILE output.mov -vcodec prores GROWING_FILE FRAGMENT_FRAMES 25", L"for creating output.mov that can be edited while recording, with a fragment written every second at 25 fps.");
 	sink.example(L">> ADD 1 STREAM udp://<client_ip_address>:9250 -format mpegts -vcodec libx264 -crf 25 -tune zerolatency -preset ultrafast",
 		L"for streaming over UDP instead of creating a local file.");
 }
@@ -1433,6 +1628,20 @@ spl::shared_ptr<core::frame_consumer> create_ffmpeg_consumer(
 	bool separate_key		= get_and_consume_flag(L"SEPARATE_KEY", params2);
 	bool mono_streams		= get_and_consume_flag(L"MONO_STREAMS", params2);
         bool no_timecode                = get_and_consume_flag(L"NO_TIMECODE", params2);
+	bool growing_file		= get_and_consume_flag(L"GROWING_FILE", params2);
+	auto fragment_frames	= get_param(L"FRAGMENT_FRAMES", params2, 50);
+
+	if (contains_param(L"FRAGMENT_FRAMES", params2))
+	{
+		if (!growing_file)
+			CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"FRAGMENT_FRAMES requires GROWING_FILE"));
+
+		auto it = std::find_if(params2.begin(), params2.end(), param_comparer(L"FRAGMENT_FRAMES"));
+		params2.erase(it, std::min(it + 2, params2.end()));
+	}
+
+	if (fragment_frames < 1)
+		CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"FRAGMENT_FRAMES must be at least 1"));
 	auto compatibility_mode	= boost::iequals(params.at(0), L"FILE");
 	auto path				= u8(params2.size() > 1 ? params2.at(1) : L"");
 
@@ -1448,21 +1657,25 @@ spl::shared_ptr<core::frame_consumer> create_ffmpeg_consumer(
 
         if (!no_timecode)
         {
-            return spl::make_shared<ffmpeg_consumer_with_timecode_proxy>(path, args, separate_key, mono_streams, compatibility_mode);
+            return spl::make_shared<ffmpeg_consumer_with_timecode_proxy>(path, args, separate_key, mono_streams, compatibility_mode, growing_file ? fragment_frames : 0);
         }
 
-	return spl::make_shared<ffmpeg_consumer_proxy>(path, args, separate_key, mono_streams, compatibility_mode);
+	return spl::make_shared<ffmpeg_consumer_proxy>(path, args, separate_key, mono_streams, compatibility_mode, growing_file ? fragment_frames : 0);
 }
 
 spl::shared_ptr<core::frame_consumer> create_preconfigured_ffmpeg_consumer(
 		const boost::property_tree::wptree& ptree, core::interaction_sink*, std::vector<spl::shared_ptr<core::video_channel>> channels)
 {
+	if (ptree.get_optional<int>(L"fragment-frames") && !ptree.get<bool>(L"growing-file", false))
+		CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"fragment-frames requires growing-file"));
+
 	return spl::make_shared<ffmpeg_consumer_proxy>(
 			u8(ptree_get<std::wstring>(ptree, L"path")),
 			u8(ptree.get<std::wstring>(L"args", L"")),
 			ptree.get<bool>(L"separate-key", false),
 			ptree.get<bool>(L"mono-streams", false),
-			false);
+			false,
+			ptree.get<bool>(L"growing-file", false) ? ptree.get<int>(L"fragment-frames", 50) : 0);
 }
 
 }}
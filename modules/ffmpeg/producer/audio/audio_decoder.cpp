@@ -165,6 +165,11 @@ public:
 		return packets_.size() > 10;
 	}
 
+	void compensate(int sample_delta, int distance)
+	{
+		THROW_ON_ERROR2(swr_set_compensation(swr_.get(), sample_delta, distance), "[audio_decoder]");
+	}
+
 	std::wstring print() const
 	{
 		return L"[audio-decoder] " + u16(codec_context_->codec->long_name);
@@ -187,6 +192,7 @@ public:
 audio_decoder::audio_decoder(int stream_index, const spl::shared_ptr<AVFormatContext>& context, int out_samplerate) : impl_(new implementation(stream_index, context, out_samplerate)){}
 void audio_decoder::push(const std::shared_ptr<AVPacket>& packet){impl_->push(packet);}
 bool audio_decoder::ready() const{return impl_->ready();}
+void audio_decoder::compensate(int sample_delta, int distance) { impl_->compensate(sample_delta, distance); }
 std::shared_ptr<core::mutable_audio_buffer> audio_decoder::poll() { return impl_->poll(); }
 int	audio_decoder::num_channels() const { return impl_->codec_context_->channels; }
 uint64_t audio_decoder::ffmpeg_channel_layout() const { return impl_->ffmpeg_channel_layout(); }
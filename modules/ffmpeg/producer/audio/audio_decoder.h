@@ -42,6 +42,10 @@ public:
 	void push(const std::shared_ptr<AVPacket>& packet);
 	std::shared_ptr<core::mutable_audio_buffer> poll();
 
+	// Stretches (positive delta) or squeezes the output by sample_delta
+	// samples, spread over the next distance output samples.
+	void compensate(int sample_delta, int distance);
+
 	int	num_channels() const;
 	uint64_t ffmpeg_channel_layout() const;
 
@@ -26,6 +26,7 @@
 #include "../ffmpeg.h"
 #include "../ffmpeg_error.h"
 #include "util/util.h"
+#include "util/drift_estimator.h"
 #include "input/input.h"
 #include "audio/audio_decoder.h"
 #include "video/video_decoder.h"
@@ -36,14 +37,17 @@
 #include <common/diagnostics/graph.h>
 #include <common/future.h>
 #include <common/executor.h>
+#include <common/memory_accounting.h>
 
 #include <core/frame/draw_frame.h>
 #include <core/help/help_repository.h>
 #include <core/help/help_sink.h>
+#include <core/latency.h>
 #include <core/producer/media_info/media_info.h>
 #include <core/producer/framerate/framerate_producer.h>
 #include <core/frame/frame_factory.h>
 
+#include <deque>
 #include <future>
 #include <queue>
 
@@ -75,6 +79,15 @@ std::wstring get_relative_or_original(
 	return result;
 }
 
+// The optional settings of a clip.
+struct producer_options
+{
+	bool			live				= false;
+	uint32_t		jitter_buffer_depth	= 0;
+	std::wstring	custom_channel_order;
+	ffmpeg_options	vid_params;
+};
+
 struct ffmpeg_producer : public core::frame_producer_base
 {
 	spl::shared_ptr<core::monitor::subject>				monitor_subject_;
@@ -87,6 +100,7 @@ struct ffmpeg_producer : public core::frame_producer_base
 	const spl::shared_ptr<core::frame_factory>			frame_factory_;
 
 	std::shared_ptr<void>								initial_logger_disabler_;
+	const std::shared_ptr<memory_account>				memory_account_				= current_memory_account();
 
 	core::constraints									constraints_;
 
@@ -100,18 +114,36 @@ struct ffmpeg_producer : public core::frame_producer_base
 
         caspar::executor worker_;
         std::atomic<bool> abort_;
+        std::atomic<bool> decoded_all_;
 
 	const boost::rational<int>							framerate_;
 	const bool											thumbnail_mode_;
+	const bool											live_;
+	const std::size_t									jitter_buffer_depth_;
+	const double										jitter_buffer_seconds_;
+	const int											audio_sample_rate_;
 
 	core::draw_frame									last_frame_;
 
 	std::queue<std::pair<core::draw_frame, uint32_t>>	frame_buffer_;
-        boost::mutex              buffer_mutex_;
+	std::queue<int64_t>									frame_times_;
+        mutable boost::mutex      buffer_mutex_;
         boost::condition_variable buffer_cond_;
 
 	int64_t												frame_number_				= 0;
 	uint32_t											file_frame_number_			= 0;
+
+	// Set by the channel, applied by the worker. Guarded by buffer_mutex_.
+	boost::optional<core::video_format_desc>			pending_format_desc_;
+
+	// Live sources only. Guarded by buffer_mutex_ except video_correction_,
+	// which is requested by the channel and applied by the worker.
+	drift_estimator										drift_;
+	bool												priming_					= true;
+	tbb::atomic<int>									video_correction_;
+	int													frames_since_correction_request_	= 0;
+	int													extra_repeats_				= 0;
+	int64_t												last_video_time_			= AV_NOPTS_VALUE;
 public:
 	explicit ffmpeg_producer(
 			const spl::shared_ptr<core::frame_factory>& frame_factory,
@@ -124,20 +156,33 @@ public:
 			uint32_t seek,
 			uint32_t out,
 			bool thumbnail_mode,
-			const std::wstring& custom_channel_order,
-			const ffmpeg_options& vid_params)
+			const producer_options& options)
 		: filename_(url_or_file)
 		, frame_factory_(frame_factory)
 		, initial_logger_disabler_(temporary_enable_quiet_logging_for_thread(thumbnail_mode))
-		, input_(graph_, url_or_file, loop, in, seek, out, thumbnail_mode, vid_params)
+		, input_(graph_, url_or_file, loop, in, seek, out, thumbnail_mode, options.live, options.vid_params)
                 , worker_(L"FFmpeg worker - " + filename_)
                 , abort_(false)
+                , decoded_all_(false)
 		, framerate_(read_framerate(*input_.context(), format_desc.framerate))
 		, thumbnail_mode_(thumbnail_mode)
+		, live_(options.live)
+		, jitter_buffer_depth_(std::max<uint32_t>(options.jitter_buffer_depth, 1))
+		, jitter_buffer_seconds_(static_cast<double>(jitter_buffer_depth_) / format_desc.fps)
+		, audio_sample_rate_(format_desc.audio_sample_rate)
 		, last_frame_(core::draw_frame::empty())
+		, drift_(jitter_buffer_seconds_, static_cast<double>(framerate_.denominator()) / static_cast<double>(framerate_.numerator()))
 	{
+		video_correction_ = 0;
+
 		graph_->set_color("frame-time", diagnostics::color(0.1f, 1.0f, 0.1f));
 		graph_->set_color("underflow", diagnostics::color(0.6f, 0.3f, 0.9f));
+
+		if (live_)
+		{
+			graph_->set_color("jitter-buffer", diagnostics::color(0.7f, 0.7f, 0.2f));
+			graph_->set_color("drift-correction", diagnostics::color(1.0f, 0.6f, 0.0f));
+		}
 		graph_->set_text(print());
 		diagnostics::register_graph(graph_);
 
@@ -207,7 +252,7 @@ public:
 				channel_layout = get_audio_channel_layout(
 						audio_decoders_.at(0)->num_channels(),
 						audio_decoders_.at(0)->ffmpeg_channel_layout(),
-						custom_channel_order);
+						options.custom_channel_order);
 				
 				audiocodec = audio_decoders_.back()->print_codec();
 				audiochannels = audio_decoders_.at(0)->num_channels();
@@ -225,7 +270,7 @@ public:
 				channel_layout = get_audio_channel_layout(
 						num_channels,
 						ffmpeg_channel_layout,
-						custom_channel_order);
+						options.custom_channel_order);
 			}
 		}
 
@@ -242,11 +287,14 @@ public:
 
                 if (!thumbnail_mode) {
                     worker_.begin_invoke([=]() {
+                        scoped_memory_account account(memory_account_);
+
                         while (!abort_) {
                             bool got_frame = try_decode_frame();
 
                             // If end of file, then abort the loop
                             if (input_.eof() && input_.buffer_empty() && !got_frame) {
+                                decoded_all_ = true;
                                 return;
                             }
                         }
@@ -314,6 +362,13 @@ public:
                 std::pair<core::draw_frame, uint32_t> frame;
                 {
                     boost::unique_lock<boost::mutex> buffer_lock(buffer_mutex_);
+
+                    if (live_ && !absorb_jitter())
+                    {
+                        send_osc();
+                        return std::make_pair(last_frame_, -1);
+                    }
+
                     if (frame_buffer_.empty())
                     {
                         if (input_.eof())
@@ -337,6 +392,7 @@ public:
 
                     frame = frame_buffer_.front();
                     frame_buffer_.pop();
+                    frame_times_.pop();
                     buffer_cond_.notify_all();
                 }
 
@@ -357,6 +413,115 @@ public:
 		return boost::contains(filename_, L"://");
 	}
 
+	// True when every frame up to the out point has been rendered.
+	bool exhausted() const
+	{
+		boost::unique_lock<boost::mutex> buffer_lock(buffer_mutex_);
+		return decoded_all_ && frame_buffer_.empty();
+	}
+
+	// Blocks until the first frame has been decoded, so that it can be
+	// rendered without delay.
+	bool preroll(boost::chrono::milliseconds timeout)
+	{
+		caspar::timer timer;
+
+		while (!abort_)
+		{
+			{
+				boost::unique_lock<boost::mutex> buffer_lock(buffer_mutex_);
+
+				if (!frame_buffer_.empty() || decoded_all_)
+					return true;
+			}
+
+			if (timer.elapsed() * 1000.0 > timeout.count())
+				return false;
+
+			boost::this_thread::sleep_for(boost::chrono::milliseconds(2));
+		}
+
+		return false;
+	}
+
+	// The jitter buffer is sized in time, so that its depth does not depend
+	// on the frame rate the muxer outputs.
+	std::size_t max_buffered_frames() const
+	{
+		if (!live_)
+			return 2;
+
+		return std::max<std::size_t>(2, static_cast<std::size_t>(std::ceil(2.0 * jitter_buffer_seconds_ * out_fps())));
+	}
+
+	// Called with buffer_mutex_ held. The span from the next frame to show to
+	// the newest packet read from the source, so that packets still waiting in
+	// the input count as buffered. Falls back to the number of buffered frames
+	// when the timestamps are missing or jump.
+	double buffered_seconds() const
+	{
+		static const double MAX_TIMESTAMP_JUMP = 10.0;
+
+		auto frames		= static_cast<double>(frame_buffer_.size()) / out_fps();
+		auto newest		= input_.newest_packet_time();
+
+		if (frame_times_.empty() || frame_times_.front() == AV_NOPTS_VALUE || newest == AV_NOPTS_VALUE)
+			return frames;
+
+		auto span = static_cast<double>(newest - frame_times_.front()) / AV_TIME_BASE;
+
+		if (span < 0.0 || span > frames + MAX_TIMESTAMP_JUMP)
+			return frames;
+
+		return span;
+	}
+
+	// Called with buffer_mutex_ held. Returns false while the jitter buffer is
+	// filling up, in which case the last frame should be repeated.
+	bool absorb_jitter()
+	{
+		graph_->set_value("jitter-buffer", buffered_seconds() / (2.0 * jitter_buffer_seconds_));
+
+		if (frame_buffer_.empty())
+		{
+			if (input_.eof())
+				return true;
+
+			if (!priming_)
+			{
+				CASPAR_LOG(debug) << print() << L" Jitter buffer underrun. Refilling.";
+				graph_->set_tag(diagnostics::tag_severity::WARNING, "underflow");
+			}
+
+			priming_ = true;
+			drift_.reset();
+			return false;
+		}
+
+		if (priming_)
+		{
+			if (buffered_seconds() < jitter_buffer_seconds_ && !input_.eof())
+				return false;
+
+			priming_ = false;
+		}
+
+		drift_.update(buffered_seconds(), 1.0 / out_fps());
+
+		auto correction = drift_.pending_correction();
+
+		if (correction != 0 && video_correction_ == 0)
+		{
+			CASPAR_LOG(debug) << print() << L" Drift " << drift_.drift_ppm() << L" ppm. "
+				<< (correction > 0 ? L"Dropping" : L"Repeating") << L" a frame at the next key frame.";
+
+			drift_.corrected(correction);
+			video_correction_ = correction;
+		}
+
+		return true;
+	}
+
 	void send_osc()
 	{
 		double fps = static_cast<double>(framerate_.numerator()) / static_cast<double>(framerate_.denominator());
@@ -602,6 +767,17 @@ public:
 		info.add(L"nb-frames",			nb_frames2 == std::numeric_limits<int64_t>::max() ? -1 : nb_frames2);
 		info.add(L"file-frame-number",	file_frame_number_);
 		info.add(L"file-nb-frames",		file_nb_frames());
+
+		if (live_)
+		{
+			boost::unique_lock<boost::mutex> buffer_lock(buffer_mutex_);
+
+			info.add(L"live.jitter-buffer-depth",	jitter_buffer_depth_);
+			info.add(L"live.jitter-buffer-fill",	frame_buffer_.size());
+			info.add(L"live.jitter-buffer-millis",	static_cast<int>(buffered_seconds() * 1000.0));
+			info.add(L"live.drift-ppm",				drift_.drift_ppm());
+		}
+
 		return info;
 	}
 
@@ -630,8 +806,45 @@ public:
 		return true;
 	}
 
+	void on_video_format_change(const core::video_format_desc& format_desc) override
+	{
+		if (thumbnail_mode_)
+			return;
+
+		boost::unique_lock<boost::mutex> buffer_lock(buffer_mutex_);
+		pending_format_desc_ = format_desc;
+	}
+
+	// The audio decoders resample to the sample rate of the channel format the
+	// clip was opened for.
+	bool can_change_video_format(const core::video_format_desc& format_desc) const override
+	{
+		return thumbnail_mode_ || format_desc.audio_sample_rate == audio_sample_rate_;
+	}
+
+	// Frames already in frame_buffer_ are played out in the old format while
+	// the muxer primes itself for the new one, so the switch happens on a
+	// frame boundary without emptying the buffer.
+	void apply_pending_format_change()
+	{
+		boost::optional<core::video_format_desc> format_desc;
+
+		{
+			boost::unique_lock<boost::mutex> buffer_lock(buffer_mutex_);
+			std::swap(format_desc, pending_format_desc_);
+		}
+
+		if (!format_desc)
+			return;
+
+		muxer_->video_format_desc(*format_desc);
+		CASPAR_LOG(info) << print() << L" Adapting to " << format_desc->name;
+	}
+
 	bool try_decode_frame()
 	{
+		apply_pending_format_change();
+
 		std::shared_ptr<AVPacket> pkt;
 
 		for (int n = 0; n < 32 && ((video_decoder_ && !video_decoder_->ready()) || !all_audio_decoders_ready()) && input_.try_pop(pkt); ++n)
@@ -675,7 +888,16 @@ public:
 			}
 		});
 
-		muxer_->push(video);
+		if (video && video != flush_video() && video != empty_video())
+			last_video_time_ = video_decoder_->frame_time(*video);
+
+		auto repeats = live_ ? apply_drift_correction(video) : 1;
+
+		if (repeats > 0)
+			muxer_->push(video);
+
+		extra_repeats_ += std::max(0, repeats - 1);
+
 		muxer_->push(audio);
 
 		if (audio_decoders_.empty())
@@ -702,14 +924,55 @@ public:
                     if (frame != core::draw_frame::empty()) {
                         got_frame = true;
                         boost::unique_lock<boost::mutex> buffer_lock(buffer_mutex_);
-                        buffer_cond_.wait(buffer_lock, [&] { return frame_buffer_.size() <= 2 || abort_; });
+                        buffer_cond_.wait(buffer_lock, [&] { return frame_buffer_.size() <= max_buffered_frames() || abort_; });
                         frame_buffer_.push(std::make_pair(frame, file_frame_number));
+                        frame_times_.push(last_video_time_);
+
+                        // A repeat shows the next muxed frame twice, rather than
+                        // feeding the filter the same source frame twice with
+                        // the same PTS.
+                        for (; extra_repeats_ > 0; --extra_repeats_)
+                        {
+                            frame_buffer_.push(std::make_pair(frame, file_frame_number));
+                            frame_times_.push(last_video_time_);
+                        }
                     }
                 }
 
                 return got_frame;
 	}
 
+	// Drops or repeats a video frame to correct drift, preferably at a key
+	// frame since those often coincide with scene changes. The audio is
+	// resampled by the same amount over the next seconds so that it stays in
+	// sync without any audible discontinuity. Returns how many times the
+	// frame should be shown, 0 to drop it.
+	int apply_drift_correction(const std::shared_ptr<AVFrame>& video)
+	{
+		static const int MAX_FRAMES_TO_KEY_FRAME	= 250;
+		static const int COMPENSATION_SECONDS		= 10;
+
+		auto correction = video_correction_.load();
+
+		if (correction == 0 || !video || video == flush_video() || video == empty_video())
+			return 1;
+
+		if (!video->key_frame && ++frames_since_correction_request_ < MAX_FRAMES_TO_KEY_FRAME)
+			return 1;
+
+		frames_since_correction_request_	= 0;
+		video_correction_					= 0;
+
+		auto samples_per_frame = audio_sample_rate_ * framerate_.denominator() / framerate_.numerator();
+
+		for (auto& audio_decoder : audio_decoders_)
+			audio_decoder->compensate(-correction * samples_per_frame, audio_sample_rate_ * COMPENSATION_SECONDS);
+
+		graph_->set_tag(diagnostics::tag_severity::INFO, "drift-correction");
+
+		return correction > 0 ? 0 : 2;
+	}
+
 	bool audio_only() const
 	{
 		return !video_decoder_;
@@ -721,10 +984,339 @@ public:
 	}
 };
 
+struct playlist_clip
+{
+	std::wstring	path;
+	uint32_t		in;
+	uint32_t		out;
+};
+
+// Plays a list of clips back to back. The following clips are opened and
+// decoded ahead of time on a worker so that the switch between two clips
+// happens between two frames without any late frames.
+struct playlist_producer : public core::frame_producer_base
+{
+	static const std::size_t							PREROLL_DEPTH				= 2;
+
+	spl::shared_ptr<core::monitor::subject>				monitor_subject_;
+	const spl::shared_ptr<diagnostics::graph>			graph_;
+
+	const spl::shared_ptr<core::frame_factory>			frame_factory_;
+	const core::video_format_repository					format_repository_;
+	core::video_format_desc								format_desc_;
+	const std::vector<playlist_clip>					clips_;
+	const bool											loop_;
+
+	std::shared_ptr<ffmpeg_producer>					current_;
+	std::size_t											current_index_				= 0;
+	uint32_t											frames_in_clip_				= 0;
+	uint32_t											frames_before_clip_			= 0;
+	int64_t												late_frames_				= 0;
+	bool												waiting_for_preroll_		= false;
+	bool												next_requested_				= false;
+	core::constraints									constraints_;
+
+	std::deque<std::pair<std::size_t, std::shared_future<std::shared_ptr<ffmpeg_producer>>>>	preroll_;
+	std::size_t											next_preroll_index_			= 0;
+	std::atomic<std::uint64_t>							format_generation_			{ 0 };
+
+	executor											executor_					{ L"playlist_producer" };
+public:
+	playlist_producer(
+			const core::frame_producer_dependencies& dependencies,
+			std::vector<playlist_clip> clips,
+			bool loop)
+		: frame_factory_(dependencies.frame_factory)
+		, format_repository_(dependencies.format_repository)
+		, format_desc_(dependencies.format_desc)
+		, clips_(std::move(clips))
+		, loop_(loop)
+	{
+		executor_.set_priority(thread_priority::DECODER);
+		graph_->set_color("late-frame", diagnostics::color(0.6f, 0.3f, 0.3f));
+		graph_->set_color("splice", diagnostics::color(0.3f, 0.6f, 0.9f));
+		graph_->set_text(print());
+		diagnostics::register_graph(graph_);
+
+		schedule_preroll();
+		switch_to_next_clip(true);
+	}
+
+	~playlist_producer()
+	{
+		executor_.invoke([this] { preroll_.clear(); });
+	}
+
+	// frame_producer
+
+	core::draw_frame receive_impl() override
+	{
+		if (next_requested_)
+			next_requested_ = !switch_to_next_clip(false) && !preroll_.empty();
+
+		// Zero length clips are skipped, hence the loop.
+		for (std::size_t n = 0; current_ && n <= clips_.size(); ++n)
+		{
+			auto frame = current_->render_frame();
+
+			if (frame.second != std::numeric_limits<uint32_t>::max())
+			{
+				++frames_in_clip_;
+				return frame.first;
+			}
+
+			if (!current_->exhausted())
+			{
+				++late_frames_;
+				graph_->set_tag(diagnostics::tag_severity::WARNING, "late-frame");
+				return core::draw_frame::late();
+			}
+
+			// Holds the last frame until the next clip is ready, or for good
+			// at the end of the playlist.
+			if (!switch_to_next_clip(false))
+				return current_->last_frame();
+
+			graph_->set_tag(diagnostics::tag_severity::INFO, "splice");
+		}
+
+		return current_ ? core::draw_frame::late() : core::draw_frame::empty();
+	}
+
+	void on_video_format_change(const core::video_format_desc& format_desc) override
+	{
+		format_desc_ = format_desc;
+
+		if (current_)
+			current_->on_video_format_change(format_desc);
+
+		// Clips opened for the old format are reopened. Opens still queued for
+		// the old format are skipped, the finished ones are released on the
+		// worker, so the channel thread never waits for them.
+		++format_generation_;
+
+		auto stale = std::make_shared<decltype(preroll_)>(std::move(preroll_));
+		preroll_.clear();
+		executor_.begin_invoke([stale] { stale->clear(); });
+
+		next_preroll_index_ = current_index_ + 1;
+		schedule_preroll();
+	}
+
+	bool can_change_video_format(const core::video_format_desc& format_desc) const override
+	{
+		return !current_ || current_->can_change_video_format(format_desc);
+	}
+
+	core::constraints& pixel_constraints() override
+	{
+		return current_ ? current_->pixel_constraints() : constraints_;
+	}
+
+	uint32_t nb_frames() const override
+	{
+		if (loop_)
+			return std::numeric_limits<uint32_t>::max();
+
+		uint64_t nb_frames = frames_before_clip_ + (current_ ? current_->nb_frames() : 0);
+
+		for (auto index = current_index_ + 1; index < clips_.size(); ++index)
+		{
+			auto it = std::find_if(preroll_.begin(), preroll_.end(), [&](const std::pair<std::size_t, std::shared_future<std::shared_ptr<ffmpeg_producer>>>& p) { return p.first == index; });
+
+			if (it != preroll_.end() && it->second.wait_for(std::chrono::seconds(0)) == std::future_status::ready && it->second.get())
+				nb_frames += it->second.get()->nb_frames();
+			else if (clips_[index].out != std::numeric_limits<uint32_t>::max())
+				nb_frames += clips_[index].out - std::min(clips_[index].in, clips_[index].out);
+			else
+				return std::numeric_limits<uint32_t>::max();
+		}
+
+		return static_cast<uint32_t>(std::min<uint64_t>(nb_frames, std::numeric_limits<uint32_t>::max()));
+	}
+
+	uint32_t frame_number() const override
+	{
+		return frames_before_clip_ + frames_in_clip_;
+	}
+
+	std::future<std::wstring> call(const std::vector<std::wstring>& params) override
+	{
+		if (boost::iequals(params.at(0), L"next"))
+		{
+			next_requested_ = !switch_to_next_clip(false) && !preroll_.empty();
+			return make_ready_future<std::wstring>(boost::lexical_cast<std::wstring>(current_index_));
+		}
+
+		if (!current_)
+			CASPAR_THROW_EXCEPTION(invalid_operation() << msg_info("Playlist has ended."));
+
+		return current_->call(params);
+	}
+
+	std::wstring print() const override
+	{
+		return L"playlist[" + boost::lexical_cast<std::wstring>(current_index_ + 1) + L"/" + boost::lexical_cast<std::wstring>(clips_.size())
+				+ (current_ ? L"|" + current_->print() : L"") + L"]";
+	}
+
+	std::wstring name() const override
+	{
+		return L"playlist";
+	}
+
+	boost::property_tree::wptree info() const override
+	{
+		boost::property_tree::wptree info;
+		info.add(L"type",			L"playlist-producer");
+		info.add(L"loop",			loop_);
+		info.add(L"clip-index",		current_index_);
+		info.add(L"nb-clips",		clips_.size());
+		info.add(L"late-frames",	late_frames_);
+
+		if (current_)
+			info.add_child(L"clip", current_->info());
+
+		return info;
+	}
+
+	core::monitor::subject& monitor_output() override
+	{
+		return *monitor_subject_;
+	}
+
+	// playlist_producer
+
+	boost::rational<int> get_out_framerate() const
+	{
+		return current_ ? current_->get_out_framerate() : format_desc_.framerate;
+	}
+
+private:
+	void schedule_preroll()
+	{
+		while (preroll_.size() < PREROLL_DEPTH)
+		{
+			if (next_preroll_index_ >= clips_.size())
+			{
+				if (!loop_)
+					return;
+
+				next_preroll_index_ = 0;
+			}
+
+			auto index			= next_preroll_index_++;
+			auto format_desc	= format_desc_;
+			auto generation		= format_generation_.load();
+
+			preroll_.push_back(std::make_pair(index, executor_.begin_invoke([=]() -> std::shared_ptr<ffmpeg_producer>
+			{
+				if (generation != format_generation_)
+					return nullptr;
+
+				try
+				{
+					return open_clip(index, format_desc);
+				}
+				catch (...)
+				{
+					CASPAR_LOG_CURRENT_EXCEPTION();
+					CASPAR_LOG(warning) << print() << L" Skipping " << clips_[index].path;
+					return nullptr;
+				}
+			}).share()));
+
+			if (loop_ && preroll_.size() >= clips_.size())
+				return;
+		}
+	}
+
+	std::shared_ptr<ffmpeg_producer> open_clip(std::size_t index, const core::video_format_desc& format_desc) const
+	{
+		auto& clip = clips_.at(index);
+
+		auto producer = std::make_shared<ffmpeg_producer>(
+				frame_factory_,
+				format_repository_,
+				format_desc,
+				clip.path,
+				L"",
+				false,
+				clip.in,
+				clip.in,
+				clip.out,
+				false,
+				producer_options());
+
+		if (!producer->preroll(boost::chrono::milliseconds(2000)))
+			CASPAR_LOG(warning) << print() << L" " << clip.path << L" did not preroll in time.";
+
+		return producer;
+	}
+
+	// Only waits for the next clip to open when asked to. Otherwise returns
+	// false while it is still opening, so the channel thread never blocks and
+	// the switch is retried on the next frame.
+	bool switch_to_next_clip(bool wait)
+	{
+		for (std::size_t attempt = 0; attempt < clips_.size(); ++attempt)
+		{
+			if (preroll_.empty())
+				return false;
+
+			auto next = preroll_.front();
+
+			if (!wait && next.second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+			{
+				if (!waiting_for_preroll_)
+					CASPAR_LOG(debug) << print() << L" Waiting for " << clips_[next.first].path << L" to preroll.";
+
+				waiting_for_preroll_ = true;
+				++late_frames_;
+				graph_->set_tag(diagnostics::tag_severity::WARNING, "late-frame");
+				return false;
+			}
+
+			waiting_for_preroll_ = false;
+			preroll_.pop_front();
+			schedule_preroll();
+
+			auto producer = next.second.get();
+
+			if (!producer)
+				continue;
+
+			auto previous = std::move(current_);
+
+			frames_before_clip_	+= frames_in_clip_;
+			frames_in_clip_		= 0;
+			current_index_		= next.first;
+			current_			= std::move(producer);
+
+			current_->monitor_output().attach_parent(monitor_subject_);
+			graph_->set_text(print());
+
+			*monitor_subject_ << core::monitor::message("/playlist/index") % static_cast<int32_t>(current_index_)
+							  << core::monitor::message("/playlist/clips") % static_cast<int32_t>(clips_.size());
+
+			// Tearing down a producer joins its worker, keep that off the channel thread.
+			if (previous)
+			{
+				auto holder = std::make_shared<std::shared_ptr<ffmpeg_producer>>(std::move(previous));
+				executor_.begin_invoke([holder] { holder->reset(); });
+			}
+
+			return true;
+		}
+
+		return false;
+	}
+};
+
 void describe_producer(core::help_sink& sink, const core::help_repository& repo)
 {
 	sink.short_description(L"A producer for playing media files supported by FFmpeg.");
-	sink.syntax(L"[clip,url:string] {[loop:LOOP]} {IN,SEEK [in:int]} {OUT [out:int] | LENGTH [length:int]} {FILTER [filter:string]} {CHANNEL_LAYOUT [channel_layout:string]}");
+	sink.syntax(L"[clip,url:string] {[loop:LOOP]} {IN,SEEK [in:int]} {OUT [out:int] | LENGTH [length:int]} {FILTER [filter:string]} {CHANNEL_LAYOUT [channel_layout:string]} {[live:LIVE]} {JITTER_BUFFER [frames:int]}");
 	sink.para()
 		->text(L"The FFmpeg Producer can play all media that FFmpeg can play, which includes many ")
 		->text(L"QuickTime video codec such as Animation, PNG, PhotoJPEG, MotionJPEG, as well as ")
@@ -739,7 +1331,12 @@ void describe_producer(core::help_sink& sink, const core::help_repository& repo)
 		->item(L"filter", L"If specified, will be used as an FFmpeg video filter.")
 		->item(L"channel_layout",
 				L"Optionally override the automatically deduced audio channel layout."
-				L"Either a named layout as specified in casparcg.config or in the format [type:string]:[channel_order:string] for a custom layout.");
+				L"Either a named layout as specified in casparcg.config or in the format [type:string]:[channel_order:string] for a custom layout.")
+		->item(L"live", L"Treats the url as a live source with its own clock. Implied for udp://, rtp:// and srt:// urls.")
+		->item(L"frames", L"The depth of the jitter buffer of a live source in channel frames, kept as a duration of media. 8 frames by default, 2 on channels with the low latency profile.");
+	sink.para()
+		->text(L"A live source is buffered to absorb network jitter. Drift between the clock of the source and the channel is ")
+		->text(L"corrected by dropping or repeating a video frame, preferably at a key frame, while the audio is resampled to match.");
 	sink.para()->text(L"Examples:");
 	sink.example(L">> PLAY 1-10 folder/clip", L"to play all frames in a clip and stop at the last frame.");
 	sink.example(L">> PLAY 1-10 folder/clip LOOP", L"to loop a clip between the first frame and the last frame.");
@@ -750,6 +1347,7 @@ void describe_producer(core::help_sink& sink, const core::help_repository& repo)
 	sink.example(L">> PLAY 1-10 folder/clip CHANNEL_LAYOUT film", L"given the defaults in casparcg.config this will specifies that the clip has 6 audio channels of the type 5.1 and that they are in the order FL FC FR BL BR LFE regardless of what ffmpeg says.");
 	sink.example(L">> PLAY 1-10 folder/clip CHANNEL_LAYOUT \"5.1:LFE FL FC FR BL BR\"", L"specifies that the clip has 6 audio channels of the type 5.1 and that they are in the specified order regardless of what ffmpeg says.");
 	sink.example(L">> PLAY 1-10 rtmp://example.com/live/stream", L"to play an RTMP stream.");
+	sink.example(L">> PLAY 1-10 udp://239.0.0.1:1234 JITTER_BUFFER 12", L"to play a multicast stream with a 12 frame jitter buffer.");
 	sink.example(L">> PLAY 1-10 \"dshow://video=Live! Cam Chat HD VF0790\"", L"to use a web camera as video input on Windows.");
 	sink.example(L">> PLAY 1-10 v4l2:///dev/video0", L"to use a web camera as video input on Linux.");
 	sink.example(L">> PLAY 1-10 iec61883://auto", L"to use a FireWire (H)DV video device as video input on Linux.");
@@ -762,6 +1360,17 @@ void describe_producer(core::help_sink& sink, const core::help_repository& repo)
 	core::describe_framerate_producer(sink);
 }
 
+bool is_live_url(const std::wstring& url)
+{
+	static const std::vector<std::wstring> LIVE_PROTOCOLS = { L"udp://", L"rtp://", L"srt://" };
+
+	for (auto& protocol : LIVE_PROTOCOLS)
+		if (boost::istarts_with(url, protocol))
+			return true;
+
+	return false;
+}
+
 spl::shared_ptr<core::frame_producer> create_producer(
 		const core::frame_producer_dependencies& dependencies,
 		const std::vector<std::wstring>& params,
@@ -800,11 +1409,16 @@ spl::shared_ptr<core::frame_producer> create_producer(
 	auto filter_str				= get_param(L"FILTER",			params, L"");
 	auto custom_channel_order	= get_param(L"CHANNEL_LAYOUT",	params, L"");
 
+	producer_options options;
+	options.custom_channel_order	= custom_channel_order;
+	options.live					= contains_param(L"LIVE", params) || is_live_url(file_or_url);
+	options.jitter_buffer_depth		= get_param(L"JITTER_BUFFER", params, static_cast<uint32_t>(core::get_current_latency_profile() == core::latency_profile::low ? 2 : 8));
+
 	boost::ireplace_all(filter_str, L"DEINTERLACE_BOB",	L"YADIF=1:-1");
 	boost::ireplace_all(filter_str, L"DEINTERLACE_LQ",	L"SEPARATEFIELDS");
 	boost::ireplace_all(filter_str, L"DEINTERLACE",		L"YADIF=0:-1");
 
-	ffmpeg_options vid_params;
+	auto& vid_params = options.vid_params;
 	bool haveFFMPEGStartIndicator = false;
 	for (size_t i = 0; i < params.size() - 1; ++i)
 	{
@@ -832,8 +1446,7 @@ spl::shared_ptr<core::frame_producer> create_producer(
 			seek,
 			out,
 			false,
-			custom_channel_order,
-			vid_params);
+			options);
 
 	if (producer->audio_only())
 		return core::create_destroy_proxy(producer);
@@ -849,6 +1462,102 @@ spl::shared_ptr<core::frame_producer> create_producer(
 			dependencies.format_desc.audio_cadence));
 }
 
+void describe_playlist_producer(core::help_sink& sink, const core::help_repository& repo)
+{
+	sink.short_description(L"Plays several media files back to back without gaps.");
+	sink.syntax(L"PLAYLIST [clip:string] {IN,SEEK [in:int]} {OUT [out:int] | LENGTH [length:int]} {[clip:string] ...} {[loop:LOOP]}");
+	sink.para()
+		->text(L"Each clip is played between its in and out points, followed directly by the next clip. ")
+		->text(L"The next clips are opened and decoded in advance, so the switch between two clips is frame accurate ")
+		->text(L"and does not cause late frames. Clips may have different frame rates.");
+	sink.definitions()
+		->item(L"clip", L"A file relative to the media folder, quoted if it contains spaces.")
+		->item(L"in", L"Optionally sets the first frame of the preceding clip.")
+		->item(L"out", L"Optionally sets the last frame of the preceding clip.")
+		->item(L"length", L"Optionally sets the length of the preceding clip.")
+		->item(L"loop", L"Starts over with the first clip after the last one.");
+	sink.para()->text(L"Examples:");
+	sink.example(L">> PLAY 1-10 PLAYLIST intro LENGTH 50 \"folder/clip two\" IN 25 OUT 200 outro", L"to play three clips in a row.");
+	sink.example(L">> PLAY 1-10 PLAYLIST clip1 clip2 clip3 LOOP", L"to loop three clips.");
+	sink.para()->text(L"The current clip can be skipped via ")->code(L"CALL")->text(L":");
+	sink.example(L">> CALL 1-10 NEXT");
+}
+
+spl::shared_ptr<core::frame_producer> create_playlist_producer(
+		const core::frame_producer_dependencies& dependencies,
+		const std::vector<std::wstring>& params)
+{
+	if (params.empty() || !boost::iequals(params.at(0), L"PLAYLIST"))
+		return core::frame_producer::empty();
+
+	constexpr auto uint32_max = std::numeric_limits<uint32_t>::max();
+
+	std::vector<playlist_clip>	clips;
+	std::vector<uint32_t>		lengths;
+	bool						loop = false;
+
+	for (std::size_t i = 1; i < params.size(); ++i)
+	{
+		auto& param = params.at(i);
+
+		if (boost::iequals(param, L"LOOP"))
+		{
+			loop = true;
+			continue;
+		}
+
+		bool is_in		= boost::iequals(param, L"IN") || boost::iequals(param, L"SEEK");
+		bool is_out		= boost::iequals(param, L"OUT");
+		bool is_length	= boost::iequals(param, L"LENGTH");
+
+		if (is_in || is_out || is_length)
+		{
+			if (clips.empty() || i + 1 >= params.size())
+				CASPAR_THROW_EXCEPTION(user_error() << msg_info(param + L" must follow a clip and be followed by a frame number."));
+
+			auto value = boost::lexical_cast<uint32_t>(params.at(++i));
+
+			if (is_in)
+				clips.back().in = value;
+			else if (is_out)
+				clips.back().out = value;
+			else
+				lengths.back() = value;
+
+			continue;
+		}
+
+		auto path = probe_stem(env::media_folder() + L"/" + param, false);
+
+		if (path.empty())
+			CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Playlist clip " + param + L" not found."));
+
+		clips.push_back(playlist_clip { path, 0, uint32_max });
+		lengths.push_back(uint32_max);
+	}
+
+	if (clips.empty())
+		CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"PLAYLIST requires at least one clip."));
+
+	for (std::size_t n = 0; n < clips.size(); ++n)
+	{
+		if (lengths[n] != uint32_max)
+			clips[n].out = lengths[n] < uint32_max - clips[n].in ? clips[n].in + lengths[n] : uint32_max;
+	}
+
+	auto producer = spl::make_shared<playlist_producer>(dependencies, std::move(clips), loop);
+
+	auto get_source_framerate	= [=] { return producer->get_out_framerate(); };
+	auto target_framerate		= dependencies.format_desc.framerate;
+
+	return core::create_destroy_proxy(core::create_framerate_producer(
+			producer,
+			get_source_framerate,
+			target_framerate,
+			dependencies.format_desc.field_mode,
+			dependencies.format_desc.audio_cadence));
+}
+
 core::draw_frame create_thumbnail_frame(
 		const core::frame_producer_dependencies& dependencies,
 		const std::wstring& media_file,
@@ -865,7 +1574,6 @@ core::draw_frame create_thumbnail_frame(
 	auto out		= std::numeric_limits<uint32_t>::max();
 	auto filter_str = L"";
 
-	ffmpeg_options vid_params;
 	auto producer = spl::make_shared<ffmpeg_producer>(
 			dependencies.frame_factory,
 			dependencies.format_repository,
@@ -877,8 +1585,7 @@ core::draw_frame create_thumbnail_frame(
 			in,
 			out,
 			true,
-			L"",
-			vid_params);
+			producer_options());
 
 	return producer->create_thumbnail_frame();
 }
@@ -35,6 +35,10 @@ spl::shared_ptr<core::frame_producer> create_producer(
 		const core::frame_producer_dependencies& dependencies,
 		const std::vector<std::wstring>& params,
 		const spl::shared_ptr<core::media_info_repository>& info_repo);
+void describe_playlist_producer(core::help_sink& sink, const core::help_repository& repo);
+spl::shared_ptr<core::frame_producer> create_playlist_producer(
+		const core::frame_producer_dependencies& dependencies,
+		const std::vector<std::wstring>& params);
 core::draw_frame create_thumbnail_frame(
 		const core::frame_producer_dependencies& dependencies,
 		const std::wstring& media_file,
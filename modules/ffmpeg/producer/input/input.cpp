@@ -33,6 +33,7 @@
 #include <common/diagnostics/graph.h>
 #include <common/executor.h>
 #include <common/except.h>
+#include <common/memory_accounting.h>
 #include <common/os/general_protection_fault.h>
 #include <common/param.h>
 #include <common/scope_exit.h>
@@ -72,19 +73,23 @@ struct input::impl : boost::noncopyable
 	tbb::atomic<uint32_t>										in_;
 	tbb::atomic<uint32_t>										out_;
 	const bool													thumbnail_mode_;
+	const bool													live_;
 	tbb::atomic<bool>											loop_;
 	uint32_t													file_frame_number_		= 0;
 
 	tbb::concurrent_bounded_queue<std::shared_ptr<AVPacket>>	buffer_;
 	tbb::atomic<size_t>											buffer_size_;
+	tbb::atomic<int64_t>										newest_packet_time_;
+	const std::shared_ptr<memory_account>						memory_account_			= current_memory_account();
 
 	executor													executor_;
 
-	explicit impl(const spl::shared_ptr<diagnostics::graph> graph, const std::wstring& url_or_file, bool loop, uint32_t in, uint32_t seek, uint32_t out, bool thumbnail_mode, const ffmpeg_options& vid_params)
+	explicit impl(const spl::shared_ptr<diagnostics::graph> graph, const std::wstring& url_or_file, bool loop, uint32_t in, uint32_t seek, uint32_t out, bool thumbnail_mode, bool live, const ffmpeg_options& vid_params)
 		: graph_(graph)
 		, format_context_(open_input(url_or_file, vid_params))
 		, filename_(url_or_file)
 		, thumbnail_mode_(thumbnail_mode)
+		, live_(live)
 		, executor_(print())
 	{
 		if (thumbnail_mode_)
@@ -93,10 +98,13 @@ struct input::impl : boost::noncopyable
 				enable_quiet_logging_for_thread();
 			});
 
+		executor_.set_priority(thumbnail_mode_ ? thread_priority::LOW : thread_priority::DECODER);
+
 		in_				= in;
 		out_			= out;
 		loop_			= loop;
 		buffer_size_	= 0;
+		newest_packet_time_	= AV_NOPTS_VALUE;
 
 		if(seek > 0)
 			queued_seek(seek);
@@ -161,9 +169,28 @@ struct input::impl : boost::noncopyable
 
 	bool full() const
 	{
+		// Shrink the read-ahead to a minimum while the memory budget is exceeded.
+		if (memory_account_ && memory_account_->is_budget_exceeded())
+			return buffer_.size() > MAX_BUFFER_COUNT_RT;
+
+		// A live source cannot be paused, so keep reading to not lose packets
+		// in the network buffers. The producer absorbs the jitter.
+		if (live_)
+			return buffer_size_ > MAX_BUFFER_SIZE;
+
 		return (buffer_size_ > MAX_BUFFER_SIZE || buffer_.size() > get_max_buffer_count()) && buffer_.size() > get_min_buffer_count();
 	}
 
+	// The decode timestamp is used since it increases from packet to packet,
+	// unlike the presentation timestamp of reordered frames.
+	void record_packet_time(const AVPacket& packet)
+	{
+		auto time = packet.dts != AV_NOPTS_VALUE ? packet.dts : packet.pts;
+
+		if (time != AV_NOPTS_VALUE)
+			newest_packet_time_ = av_rescale_q(time, format_context_->streams[packet.stream_index]->time_base, AV_TIME_BASE_Q);
+	}
+
         bool empty() const {
             return buffer_.empty();
         }
@@ -212,15 +239,19 @@ struct input::impl : boost::noncopyable
 					THROW_ON_ERROR(ret, "av_read_frame", print());
 
 					if(packet->stream_index == default_stream_index_)
+					{
 						++file_frame_number_;
+						record_packet_time(*packet);
+					}
 
 					THROW_ON_ERROR2(av_dup_packet(packet.get()), print());
 
 					// Make sure that the packet is correctly deallocated even if size and data is modified during decoding.
 					auto size = packet->size;
 					auto data = packet->data;
+					auto charge = charge_memory(memory_account_, size);
 
-					packet = spl::shared_ptr<AVPacket>(packet.get(), [packet, size, data](AVPacket*)
+					packet = spl::shared_ptr<AVPacket>(packet.get(), [packet, size, data, charge](AVPacket*)
 					{
 						packet->size = size;
 						packet->data = data;
@@ -338,6 +369,8 @@ struct input::impl : boost::noncopyable
 		if (!thumbnail_mode_)
 			CASPAR_LOG(debug) << print() << " Seeking: " << target;
 
+		newest_packet_time_ = AV_NOPTS_VALUE;
+
 		auto stream = format_context_->streams[default_stream_index_];
 
 		auto fps = read_fps(*format_context_, 0.0);
@@ -376,9 +409,10 @@ struct input::impl : boost::noncopyable
 	}
 };
 
-input::input(const spl::shared_ptr<diagnostics::graph>& graph, const std::wstring& url_or_file, bool loop, uint32_t in, uint32_t seek, uint32_t out, bool thumbnail_mode, const ffmpeg_options& vid_params)
-	: impl_(new impl(graph, url_or_file, loop, in, seek, out, thumbnail_mode, vid_params)){}
+input::input(const spl::shared_ptr<diagnostics::graph>& graph, const std::wstring& url_or_file, bool loop, uint32_t in, uint32_t seek, uint32_t out, bool thumbnail_mode, bool live, const ffmpeg_options& vid_params)
+	: impl_(new impl(graph, url_or_file, loop, in, seek, out, thumbnail_mode, live, vid_params)){}
 bool input::eof() const {return !impl_->executor_.is_running();}
+int64_t input::newest_packet_time() const { return impl_->newest_packet_time_; }
 bool input::try_pop(std::shared_ptr<AVPacket>& packet){return impl_->try_pop(packet);}
 bool input::buffer_empty() const { return impl_->empty(); }
 spl::shared_ptr<AVFormatContext> input::context(){return impl_->format_context_;}
@@ -49,11 +49,14 @@ namespace ffmpeg {
 class input : boost::noncopyable
 {
 public:
-	explicit input(const spl::shared_ptr<diagnostics::graph>& graph, const std::wstring& url_or_file, bool loop, uint32_t in, uint32_t seek, uint32_t out, bool thumbnail_mode, const ffmpeg_options& vid_params);
+	explicit input(const spl::shared_ptr<diagnostics::graph>& graph, const std::wstring& url_or_file, bool loop, uint32_t in, uint32_t seek, uint32_t out, bool thumbnail_mode, bool live, const ffmpeg_options& vid_params);
 
 	bool								try_pop(std::shared_ptr<AVPacket>& packet);
         bool                                                            buffer_empty() const;
 	bool								eof() const;
+	// The timestamp of the newest packet read from the source in AV_TIME_BASE
+	// units, AV_NOPTS_VALUE before the first one.
+	int64_t								newest_packet_time() const;
 
 	void								in(uint32_t value);
 	uint32_t							in() const;
@@ -136,7 +136,7 @@ struct frame_muxer::impl : boost::noncopyable
 	display_mode									display_mode_				= display_mode::invalid;
 	const boost::rational<int>						in_framerate_;
 	core::video_format_repository					format_repository_;
-	const video_format_desc							format_desc_;
+	core::video_format_desc							format_desc_;
 	const audio_channel_layout						audio_channel_layout_;
 
 	std::vector<int>								audio_cadence_				= format_desc_.audio_cadence;
@@ -344,6 +344,21 @@ struct frame_muxer::impl : boost::noncopyable
 		return samples;
 	}
 
+	void video_format_desc(const core::video_format_desc& format_desc)
+	{
+		if (format_desc_ == format_desc)
+			return;
+
+		format_desc_ = format_desc;
+
+		// The deinterlacing and field order decisions depend on the channel
+		// format, so the filter graph is rebuilt from the next video frame.
+		// Frames already muxed are kept.
+		display_mode_ = display_mode::invalid;
+		filter_.reset();
+		previously_filtered_frame_ = boost::none;
+	}
+
 	uint32_t calc_nb_frames(uint32_t nb_frames) const
 	{
 		uint64_t nb_frames2 = nb_frames;
@@ -488,6 +503,7 @@ frame_muxer::frame_muxer(
 void frame_muxer::push(const std::shared_ptr<AVFrame>& video){impl_->push(video);}
 void frame_muxer::push(const std::vector<std::shared_ptr<core::mutable_audio_buffer>>& audio_samples_per_stream){impl_->push(audio_samples_per_stream);}
 core::draw_frame frame_muxer::poll(){return impl_->poll();}
+void frame_muxer::video_format_desc(const core::video_format_desc& format_desc){impl_->video_format_desc(format_desc);}
 uint32_t frame_muxer::calc_nb_frames(uint32_t nb_frames) const {return impl_->calc_nb_frames(nb_frames);}
 bool frame_muxer::video_ready() const{return impl_->video_ready();}
 bool frame_muxer::audio_ready() const{return impl_->audio_ready();}
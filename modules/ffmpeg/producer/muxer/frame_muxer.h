@@ -63,6 +63,8 @@ public:
 
 	core::draw_frame poll();
 
+	void video_format_desc(const core::video_format_desc& format_desc);
+
 	boost::rational<int> out_framerate() const;
 
 	uint32_t calc_nb_frames(uint32_t nb_frames) const;
@@ -0,0 +1,113 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "../../StdAfx.h"
+
+#include "drift_estimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace caspar { namespace ffmpeg {
+
+// Weight of each new sample in the average fill, about 2 seconds at 25 fps.
+static const double			FILL_SMOOTHING			= 1.0 / 50.0;
+// Number of frames the drift is measured over, about 30 seconds at 25 fps.
+static const std::int64_t	DRIFT_WINDOW			= 750;
+// Frames to wait after a correction before requesting another, long enough
+// for the correction to be applied and show in the average fill.
+static const std::int64_t	CORRECTION_HOLDOFF		= 750;
+static const double			MAX_DRIFT_PPM			= 1000.0;
+
+drift_estimator::drift_estimator(double target_seconds, double frame_seconds)
+	: target_seconds_(target_seconds)
+	, frame_seconds_(frame_seconds)
+{
+}
+
+void drift_estimator::update(double fill_seconds, double sample_seconds)
+{
+	if (!has_average_)
+	{
+		average_fill_		= fill_seconds;
+		window_start_fill_	= average_fill_;
+		has_average_		= true;
+	}
+	else
+		average_fill_ += (fill_seconds - average_fill_) * FILL_SMOOTHING;
+
+	++frames_since_correction_;
+	window_seconds_ += sample_seconds;
+
+	if (++window_frames_ < DRIFT_WINDOW)
+		return;
+
+	// Dropped frames would otherwise have stayed in the buffer and repeated
+	// frames would not have been there, so add them back to get the drift.
+	auto growth		= average_fill_ - window_start_fill_ + static_cast<double>(window_corrections_) * frame_seconds_;
+	auto measured	= std::max(-MAX_DRIFT_PPM, std::min(MAX_DRIFT_PPM, growth / window_seconds_ * 1000000.0));
+
+	drift_ppm_				+= (measured - drift_ppm_) * 0.25;
+	window_start_fill_		= average_fill_;
+	window_frames_			= 0;
+	window_seconds_			= 0.0;
+	window_corrections_		= 0;
+}
+
+void drift_estimator::corrected(int correction)
+{
+	window_corrections_			+= correction;
+	frames_since_correction_	= 0;
+}
+
+void drift_estimator::reset()
+{
+	has_average_				= false;
+	window_frames_				= 0;
+	window_seconds_				= 0.0;
+	window_corrections_			= 0;
+	frames_since_correction_	= 0;
+}
+
+int drift_estimator::pending_correction() const
+{
+	if (!has_average_ || frames_since_correction_ < CORRECTION_HOLDOFF)
+		return 0;
+
+	auto error = average_fill_ - target_seconds_;
+
+	if (error >= frame_seconds_)
+		return 1;
+	else if (error <= -frame_seconds_)
+		return -1;
+	else
+		return 0;
+}
+
+double drift_estimator::average_fill() const
+{
+	return average_fill_;
+}
+
+double drift_estimator::drift_ppm() const
+{
+	return drift_ppm_;
+}
+
+}}
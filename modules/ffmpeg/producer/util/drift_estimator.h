@@ -0,0 +1,64 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace caspar { namespace ffmpeg {
+
+/**
+ * Estimates the drift between the clock of a live source and the channel
+ * clock from the fill level of the jitter buffer in seconds of media, sampled
+ * once per rendered frame.
+ *
+ * Network jitter is smoothed out by averaging the fill level. When the
+ * average has moved a whole source frame away from the target depth a
+ * correction is requested, 1 to drop a frame (source is faster) or -1 to
+ * repeat one (source is slower). After a correction no new one is requested
+ * until it has had time to take effect.
+ */
+class drift_estimator
+{
+public:
+	drift_estimator(double target_seconds, double frame_seconds);
+
+	// sample_seconds is the time since the previous sample.
+	void		update(double fill_seconds, double sample_seconds);
+	void		corrected(int correction);
+	void		reset();
+
+	int			pending_correction() const;
+	double		average_fill() const;
+	double		drift_ppm() const;
+private:
+	const double	target_seconds_;
+	const double	frame_seconds_;
+	double			average_fill_			= 0.0;
+	bool			has_average_			= false;
+	double			drift_ppm_				= 0.0;
+	double			window_start_fill_		= 0.0;
+	std::int64_t	window_frames_			= 0;
+	double			window_seconds_			= 0.0;
+	std::int64_t	window_corrections_		= 0;
+	std::int64_t	frames_since_correction_	= 0;
+};
+
+}}
@@ -60,6 +60,7 @@ extern "C"
 	#include <libswscale/swscale.h>
 	#include <libavcodec/avcodec.h>
 	#include <libavformat/avformat.h>
+	#include <libavutil/pixdesc.h>
 }
 #if defined(_MSC_VER)
 #pragma warning (pop)
@@ -75,6 +76,61 @@ core::field_mode get_mode(const AVFrame& frame)
 	return frame.top_field_first ? core::field_mode::upper : core::field_mode::lower;
 }
 
+core::color_space get_color_space(const AVFrame& frame)
+{
+	switch(frame.colorspace)
+	{
+	case AVColorSpace::AVCOL_SPC_BT709:			return core::color_space::bt709;
+	case AVColorSpace::AVCOL_SPC_BT470BG:		return core::color_space::bt601;
+	case AVColorSpace::AVCOL_SPC_SMPTE170M:		return core::color_space::bt601;
+	case AVColorSpace::AVCOL_SPC_BT2020_NCL:	return core::color_space::bt2020;
+	case AVColorSpace::AVCOL_SPC_BT2020_CL:		return core::color_space::bt2020;
+	default:									break;
+	}
+
+	// Some encoders only tag the primaries.
+	switch(frame.color_primaries)
+	{
+	case AVColorPrimaries::AVCOL_PRI_BT709:		return core::color_space::bt709;
+	case AVColorPrimaries::AVCOL_PRI_BT470BG:	return core::color_space::bt601;
+	case AVColorPrimaries::AVCOL_PRI_SMPTE170M:	return core::color_space::bt601;
+	case AVColorPrimaries::AVCOL_PRI_BT2020:	return core::color_space::bt2020;
+	default:									return core::color_space::unspecified;
+	}
+}
+
+core::color_transfer get_color_transfer(const AVFrame& frame)
+{
+	switch(frame.color_trc)
+	{
+	case AVColorTransferCharacteristic::AVCOL_TRC_SMPTE2084:		return core::color_transfer::pq;
+	case AVColorTransferCharacteristic::AVCOL_TRC_ARIB_STD_B67:	return core::color_transfer::hlg;
+	case AVColorTransferCharacteristic::AVCOL_TRC_UNSPECIFIED:		return core::color_transfer::unspecified;
+	default:														return core::color_transfer::sdr;
+	}
+}
+
+void set_sws_color_space(SwsContext* sws_context, core::color_space space, int height)
+{
+	int* inv_table;
+	int* table;
+	int src_range, dst_range, brightness, contrast, saturation;
+
+	if(sws_getColorspaceDetails(sws_context, &inv_table, &src_range, &table, &dst_range, &brightness, &contrast, &saturation) < 0)
+		return; // Ycbcr output, the matrix is not used.
+
+	int coefficients;
+
+	switch(core::resolve_color_space(space, height))
+	{
+	case core::color_space::bt2020:	coefficients = SWS_CS_BT2020; break;
+	case core::color_space::bt709:	coefficients = SWS_CS_ITU709; break;
+	default:						coefficients = SWS_CS_ITU601; break;
+	}
+
+	sws_setColorspaceDetails(sws_context, sws_getCoefficients(coefficients), src_range, table, dst_range, brightness, contrast, saturation);
+}
+
 core::pixel_format get_pixel_format(AVPixelFormat pix_fmt)
 {
 	switch(pix_fmt)
@@ -86,6 +142,7 @@ core::pixel_format get_pixel_format(AVPixelFormat pix_fmt)
 	case AVPixelFormat::AV_PIX_FMT_ARGB:		return core::pixel_format::argb;
 	case AVPixelFormat::AV_PIX_FMT_RGBA:		return core::pixel_format::rgba;
 	case AVPixelFormat::AV_PIX_FMT_ABGR:		return core::pixel_format::abgr;
+	case AVPixelFormat::AV_PIX_FMT_BGRA64LE:	return core::pixel_format::bgra16;
 	case AVPixelFormat::AV_PIX_FMT_YUV444P:		return core::pixel_format::ycbcr;
 	case AVPixelFormat::AV_PIX_FMT_YUV422P:		return core::pixel_format::ycbcr;
 	case AVPixelFormat::AV_PIX_FMT_YUV420P:		return core::pixel_format::ycbcr;
@@ -126,6 +183,11 @@ core::pixel_format_desc pixel_format_desc(AVPixelFormat pix_fmt, int width, int
 			desc.planes.push_back(core::pixel_format_desc::plane(dummy_pict.linesize[0]/4, height, 4));
 			return desc;
 		}
+	case core::pixel_format::bgra16:
+		{
+			desc.planes.push_back(core::pixel_format_desc::plane(dummy_pict.linesize[0]/8, height, 8));
+			return desc;
+		}
 	case core::pixel_format::ycbcr:
 	case core::pixel_format::ycbcra:
 		{
@@ -157,6 +219,10 @@ core::mutable_frame make_frame(const void* tag, const spl::shared_ptr<AVFrame>&
 	const auto width  = decoded_frame->width;
 	const auto height = decoded_frame->height;
 	auto desc		  = pixel_format_desc(static_cast<AVPixelFormat>(decoded_frame->format), width, height);
+	auto color_space  = get_color_space(*decoded_frame);
+
+	desc.color_space	= color_space;
+	desc.color_transfer	= get_color_transfer(*decoded_frame);
 
 	if(desc.format == core::pixel_format::invalid)
 	{
@@ -176,15 +242,32 @@ core::mutable_frame make_frame(const void* tag, const spl::shared_ptr<AVFrame>&
 		else if(pix_fmt == AVPixelFormat::AV_PIX_FMT_YUV444P10)
 			target_pix_fmt = AVPixelFormat::AV_PIX_FMT_YUV444P;
 
+		// Keep the precision of deep sources when the mixer can make use of it.
+		auto av_desc = av_pix_fmt_desc_get(pix_fmt);
+		bool high_bit_depth = frame_factory.get_mixing_bit_depth() > 8 && av_desc && av_desc->comp[0].depth > 8;
+
+		if(high_bit_depth)
+			target_pix_fmt = AVPixelFormat::AV_PIX_FMT_BGRA64LE;
+
 		auto target_desc = pixel_format_desc(target_pix_fmt, width, height);
 
+		target_desc.color_space		= color_space;
+		target_desc.color_transfer	= desc.color_transfer;
+
 		auto write = frame_factory.create_frame(tag, target_desc, channel_layout);
 
 		std::shared_ptr<SwsContext> sws_context;
 
 		//CASPAR_LOG(warning) << "Hardware accelerated color transform not supported.";
 
-		int64_t key = ((static_cast<int64_t>(width)			 << 32) & 0xFFFF00000000) |
+		// The matrix only follows the colour space of the frame when the
+		// channel has a working colour space, otherwise the sws default
+		// BT.601 is kept.
+		bool set_matrix = frame_factory.get_working_color_space() != core::color_space::unspecified;
+
+		int64_t key = ((static_cast<int64_t>(set_matrix)	 << 56) & 0xFF00000000000000) |
+					  ((static_cast<int64_t>(color_space)	 << 48) & 0xFF000000000000) |
+					  ((static_cast<int64_t>(width)			 << 32) & 0xFFFF00000000) |
 					  ((static_cast<int64_t>(height)		 << 16) & 0xFFFF0000) |
 					  ((static_cast<int64_t>(pix_fmt)		 <<  8) & 0xFF00) |
 					  ((static_cast<int64_t>(target_pix_fmt) <<  0) & 0xFF);
@@ -194,7 +277,11 @@ core::mutable_frame make_frame(const void* tag, const spl::shared_ptr<AVFrame>&
 		if(!pool.try_pop(sws_context))
 		{
 			double param;
-			sws_context.reset(sws_getContext(width, height, pix_fmt, width, height, target_pix_fmt, SWS_BILINEAR, nullptr, nullptr, &param), sws_freeContext);
+			auto flags = high_bit_depth ? SWS_BILINEAR | SWS_ACCURATE_RND | SWS_FULL_CHR_H_INT : SWS_BILINEAR;
+			sws_context.reset(sws_getContext(width, height, pix_fmt, width, height, target_pix_fmt, flags, nullptr, nullptr, &param), sws_freeContext);
+
+			if(sws_context && set_matrix)
+				set_sws_color_space(sws_context.get(), color_space, height);
 		}
 
 		if(!sws_context)
@@ -300,6 +387,9 @@ spl::shared_ptr<AVFrame> make_av_frame(std::array<uint8_t*, 4> data, const core:
 	case core::pixel_format::bgra:
 		av_frame->format = AVPixelFormat::AV_PIX_FMT_BGRA;
 		break;
+	case core::pixel_format::bgra16:
+		av_frame->format = AVPixelFormat::AV_PIX_FMT_BGRA64LE;
+		break;
 	case core::pixel_format::abgr:
 		av_frame->format = AVPixelFormat::AV_PIX_FMT_ABGR;
 		break;
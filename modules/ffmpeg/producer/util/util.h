@@ -53,6 +53,7 @@ struct AVFormatContext;
 struct AVPacket;
 struct AVRational;
 struct AVCodecContext;
+struct SwsContext;
 
 namespace caspar { namespace ffmpeg {
 
@@ -61,6 +62,9 @@ typedef std::vector<std::pair<std::string, std::string>> ffmpeg_options;
 // Utils
 
 core::field_mode					get_mode(const AVFrame& frame);
+core::color_space					get_color_space(const AVFrame& frame);
+core::color_transfer				get_color_transfer(const AVFrame& frame);
+void								set_sws_color_space(SwsContext* sws_context, core::color_space space, int height);
 core::mutable_frame					make_frame(const void* tag, const spl::shared_ptr<AVFrame>& decoded_frame, core::frame_factory& frame_factory, const core::audio_channel_layout& channel_layout);
 spl::shared_ptr<AVFrame>			make_av_frame(core::mutable_frame& frame);
 spl::shared_ptr<AVFrame>			make_av_frame(std::array<uint8_t*, 4> data, const core::pixel_format_desc& pix_desc);
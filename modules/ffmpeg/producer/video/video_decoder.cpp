@@ -64,11 +64,13 @@ struct video_decoder::implementation : boost::noncopyable
 	bool									is_progressive_		= true;
 
 	tbb::atomic<uint32_t>					file_frame_number_;
+	const AVRational						time_base_;
 
 public:
 	explicit implementation(const spl::shared_ptr<AVFormatContext>& context)
 		: codec_context_(open_codec(*context, AVMEDIA_TYPE_VIDEO, index_, false))
 		, nb_frames_(static_cast<uint32_t>(context->streams[index_]->nb_frames))
+		, time_base_(context->streams[index_]->time_base)
 	{
 		file_frame_number_ = 0;
 
@@ -153,6 +155,13 @@ public:
 		return packets_.empty();
 	}
 
+	int64_t frame_time(const AVFrame& frame) const
+	{
+		auto time = av_frame_get_best_effort_timestamp(&frame);
+
+		return time != AV_NOPTS_VALUE ? av_rescale_q(time, time_base_, AV_TIME_BASE_Q) : AV_NOPTS_VALUE;
+	}
+
 	uint32_t nb_frames() const
 	{
 		return std::max(nb_frames_, static_cast<uint32_t>(file_frame_number_));
@@ -178,6 +187,7 @@ int video_decoder::width() const{return impl_->width_;}
 int video_decoder::height() const{return impl_->height_;}
 uint32_t video_decoder::nb_frames() const{return impl_->nb_frames();}
 uint32_t video_decoder::file_frame_number() const{return static_cast<uint32_t>(impl_->file_frame_number_);}
+int64_t video_decoder::frame_time(const AVFrame& frame) const { return impl_->frame_time(frame); }
 bool	video_decoder::is_progressive() const{return impl_->is_progressive_;}
 std::wstring video_decoder::print() const{return impl_->print();}
 std::wstring video_decoder::print_codec() const { return impl_->print_codec(); }
@@ -53,6 +53,9 @@ public:
 
 	uint32_t					nb_frames() const;
 	uint32_t					file_frame_number() const;
+	// The presentation timestamp of a decoded frame in AV_TIME_BASE units,
+	// AV_NOPTS_VALUE if unknown.
+	int64_t						frame_time(const AVFrame& frame) const;
 	bool						is_progressive() const;
 
 	std::wstring				print() const;
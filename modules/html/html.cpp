@@ -351,6 +351,7 @@ void init(core::module_dependencies dependencies)
 	{
 		CefRunMessageLoop();
 	});
+	warm_browser_pools();
 	dependencies.cg_registry->register_cg_producer(
 			L"html",
 			{ L".html" },
@@ -389,6 +390,7 @@ void init(core::module_dependencies dependencies)
 
 void uninit()
 {
+	close_browser_pools();
 	invoke([]
 	{
 		CefQuitMessageLoop();
@@ -48,6 +48,8 @@
 
 #include <boost/algorithm/string/predicate.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/range/algorithm/count.hpp>
+#include <boost/range/algorithm_ext/erase.hpp>
 #include <boost/log/trivial.hpp>
 #include <boost/property_tree/ptree.hpp>
 
@@ -62,6 +64,8 @@
 #include <cef_render_handler.h>
 #pragma warning(pop)
 
+#include <algorithm>
+#include <map>
 #include <queue>
 
 #include "../html.h"
@@ -90,7 +94,7 @@ class html_client
 	caspar::timer							frame_timer_;
 	caspar::timer							paint_timer_;
 
-	spl::shared_ptr<core::frame_factory>	frame_factory_;
+	std::shared_ptr<core::frame_factory>	frame_factory_;
 	core::video_format_desc					format_desc_;
     bool                                 	shared_texture_enable_;
 	tbb::concurrent_queue<std::wstring>		javascript_before_load_;
@@ -115,7 +119,7 @@ class html_client
 public:
 
 	html_client(
-			spl::shared_ptr<core::frame_factory> frame_factory,
+			std::shared_ptr<core::frame_factory> frame_factory,
 			const core::video_format_desc& format_desc,
             bool shared_texture_enable,
 			const std::wstring& url)
@@ -201,6 +205,11 @@ public:
 			{
 				browser_->GetHost()->CloseBrowser(true);
 			}
+			else
+			{
+				// Closed by OnAfterCreated once the browser exists.
+				removed_ = true;
+			}
 		});
 	}
 
@@ -215,6 +224,73 @@ public:
 		return removed_;
 	}
 
+	// An idle browser has finished loading and can be handed to a producer.
+	bool is_idle() const
+	{
+		CASPAR_ASSERT(CefCurrentlyOn(TID_UI));
+
+		return browser_ != nullptr && loaded_ && !removed_;
+	}
+
+	bool has_browser() const
+	{
+		CASPAR_ASSERT(CefCurrentlyOn(TID_UI));
+
+		return browser_ != nullptr;
+	}
+
+	const core::video_format_desc& format_desc() const
+	{
+		return format_desc_;
+	}
+
+	const std::wstring& url() const
+	{
+		return url_;
+	}
+
+	void attach(std::shared_ptr<core::frame_factory> frame_factory, const std::wstring& url)
+	{
+		CASPAR_ASSERT(CefCurrentlyOn(TID_UI));
+
+		frame_factory_ = std::move(frame_factory);
+
+		// Nothing was painted while detached, so a page that is already
+		// loaded has to be asked for a fresh frame.
+		if (url != url_)
+			navigate(url);
+		else if (browser_ != nullptr)
+			browser_->GetHost()->Invalidate(PET_VIEW);
+
+		graph_->set_text(print());
+	}
+
+	void detach(const std::wstring& url)
+	{
+		CASPAR_ASSERT(CefCurrentlyOn(TID_UI));
+
+		frame_factory_.reset();
+
+		executor_.invoke([&]
+		{
+			{
+				std::lock_guard<std::mutex> lock(frames_mutex_);
+				frames_ = std::queue<core::draw_frame>();
+			}
+
+			std::lock_guard<std::mutex> lock(last_frame_mutex_);
+			last_frame_ = core::draw_frame::empty();
+			last_progressive_frame_ = core::draw_frame::empty();
+		});
+
+		std::wstring javascript;
+		while (javascript_before_load_.try_pop(javascript))
+			;
+
+		navigate(url);
+		graph_->set_text(print());
+	}
+
 private:
 
 	void GetViewRect(CefRefPtr<CefBrowser> browser, CefRect& rect)
@@ -232,7 +308,7 @@ private:
 			int width,
 			int height)
 	{
-        if (shared_texture_enable_)
+        if (shared_texture_enable_ || !frame_factory_)
             return;
 
 		graph_->set_value("browser-tick-time", paint_timer_.elapsed()
@@ -273,7 +349,7 @@ private:
                             void*                 shared_handle) override
     {
         try {
-            if (!shared_texture_enable_)
+            if (!shared_texture_enable_ || !frame_factory_)
                 return;
 
 			graph_->set_value("browser-tick-time", paint_timer_.elapsed()
@@ -330,6 +406,9 @@ private:
 		CASPAR_ASSERT(CefCurrentlyOn(TID_UI));
 
 		browser_ = browser;
+
+		if (removed_)
+			browser_->GetHost()->CloseBrowser(true);
 	}
 
 	void OnBeforeClose(CefRefPtr<CefBrowser> browser) override
@@ -495,6 +574,15 @@ private:
 		}
 	}
 
+	void navigate(const std::wstring& url)
+	{
+		url_ = url;
+		loaded_ = false;
+
+		if (browser_ != nullptr)
+			browser_->GetMainFrame()->LoadURL(url);
+	}
+
 	void do_execute_javascript(const std::wstring& javascript)
 	{
 		html::begin_invoke([=]
@@ -520,12 +608,234 @@ private:
 	IMPLEMENT_REFCOUNTING(html_client);
 };
 
+CefRefPtr<html_client> create_client(
+		std::shared_ptr<core::frame_factory> frame_factory,
+		const core::video_format_desc& format_desc,
+		const std::wstring& url)
+{
+	CASPAR_ASSERT(CefCurrentlyOn(TID_UI));
+
+	const bool enable_gpu = env::properties().get(L"configuration.html.enable-gpu", false);
+	bool       shared_texture_enable = false;
+
+#ifdef WIN32
+	shared_texture_enable = enable_gpu && accelerator::d3d::d3d_device::get_device();
+#endif
+
+	CefRefPtr<html_client> client = new html_client(std::move(frame_factory), format_desc, shared_texture_enable, url);
+
+	CefWindowInfo window_info;
+	window_info.width = format_desc.square_width;
+	window_info.height = format_desc.square_height;
+	window_info.windowless_rendering_enabled = true;
+	window_info.shared_texture_enabled = shared_texture_enable;
+
+	CefBrowserSettings browser_settings;
+	browser_settings.web_security = cef_state_t::STATE_DISABLED;
+	browser_settings.webgl = enable_gpu ? cef_state_t::STATE_ENABLED : cef_state_t::STATE_DISABLED;
+	double fps = format_desc.fps;
+	if (format_desc.field_mode != core::field_mode::progressive) {
+		fps *= 2.0;
+	}
+	browser_settings.windowless_frame_rate = int(ceil(fps));
+	CefBrowserHost::CreateBrowser(window_info, client.get(), url, browser_settings, nullptr);
+
+	return client;
+}
+
+std::wstring find_template_url(const std::wstring& name)
+{
+	const auto found_filename	= find_case_insensitive(env::template_folder() + name + L".html");
+	const auto http_prefix		= boost::algorithm::istarts_with(name, L"http:") || boost::algorithm::istarts_with(name, L"https:");
+
+	if (found_filename)
+		return L"file://" + *found_filename;
+	else if (http_prefix)
+		return name;
+	else
+		return L"";
+}
+
+// Keeps idle offscreen browsers per video mode so that a producer does not
+// have to wait for a renderer process and a page load before its first frame.
+// Blank browsers sit on about:blank and are navigated when claimed, preloaded
+// templates are handed over as they are. Only used on the CEF UI thread.
+class browser_pool
+{
+	struct pool
+	{
+		std::vector<CefRefPtr<html_client>>					blank;
+		std::map<std::wstring, CefRefPtr<html_client>>		preloaded;
+		bool												warmed		= false;
+	};
+
+	const std::size_t							size_;
+	std::vector<std::wstring>					preload_urls_;
+	std::map<std::wstring, pool>				pools_;
+
+	browser_pool()
+		: size_(env::properties().get(L"configuration.html.browser-pool.size", 0u))
+	{
+		auto preload_element = env::properties().get_child_optional(L"configuration.html.browser-pool.preload");
+
+		if (preload_element)
+		{
+			for (auto& xml_template : *preload_element)
+			{
+				auto url = find_template_url(xml_template.second.get_value<std::wstring>());
+
+				if (url.empty())
+					CASPAR_LOG(warning) << L"[html] Template " << xml_template.second.get_value<std::wstring>() << L" not found, not preloading it.";
+				else
+					preload_urls_.push_back(url);
+			}
+		}
+	}
+public:
+	static browser_pool& instance()
+	{
+		CASPAR_ASSERT(CefCurrentlyOn(TID_UI));
+
+		static browser_pool pool;
+
+		return pool;
+	}
+
+	bool enabled() const
+	{
+		return size_ > 0 || !preload_urls_.empty();
+	}
+
+	void warm(const core::video_format_desc& format_desc)
+	{
+		if (enabled())
+			fill(get_pool(format_desc), format_desc);
+	}
+
+	CefRefPtr<html_client> claim(
+			std::shared_ptr<core::frame_factory> frame_factory,
+			const core::video_format_desc& format_desc,
+			const std::wstring& url)
+	{
+		if (!enabled())
+			return nullptr;
+
+		auto& pool = get_pool(format_desc);
+		CefRefPtr<html_client> client;
+		auto preloaded = pool.preloaded.find(url);
+
+		if (preloaded != pool.preloaded.end() && preloaded->second->is_idle())
+		{
+			client = preloaded->second;
+			pool.preloaded.erase(preloaded);
+		}
+		else
+		{
+			auto blank = std::find_if(pool.blank.begin(), pool.blank.end(), [](const CefRefPtr<html_client>& c) { return c->is_idle(); });
+
+			if (blank != pool.blank.end())
+			{
+				client = *blank;
+				pool.blank.erase(blank);
+			}
+		}
+
+		// Preloaded templates are replaced right away, blank browsers come
+		// back when producers release theirs.
+		fill(pool, format_desc);
+
+		if (client)
+			client->attach(std::move(frame_factory), url);
+
+		return client;
+	}
+
+	void release(const CefRefPtr<html_client>& client)
+	{
+		if (client->is_removed())
+			return;
+
+		if (!enabled() || !client->has_browser())
+		{
+			client->close();
+			return;
+		}
+
+		auto& pool = get_pool(client->format_desc());
+		auto url = client->url();
+
+		if (boost::range::count(preload_urls_, url) > 0 && pool.preloaded.find(url) == pool.preloaded.end())
+		{
+			client->detach(url);
+			pool.preloaded[url] = client;
+		}
+		else if (pool.blank.size() < size_)
+		{
+			client->detach(L"about:blank");
+			pool.blank.push_back(client);
+		}
+		else
+			client->close();
+	}
+
+	void clear()
+	{
+		for (auto& pool : pools_)
+		{
+			for (auto& client : pool.second.blank)
+				client->close();
+
+			for (auto& client : pool.second.preloaded)
+				client.second->close();
+		}
+
+		pools_.clear();
+	}
+private:
+	pool& get_pool(const core::video_format_desc& format_desc)
+	{
+		auto& pool = pools_[format_desc.name];
+
+		boost::range::remove_erase_if(pool.blank, [](const CefRefPtr<html_client>& c) { return c->is_removed(); });
+
+		for (auto it = pool.preloaded.begin(); it != pool.preloaded.end();)
+		{
+			if (it->second->is_removed())
+				it = pool.preloaded.erase(it);
+			else
+				++it;
+		}
+
+		return pool;
+	}
+
+	void fill(pool& pool, const core::video_format_desc& format_desc)
+	{
+		if (!pool.warmed)
+		{
+			while (pool.blank.size() < size_)
+				pool.blank.push_back(create_client(nullptr, format_desc, L"about:blank"));
+
+			pool.warmed = true;
+		}
+
+		for (auto& url : preload_urls_)
+		{
+			if (pool.preloaded.find(url) == pool.preloaded.end())
+				pool.preloaded[url] = create_client(nullptr, format_desc, url);
+		}
+	}
+};
+
 class html_producer
 	: public core::frame_producer_base
 {
 	core::monitor::subject	monitor_subject_;
 	const std::wstring		url_;
 	core::constraints		constraints_;
+	caspar::timer			first_frame_timer_;
+	bool					first_frame_received_	= false;
+	bool					pooled_					= false;
 
 	CefRefPtr<html_client>	client_;
 
@@ -541,37 +851,23 @@ public:
 
 		html::invoke([&]
 		{
-			const bool enable_gpu = env::properties().get(L"configuration.html.enable-gpu", false);
-            bool       shared_texture_enable = false;
-			
-#ifdef WIN32
-            shared_texture_enable = enable_gpu && accelerator::d3d::d3d_device::get_device();
-#endif
-
-			client_ = new html_client(frame_factory, format_desc, shared_texture_enable, url_);
-
-			CefWindowInfo window_info;
-			window_info.width = format_desc.square_width;
-			window_info.height = format_desc.square_height;
-			window_info.windowless_rendering_enabled = true;
-            window_info.shared_texture_enabled = shared_texture_enable;
+			client_ = browser_pool::instance().claim(frame_factory, format_desc, url_);
+			pooled_ = client_ != nullptr;
 
-			CefBrowserSettings browser_settings;
-			browser_settings.web_security = cef_state_t::STATE_DISABLED;
-			browser_settings.webgl = enable_gpu ? cef_state_t::STATE_ENABLED : cef_state_t::STATE_DISABLED;
-			double fps = format_desc.fps;
-			if (format_desc.field_mode != core::field_mode::progressive) {
-				fps *= 2.0;
-			}
-			browser_settings.windowless_frame_rate = int(ceil(fps));
-			CefBrowserHost::CreateBrowser(window_info, client_.get(), url, browser_settings, nullptr);
+			if (!client_)
+				client_ = create_client(frame_factory, format_desc, url_);
 		});
 	}
 
 	~html_producer()
 	{
 		if (client_)
-			client_->close();
+		{
+			html::invoke([&]
+			{
+				browser_pool::instance().release(client_);
+			});
+		}
 	}
 
 	// frame_producer
@@ -648,7 +944,15 @@ public:
 				return core::draw_frame::empty();
 			}
 
-			return client_->receive();
+			auto frame = client_->receive();
+
+			if (!first_frame_received_ && !(frame == core::draw_frame::empty()))
+			{
+				first_frame_received_ = true;
+				CASPAR_LOG(debug) << print() << L" First frame after " << static_cast<int>(first_frame_timer_.elapsed() * 1000.0) << L" ms" << (pooled_ ? L" (pooled browser)." : L".");
+			}
+
+			return frame;
 		}
 
 		return core::draw_frame::empty();
@@ -699,6 +1003,9 @@ void describe_producer(core::help_sink& sink, const core::help_repository& repo)
 		->text(L" folder or fetched directly via an URL. If a .html file is found with the name ")
 		->code(L"html_filename")->text(L" under the ")->code(L"templates")->text(L" folder it will be rendered. If the ")
 		->code(L"[HTML] url")->text(L" syntax is used instead, the URL will be loaded.");
+	sink.para()
+		->text(L"If ")->code(L"html/browser-pool")->text(L" is configured the producer takes an already started browser, ")
+		->text(L"or a browser with the template already loaded, instead of starting a new one.");
 	sink.para()->text(L"Examples:");
 	sink.example(L">> PLAY 1-10 [HTML] http://www.casparcg.com");
 	sink.example(L">> PLAY 1-10 folder/html_file");
@@ -708,17 +1015,11 @@ spl::shared_ptr<core::frame_producer> create_cg_producer(
 	const core::frame_producer_dependencies& dependencies,
 	const std::vector<std::wstring>& params)
 {
-	const auto filename = env::template_folder() + params.at(0) + L".html";
-	const auto found_filename = find_case_insensitive(filename);
-	const auto http_prefix = boost::algorithm::istarts_with(params.at(0), L"http:") || boost::algorithm::istarts_with(params.at(0), L"https:");
+	const auto url = find_template_url(params.at(0));
 
-	if (!found_filename && !http_prefix)
+	if (url.empty())
 		return core::frame_producer::empty();
 
-	const auto url = found_filename
-		? L"file://" + *found_filename
-		: params.at(0);
-
 	return core::create_destroy_proxy(spl::make_shared<html_producer>(
 		dependencies.frame_factory,
 		dependencies.format_desc,
@@ -749,4 +1050,38 @@ spl::shared_ptr<core::frame_producer> create_producer(
 			url));
 }
 
+void warm_browser_pools()
+{
+	auto channels = env::properties().get_child_optional(L"configuration.channels");
+
+	if (!channels)
+		return;
+
+	core::video_format_repository format_repository;
+	std::vector<core::video_format_desc> formats;
+
+	for (auto& xml_channel : *channels)
+	{
+		auto format_desc = format_repository.find(xml_channel.second.get(L"video-mode", L"PAL"));
+
+		// Custom video modes are not known yet, those are warmed on first use.
+		if (format_desc.format != core::video_format::invalid)
+			formats.push_back(format_desc);
+	}
+
+	html::begin_invoke([=]
+	{
+		for (auto& format_desc : formats)
+			browser_pool::instance().warm(format_desc);
+	});
+}
+
+void close_browser_pools()
+{
+	html::invoke([]
+	{
+		browser_pool::instance().clear();
+	});
+}
+
 }}
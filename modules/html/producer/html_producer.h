@@ -37,5 +37,7 @@ spl::shared_ptr<core::frame_producer> create_producer(
 spl::shared_ptr<core::frame_producer> create_cg_producer(
 	const core::frame_producer_dependencies& dependencies,
 	const std::vector<std::wstring>& params);
+void warm_browser_pools();
+void close_browser_pools();
 
 }}
\ No newline at end of file
@@ -0,0 +1,501 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "preview_consumer.h"
+
+#include "../util/image_downscale.h"
+
+#include <common/diagnostics/graph.h>
+#include <common/except.h>
+#include <common/executor.h>
+#include <common/future.h>
+#include <common/log.h>
+#include <common/os/general_protection_fault.h>
+#include <common/param.h>
+#include <common/timer.h>
+#include <common/utf.h>
+
+#include <core/consumer/frame_consumer.h>
+#include <core/frame/frame.h>
+#include <core/help/help_repository.h>
+#include <core/help/help_sink.h>
+#include <core/monitor/monitor.h>
+#include <core/video_format.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/asio.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/thread.hpp>
+
+#include <tbb/atomic.h>
+
+#include <FreeImage.h>
+
+#include <algorithm>
+#include <istream>
+#include <memory>
+#include <vector>
+
+namespace caspar { namespace image {
+
+using boost::asio::ip::tcp;
+
+const char* const MJPEG_BOUNDARY = "casparcg";
+
+struct preview_client
+{
+    tcp::socket                 socket;
+    boost::asio::streambuf      request;
+    boost::asio::deadline_timer timeout;
+    bool                        writing = false;
+
+    explicit preview_client(boost::asio::io_service& service)
+        : socket(service)
+        , request(8192)
+        , timeout(service)
+    {
+    }
+};
+
+class preview_consumer : public core::frame_consumer
+{
+    core::monitor::subject              monitor_subject_;
+    spl::shared_ptr<diagnostics::graph> graph_;
+    const std::wstring                  address_;
+    const int                           port_;
+    const int                           width_;
+    const double                        fps_;
+    const int                           quality_;
+
+    core::video_format_desc format_desc_;
+    int                     channel_index_ = -1;
+    caspar::timer           since_last_encode_;
+    tbb::atomic<int>        subscribers_;
+    tbb::atomic<bool>       encoding_;
+
+    boost::asio::io_service                      service_;
+    tcp::acceptor                                acceptor_;
+    std::vector<std::shared_ptr<preview_client>> snapshot_clients_;
+    std::vector<std::shared_ptr<preview_client>> stream_clients_;
+    std::shared_ptr<const std::string>           latest_;
+    caspar::timer                                latest_age_;
+    boost::thread                                thread_;
+
+    executor encoder_{L"preview_consumer"};
+
+  public:
+    preview_consumer(const std::wstring& address, int port, int width, double fps, int quality)
+        : address_(address)
+        , port_(port)
+        , width_(std::max(16, width))
+        , fps_(std::max(0.1, fps))
+        , quality_(std::max(1, std::min(100, quality)))
+        , acceptor_(service_)
+    {
+        subscribers_ = 0;
+        encoding_    = false;
+
+        try {
+            tcp::endpoint endpoint(boost::asio::ip::address::from_string(u8(address_)), static_cast<unsigned short>(port_));
+
+            acceptor_.open(endpoint.protocol());
+            acceptor_.set_option(tcp::acceptor::reuse_address(true));
+            acceptor_.bind(endpoint);
+            acceptor_.listen();
+        } catch (const boost::system::system_error& e) {
+            CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Could not listen on " + address_ + L":" +
+                                                            boost::lexical_cast<std::wstring>(port_) + L": " +
+                                                            u16(e.what())));
+        }
+
+        graph_->set_color("encode-time", diagnostics::color(0.0f, 0.6f, 0.9f));
+        graph_->set_color("skipped-frame", diagnostics::color(0.3f, 0.6f, 0.3f));
+        diagnostics::register_graph(graph_);
+
+        encoder_.set_priority(thread_priority::LOW);
+
+        accept();
+
+        thread_ = boost::thread([this] {
+            ensure_gpf_handler_installed_for_thread("preview-consumer");
+            service_.run();
+        });
+    }
+
+    ~preview_consumer()
+    {
+        encoder_.stop();
+        encoder_.join();
+        service_.stop();
+        thread_.join();
+    }
+
+    // frame_consumer
+
+    void initialize(const core::video_format_desc& format_desc, const core::audio_channel_layout&, int channel_index) override
+    {
+        format_desc_   = format_desc;
+        channel_index_ = channel_index;
+
+        graph_->set_text(print());
+    }
+
+    int64_t presentation_frame_age_millis() const override { return 0; }
+
+    std::future<bool> send(core::frame_timecode timecode, core::const_frame frame) override
+    {
+        // Nobody is watching, so the channel pays nothing for this consumer.
+        if (subscribers_ == 0 || since_last_encode_.elapsed() < 1.0 / fps_)
+            return make_ready_future(true);
+
+        if (encoding_.compare_and_swap(true, false)) {
+            graph_->set_tag(diagnostics::tag_severity::WARNING, "skipped-frame");
+            return make_ready_future(true);
+        }
+
+        since_last_encode_.restart();
+
+        auto width  = std::min(width_, static_cast<int>(frame.width()));
+        auto height = static_cast<int>(width * format_desc_.square_height / std::max(1, format_desc_.square_width));
+        height      = std::max(2, std::min(height, static_cast<int>(frame.height())) & ~1);
+
+        encoder_.begin_invoke([=] {
+            try {
+                caspar::timer encode_timer;
+
+                auto jpeg = encode(frame, width, height);
+
+                graph_->set_value("encode-time", encode_timer.elapsed() * fps_ * 0.5);
+
+                if (jpeg)
+                    service_.post([=] { publish(jpeg); });
+            } catch (...) {
+                CASPAR_LOG_CURRENT_EXCEPTION();
+            }
+
+            encoding_ = false;
+        });
+
+        return make_ready_future(true);
+    }
+
+    std::wstring print() const override
+    {
+        return L"preview[" + boost::lexical_cast<std::wstring>(channel_index_) + L"|" + address_ + L":" +
+               boost::lexical_cast<std::wstring>(port_) + L"]";
+    }
+
+    std::wstring name() const override { return L"preview"; }
+
+    boost::property_tree::wptree info() const override
+    {
+        boost::property_tree::wptree info;
+        info.add(L"type", L"preview");
+        info.add(L"address", address_);
+        info.add(L"port", port_);
+        info.add(L"width", width_);
+        info.add(L"fps", fps_);
+        info.add(L"quality", quality_);
+        info.add(L"subscribers", static_cast<int>(subscribers_));
+        return info;
+    }
+
+    bool has_synchronization_clock() const override { return false; }
+
+    int buffer_depth() const override { return -1; }
+
+    int index() const override { return 300000 + port_; }
+
+    core::monitor::subject& monitor_output() override { return monitor_subject_; }
+
+  private:
+    std::shared_ptr<const std::string> encode(const core::const_frame& frame, int width, int height)
+    {
+        auto image = frame.image_data();
+
+        if (image.size() != frame.width() * frame.height() * 4)
+            return nullptr;
+
+        auto bitmap = std::shared_ptr<FIBITMAP>(FreeImage_Allocate(width, height, 32), FreeImage_Unload);
+
+        // The frame is premultiplied, so dropping alpha composites it over black, which is what a
+        // monitoring preview should show.
+        downscale_area(image.begin(),
+                       static_cast<int>(frame.width()),
+                       static_cast<int>(frame.height()),
+                       FreeImage_GetBits(bitmap.get()),
+                       width,
+                       height);
+        FreeImage_FlipVertical(bitmap.get());
+
+        auto rgb    = std::shared_ptr<FIBITMAP>(FreeImage_ConvertTo24Bits(bitmap.get()), FreeImage_Unload);
+        auto memory = std::shared_ptr<FIMEMORY>(FreeImage_OpenMemory(), FreeImage_CloseMemory);
+
+        if (!FreeImage_SaveToMemory(FIF_JPEG, rgb.get(), memory.get(), quality_ | JPEG_BASELINE))
+            CASPAR_THROW_EXCEPTION(caspar_exception() << msg_info(L"Could not encode preview JPEG."));
+
+        BYTE* data = nullptr;
+        DWORD size = 0;
+        FreeImage_AcquireMemory(memory.get(), &data, &size);
+
+        return std::make_shared<const std::string>(reinterpret_cast<const char*>(data), size);
+    }
+
+    void publish(const std::shared_ptr<const std::string>& jpeg)
+    {
+        latest_ = jpeg;
+        latest_age_.restart();
+
+        for (auto& client : snapshot_clients_) {
+            boost::system::error_code ignored;
+            client->timeout.cancel(ignored);
+            --subscribers_;
+            write_snapshot(client, jpeg);
+        }
+
+        snapshot_clients_.clear();
+
+        for (auto& client : stream_clients_) {
+            // A client still busy with the previous part simply misses this one.
+            if (!client->writing)
+                write_part(client, jpeg);
+        }
+    }
+
+    void accept()
+    {
+        auto client = std::make_shared<preview_client>(service_);
+
+        acceptor_.async_accept(client->socket, [this, client](const boost::system::error_code& error) {
+            if (error == boost::asio::error::operation_aborted)
+                return;
+
+            if (!error)
+                read_request(client);
+
+            accept();
+        });
+    }
+
+    void read_request(const std::shared_ptr<preview_client>& client)
+    {
+        boost::asio::async_read_until(
+            client->socket, client->request, "\r\n\r\n", [this, client](const boost::system::error_code& error, std::size_t) {
+                if (error)
+                    return;
+
+                std::istream request(&client->request);
+                std::string  method;
+                std::string  path;
+                request >> method >> path;
+                path = path.substr(0, path.find('?'));
+
+                if (method != "GET")
+                    write_status(client, "405 Method Not Allowed");
+                else if (path == "/" || path == "/preview.jpg")
+                    start_snapshot(client);
+                else if (path == "/stream" || path == "/preview.mjpg")
+                    start_stream(client);
+                else
+                    write_status(client, "404 Not Found");
+            });
+    }
+
+    void start_snapshot(const std::shared_ptr<preview_client>& client)
+    {
+        // Encoding stops when nobody is subscribed, so only a recent image is good enough.
+        if (latest_ && latest_age_.elapsed() < 2.0 / fps_) {
+            write_snapshot(client, latest_);
+            return;
+        }
+
+        snapshot_clients_.push_back(client);
+        ++subscribers_;
+
+        client->timeout.expires_from_now(boost::posix_time::seconds(2));
+        client->timeout.async_wait([this, client](const boost::system::error_code& error) {
+            if (error)
+                return;
+
+            auto it = std::find(snapshot_clients_.begin(), snapshot_clients_.end(), client);
+
+            if (it == snapshot_clients_.end())
+                return;
+
+            snapshot_clients_.erase(it);
+            --subscribers_;
+            write_status(client, "503 Service Unavailable");
+        });
+    }
+
+    void start_stream(const std::shared_ptr<preview_client>& client)
+    {
+        auto header = std::make_shared<std::string>(std::string("HTTP/1.0 200 OK\r\n"
+                                                                "Content-Type: multipart/x-mixed-replace; boundary=") +
+                                                    MJPEG_BOUNDARY +
+                                                    "\r\n"
+                                                    "Cache-Control: no-cache\r\n"
+                                                    "Connection: close\r\n\r\n");
+
+        stream_clients_.push_back(client);
+        ++subscribers_;
+
+        write(client, header, nullptr, [this, client](const boost::system::error_code& error) {
+            if (error)
+                stop_stream(client);
+        });
+    }
+
+    void stop_stream(const std::shared_ptr<preview_client>& client)
+    {
+        auto it = std::find(stream_clients_.begin(), stream_clients_.end(), client);
+
+        if (it == stream_clients_.end())
+            return;
+
+        stream_clients_.erase(it);
+        --subscribers_;
+
+        boost::system::error_code ignored;
+        client->socket.close(ignored);
+    }
+
+    void write_part(const std::shared_ptr<preview_client>& client, const std::shared_ptr<const std::string>& jpeg)
+    {
+        auto header = std::make_shared<std::string>(std::string("--") + MJPEG_BOUNDARY +
+                                                     "\r\n"
+                                                     "Content-Type: image/jpeg\r\n"
+                                                     "Content-Length: " +
+                                                     boost::lexical_cast<std::string>(jpeg->size()) + "\r\n\r\n");
+
+        write(client, header, jpeg, [this, client](const boost::system::error_code& error) {
+            if (error)
+                stop_stream(client);
+        });
+    }
+
+    void write_snapshot(const std::shared_ptr<preview_client>& client, const std::shared_ptr<const std::string>& jpeg)
+    {
+        auto header = std::make_shared<std::string>("HTTP/1.0 200 OK\r\n"
+                                                    "Content-Type: image/jpeg\r\n"
+                                                    "Cache-Control: no-cache\r\n"
+                                                    "Connection: close\r\n"
+                                                    "Content-Length: " +
+                                                    boost::lexical_cast<std::string>(jpeg->size()) + "\r\n\r\n");
+
+        write(client, header, jpeg, [client](const boost::system::error_code&) {
+            boost::system::error_code ignored;
+            client->socket.shutdown(tcp::socket::shutdown_both, ignored);
+        });
+    }
+
+    void write_status(const std::shared_ptr<preview_client>& client, const std::string& status)
+    {
+        auto response = std::make_shared<std::string>("HTTP/1.0 " + status +
+                                                      "\r\n"
+                                                      "Content-Type: text/plain\r\n"
+                                                      "Connection: close\r\n\r\n" +
+                                                      status + "\r\n");
+
+        write(client, response, nullptr, [client](const boost::system::error_code&) {
+            boost::system::error_code ignored;
+            client->socket.shutdown(tcp::socket::shutdown_both, ignored);
+        });
+    }
+
+    void write(const std::shared_ptr<preview_client>&                 client,
+               const std::shared_ptr<std::string>&                    header,
+               const std::shared_ptr<const std::string>&              jpeg,
+               const std::function<void(boost::system::error_code)>& handler)
+    {
+        std::vector<boost::asio::const_buffer> buffers;
+        buffers.push_back(boost::asio::buffer(*header));
+
+        if (jpeg) {
+            buffers.push_back(boost::asio::buffer(*jpeg));
+            buffers.push_back(boost::asio::buffer("\r\n", 2));
+        }
+
+        client->writing = true;
+
+        boost::asio::async_write(
+            client->socket, buffers, [client, header, jpeg, handler](const boost::system::error_code& error, std::size_t) {
+                client->writing = false;
+                handler(error);
+            });
+    }
+};
+
+void describe_preview_consumer(core::help_sink& sink, const core::help_repository& repo)
+{
+    sink.short_description(L"Serves a low resolution JPEG preview of a video channel over HTTP.");
+    sink.syntax(L"PREVIEW {[port:int]|8090} {WIDTH [width:int]|480} {FPS [fps:float]|5} {QUALITY [quality:int]|75} "
+                L"{ADDRESS [address:string]|127.0.0.1}");
+    sink.para()
+        ->text(L"Listens for HTTP requests and serves the channel downscaled to ")
+        ->code(L"width")
+        ->text(L" pixels and JPEG encoded at most ")
+        ->code(L"fps")
+        ->text(L" times per second.");
+    sink.definitions()
+        ->item(L"/ or /preview.jpg", L"The latest image. Waits up to two seconds for a new one.")
+        ->item(L"/stream or /preview.mjpg", L"A continuous MJPEG stream for browsers and media players.");
+    sink.para()->text(L"No frames are encoded while nobody is requesting a preview. ")->text(
+        L"Layers can be previewed by routing them to a separate channel first.");
+    sink.para()->text(L"Examples:");
+    sink.example(L">> ADD 1 PREVIEW 8090", L"serves http://127.0.0.1:8090/preview.jpg and /preview.mjpg.");
+    sink.example(L">> ADD 1 PREVIEW 8091 WIDTH 320 FPS 2 ADDRESS 0.0.0.0",
+                 L"a smaller preview reachable from other machines.");
+}
+
+spl::shared_ptr<core::frame_consumer> create_preview_consumer(const std::vector<std::wstring>&                  params,
+                                                              core::interaction_sink*,
+                                                              std::vector<spl::shared_ptr<core::video_channel>> channels)
+{
+    if (params.size() < 1 || !boost::iequals(params.at(0), L"PREVIEW"))
+        return core::frame_consumer::empty();
+
+    auto port = 8090;
+
+    if (params.size() > 1 && std::all_of(params.at(1).begin(), params.at(1).end(), [](wchar_t c) { return c >= L'0' && c <= L'9'; }))
+        port = boost::lexical_cast<int>(params.at(1));
+
+    auto width   = get_param(L"WIDTH", params, 480);
+    auto fps     = get_param(L"FPS", params, 5.0);
+    auto quality = get_param(L"QUALITY", params, 75);
+    auto address = get_param(L"ADDRESS", params, L"127.0.0.1");
+
+    return spl::make_shared<preview_consumer>(address, port, width, fps, quality);
+}
+
+spl::shared_ptr<core::frame_consumer>
+create_preconfigured_preview_consumer(const boost::property_tree::wptree& ptree,
+                                      core::interaction_sink*,
+                                      std::vector<spl::shared_ptr<core::video_channel>> channels)
+{
+    return spl::make_shared<preview_consumer>(ptree.get(L"address", L"127.0.0.1"),
+                                              ptree.get(L"port", 8090),
+                                              ptree.get(L"width", 480),
+                                              ptree.get(L"fps", 5.0),
+                                              ptree.get(L"quality", 75));
+}
+
+}} // namespace caspar::image
@@ -24,6 +24,7 @@
 #include "producer/image_producer.h"
 #include "producer/image_scroll_producer.h"
 #include "consumer/image_consumer.h"
+#include "consumer/preview_consumer.h"
 #include "util/image_loader.h"
 
 #include <core/producer/frame_producer.h>
@@ -54,6 +55,8 @@ void init(core::module_dependencies dependencies)
 	dependencies.producer_registry->register_producer_factory(L"Image Producer", create_producer, describe_producer);
 	dependencies.producer_registry->register_thumbnail_producer(create_thumbnail);
 	dependencies.consumer_registry->register_consumer_factory(L"Image Consumer", create_consumer, describe_consumer);
+	dependencies.consumer_registry->register_consumer_factory(L"Preview Consumer", create_preview_consumer, describe_preview_consumer);
+	dependencies.consumer_registry->register_preconfigured_consumer_factory(L"preview", create_preconfigured_preview_consumer);
 	dependencies.media_info_repo->register_extractor([](const std::wstring& file, const std::wstring& extension, core::media_info& info)
 	{
 		if (supported_extensions().find(boost::to_lower_copy(extension)) != supported_extensions().end())
@@ -58,19 +58,15 @@ std::pair<core::draw_frame, core::constraints> load_image(
 		const spl::shared_ptr<core::frame_factory>& frame_factory,
 		const std::wstring& filename)
 {
-	auto bitmap = load_image(filename);
-	FreeImage_FlipVertical(bitmap.get());
+	auto image = decode_image(filename);
 
 	core::pixel_format_desc desc = core::pixel_format::bgra;
-	auto width = FreeImage_GetWidth(bitmap.get());
-	auto height = FreeImage_GetHeight(bitmap.get());
+	auto width = image.width();
+	auto height = image.height();
 	desc.planes.push_back(core::pixel_format_desc::plane(width, height, 4));
-	auto frame = frame_factory->create_frame(bitmap.get(), desc, core::audio_channel_layout::invalid());
+	auto frame = frame_factory->create_frame(image.bitmap.get(), desc, core::audio_channel_layout::invalid());
 
-	std::copy_n(
-			FreeImage_GetBits(bitmap.get()),
-			frame.image_data(0).size(),
-			frame.image_data(0).begin());
+	write_bgra(image, frame.image_data(0).begin());
 
 	return std::make_pair(
 			core::draw_frame(std::move(frame)),
@@ -93,7 +89,7 @@ struct image_producer : public core::frame_producer_base
 		, frame_factory_(frame_factory)
 		, length_(length)
 	{
-		load(load_image(description_));
+		load(decode_image(description_));
 
 		if (thumbnail_mode)
 			CASPAR_LOG(debug) << print() << L" Initialized";
@@ -112,32 +108,31 @@ struct image_producer : public core::frame_producer_base
 			auto new_str = std::string(raw_str.begin(), raw_str.end());
 			new_str.resize(raw_str.size());
 			auto decoded_str = from_base64(new_str);
-			load(load_png_from_memory(decoded_str.data(), decoded_str.size()));
+			load(decode_png_from_memory(decoded_str.data(), decoded_str.size()));
 		});
 		png_string_data_.value().set(png_data);
 
 		CASPAR_LOG(info) << print() << L" Initialized";
 	}
 
-	void load(const std::shared_ptr<FIBITMAP>& bitmap)
+	void load(const decoded_image& image)
 	{
-		FreeImage_FlipVertical(bitmap.get());
-		auto longest_side = static_cast<int>(std::max(FreeImage_GetWidth(bitmap.get()), FreeImage_GetHeight(bitmap.get())));
+		auto longest_side = std::max(image.width(), image.height());
 
 		if (longest_side > frame_factory_->get_max_frame_size())
 			CASPAR_THROW_EXCEPTION(user_error() << msg_info("Image too large for texture"));
 
 		core::pixel_format_desc desc;
 		desc.format = core::pixel_format::bgra;
-		desc.planes.push_back(core::pixel_format_desc::plane(FreeImage_GetWidth(bitmap.get()), FreeImage_GetHeight(bitmap.get()), 4));
+		desc.planes.push_back(core::pixel_format_desc::plane(image.width(), image.height(), 4));
 		auto frame = frame_factory_->create_frame(this, desc, core::audio_channel_layout::invalid());
 
-		std::copy_n(FreeImage_GetBits(bitmap.get()), frame.image_data().size(), frame.image_data().begin());
+		write_bgra(image, frame.image_data().begin());
 		frame_ = core::draw_frame(std::move(frame));
 		if (!constraints_.width.bound())
-			constraints_.width.set(FreeImage_GetWidth(bitmap.get()));
+			constraints_.width.set(image.width());
 		if (!constraints_.height.bound())
-			constraints_.height.set(FreeImage_GetHeight(bitmap.get()));
+			constraints_.height.set(image.height());
 	}
 
 	std::future<std::wstring> call(const std::vector<std::wstring>& param) override
@@ -185,6 +180,11 @@ struct image_producer : public core::frame_producer_base
 		return constraints_;
 	}
 
+	bool can_change_video_format(const core::video_format_desc& format_desc) const override
+	{
+		return true;
+	}
+
 	std::wstring print() const override
 	{
 		return L"image_producer[" + description_ + L"]";
@@ -0,0 +1,174 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "image_downscale.h"
+
+#include <tbb/parallel_for.h>
+
+#include <emmintrin.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace caspar { namespace image {
+
+namespace {
+
+void halve(const std::uint8_t* source, int source_width, int source_height, std::uint8_t* destination)
+{
+	auto width	= source_width / 2;
+	auto height	= source_height / 2;
+
+	tbb::parallel_for(0, height, [&](int y)
+	{
+		auto top	= source + (y * 2) * source_width * 4;
+		auto bottom	= top + source_width * 4;
+		auto out	= destination + y * width * 4;
+		int x		= 0;
+
+		for (; x + 4 <= width; x += 4)
+		{
+			auto a = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(top + x * 8)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + x * 8)));
+			auto b = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(top + x * 8 + 16)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(bottom + x * 8 + 16)));
+
+			auto even	= _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(2, 0, 2, 0)));
+			auto odd	= _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), _MM_SHUFFLE(3, 1, 3, 1)));
+
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(out + x * 4), _mm_avg_epu8(even, odd));
+		}
+
+		for (; x < width; ++x)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				auto sum = top[x * 8 + c] + top[x * 8 + 4 + c] + bottom[x * 8 + c] + bottom[x * 8 + 4 + c];
+				out[x * 4 + c] = static_cast<std::uint8_t>((sum + 2) / 4);
+			}
+		}
+	});
+}
+
+// Source pixel coverage of one destination pixel along an axis, in 1/256ths.
+struct span
+{
+	int					first;
+	std::vector<int>	weights;
+};
+
+std::vector<span> area_spans(int source_size, int destination_size)
+{
+	std::vector<span> spans(destination_size);
+	auto scale = static_cast<double>(source_size) / destination_size;
+
+	for (int i = 0; i < destination_size; ++i)
+	{
+		auto begin	= i * scale;
+		auto end	= std::min<double>(source_size, (i + 1) * scale);
+		auto first	= static_cast<int>(begin);
+		auto total	= 0;
+
+		spans[i].first = first;
+
+		for (int s = first; s < end; ++s)
+		{
+			auto coverage	= std::min<double>(s + 1, end) - std::max<double>(s, begin);
+			auto weight		= static_cast<int>(coverage / scale * 256.0 + 0.5);
+
+			spans[i].weights.push_back(weight);
+			total += weight;
+		}
+
+		// Make every destination pixel sum to exactly 256.
+		spans[i].weights.back() += 256 - total;
+	}
+
+	return spans;
+}
+
+void area_resample(const std::uint8_t* source, int source_width, int source_height, std::uint8_t* destination, int destination_width, int destination_height)
+{
+	auto columns	= area_spans(source_width, destination_width);
+	auto rows		= area_spans(source_height, destination_height);
+
+	tbb::parallel_for(0, destination_height, [&](int y)
+	{
+		std::vector<int> line(source_width * 4, 0);
+
+		for (std::size_t r = 0; r < rows[y].weights.size(); ++r)
+		{
+			auto weight	= rows[y].weights[r];
+			auto row	= source + (rows[y].first + r) * source_width * 4;
+
+			for (int x = 0; x < source_width * 4; ++x)
+				line[x] += row[x] * weight;
+		}
+
+		auto out = destination + y * destination_width * 4;
+
+		for (int x = 0; x < destination_width; ++x)
+		{
+			int sum[4] = { 0, 0, 0, 0 };
+
+			for (std::size_t s = 0; s < columns[x].weights.size(); ++s)
+			{
+				auto weight = columns[x].weights[s];
+				auto pixel	= line.data() + (columns[x].first + s) * 4;
+
+				for (int c = 0; c < 4; ++c)
+					sum[c] += pixel[c] * weight;
+			}
+
+			for (int c = 0; c < 4; ++c)
+				out[x * 4 + c] = static_cast<std::uint8_t>(std::min(255, (sum[c] + 32768) >> 16));
+		}
+	});
+}
+
+}
+
+void downscale_area(
+		const std::uint8_t* source, int source_width, int source_height,
+		std::uint8_t* destination, int destination_width, int destination_height)
+{
+	std::vector<std::uint8_t> buffers[2];
+	auto current	= source;
+	auto width		= source_width;
+	auto height		= source_height;
+
+	for (int i = 0; width / 2 >= destination_width && height / 2 >= destination_height; ++i)
+	{
+		auto& buffer = buffers[i % 2];
+		buffer.resize((width / 2) * (height / 2) * 4);
+
+		halve(current, width, height, buffer.data());
+
+		current	= buffer.data();
+		width	/= 2;
+		height	/= 2;
+	}
+
+	if (width == destination_width && height == destination_height)
+		std::memcpy(destination, current, width * height * 4);
+	else
+		area_resample(current, width, height, destination, destination_width, destination_height);
+}
+
+}}
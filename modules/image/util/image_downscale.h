@@ -0,0 +1,36 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+
+namespace caspar { namespace image {
+
+/**
+ * Area (box) filtered downscale of a BGRA image. The image is first halved
+ * with SSE2 as long as it stays at least as large as the destination, then
+ * a weighted area pass produces the exact size. Upscaling is not supported.
+ */
+void downscale_area(
+		const std::uint8_t* source, int source_width, int source_height,
+		std::uint8_t* destination, int destination_width, int destination_height);
+
+}}
@@ -30,22 +30,126 @@
 
 #include <boost/exception/errinfo_file_name.hpp>
 #include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <tbb/parallel_for.h>
+
+#include <cstring>
+#include <vector>
 
 #include "image_algorithms.h"
 #include "image_view.h"
 
 namespace caspar { namespace image {
 
-std::shared_ptr<FIBITMAP> load_image(const std::wstring& filename)
+namespace {
+
+typedef std::unique_ptr<FIMEMORY, decltype(&FreeImage_CloseMemory)> memory_ptr;
+
+memory_ptr open_memory(const void* memory_location, size_t size)
+{
+	return memory_ptr(
+			FreeImage_OpenMemory(static_cast<BYTE*>(const_cast<void*>(memory_location)), static_cast<DWORD>(size)),
+			FreeImage_CloseMemory);
+}
+
+decoded_image decode(FREE_IMAGE_FORMAT fif, FIMEMORY* memory)
+{
+	if (fif == FIF_UNKNOWN || !FreeImage_FIFSupportsReading(fif))
+		CASPAR_THROW_EXCEPTION(invalid_argument() << msg_info("Unsupported image format."));
+
+	decoded_image image;
+	image.bitmap			= std::shared_ptr<FIBITMAP>(FreeImage_LoadFromMemory(fif, memory, 0), FreeImage_Unload);
+	image.straight_alpha	= fif == FIF_PNG;
+
+	if (!image.bitmap)
+		CASPAR_THROW_EXCEPTION(invalid_argument() << msg_info("Unsupported image format."));
+
+	return image;
+}
+
+bool is_bgr(FIBITMAP* bitmap)
+{
+	return FreeImage_GetImageType(bitmap) == FIT_BITMAP
+		&& (FreeImage_GetBPP(bitmap) == 24 || FreeImage_GetBPP(bitmap) == 32)
+		&& FreeImage_GetColorType(bitmap) != FIC_CMYK
+		&& FI_RGBA_BLUE == 0 && FI_RGBA_GREEN == 1 && FI_RGBA_RED == 2 && FI_RGBA_ALPHA == 3;
+}
+
+std::shared_ptr<FIBITMAP> to_32_bits(const std::shared_ptr<FIBITMAP>& bitmap)
+{
+	if (FreeImage_GetBPP(bitmap.get()) == 32 && FreeImage_GetImageType(bitmap.get()) == FIT_BITMAP)
+		return bitmap;
+
+	auto converted = std::shared_ptr<FIBITMAP>(FreeImage_ConvertTo32Bits(bitmap.get()), FreeImage_Unload);
+
+	if (!converted)
+		CASPAR_THROW_EXCEPTION(invalid_argument() << msg_info("Unsupported image format."));
+
+	return converted;
+}
+
+// value * alpha / 255 truncated like premultiply(), exact for 16 bit products.
+inline std::uint8_t multiply_alpha(int value, int alpha)
+{
+	return static_cast<std::uint8_t>((value * alpha * 0x8081) >> 23);
+}
+
+void write_row(const std::uint8_t* source, int bytes_per_pixel, bool straight_alpha, int width, std::uint8_t* destination)
+{
+	if (bytes_per_pixel == 3)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			destination[x * 4 + 0] = source[x * 3 + 0];
+			destination[x * 4 + 1] = source[x * 3 + 1];
+			destination[x * 4 + 2] = source[x * 3 + 2];
+			destination[x * 4 + 3] = 255;
+		}
+	}
+	else if (!straight_alpha)
+		std::memcpy(destination, source, width * 4);
+	else
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			int alpha = source[x * 4 + 3];
+
+			destination[x * 4 + 0] = multiply_alpha(source[x * 4 + 0], alpha);
+			destination[x * 4 + 1] = multiply_alpha(source[x * 4 + 1], alpha);
+			destination[x * 4 + 2] = multiply_alpha(source[x * 4 + 2], alpha);
+			destination[x * 4 + 3] = static_cast<std::uint8_t>(alpha);
+		}
+	}
+}
+
+}
+
+int decoded_image::width() const
+{
+	return static_cast<int>(FreeImage_GetWidth(bitmap.get()));
+}
+
+int decoded_image::height() const
+{
+	return static_cast<int>(FreeImage_GetHeight(bitmap.get()));
+}
+
+// The file is read in one go, which is much faster than the small reads of
+// the FreeImage decoders on network storage.
+decoded_image decode_image(const std::wstring& filename)
 {
 	if(!boost::filesystem::exists(filename))
 		CASPAR_THROW_EXCEPTION(file_not_found() << boost::errinfo_file_name(u8(filename)));
 
-#ifdef WIN32
-	FREE_IMAGE_FORMAT fif = FreeImage_GetFileTypeU(filename.c_str(), 0);
-#else
-	FREE_IMAGE_FORMAT fif = FreeImage_GetFileType(u8(filename).c_str(), 0);
-#endif
+	boost::filesystem::ifstream stream(boost::filesystem::path(filename), std::ios::binary);
+	std::vector<char> data(static_cast<std::size_t>(boost::filesystem::file_size(filename)));
+
+	if (!stream.read(data.data(), data.size()))
+		CASPAR_THROW_EXCEPTION(file_read_error() << boost::errinfo_file_name(u8(filename)));
+
+	auto memory	= open_memory(data.data(), data.size());
+	auto fif	= FreeImage_GetFileTypeFromMemory(memory.get(), 0);
 
 	if (fif == FIF_UNKNOWN)
 #ifdef WIN32
@@ -54,51 +158,41 @@ std::shared_ptr<FIBITMAP> load_image(const std::wstring& filename)
 		fif = FreeImage_GetFIFFromFilename(u8(filename).c_str());
 #endif
 
-	if(fif == FIF_UNKNOWN || !FreeImage_FIFSupportsReading(fif))
-		CASPAR_THROW_EXCEPTION(invalid_argument() << msg_info("Unsupported image format."));
-
-#ifdef WIN32
-	auto bitmap = std::shared_ptr<FIBITMAP>(FreeImage_LoadU(fif, filename.c_str(), 0), FreeImage_Unload);
-#else
-	auto bitmap = std::shared_ptr<FIBITMAP>(FreeImage_Load(fif, u8(filename).c_str(), 0), FreeImage_Unload);
-#endif
-
-	if(FreeImage_GetBPP(bitmap.get()) != 32)
-	{
-		bitmap = std::shared_ptr<FIBITMAP>(FreeImage_ConvertTo32Bits(bitmap.get()), FreeImage_Unload);
-		if(!bitmap)
-			CASPAR_THROW_EXCEPTION(invalid_argument() << msg_info("Unsupported image format."));
-	}
+	return decode(fif, memory.get());
+}
 
-	//PNG-images need to be premultiplied with their alpha
-	if(fif == FIF_PNG)
-	{
-		image_view<bgra_pixel> original_view(FreeImage_GetBits(bitmap.get()), FreeImage_GetWidth(bitmap.get()), FreeImage_GetHeight(bitmap.get()));
-		premultiply(original_view);
-	}
+decoded_image decode_png_from_memory(const void* memory_location, size_t size)
+{
+	auto memory = open_memory(memory_location, size);
 
-	return bitmap;
+	return decode(FIF_PNG, memory.get());
 }
 
-std::shared_ptr<FIBITMAP> load_png_from_memory(const void* memory_location, size_t size)
+void write_bgra(const decoded_image& image, std::uint8_t* destination)
 {
-	FREE_IMAGE_FORMAT fif = FIF_PNG;
-
-	auto memory = std::unique_ptr<FIMEMORY, decltype(&FreeImage_CloseMemory)>(
-			FreeImage_OpenMemory(static_cast<BYTE*>(const_cast<void*>(memory_location)), static_cast<DWORD>(size)),
-			FreeImage_CloseMemory);
-	auto bitmap = std::shared_ptr<FIBITMAP>(FreeImage_LoadFromMemory(fif, memory.get(), 0), FreeImage_Unload);
+	auto bitmap = is_bgr(image.bitmap.get()) ? image.bitmap : to_32_bits(image.bitmap);
+	auto width	= image.width();
+	auto height	= image.height();
+	auto bytes_per_pixel = static_cast<int>(FreeImage_GetBPP(bitmap.get()) / 8);
 
-	if (FreeImage_GetBPP(bitmap.get()) != 32)
+	tbb::parallel_for(0, height, [&](int y)
 	{
-		bitmap = std::shared_ptr<FIBITMAP>(FreeImage_ConvertTo32Bits(bitmap.get()), FreeImage_Unload);
+		write_row(
+				FreeImage_GetScanLine(bitmap.get(), height - 1 - y),
+				bytes_per_pixel,
+				image.straight_alpha,
+				width,
+				destination + static_cast<std::size_t>(y) * width * 4);
+	});
+}
 
-		if (!bitmap)
-			CASPAR_THROW_EXCEPTION(invalid_argument() << msg_info("Unsupported image format."));
-	}
+std::shared_ptr<FIBITMAP> load_image(const std::wstring& filename)
+{
+	auto image	= decode_image(filename);
+	auto bitmap	= to_32_bits(image.bitmap);
 
 	//PNG-images need to be premultiplied with their alpha
-	if (fif == FIF_PNG)
+	if(image.straight_alpha)
 	{
 		image_view<bgra_pixel> original_view(FreeImage_GetBits(bitmap.get()), FreeImage_GetWidth(bitmap.get()), FreeImage_GetHeight(bitmap.get()));
 		premultiply(original_view);
@@ -23,14 +23,33 @@
 
 #include <FreeImage.h>
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <set>
 
 namespace caspar { namespace image {
 
+// An image as decoded from its file, in the pixel layout of the file.
+struct decoded_image
+{
+	std::shared_ptr<FIBITMAP>	bitmap;
+	bool						straight_alpha	= false;	// PNG
+
+	int width() const;
+	int height() const;
+};
+
+decoded_image decode_image(const std::wstring& filename);
+decoded_image decode_png_from_memory(const void* memory_location, size_t size);
+
+// Writes the image as premultiplied top-down bgra directly to destination,
+// which holds width * height * 4 bytes. 24 and 32 bit images are converted in
+// one pass over the rows in parallel, other layouts go through FreeImage.
+void write_bgra(const decoded_image& image, std::uint8_t* destination);
+
+// A premultiplied bottom-up 32 bit bitmap.
 std::shared_ptr<FIBITMAP> load_image(const std::wstring& filename);
-std::shared_ptr<FIBITMAP> load_png_from_memory(const void* memory_location, size_t size);
 const std::set<std::wstring>& supported_extensions();
 
 }}
@@ -129,6 +129,7 @@ public:
 		presentation_age_ = 0;
 
 		init_device();
+		executor_.set_priority(thread_priority::OUTPUT);
 
 		graph_->set_color("tick-time", diagnostics::color(0.0f, 0.6f, 0.9f));
 		graph_->set_color("dropped-frame", diagnostics::color(0.3f, 0.6f, 0.3f));
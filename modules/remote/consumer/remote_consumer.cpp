@@ -0,0 +1,435 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "remote_consumer.h"
+
+#include "../util/frame_codec.h"
+#include "../util/protocol.h"
+
+#include <common/except.h>
+#include <common/diagnostics/graph.h>
+#include <common/log.h>
+#include <common/utf.h>
+#include <common/future.h>
+#include <common/param.h>
+#include <common/timer.h>
+#include <common/os/general_protection_fault.h>
+
+#include <core/consumer/frame_consumer.h>
+#include <core/frame/frame.h>
+#include <core/frame/frame_timecode.h>
+#include <core/frame/audio_channel_layout.h>
+#include <core/video_format.h>
+#include <core/monitor/monitor.h>
+#include <core/help/help_sink.h>
+#include <core/help/help_repository.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/asio.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/thread.hpp>
+
+#include <tbb/atomic.h>
+
+#include <deque>
+#include <map>
+#include <mutex>
+
+namespace caspar { namespace remote {
+
+using boost::asio::ip::tcp;
+
+struct packet
+{
+	packet_header				header;
+	std::vector<std::uint8_t>	encoded_image;
+	core::const_frame			frame;
+	std::string					layout;
+};
+
+// Every destination gets an index of its own for the lifetime of the process,
+// so that two consumers on a channel never replace each other by accident
+// while REMOVE with the same parameters still finds the consumer.
+int destination_index(const std::wstring& host, const std::wstring& port)
+{
+	static std::mutex					mutex;
+	static std::map<std::wstring, int>	indexes;
+
+	auto destination = boost::to_lower_copy(host) + L":" + port;
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	auto found = indexes.find(destination);
+
+	if (found != indexes.end())
+		return found->second;
+
+	if (indexes.size() >= 100000)
+		CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Too many remote consumer destinations."));
+
+	auto index = 200000 + static_cast<int>(indexes.size());
+
+	indexes.insert(std::make_pair(destination, index));
+
+	return index;
+}
+
+class remote_consumer : public core::frame_consumer
+{
+	core::monitor::subject							monitor_subject_;
+	spl::shared_ptr<diagnostics::graph>				graph_;
+	const std::wstring								host_;
+	const std::wstring								port_;
+	const int										index_;
+	const bool										compress_;
+	const int										max_queued_;
+
+	core::video_format_desc							format_desc_;
+	int												channel_index_	= -1;
+	bool											started_		= false;
+	std::string										layout_;
+	std::int64_t									frame_number_	= 0;
+	tbb::atomic<int>								queued_;
+	tbb::atomic<bool>								connected_;
+
+	boost::asio::io_service							service_;
+	std::unique_ptr<boost::asio::io_service::work>	work_;
+	tcp::socket										socket_;
+	boost::asio::deadline_timer						reconnect_timer_;
+	std::deque<std::shared_ptr<packet>>				pending_;
+	bool											writing_		= false;
+	boost::thread									thread_;
+public:
+	remote_consumer(const std::wstring& host, const std::wstring& port, bool compress, int max_queued)
+		: host_(host)
+		, port_(port)
+		, index_(destination_index(host, port))
+		, compress_(compress)
+		, max_queued_(max_queued)
+		, work_(new boost::asio::io_service::work(service_))
+		, socket_(service_)
+		, reconnect_timer_(service_)
+	{
+		queued_		= 0;
+		connected_	= false;
+
+		graph_->set_color("encode-time", diagnostics::color(0.0f, 0.6f, 0.9f));
+		graph_->set_color("dropped-frame", diagnostics::color(0.3f, 0.6f, 0.3f));
+		graph_->set_color("compression", diagnostics::color(0.9f, 0.9f, 0.3f));
+		diagnostics::register_graph(graph_);
+
+		thread_ = boost::thread([this]
+		{
+			ensure_gpf_handler_installed_for_thread("remote-consumer");
+			service_.run();
+		});
+	}
+
+	~remote_consumer()
+	{
+		work_.reset();
+		service_.stop();
+		thread_.join();
+	}
+
+	// frame_consumer
+
+	void initialize(const core::video_format_desc& format_desc, const core::audio_channel_layout& channel_layout, int channel_index) override
+	{
+		format_desc_	= format_desc;
+		channel_index_	= channel_index;
+		layout_			= u8(channel_layout.type + L":" + boost::join(channel_layout.channel_order, L" "));
+
+		graph_->set_text(print());
+
+		if (!started_)
+			service_.post([this] { connect(); });
+
+		started_ = true;
+	}
+
+	std::future<bool> send(core::frame_timecode timecode, core::const_frame frame) override
+	{
+		auto frame_number = frame_number_++;
+
+		if (!connected_)
+			return make_ready_future(true);
+
+		// Never stall the channel, a slow link drops frames here instead.
+		if (queued_ >= max_queued_)
+		{
+			graph_->set_tag(diagnostics::tag_severity::WARNING, "dropped-frame");
+			return make_ready_future(true);
+		}
+
+		++queued_;
+
+		auto layout	= layout_;
+		auto fps	= format_desc_.fps;
+
+		service_.post([=]
+		{
+			enqueue(encode(timecode, frame, frame_number, layout, fps));
+		});
+
+		return make_ready_future(true);
+	}
+
+	std::wstring print() const override
+	{
+		return L"remote[" + boost::lexical_cast<std::wstring>(channel_index_) + L"|" + host_ + L":" + port_ + L"]";
+	}
+
+	std::wstring name() const override
+	{
+		return L"remote";
+	}
+
+	boost::property_tree::wptree info() const override
+	{
+		boost::property_tree::wptree info;
+		info.add(L"type", L"remote");
+		info.add(L"host", host_);
+		info.add(L"port", port_);
+		info.add(L"compression", compress_);
+		info.add(L"connected", static_cast<bool>(connected_));
+		return info;
+	}
+
+	bool has_synchronization_clock() const override
+	{
+		return false;
+	}
+
+	int buffer_depth() const override
+	{
+		return -1;
+	}
+
+	int index() const override
+	{
+		return index_;
+	}
+
+	int64_t presentation_frame_age_millis() const override
+	{
+		return 0;
+	}
+
+	core::monitor::subject& monitor_output() override
+	{
+		return monitor_subject_;
+	}
+private:
+	std::shared_ptr<packet> encode(const core::frame_timecode& timecode, const core::const_frame& frame, std::int64_t frame_number, const std::string& layout, double fps)
+	{
+		caspar::timer encode_timer;
+
+		auto result		= std::make_shared<packet>();
+		auto image		= frame.image_data();
+		auto& header	= result->header;
+
+		result->frame	= frame;
+		result->layout	= layout;
+
+		if (compress_)
+		{
+			encode_image(image.begin(), static_cast<int>(frame.width()), static_cast<int>(frame.height()), result->encoded_image);
+
+			// Noise does not compress, send it as is.
+			if (result->encoded_image.size() >= image.size())
+				result->encoded_image.clear();
+		}
+
+		header.magic			= PACKET_MAGIC;
+		header.version			= PROTOCOL_VERSION;
+		header.frame_number		= frame_number;
+		header.width			= static_cast<std::uint32_t>(frame.width());
+		header.height			= static_cast<std::uint32_t>(frame.height());
+		header.codec			= static_cast<std::uint32_t>(result->encoded_image.empty() ? image_codec::raw : image_codec::delta);
+		header.image_size		= static_cast<std::uint32_t>(result->encoded_image.empty() ? image.size() : result->encoded_image.size());
+		header.audio_channels	= static_cast<std::uint32_t>(frame.audio_channel_layout().num_channels);
+		header.audio_samples	= static_cast<std::uint32_t>(frame.audio_data().size());
+		header.layout_size		= static_cast<std::uint32_t>(layout.size());
+		header.timecode_frames	= timecode.total_frames();
+		header.timecode_fps		= timecode.fps();
+
+		graph_->set_value("encode-time", encode_timer.elapsed() * fps * 0.5);
+		graph_->set_value("compression", image.size() > 0 ? header.image_size / static_cast<double>(image.size()) : 1.0);
+
+		return result;
+	}
+
+	void connect()
+	{
+		if (connected_)
+			return;
+
+		try
+		{
+			tcp::resolver resolver(service_);
+			auto endpoints = resolver.resolve(tcp::resolver::query(u8(host_), u8(port_)));
+
+			boost::asio::async_connect(socket_, endpoints, [this](const boost::system::error_code& error, tcp::resolver::iterator)
+			{
+				if (error)
+				{
+					CASPAR_LOG(debug) << print() << L" Could not connect: " << u16(error.message());
+					schedule_reconnect();
+					return;
+				}
+
+				socket_.set_option(tcp::no_delay(true));
+				connected_ = true;
+
+				CASPAR_LOG(info) << print() << L" Connected.";
+			});
+		}
+		catch (...)
+		{
+			CASPAR_LOG_CURRENT_EXCEPTION();
+			schedule_reconnect();
+		}
+	}
+
+	void schedule_reconnect()
+	{
+		reconnect_timer_.expires_from_now(boost::posix_time::seconds(1));
+		reconnect_timer_.async_wait([this](const boost::system::error_code& error)
+		{
+			if (!error)
+				connect();
+		});
+	}
+
+	void enqueue(const std::shared_ptr<packet>& packet)
+	{
+		if (!connected_)
+		{
+			--queued_;
+			return;
+		}
+
+		pending_.push_back(packet);
+
+		if (!writing_)
+			write_next();
+	}
+
+	void write_next()
+	{
+		if (pending_.empty())
+		{
+			writing_ = false;
+			return;
+		}
+
+		writing_ = true;
+
+		auto packet = pending_.front();
+		auto& header = packet->header;
+		auto image = packet->frame.image_data();
+		auto audio = packet->frame.audio_data();
+
+		std::vector<boost::asio::const_buffer> buffers;
+		buffers.push_back(boost::asio::buffer(&header, sizeof(header)));
+
+		if (packet->encoded_image.empty())
+			buffers.push_back(boost::asio::buffer(image.begin(), image.size()));
+		else
+			buffers.push_back(boost::asio::buffer(packet->encoded_image));
+
+		buffers.push_back(boost::asio::buffer(audio.begin(), audio.size() * sizeof(std::int32_t)));
+		buffers.push_back(boost::asio::buffer(packet->layout));
+
+		boost::asio::async_write(socket_, buffers, [this, packet](const boost::system::error_code& error, std::size_t)
+		{
+			pending_.pop_front();
+			--queued_;
+
+			if (error)
+			{
+				disconnect(error);
+				return;
+			}
+
+			write_next();
+		});
+	}
+
+	void disconnect(const boost::system::error_code& error)
+	{
+		CASPAR_LOG(warning) << print() << L" Connection lost: " << u16(error.message());
+
+		boost::system::error_code ignored;
+		socket_.close(ignored);
+
+		queued_ -= static_cast<int>(pending_.size());
+		pending_.clear();
+		writing_	= false;
+		connected_	= false;
+
+		schedule_reconnect();
+	}
+};
+
+void describe_consumer(core::help_sink& sink, const core::help_repository& repo)
+{
+	sink.short_description(L"Sends the channel to a REMOTE producer on another server.");
+	sink.syntax(L"REMOTE [host:string] [port:int] {[raw:RAW]} {QUEUE [frames:int|3]}");
+	sink.para()->text(L"Sends image, audio and timecode of every frame over TCP. The image is compressed losslessly unless ")->code(L"RAW")->text(L" is given.");
+	sink.para()->text(L"The channel is never held back by the network. When more than ")->code(L"frames")
+		->text(L" frames are waiting to be sent, new frames are dropped. The connection is retried every second until it succeeds.");
+	sink.para()->text(L"Examples:");
+	sink.example(L">> ADD 1 REMOTE 192.168.0.2 5300", L"sends channel 1 to a REMOTE producer listening on port 5300 of 192.168.0.2.");
+	sink.example(L">> ADD 1 REMOTE localhost 5300 RAW", L"sends uncompressed frames, for links where bandwidth is not a concern.");
+}
+
+spl::shared_ptr<core::frame_consumer> create_consumer(
+		const std::vector<std::wstring>& params, core::interaction_sink*, std::vector<spl::shared_ptr<core::video_channel>> channels)
+{
+	if (params.size() < 3 || !boost::iequals(params.at(0), L"REMOTE"))
+		return core::frame_consumer::empty();
+
+	auto host		= params.at(1);
+	auto port		= params.at(2);
+	auto compress	= !contains_param(L"RAW", params);
+	auto queue		= get_param(L"QUEUE", params, 3);
+
+	boost::lexical_cast<unsigned short>(port);
+
+	return spl::make_shared<remote_consumer>(host, port, compress, std::max(1, queue));
+}
+
+spl::shared_ptr<core::frame_consumer> create_preconfigured_consumer(
+		const boost::property_tree::wptree& ptree, core::interaction_sink*, std::vector<spl::shared_ptr<core::video_channel>> channels)
+{
+	auto host		= ptree.get<std::wstring>(L"host");
+	auto port		= ptree.get<std::wstring>(L"port");
+	auto compress	= ptree.get(L"compression", true);
+	auto queue		= ptree.get(L"queue", 3);
+
+	boost::lexical_cast<unsigned short>(port);
+
+	return spl::make_shared<remote_consumer>(host, port, compress, std::max(1, queue));
+}
+
+}}
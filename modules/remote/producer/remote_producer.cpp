@@ -0,0 +1,396 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "remote_producer.h"
+
+#include "../util/frame_codec.h"
+#include "../util/protocol.h"
+
+#include <common/except.h>
+#include <common/diagnostics/graph.h>
+#include <common/log.h>
+#include <common/utf.h>
+#include <common/param.h>
+#include <common/os/general_protection_fault.h>
+
+#include <core/producer/frame_producer.h>
+#include <core/frame/draw_frame.h>
+#include <core/frame/frame.h>
+#include <core/frame/frame_factory.h>
+#include <core/frame/frame_timecode.h>
+#include <core/frame/pixel_format.h>
+#include <core/frame/audio_channel_layout.h>
+#include <core/video_format.h>
+#include <core/monitor/monitor.h>
+#include <core/help/help_sink.h>
+#include <core/help/help_repository.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/asio.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/thread.hpp>
+
+#include <tbb/concurrent_queue.h>
+
+#include <cstring>
+
+namespace caspar { namespace remote {
+
+using boost::asio::ip::tcp;
+
+const std::uint32_t MAX_DIMENSION	= 8192;
+const std::uint32_t MAX_LAYOUT_SIZE	= 1024;
+const std::uint32_t MAX_CHANNELS	= 64;
+
+class remote_producer : public core::frame_producer_base
+{
+	core::monitor::subject										monitor_subject_;
+	spl::shared_ptr<diagnostics::graph>							graph_;
+	const spl::shared_ptr<core::frame_factory>					frame_factory_;
+	const core::video_format_desc								format_desc_;
+	const std::wstring											address_;
+	const unsigned short										port_;
+	const int													buffer_depth_;
+	core::constraints											constraints_;
+
+	typedef std::pair<core::frame_timecode, core::draw_frame>	buffered_frame;
+	tbb::concurrent_bounded_queue<buffered_frame>				buffer_;
+	bool														started_		= false;
+	core::frame_timecode										timecode_		= core::frame_timecode::empty();
+
+	boost::asio::io_service										service_;
+	tcp::acceptor												acceptor_;
+	std::shared_ptr<tcp::socket>								socket_;
+	packet_header												header_;
+	std::vector<std::uint8_t>									payload_;
+	std::int64_t												next_frame_number_	= -1;
+	std::string													layout_string_;
+	core::audio_channel_layout									layout_			= core::audio_channel_layout::invalid();
+	boost::thread												thread_;
+public:
+	remote_producer(const spl::shared_ptr<core::frame_factory>& frame_factory, const core::video_format_desc& format_desc, const std::wstring& address, unsigned short port, int buffer_depth)
+		: frame_factory_(frame_factory)
+		, format_desc_(format_desc)
+		, address_(address)
+		, port_(port)
+		, buffer_depth_(buffer_depth)
+		, constraints_(format_desc.width, format_desc.height)
+		, acceptor_(service_)
+	{
+		try
+		{
+			tcp::endpoint endpoint(boost::asio::ip::address::from_string(u8(address_)), port_);
+
+			acceptor_.open(endpoint.protocol());
+			acceptor_.set_option(tcp::acceptor::reuse_address(true));
+			acceptor_.bind(endpoint);
+			acceptor_.listen();
+		}
+		catch (const boost::system::system_error& e)
+		{
+			CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Could not listen on " + address_ + L":" + boost::lexical_cast<std::wstring>(port_) + L": " + u16(e.what())));
+		}
+
+		buffer_.set_capacity(buffer_depth * 2);
+
+		graph_->set_color("buffer", diagnostics::color(0.7f, 0.4f, 0.4f));
+		graph_->set_color("late-frame", diagnostics::color(0.6f, 0.3f, 0.3f));
+		graph_->set_color("dropped-frame", diagnostics::color(0.3f, 0.6f, 0.3f));
+		graph_->set_text(print());
+		diagnostics::register_graph(graph_);
+
+		accept();
+
+		thread_ = boost::thread([this]
+		{
+			ensure_gpf_handler_installed_for_thread("remote-producer");
+			service_.run();
+		});
+
+		CASPAR_LOG(info) << print() << L" Listening.";
+	}
+
+	~remote_producer()
+	{
+		service_.stop();
+		thread_.join();
+	}
+
+	// frame_producer
+
+	core::draw_frame receive_impl() override
+	{
+		// The jitter buffer is filled to its depth before playing and after
+		// every underrun, holding the last frame meanwhile.
+		if (!started_)
+		{
+			if (static_cast<int>(buffer_.size()) < buffer_depth_)
+				return core::draw_frame::late();
+
+			started_ = true;
+		}
+
+		buffered_frame frame;
+
+		if (!buffer_.try_pop(frame))
+		{
+			started_ = false;
+			graph_->set_tag(diagnostics::tag_severity::WARNING, "late-frame");
+			return core::draw_frame::late();
+		}
+
+		timecode_ = frame.first;
+
+		graph_->set_value("buffer", static_cast<double>(buffer_.size()) / buffer_.capacity());
+		monitor_subject_ << core::monitor::message("/remote/buffer") % static_cast<int>(buffer_.size());
+
+		return frame.second;
+	}
+
+	core::constraints& pixel_constraints() override
+	{
+		return constraints_;
+	}
+
+	const core::frame_timecode& timecode() override
+	{
+		return timecode_;
+	}
+
+	bool has_timecode() override
+	{
+		return timecode_.is_valid();
+	}
+
+	bool provides_timecode() override
+	{
+		return true;
+	}
+
+	std::wstring print() const override
+	{
+		return L"remote[" + address_ + L":" + boost::lexical_cast<std::wstring>(port_) + L"]";
+	}
+
+	std::wstring name() const override
+	{
+		return L"remote";
+	}
+
+	boost::property_tree::wptree info() const override
+	{
+		boost::property_tree::wptree info;
+		info.add(L"type", L"remote");
+		info.add(L"address", address_);
+		info.add(L"port", port_);
+		info.add(L"buffer-depth", buffer_depth_);
+		info.add(L"buffered", buffer_.size());
+		return info;
+	}
+
+	core::monitor::subject& monitor_output() override
+	{
+		return monitor_subject_;
+	}
+private:
+	void accept()
+	{
+		auto socket = std::make_shared<tcp::socket>(service_);
+
+		acceptor_.async_accept(*socket, [this, socket](const boost::system::error_code& error)
+		{
+			if (error == boost::asio::error::operation_aborted)
+				return;
+
+			if (!error)
+			{
+				// A new sender replaces the current one.
+				if (socket_)
+				{
+					boost::system::error_code ignored;
+					socket_->close(ignored);
+				}
+
+				socket->set_option(tcp::no_delay(true));
+				socket_				= socket;
+				next_frame_number_	= -1;
+
+				CASPAR_LOG(info) << print() << L" Sender connected from " << u16(socket->remote_endpoint().address().to_string()) << L".";
+
+				read_header(socket);
+			}
+
+			accept();
+		});
+	}
+
+	void read_header(const std::shared_ptr<tcp::socket>& socket)
+	{
+		boost::asio::async_read(*socket, boost::asio::buffer(&header_, sizeof(header_)), [this, socket](const boost::system::error_code& error, std::size_t)
+		{
+			if (error || socket != socket_)
+			{
+				disconnect(socket, error);
+				return;
+			}
+
+			// Sizes are computed in 64 bits so that no header can overflow them.
+			if (header_.magic != PACKET_MAGIC
+					|| header_.version != PROTOCOL_VERSION
+					|| header_.width > MAX_DIMENSION
+					|| header_.height > MAX_DIMENSION
+					|| header_.image_size > std::uint64_t(header_.width) * header_.height * 4 + std::uint64_t(header_.height) * 64 + 4096
+					|| header_.audio_channels > MAX_CHANNELS
+					|| std::uint64_t(header_.audio_samples) > std::uint64_t(header_.audio_channels) * 48000
+					|| (header_.audio_channels > 0 && header_.audio_samples % header_.audio_channels != 0)
+					|| header_.layout_size > MAX_LAYOUT_SIZE)
+			{
+				CASPAR_LOG(error) << print() << L" Invalid frame header received, dropping connection.";
+				disconnect(socket, error);
+				return;
+			}
+
+			payload_.resize(static_cast<std::size_t>(std::uint64_t(header_.image_size) + std::uint64_t(header_.audio_samples) * sizeof(std::int32_t) + header_.layout_size));
+
+			read_payload(socket);
+		});
+	}
+
+	void read_payload(const std::shared_ptr<tcp::socket>& socket)
+	{
+		boost::asio::async_read(*socket, boost::asio::buffer(payload_), [this, socket](const boost::system::error_code& error, std::size_t)
+		{
+			if (error || socket != socket_)
+			{
+				disconnect(socket, error);
+				return;
+			}
+
+			try
+			{
+				receive_frame();
+			}
+			catch (...)
+			{
+				CASPAR_LOG_CURRENT_EXCEPTION();
+			}
+
+			read_header(socket);
+		});
+	}
+
+	void disconnect(const std::shared_ptr<tcp::socket>& socket, const boost::system::error_code& error)
+	{
+		if (socket != socket_)
+			return;
+
+		if (error)
+			CASPAR_LOG(info) << print() << L" Sender disconnected: " << u16(error.message());
+
+		boost::system::error_code ignored;
+		socket_->close(ignored);
+		socket_.reset();
+	}
+
+	void receive_frame()
+	{
+		if (next_frame_number_ != -1 && header_.frame_number != next_frame_number_)
+		{
+			CASPAR_LOG(warning) << print() << L" " << header_.frame_number - next_frame_number_ << L" frames lost by the sender.";
+			graph_->set_tag(diagnostics::tag_severity::WARNING, "dropped-frame");
+		}
+
+		next_frame_number_ = header_.frame_number + 1;
+
+		auto image	= payload_.data();
+		auto audio	= reinterpret_cast<const std::int32_t*>(image + header_.image_size);
+		auto layout	= std::string(reinterpret_cast<const char*>(audio + header_.audio_samples), header_.layout_size);
+
+		if (layout != layout_string_ || layout_.num_channels != static_cast<int>(header_.audio_channels))
+		{
+			auto separator	= layout.find(':');
+			auto type		= u16(layout.substr(0, separator));
+			auto order		= separator == std::string::npos ? L"" : u16(layout.substr(separator + 1));
+
+			layout_			= core::audio_channel_layout(header_.audio_channels, type, order);
+			layout_string_	= layout;
+		}
+
+		core::pixel_format_desc desc(core::pixel_format::bgra);
+		desc.planes.push_back(core::pixel_format_desc::plane(header_.width, header_.height, 4));
+		auto frame = frame_factory_->create_frame(this, desc, layout_);
+
+		if (header_.codec == static_cast<std::uint32_t>(image_codec::delta))
+		{
+			if (!decode_image(image, header_.image_size, header_.width, header_.height, frame.image_data(0).begin()))
+				CASPAR_THROW_EXCEPTION(invalid_argument() << msg_info(print() + L" Corrupt frame received."));
+		}
+		else if (header_.image_size == frame.image_data(0).size())
+			std::memcpy(frame.image_data(0).begin(), image, header_.image_size);
+		else
+			CASPAR_THROW_EXCEPTION(invalid_argument() << msg_info(print() + L" Frame size mismatch."));
+
+		frame.audio_data().assign(audio, audio + header_.audio_samples);
+
+		auto timecode = header_.timecode_fps != 0
+				? core::frame_timecode(header_.timecode_frames, static_cast<std::uint8_t>(header_.timecode_fps))
+				: core::frame_timecode::empty();
+
+		// When the sender runs faster than this channel the oldest frame goes.
+		buffered_frame entry(timecode, core::draw_frame(std::move(frame)));
+
+		while (!buffer_.try_push(entry))
+		{
+			buffered_frame dropped;
+			buffer_.try_pop(dropped);
+			graph_->set_tag(diagnostics::tag_severity::WARNING, "dropped-frame");
+		}
+	}
+};
+
+void describe_producer(core::help_sink& sink, const core::help_repository& repo)
+{
+	sink.short_description(L"Receives frames from a REMOTE consumer on another server.");
+	sink.syntax(L"REMOTE [port:int] {BUFFER [frames:int|3]} {ADDRESS [address:string]|127.0.0.1}");
+	sink.para()->text(L"Listens on ")->code(L"port")->text(L" for a REMOTE consumer and plays the image, audio and timecode it sends. ")
+		->text(L"Received frames pass a jitter buffer that is filled to ")->code(L"frames")->text(L" before playing and again after it runs dry, while the last frame is held.");
+	sink.para()->text(L"A new connection replaces the current sender. Lost frames are reported in the log and the diagnostics graph.");
+	sink.para()->text(L"Only connections to ")->code(L"address")->text(L" are accepted, by default the loopback interface. ")
+		->text(L"There is no authentication, so anyone who can reach a non loopback address can put frames on air. ")
+		->text(L"Only listen on an interface of a trusted network.");
+	sink.para()->text(L"Examples:");
+	sink.example(L">> PLAY 1-10 REMOTE 5300", L"plays what is sent to port 5300 from the same machine.");
+	sink.example(L">> PLAY 1-10 REMOTE 5300 BUFFER 6 ADDRESS 10.0.0.2", L"receives from other machines on the 10.0.0.2 interface with a deeper jitter buffer.");
+}
+
+spl::shared_ptr<core::frame_producer> create_producer(const core::frame_producer_dependencies& dependencies, const std::vector<std::wstring>& params)
+{
+	if (params.size() < 2 || !boost::iequals(params.at(0), L"REMOTE"))
+		return core::frame_producer::empty();
+
+	auto port			= boost::lexical_cast<unsigned short>(params.at(1));
+	auto buffer_depth	= get_param(L"BUFFER", params, 3);
+	auto address		= get_param(L"ADDRESS", params, L"127.0.0.1");
+
+	return spl::make_shared<remote_producer>(dependencies.frame_factory, dependencies.format_desc, address, port, std::max(1, buffer_depth));
+}
+
+}}
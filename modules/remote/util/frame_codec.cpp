@@ -0,0 +1,350 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "frame_codec.h"
+
+#include <tbb/atomic.h>
+#include <tbb/parallel_for.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace caspar { namespace remote {
+
+namespace {
+
+const int BAND_ROWS		= 16;
+const int BLOCK_SIZE	= 16;
+
+std::uint8_t zigzag(std::uint8_t residual)
+{
+	auto value = static_cast<std::int8_t>(residual);
+	return static_cast<std::uint8_t>((value << 1) ^ (value >> 7));
+}
+
+std::uint8_t unzigzag(std::uint8_t value)
+{
+	return static_cast<std::uint8_t>((value >> 1) ^ -(value & 1));
+}
+
+std::size_t max_band_size(int width, int rows)
+{
+	auto blocks = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+	return static_cast<std::size_t>(rows) * 4 * blocks * (1 + BLOCK_SIZE);
+}
+
+// Fixed widths let the compiler unroll the packing completely.
+template<int BITS>
+std::uint8_t* pack(const std::uint8_t* values, std::uint8_t* out)
+{
+	for (int half = 0; half < 2; ++half)
+	{
+		std::uint64_t accumulator = 0;
+
+		for (int i = 0; i < 8; ++i)
+			accumulator |= static_cast<std::uint64_t>(values[half * 8 + i]) << (i * BITS);
+
+		std::memcpy(out, &accumulator, BITS);
+		out += BITS;
+	}
+
+	return out;
+}
+
+template<int BITS>
+const std::uint8_t* unpack(const std::uint8_t* in, std::uint8_t* values)
+{
+	for (int half = 0; half < 2; ++half)
+	{
+		std::uint64_t accumulator = 0;
+		std::memcpy(&accumulator, in, BITS);
+		in += BITS;
+
+		for (int i = 0; i < 8; ++i)
+			values[half * 8 + i] = static_cast<std::uint8_t>((accumulator >> (i * BITS)) & ((1u << BITS) - 1));
+	}
+
+	return in;
+}
+
+std::uint8_t* write_block(const std::uint8_t* values, std::uint8_t* out)
+{
+	std::uint8_t all = 0;
+
+	for (int i = 0; i < BLOCK_SIZE; ++i)
+		all |= values[i];
+
+	int bits = 0;
+
+	while (bits < 8 && (all >> bits) != 0)
+		++bits;
+
+	*out++ = static_cast<std::uint8_t>(bits);
+
+	switch (bits)
+	{
+	case 0:	return out;
+	case 1:	return pack<1>(values, out);
+	case 2:	return pack<2>(values, out);
+	case 3:	return pack<3>(values, out);
+	case 4:	return pack<4>(values, out);
+	case 5:	return pack<5>(values, out);
+	case 6:	return pack<6>(values, out);
+	case 7:	return pack<7>(values, out);
+	default:
+		std::memcpy(out, values, BLOCK_SIZE);
+		return out + BLOCK_SIZE;
+	}
+}
+
+const std::uint8_t* read_block(const std::uint8_t* in, const std::uint8_t* end, std::uint8_t* values)
+{
+	if (in >= end)
+		return nullptr;
+
+	int bits = *in++;
+
+	if (bits > 8 || end - in < bits * BLOCK_SIZE / 8)
+		return nullptr;
+
+	switch (bits)
+	{
+	case 0:
+		std::memset(values, 0, BLOCK_SIZE);
+		return in;
+	case 1:	return unpack<1>(in, values);
+	case 2:	return unpack<2>(in, values);
+	case 3:	return unpack<3>(in, values);
+	case 4:	return unpack<4>(in, values);
+	case 5:	return unpack<5>(in, values);
+	case 6:	return unpack<6>(in, values);
+	case 7:	return unpack<7>(in, values);
+	default:
+		std::memcpy(values, in, BLOCK_SIZE);
+		return in + BLOCK_SIZE;
+	}
+}
+
+// Per channel plane the residual is the horizontal delta of the row minus
+// the horizontal delta of the row above (only the horizontal delta on the
+// first row of a band).
+struct band_planes
+{
+	int							width;
+	std::vector<std::uint8_t>	current;
+	std::vector<std::uint8_t>	previous;
+	std::vector<std::uint8_t>	residuals;
+
+	explicit band_planes(int width)
+		: width(width)
+		, current(4 * width)
+		, previous(4 * width)
+		, residuals(((width + BLOCK_SIZE - 1) / BLOCK_SIZE) * BLOCK_SIZE, 0)
+	{
+	}
+
+	std::uint8_t* plane(std::vector<std::uint8_t>& planes, int c)
+	{
+		return planes.data() + c * width;
+	}
+};
+
+std::size_t encode_band(const std::uint8_t* image, int width, int first_row, int last_row, std::uint8_t* out)
+{
+	auto begin	= out;
+	auto blocks	= (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+	band_planes planes(width);
+
+	for (int y = first_row; y < last_row; ++y)
+	{
+		auto row = image + y * width * 4;
+
+		for (int x = 0; x < width; ++x)
+			for (int c = 0; c < 4; ++c)
+				planes.current[c * width + x] = row[x * 4 + c];
+
+		for (int c = 0; c < 4; ++c)
+		{
+			auto current	= planes.plane(planes.current, c);
+			auto previous	= planes.plane(planes.previous, c);
+			auto residuals	= planes.residuals.data();
+
+			residuals[0] = zigzag(static_cast<std::uint8_t>(current[0] - (y == first_row ? 0 : previous[0])));
+
+			if (y == first_row)
+			{
+				for (int x = 1; x < width; ++x)
+					residuals[x] = zigzag(static_cast<std::uint8_t>(current[x] - current[x - 1]));
+			}
+			else
+			{
+				for (int x = 1; x < width; ++x)
+					residuals[x] = zigzag(static_cast<std::uint8_t>(current[x] - current[x - 1] - previous[x] + previous[x - 1]));
+			}
+
+			for (int b = 0; b < blocks; ++b)
+				out = write_block(residuals + b * BLOCK_SIZE, out);
+		}
+
+		std::swap(planes.current, planes.previous);
+	}
+
+	return out - begin;
+}
+
+bool decode_band(const std::uint8_t* in, std::size_t size, int width, int first_row, int last_row, std::uint8_t* image)
+{
+	auto end	= in + size;
+	auto blocks	= (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+	band_planes planes(width);
+
+	for (int y = first_row; y < last_row; ++y)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			auto current	= planes.plane(planes.current, c);
+			auto previous	= planes.plane(planes.previous, c);
+			auto residuals	= planes.residuals.data();
+
+			for (int b = 0; b < blocks; ++b)
+			{
+				in = read_block(in, end, residuals + b * BLOCK_SIZE);
+
+				if (!in)
+					return false;
+			}
+
+			if (y == first_row)
+			{
+				for (int x = 0; x < width; ++x)
+					residuals[x] = unzigzag(residuals[x]);
+			}
+			else
+			{
+				residuals[0] = static_cast<std::uint8_t>(unzigzag(residuals[0]) + previous[0]);
+
+				for (int x = 1; x < width; ++x)
+					residuals[x] = static_cast<std::uint8_t>(unzigzag(residuals[x]) + previous[x] - previous[x - 1]);
+			}
+
+			std::uint8_t value = current[0] = residuals[0];
+
+			for (int x = 1; x < width; ++x)
+				current[x] = value = static_cast<std::uint8_t>(value + residuals[x]);
+		}
+
+		auto row = image + y * width * 4;
+
+		for (int x = 0; x < width; ++x)
+			for (int c = 0; c < 4; ++c)
+				row[x * 4 + c] = planes.current[c * width + x];
+
+		std::swap(planes.current, planes.previous);
+	}
+
+	return in == end;
+}
+
+}
+
+void encode_image(const std::uint8_t* image, int width, int height, std::vector<std::uint8_t>& encoded)
+{
+	auto band_count	= (height + BAND_ROWS - 1) / BAND_ROWS;
+	auto band_max	= max_band_size(width, BAND_ROWS);
+
+	std::vector<std::uint8_t>	scratch(band_max * band_count);
+	std::vector<std::uint32_t>	sizes(band_count);
+
+	tbb::parallel_for(0, band_count, [&](int band)
+	{
+		auto first_row	= band * BAND_ROWS;
+		auto last_row	= std::min(height, first_row + BAND_ROWS);
+
+		sizes[band] = static_cast<std::uint32_t>(encode_band(image, width, first_row, last_row, scratch.data() + band * band_max));
+	});
+
+	auto header_size = (1 + band_count) * sizeof(std::uint32_t);
+	std::size_t total = header_size;
+
+	for (auto size : sizes)
+		total += size;
+
+	encoded.resize(total);
+
+	auto out = encoded.data();
+	auto count = static_cast<std::uint32_t>(band_count);
+	std::memcpy(out, &count, sizeof(count));
+	std::memcpy(out + sizeof(count), sizes.data(), band_count * sizeof(std::uint32_t));
+	out += header_size;
+
+	for (int band = 0; band < band_count; ++band)
+	{
+		std::memcpy(out, scratch.data() + band * band_max, sizes[band]);
+		out += sizes[band];
+	}
+}
+
+bool decode_image(const std::uint8_t* encoded, std::size_t size, int width, int height, std::uint8_t* image)
+{
+	auto band_count = (height + BAND_ROWS - 1) / BAND_ROWS;
+	auto header_size = (1 + band_count) * sizeof(std::uint32_t);
+
+	if (size < header_size)
+		return false;
+
+	std::uint32_t count;
+	std::memcpy(&count, encoded, sizeof(count));
+
+	if (count != static_cast<std::uint32_t>(band_count))
+		return false;
+
+	std::vector<std::uint32_t>		sizes(band_count);
+	std::vector<std::size_t>		offsets(band_count);
+	std::memcpy(sizes.data(), encoded + sizeof(count), band_count * sizeof(std::uint32_t));
+
+	std::size_t offset = header_size;
+
+	for (int band = 0; band < band_count; ++band)
+	{
+		offsets[band] = offset;
+		offset += sizes[band];
+	}
+
+	if (offset != size)
+		return false;
+
+	tbb::atomic<bool> valid;
+	valid = true;
+
+	tbb::parallel_for(0, band_count, [&](int band)
+	{
+		auto first_row	= band * BAND_ROWS;
+		auto last_row	= std::min(height, first_row + BAND_ROWS);
+
+		if (!decode_band(encoded + offsets[band], sizes[band], width, first_row, last_row, image))
+			valid = false;
+	});
+
+	return valid;
+}
+
+}}
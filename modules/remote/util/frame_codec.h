@@ -0,0 +1,42 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace caspar { namespace remote {
+
+/**
+ * Lossless codec for BGRA frames. The image is cut into bands of rows that
+ * are coded independently, so both directions run in parallel. Each channel
+ * is predicted from its neighbours (left on the first row of a band, median
+ * edge detection below it) and the residuals are bit packed in blocks of 16,
+ * which makes flat graphics and alpha nearly free and natural video roughly
+ * halve.
+ */
+void encode_image(const std::uint8_t* image, int width, int height, std::vector<std::uint8_t>& encoded);
+
+// Returns false if the data is malformed.
+bool decode_image(const std::uint8_t* encoded, std::size_t size, int width, int height, std::uint8_t* image);
+
+}}
@@ -0,0 +1,57 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include <cstdint>
+
+namespace caspar { namespace remote {
+
+const std::uint32_t PACKET_MAGIC		= 0x43475254; // "CGRT"
+const std::uint32_t PROTOCOL_VERSION	= 1;
+
+enum class image_codec : std::uint32_t
+{
+	raw = 0,
+	delta,
+};
+
+#pragma pack(push, 1)
+// Precedes every frame on the wire and is followed by image_size bytes of
+// image, audio_samples 32 bit samples and layout_size bytes of utf-8
+// "type:channel order". Both ends are assumed to be little endian.
+struct packet_header
+{
+	std::uint32_t	magic;
+	std::uint32_t	version;
+	std::int64_t	frame_number;
+	std::uint32_t	width;
+	std::uint32_t	height;
+	std::uint32_t	codec;
+	std::uint32_t	image_size;
+	std::uint32_t	audio_channels;
+	std::uint32_t	audio_samples;
+	std::uint32_t	layout_size;
+	std::uint32_t	timecode_frames;
+	std::uint32_t	timecode_fps;
+};
+#pragma pack(pop)
+
+}}
@@ -36,6 +36,7 @@
 #include <core/frame/draw_frame.h>
 #include <core/frame/frame_factory.h>
 #include <core/video_format.h>
+#include <core/latency.h>
 
 #include <boost/thread/once.hpp>
 #include <boost/lexical_cast.hpp>
@@ -83,6 +84,7 @@ class channel_consumer : public core::frame_consumer
 	tbb::atomic<int64_t>								current_age_;
 	semaphore											frames_available_ { 0 };
 	int													frames_delay_;
+	const bool											low_latency_			= core::get_current_latency_profile() == core::latency_profile::low;
 
 public:
 	channel_consumer(int frames_delay)
@@ -91,7 +93,7 @@ public:
 	{
 		is_running_ = true;
 		current_age_ = 0;
-		frame_buffer_.set_capacity(3 + frames_delay);
+		frame_buffer_.set_capacity((low_latency_ ? 2 : 3) + frames_delay);
 	}
 
 	static int next_consumer_index()
@@ -119,6 +121,14 @@ public:
 
 		if (pushed)
 			frames_available_.release();
+		else if (low_latency_)
+		{
+			// Keep the most recent frames rather than the oldest ones.
+			core::const_frame dummy = core::const_frame::empty();
+
+			frame_buffer_.try_pop(dummy);
+			frame_buffer_.try_push(frame);
+		}
 
 		return make_ready_future(is_running_.load());
 	}
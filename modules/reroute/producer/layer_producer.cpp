@@ -242,6 +242,12 @@ public:
 		return pixel_constraints_;
 	}
 
+	// The frames follow the format of the source channel.
+	bool can_change_video_format(const core::video_format_desc& format_desc) const override
+	{
+		return true;
+	}
+
 	boost::rational<int> current_framerate() const
 	{
 		auto channel = channel_.lock();
@@ -26,9 +26,15 @@
 
 namespace caspar { namespace protocol { namespace amcp {
 
-std::future<std::wstring> AMCPCommand::Execute(const std::vector<channel_context>& channels)
+std::future<std::wstring> AMCPCommand::Execute(const std::vector<channel_context>& channels, bool reply_without_req_id)
 {
-    return command_(ctx_, channels);
+    // Commands may stream their reply straight to the client, but only when
+    // SendReply would have sent it.
+    auto ctx         = ctx_;
+    ctx.request_id   = request_id_;
+    ctx.stream_reply = reply_without_req_id || !request_id_.empty();
+
+    return command_(ctx, channels);
 }
 
 void send_reply(IO::ClientInfoPtrStd client, const std::wstring& str, const std::wstring& request_id)
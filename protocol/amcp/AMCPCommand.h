@@ -48,7 +48,7 @@ class AMCPCommand
 
     typedef std::shared_ptr<AMCPCommand> ptr_type;
 
-    std::future<std::wstring> Execute(const std::vector<channel_context>& channels);
+    std::future<std::wstring> Execute(const std::vector<channel_context>& channels, bool reply_without_req_id);
 
     void SendReply(const std::wstring& str, bool reply_without_req_id) const;
 
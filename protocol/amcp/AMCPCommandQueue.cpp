@@ -45,7 +45,7 @@ exec_cmd(std::shared_ptr<AMCPCommand> cmd, const std::vector<channel_context>& c
             auto name = cmd->name();
             CASPAR_LOG(debug) << "Executing command: " << name;
 
-            auto res = cmd->Execute(channels).share();
+            auto res = cmd->Execute(channels, reply_without_req_id).share();
             return std::async(std::launch::async, [cmd, res, reply_without_req_id, timer, name]() -> bool {
                 cmd->SendReply(res.get(), reply_without_req_id);
 
@@ -31,6 +31,7 @@
 #include "AMCPCommandQueue.h"
 #include "amcp_command_repository.h"
 #include "amcp_args.h"
+#include "amcp_reply_stream.h"
 
 #include <accelerator/ogl/util/device.h>
 
@@ -39,6 +40,7 @@
 #include <common/base64.h>
 #include <common/filesystem.h>
 #include <common/log.h>
+#include <common/memory_accounting.h>
 #include <common/os/filesystem.h>
 #include <common/os/system_info.h>
 #include <common/param.h>
@@ -48,11 +50,14 @@
 #include <core/diagnostics/call_context.h>
 #include <core/diagnostics/osd_graph.h>
 #include <core/frame/audio_channel_layout.h>
+#include <core/frame/color_lut.h>
+#include <core/frame/color_space.h>
 #include <core/frame/frame_transform.h>
 #include <core/help/help_repository.h>
 #include <core/help/help_sink.h>
 #include <core/help/util.h>
 #include <core/mixer/mixer.h>
+#include <core/mixer/audio/audio_delay_line.h>
 #include <core/producer/cg_proxy.h>
 #include <core/producer/frame_producer.h>
 #include <core/producer/color/color_producer.h>
@@ -71,13 +76,13 @@
 #include <cctype>
 #include <fstream>
 #include <future>
+#include <list>
 #include <locale>
+#include <map>
 #include <memory>
+#include <mutex>
 
 #include <boost/algorithm/string.hpp>
-#include <boost/archive/iterators/base64_from_binary.hpp>
-#include <boost/archive/iterators/insert_linebreaks.hpp>
-#include <boost/archive/iterators/transform_width.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
@@ -118,24 +123,142 @@ namespace caspar { namespace protocol { namespace amcp {
 
 using namespace core;
 
-std::wstring read_file_base64(const boost::filesystem::path& file)
+std::string read_file_base64(const boost::filesystem::path& file)
 {
-    using namespace boost::archive::iterators;
-
     boost::filesystem::ifstream filestream(file, std::ios::binary);
 
     if (!filestream)
-        return L"";
+        return "";
 
     auto              length = boost::filesystem::file_size(file);
     std::vector<char> bytes;
     bytes.resize(length);
     filestream.read(bytes.data(), length);
 
-    std::string result(to_base64(bytes.data(), length));
-    return std::wstring(result.begin(), result.end());
+    return to_base64(bytes.data(), length);
 }
 
+// Caches base64 encoded thumbnails keyed by the requested file name, without
+// the line breaks to_base64 inserts so that a thumbnail always fits on one
+// reply line. An entry is valid as long as the resolved file keeps its
+// modification time and size, so a cache hit costs a stat instead of a case
+// insensitive lookup, a read and an encode. The size guards against
+// filesystems with a coarse mtime resolution where a rewrite within the same
+// tick would otherwise go unseen. The file system is never touched while the
+// cache is locked.
+class thumbnail_cache
+{
+    struct entry
+    {
+        std::wstring                       path;
+        std::time_t                        mtime;
+        boost::uintmax_t                   file_size;
+        std::shared_ptr<const std::string> payload;
+    };
+
+    static const std::size_t MAX_SIZE = 64 * 1024 * 1024;
+
+    std::mutex                                                                                         mutex_;
+    std::list<std::wstring>                                                                            lru_;
+    std::map<std::wstring, std::pair<std::shared_ptr<const entry>, std::list<std::wstring>::iterator>> entries_;
+    std::size_t                                                                                        size_ = 0;
+
+  public:
+    static thumbnail_cache& get_instance()
+    {
+        static thumbnail_cache instance;
+
+        return instance;
+    }
+
+    std::shared_ptr<const std::string> get(const std::wstring& filename)
+    {
+        std::shared_ptr<const entry> cached;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+
+            auto found = entries_.find(filename);
+
+            if (found != entries_.end())
+                cached = found->second.first;
+        }
+
+        if (cached) {
+            boost::system::error_code mtime_ec;
+            boost::system::error_code size_ec;
+            auto mtime     = boost::filesystem::last_write_time(cached->path, mtime_ec);
+            auto file_size = boost::filesystem::file_size(cached->path, size_ec);
+
+            if (!mtime_ec && !size_ec && mtime == cached->mtime && file_size == cached->file_size) {
+                std::lock_guard<std::mutex> lock(mutex_);
+
+                auto found = entries_.find(filename);
+
+                if (found != entries_.end() && found->second.first == cached)
+                    lru_.splice(lru_.begin(), lru_, found->second.second);
+
+                return cached->payload;
+            }
+        }
+
+        auto loaded = load(filename);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        auto found = entries_.find(filename);
+
+        if (found != entries_.end())
+            erase(found);
+
+        if (!loaded)
+            return nullptr;
+
+        lru_.push_front(filename);
+        entries_.insert(std::make_pair(filename, std::make_pair(loaded, lru_.begin())));
+        size_ += loaded->payload->size();
+
+        while (size_ > MAX_SIZE && lru_.size() > 1)
+            erase(entries_.find(lru_.back()));
+
+        return loaded->payload;
+    }
+
+  private:
+    static std::shared_ptr<const entry> load(const std::wstring& filename)
+    {
+        auto found_file = find_case_insensitive(filename);
+
+        if (!found_file)
+            return nullptr;
+
+        boost::system::error_code mtime_ec;
+        boost::system::error_code size_ec;
+        auto mtime     = boost::filesystem::last_write_time(*found_file, mtime_ec);
+        auto file_size = boost::filesystem::file_size(*found_file, size_ec);
+
+        if (mtime_ec || size_ec)
+            return nullptr;
+
+        auto payload = read_file_base64(*found_file);
+
+        if (payload.empty())
+            return nullptr;
+
+        boost::erase_all(payload, "\n");
+
+        return std::make_shared<const entry>(
+            entry{*found_file, mtime, file_size, std::make_shared<const std::string>(std::move(payload))});
+    }
+
+    void erase(std::map<std::wstring, std::pair<std::shared_ptr<const entry>, std::list<std::wstring>::iterator>>::iterator it)
+    {
+        size_ -= it->second.first->payload->size();
+        lru_.erase(it->second.second);
+        entries_.erase(it);
+    }
+};
+
 std::wstring read_utf8_file(const boost::filesystem::path& file)
 {
     std::wstringstream           result;
@@ -245,28 +368,19 @@ std::wstring get_sub_directory(const std::wstring& base_folder, const std::wstri
     return *found;
 }
 
-std::wstring ListMedia(const spl::shared_ptr<media_info_repository>& media_info_repo,
-                       const std::wstring&                           sub_directory = L"")
+void ListMedia(std::wostream&                                replyString,
+               const spl::shared_ptr<media_info_repository>& media_info_repo,
+               const std::wstring&                           media_folder)
 {
-    std::wstringstream replyString;
-    for (boost::filesystem::recursive_directory_iterator itr(get_sub_directory(env::media_folder(), sub_directory)),
-         end;
-         itr != end;
-         ++itr)
-        replyString << MediaInfo(itr->path(), media_info_repo);
-
-    return boost::to_upper_copy(replyString.str());
+    for (boost::filesystem::recursive_directory_iterator itr(media_folder), end; itr != end; ++itr)
+        replyString << boost::to_upper_copy(MediaInfo(itr->path(), media_info_repo));
 }
 
-std::wstring ListTemplates(const spl::shared_ptr<core::cg_producer_registry>& cg_registry,
-                           const std::wstring&                                sub_directory = L"")
+void ListTemplates(std::wostream&                                     replyString,
+                   const spl::shared_ptr<core::cg_producer_registry>& cg_registry,
+                   const std::wstring&                                template_folder)
 {
-    std::wstringstream replyString;
-
-    for (boost::filesystem::recursive_directory_iterator itr(get_sub_directory(env::template_folder(), sub_directory)),
-         end;
-         itr != end;
-         ++itr) {
+    for (boost::filesystem::recursive_directory_iterator itr(template_folder), end; itr != end; ++itr) {
         if (boost::filesystem::is_regular_file(itr->path()) &&
             cg_registry->is_cg_extension(itr->path().extension().wstring())) {
             auto relativePath = get_relative_without_extension(itr->path(), env::template_folder());
@@ -297,7 +411,6 @@ std::wstring ListTemplates(const spl::shared_ptr<core::cg_producer_registry>& cg
                         << L"\r\n";
         }
     }
-    return replyString.str();
 }
 
 std::vector<spl::shared_ptr<core::video_channel>> get_channels(const command_context& ctx)
@@ -749,6 +862,29 @@ std::wstring swap_command(command_context& ctx)
     return L"202 SWAP OK\r\n";
 }
 
+// Takes an optional VIDEO_MODE [mode] out of the parameters of a consumer,
+// which then runs at that format instead of the format of the channel.
+boost::optional<core::video_format_desc> take_consumer_video_mode(command_context& ctx)
+{
+    auto it = std::find_if(ctx.parameters.begin(), ctx.parameters.end(), [](const std::wstring& param) {
+        return boost::iequals(param, L"VIDEO_MODE");
+    });
+
+    if (it == ctx.parameters.end())
+        return boost::none;
+
+    if (it + 1 == ctx.parameters.end())
+        CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"VIDEO_MODE requires a video mode"));
+
+    auto format_desc = ctx.static_context->format_repository.find(*(it + 1));
+    if (format_desc.format == core::video_format::invalid)
+        CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Invalid video mode: " + *(it + 1)));
+
+    ctx.parameters.erase(it, it + 2);
+
+    return format_desc;
+}
+
 void add_describer(core::help_sink& sink, const core::help_repository& repo)
 {
     sink.short_description(L"Add a consumer to a video channel.");
@@ -769,6 +905,11 @@ void add_describer(core::help_sink& sink, const core::help_repository& repo)
         ->text(L" overrides the index that the consumer itself decides and can later be used with the ")
         ->see(L"REMOVE")
         ->text(L" command to remove the consumer.");
+    sink.para()
+        ->text(L"A consumer given ")
+        ->code(L"VIDEO_MODE [mode:string]")
+        ->text(L" runs at that progressive video mode instead of the mode of the channel. Frames are rescaled, ")
+        ->text(L"dropped or repeated and the audio resliced by an adapter shared by the consumers of the channel with the same mode.");
     sink.para()->text(L"Examples:");
     sink.example(L">> ADD 1 DECKLINK 1");
     sink.example(L">> ADD 1 BLUEFISH 2");
@@ -778,6 +919,8 @@ void add_describer(core::help_sink& sink, const core::help_repository& repo)
     sink.example(L">> ADD 2 SYNCTO 1");
     sink.example(L">> ADD 1 FILE filename.mov");
     sink.example(L">> ADD 1 FILE filename.mov SEPARATE_KEY");
+    sink.example(L">> ADD 1 STREAM udp://localhost:5004 -format mpegts VIDEO_MODE 720p2500",
+                 L"for streaming a 1080p5000 channel at 720p2500.");
     sink.example(L">> ADD 1-700 FILE filename.mov SEPARATE_KEY\n"
                  L">> REMOVE 1-700",
                  L"overriding the consumer index to easier remove later.");
@@ -794,9 +937,14 @@ std::wstring add_command(command_context& ctx)
     core::diagnostics::scoped_call_context save;
     core::diagnostics::call_context::for_thread().video_channel = ctx.channel_index + 1;
 
-    auto consumer = ctx.static_context->consumer_registry->create_consumer(
+    auto video_mode = take_consumer_video_mode(ctx);
+    auto consumer   = ctx.static_context->consumer_registry->create_consumer(
         ctx.parameters, ctx.channel.stage.get(), get_channels(ctx));
-    ctx.channel.raw_channel->output().add(ctx.layer_index(consumer->index()), consumer);
+
+    if (video_mode)
+        ctx.channel.raw_channel->output().add(ctx.layer_index(consumer->index()), consumer, *video_mode);
+    else
+        ctx.channel.raw_channel->output().add(ctx.layer_index(consumer->index()), consumer);
 
     return L"202 ADD OK\r\n";
 }
@@ -827,6 +975,7 @@ std::wstring remove_command(command_context& ctx)
 
     if (index == std::numeric_limits<int>::min()) {
         replace_placeholders(L"<CLIENT_IP_ADDRESS>", ctx.client->address(), ctx.parameters);
+        take_consumer_video_mode(ctx);
 
         index = ctx.static_context->consumer_registry
                     ->create_consumer(ctx.parameters, ctx.channel.stage.get(), get_channels(ctx))
@@ -838,6 +987,58 @@ std::wstring remove_command(command_context& ctx)
     return L"202 REMOVE OK\r\n";
 }
 
+void syncoffset_describer(core::help_sink& sink, const core::help_repository& repo)
+{
+    sink.short_description(L"Shift the audio of a consumer against its video.");
+    sink.syntax(L"SYNCOFFSET [video_channel:int]-[consumer_index:int] {[offset:float]}");
+    sink.para()
+        ->text(L"Compensates for lip-sync errors in devices downstream of the consumer with index ")
+        ->code(L"consumer_index")
+        ->text(L". The offset is given in milliseconds, see ")
+        ->see(L"MIXER SYNCOFFSET")
+        ->text(L" for how positive and negative offsets are applied.");
+    sink.para()->text(L"Retrieves the current offset if no argument is given.");
+    sink.para()->text(L"Examples:");
+    sink.example(L">> SYNCOFFSET 1-300 -40", L"for playing the audio of consumer 300 40 ms ahead of the video");
+    sink.example(L">> SYNCOFFSET 1-300\n"
+                 L"<< 201 SYNCOFFSET OK\n"
+                 L"<< -40");
+}
+
+double parse_sync_offset(const std::wstring& param)
+{
+    auto offset = boost::lexical_cast<double>(param);
+
+    if (std::abs(offset) > core::MAX_SYNC_OFFSET_MILLIS)
+        CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Sync offset must be between -2000 and 2000 ms"));
+
+    return offset;
+}
+
+std::wstring syncoffset_command(command_context& ctx)
+{
+    auto index = ctx.layer_index(std::numeric_limits<int>::min());
+
+    if (index == std::numeric_limits<int>::min())
+        CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"No consumer index given"));
+
+    if (ctx.parameters.empty()) {
+        auto offset = ctx.channel.raw_channel->output().get_sync_offset(index);
+
+        if (!offset)
+            CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"No consumer with index " + boost::lexical_cast<std::wstring>(index)));
+
+        return L"201 SYNCOFFSET OK\r\n" + boost::lexical_cast<std::wstring>(*offset) + L"\r\n";
+    }
+
+    auto offset = parse_sync_offset(ctx.parameters.at(0));
+
+    if (!ctx.channel.raw_channel->output().set_sync_offset(index, offset))
+        CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"No consumer with index " + boost::lexical_cast<std::wstring>(index)));
+
+    return L"202 SYNCOFFSET OK\r\n";
+}
+
 void print_describer(core::help_sink& sink, const core::help_repository& repo)
 {
     sink.short_description(L"Take a snapshot of a channel.");
@@ -902,6 +1103,8 @@ void set_describer(core::help_sink& sink, const core::help_repository& repo)
     sink.definitions()
         ->item(L"MODE", L"Changes the video format of the channel.")
         ->item(L"CHANNEL_LAYOUT", L"Changes the audio channel layout of the video channel channel.");
+    sink.para()->text(L"Loaded layers are kept when the video mode or channel layout changes. Producers adapt to the new format while frames already produced are played out.");
+    sink.para()->text(L"Only ffmpeg, image, color and producer host layers can follow a new video mode, and ffmpeg layers only if the audio sample rate stays the same. MODE fails while other producers are loaded, clear or reload those layers first.");
     sink.para()->text(L"Examples:");
     sink.example(L">> SET 1 MODE PAL", L"changes the video mode on channel 1 to PAL.");
     sink.example(L">> SET 1 CHANNEL_LAYOUT smpte", L"changes the audio channel layout on channel 1 to smpte.");
@@ -1647,6 +1850,149 @@ std::future<std::wstring> mixer_blend_command(command_context& ctx)
     return make_ready_future<std::wstring>(L"202 MIXER OK\r\n");
 }
 
+void mixer_colorspace_describer(core::help_sink& sink, const core::help_repository& repo)
+{
+    sink.short_description(L"Override the colour space of a layer.");
+    sink.syntax(L"MIXER [video_channel:int]{-[layer:int]|-0} COLORSPACE {[space:string] {[transfer:string]}}");
+    sink.para()
+        ->text(L"Sets the colour space and transfer function of the layer, replacing what the producer reports. ")
+        ->text(L"Use it for files with missing or wrong metadata. ")
+        ->code(L"auto")
+        ->text(L" goes back to the producer value and a transfer function that is left out is kept. ")
+        ->text(L"If no argument is given the current override is returned.");
+    sink.para()
+        ->text(L"Supported spaces are ")
+        ->code(L"bt601")->text(L", ")->code(L"bt709")->text(L" and ")->code(L"bt2020")
+        ->text(L", supported transfer functions ")
+        ->code(L"sdr")->text(L", ")->code(L"pq")->text(L" and ")->code(L"hlg")->text(L".");
+    sink.para()
+        ->text(L"The cpu accelerator converts layers to the colour space of the channel, see ")
+        ->code(L"color-space")
+        ->text(L" and ")
+        ->code(L"color-transfer")
+        ->text(L" in the channel configuration. ")
+        ->text(L"The conversion is costly, about 90 ms per 3840x2160 16-bit layer and core with AVX2 and 380 ms without, ")
+        ->text(L"split over the cores of the machine. ")
+        ->text(L"The ycbcr matrix of the space is only applied by the cpu accelerator when ")
+        ->code(L"color-space")
+        ->text(L" is set for the channel, otherwise BT.601 is used for all formats as before.");
+    sink.para()->text(L"The ogl accelerator ignores the colour space of layers.");
+    sink.para()->text(L"Examples:");
+    sink.example(L">> MIXER 1-1 COLORSPACE BT2020 PQ");
+    sink.example(L">> MIXER 1-1 COLORSPACE AUTO AUTO", L"for using the producer values again");
+    sink.example(L">> MIXER 1-1 COLORSPACE\n"
+                 L"<< 201 MIXER OK\n"
+                 L"<< bt2020 pq",
+                 L"for getting the current override");
+}
+
+std::future<std::wstring> mixer_colorspace_command(command_context& ctx)
+{
+    if (ctx.parameters.empty())
+        return reply_value(ctx, [](const frame_transform& t) {
+            return get_color_space(t.image_transform.color_space) + L" " +
+                   get_color_transfer(t.image_transform.color_transfer);
+        });
+
+    auto space = get_color_space(ctx.parameters.at(0));
+
+    if (space == color_space::unspecified && !boost::iequals(ctx.parameters.at(0), L"auto"))
+        CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Invalid color space " + ctx.parameters.at(0)));
+
+    bool set_transfer = ctx.parameters.size() > 1;
+    auto transfer     = set_transfer ? get_color_transfer(ctx.parameters.at(1)) : color_transfer::unspecified;
+
+    if (set_transfer && transfer == color_transfer::unspecified && !boost::iequals(ctx.parameters.at(1), L"auto"))
+        CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Invalid color transfer " + ctx.parameters.at(1)));
+
+    transforms_applier transforms(ctx);
+    transforms.add(stage::transform_tuple_t(ctx.layer_index(),
+                                            [=](frame_transform transform) -> frame_transform {
+                                                transform.image_transform.color_space = space;
+
+                                                if (set_transfer)
+                                                    transform.image_transform.color_transfer = transfer;
+
+                                                return transform;
+                                            },
+                                            0,
+                                            tweener(L"linear")));
+    transforms.apply();
+
+    return make_ready_future<std::wstring>(L"202 MIXER OK\r\n");
+}
+
+void mixer_lut_describer(core::help_sink& sink, const core::help_repository& repo)
+{
+    sink.short_description(L"Grade a layer with a 3D lookup table.");
+    sink.syntax(L"MIXER [video_channel:int]{-[layer:int]|-0} LUT {[file:string]|NONE {[mix:float]|1.0}" +
+                ANIMATION_SYNTAX);
+    sink.para()
+        ->text(L"Grades the layer through a ")
+        ->code(L".cube")
+        ->text(L" 3D lookup table in the media folder, with 17, 33 or 65 points being the usual sizes. ")
+        ->text(L"The file extension may be left out. ")
+        ->code(L"mix")
+        ->text(L" weighs the graded image against the original and a duration crossfades from the current grade. ")
+        ->code(L"NONE")
+        ->text(L" removes the grade. If no argument is given the current table and mix are returned.");
+    sink.para()->text(L"Tables are loaded once and shared between layers, a changed file is read again on the next "
+                      L"command. Only the cpu accelerator applies the grade, the command fails on the ogl accelerator.");
+    sink.para()->text(L"Grading is costly on the cpu. Per layer and core with AVX2 a 33 point table takes about 23 ms "
+                      L"at 1080p and 93 ms at 2160p in 16-bit, a 65 point table 73 ms and 295 ms. Without AVX2 it "
+                      L"is about 150 ms at 1080p and 550 ms at 2160p. The work is split over the cores of the "
+                      L"machine, but a 65 point table on 2160p layers will not keep up with the frame rate.");
+    sink.para()->text(L"Examples:");
+    sink.example(L">> MIXER 1-1 LUT grades/teal_orange");
+    sink.example(L">> MIXER 1-1 LUT grades/day_for_night 0.8 50 easeinsine",
+                 L"for crossfading to another table over 50 frames");
+    sink.example(L">> MIXER 1-1 LUT NONE 25", L"for fading the grade out");
+    sink.example(L">> MIXER 1-1 LUT\n"
+                 L"<< 201 MIXER OK\n"
+                 L"<< grades/teal_orange 1",
+                 L"for getting the current grade");
+}
+
+std::future<std::wstring> mixer_lut_command(command_context& ctx)
+{
+    if (ctx.parameters.empty())
+        return reply_value(ctx, [](const frame_transform& t) {
+            const auto& grade = t.image_transform.grade;
+            return grade.lut ? grade.lut->name + L" " + boost::lexical_cast<std::wstring>(grade.mix) : L"NONE";
+        });
+
+    std::shared_ptr<const color_lut> lut;
+
+    if (!boost::iequals(ctx.parameters.at(0), L"NONE")) {
+        if (!ctx.channel.raw_channel->mixer().supports_color_grading())
+            CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"LUT grades need the cpu accelerator"));
+
+        lut = load_color_lut(ctx.parameters.at(0));
+    }
+
+    auto mix      = ctx.parameters.size() > 1 ? boost::lexical_cast<double>(ctx.parameters.at(1)) : 1.0;
+    int  duration = ctx.parameters.size() > 2 ? boost::lexical_cast<int>(ctx.parameters.at(2)) : 0;
+    auto tween    = ctx.parameters.size() > 3 ? ctx.parameters.at(3) : L"linear";
+
+    transforms_applier transforms(ctx);
+    transforms.add(stage::transform_tuple_t(ctx.layer_index(),
+                                            [=](frame_transform transform) -> frame_transform {
+                                                auto& grade = transform.image_transform.grade;
+
+                                                grade.lut      = lut;
+                                                grade.mix      = mix;
+                                                grade.from     = nullptr;
+                                                grade.from_mix = 0.0;
+
+                                                return transform;
+                                            },
+                                            duration,
+                                            tween));
+    transforms.apply();
+
+    return make_ready_future<std::wstring>(L"202 MIXER OK\r\n");
+}
+
 template <typename Getter, typename Setter>
 std::future<std::wstring>
 single_double_animatable_mixer_command(command_context& ctx, const Getter& getter, const Setter& setter)
@@ -2268,6 +2614,42 @@ std::future<std::wstring> mixer_volume_command(command_context& ctx)
         [](frame_transform& t, double value) { t.audio_transform.volume = value; });
 }
 
+void mixer_syncoffset_describer(core::help_sink& sink, const core::help_repository& repo)
+{
+    sink.short_description(L"Shift the audio of a layer against its video.");
+    sink.syntax(L"MIXER [video_channel:int]{-[layer:int]|-0} SYNCOFFSET {[offset:float]}");
+    sink.para()
+        ->text(L"Corrects lip-sync errors in the source of the specified layer. The offset is given in ")
+        ->text(L"milliseconds (at most 2000), a positive offset delays the audio and a negative offset delays the video ")
+        ->text(L"by whole frames and the audio by the remainder. Changes crossfade over one frame.");
+    sink.para()->text(L"Retrieves the current offset if no argument is given.");
+    sink.para()->text(L"Examples:");
+    sink.example(L">> MIXER 1-10 SYNCOFFSET 40", L"for delaying the audio by 40 ms");
+    sink.example(L">> MIXER 1-10 SYNCOFFSET -20", L"for playing the audio 20 ms ahead of the video");
+    sink.example(L">> MIXER 1-10 SYNCOFFSET\n"
+                 L"<< 201 MIXER OK\n"
+                 L"<< 40");
+}
+
+std::future<std::wstring> mixer_syncoffset_command(command_context& ctx)
+{
+    if (ctx.parameters.empty())
+        return reply_value(ctx, [](const frame_transform& t) { return t.audio_transform.sync_offset; });
+
+    transforms_applier transforms(ctx);
+    auto               value = parse_sync_offset(ctx.parameters.at(0));
+    transforms.add(stage::transform_tuple_t(ctx.layer_index(),
+                                            [=](frame_transform transform) -> frame_transform {
+                                                transform.audio_transform.sync_offset = value;
+                                                return transform;
+                                            },
+                                            0,
+                                            tweener(L"linear")));
+    transforms.apply();
+
+    return make_ready_future<std::wstring>(L"202 MIXER OK\r\n");
+}
+
 void mixer_mastervolume_describer(core::help_sink& sink, const core::help_repository& repo)
 {
     sink.short_description(L"Change the volume of an entire channel.");
@@ -2319,6 +2701,194 @@ std::wstring mixer_straight_alpha_command(command_context& ctx)
     return L"202 MIXER OK\r\n";
 }
 
+core::audio_dynamics parse_compressor(const std::vector<std::wstring>& params)
+{
+    if (boost::iequals(params.at(0), L"OFF"))
+        return core::audio_dynamics();
+
+    if (params.size() < 2)
+        CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"COMPRESSOR requires a threshold and a ratio"));
+
+    auto param = [&](size_t index, double default_value) {
+        return params.size() > index ? boost::lexical_cast<double>(params.at(index)) : default_value;
+    };
+
+    return core::audio_dynamics::compressor(
+        param(0, 0.0), param(1, 1.0), param(2, 5.0), param(3, 100.0), param(4, 0.0));
+}
+
+core::audio_dynamics parse_limiter(const std::vector<std::wstring>& params)
+{
+    if (boost::iequals(params.at(0), L"OFF"))
+        return core::audio_dynamics();
+
+    auto param = [&](size_t index, double default_value) {
+        return params.size() > index ? boost::lexical_cast<double>(params.at(index)) : default_value;
+    };
+
+    return core::audio_dynamics::limiter(param(0, 0.0), param(1, 50.0), param(2, 5.0));
+}
+
+std::wstring print_compressor(const core::audio_dynamics& dynamics)
+{
+    if (!dynamics.enabled)
+        return L"OFF";
+
+    return boost::lexical_cast<std::wstring>(dynamics.threshold) + L" " +
+           boost::lexical_cast<std::wstring>(dynamics.ratio) + L" " +
+           boost::lexical_cast<std::wstring>(dynamics.attack) + L" " +
+           boost::lexical_cast<std::wstring>(dynamics.release) + L" " +
+           boost::lexical_cast<std::wstring>(dynamics.makeup);
+}
+
+std::wstring print_limiter(const core::audio_dynamics& dynamics)
+{
+    if (!dynamics.enabled)
+        return L"OFF";
+
+    return boost::lexical_cast<std::wstring>(dynamics.threshold) + L" " +
+           boost::lexical_cast<std::wstring>(dynamics.release) + L" " +
+           boost::lexical_cast<std::wstring>(dynamics.lookahead);
+}
+
+void mixer_compressor_describer(core::help_sink& sink, const core::help_repository& repo)
+{
+    sink.short_description(L"Compress the audio of a layer.");
+    sink.syntax(L"MIXER [video_channel:int]{-[layer:int]|-0} COMPRESSOR {[threshold:float] [ratio:float] "
+                L"{[attack:float] {[release:float] {[makeup:float]}}}|OFF}");
+    sink.para()
+        ->text(L"Applies a channel linked peak compressor to the audio of the specified layer. ")
+        ->text(L"The threshold and makeup gain are given in dBFS/dB, attack and release in milliseconds ")
+        ->text(L"(defaults 5 and 100). Gain changes are applied per sample.");
+    sink.para()
+        ->text(L"The gain reduction is reported over OSC at ")
+        ->code(L"/channel/[video_channel]/mixer/audio/layer/[layer]/gain_reduction")
+        ->text(L" in dB.");
+    sink.para()->text(L"Retrieves the current settings if no argument is given.");
+    sink.para()->text(L"Examples:");
+    sink.example(L">> MIXER 1-10 COMPRESSOR -18 4", L"for a 4:1 compressor above -18 dBFS");
+    sink.example(L">> MIXER 1-10 COMPRESSOR -24 3 10 200 6", L"with slower timing and 6 dB makeup gain");
+    sink.example(L">> MIXER 1-10 COMPRESSOR OFF");
+    sink.example(L">> MIXER 1-10 COMPRESSOR\n"
+                 L"<< 201 MIXER OK\n"
+                 L"<< -18 4 5 100 0");
+}
+
+std::future<std::wstring> mixer_compressor_command(command_context& ctx)
+{
+    if (ctx.parameters.empty())
+        return reply_value(ctx, [](const frame_transform& t) { return print_compressor(t.audio_transform.compressor); });
+
+    transforms_applier transforms(ctx);
+    auto               value = parse_compressor(ctx.parameters);
+    transforms.add(stage::transform_tuple_t(ctx.layer_index(),
+                                            [=](frame_transform transform) -> frame_transform {
+                                                transform.audio_transform.compressor = value;
+                                                return transform;
+                                            },
+                                            0,
+                                            tweener(L"linear")));
+    transforms.apply();
+
+    return make_ready_future<std::wstring>(L"202 MIXER OK\r\n");
+}
+
+void mixer_limiter_describer(core::help_sink& sink, const core::help_repository& repo)
+{
+    sink.short_description(L"Limit the audio of a layer.");
+    sink.syntax(L"MIXER [video_channel:int]{-[layer:int]|-0} LIMITER {[ceiling:float] {[release:float] "
+                L"{[lookahead:float]}}|OFF}");
+    sink.para()
+        ->text(L"Applies a channel linked look-ahead peak limiter to the audio of the specified layer. ")
+        ->text(L"The ceiling is given in dBFS, release and lookahead in milliseconds (defaults 50 and 5). ")
+        ->text(L"Samples never exceed the ceiling. The audio of the layer is delayed by the lookahead.");
+    sink.para()
+        ->text(L"The gain reduction is reported over OSC at ")
+        ->code(L"/channel/[video_channel]/mixer/audio/layer/[layer]/gain_reduction")
+        ->text(L" in dB.");
+    sink.para()->text(L"Retrieves the current settings if no argument is given.");
+    sink.para()->text(L"Examples:");
+    sink.example(L">> MIXER 1-10 LIMITER -1", L"for a -1 dBFS ceiling");
+    sink.example(L">> MIXER 1-10 LIMITER -1 100 0", L"for a limiter without added latency");
+    sink.example(L">> MIXER 1-10 LIMITER OFF");
+}
+
+std::future<std::wstring> mixer_limiter_command(command_context& ctx)
+{
+    if (ctx.parameters.empty())
+        return reply_value(ctx, [](const frame_transform& t) { return print_limiter(t.audio_transform.limiter); });
+
+    transforms_applier transforms(ctx);
+    auto               value = parse_limiter(ctx.parameters);
+    transforms.add(stage::transform_tuple_t(ctx.layer_index(),
+                                            [=](frame_transform transform) -> frame_transform {
+                                                transform.audio_transform.limiter = value;
+                                                return transform;
+                                            },
+                                            0,
+                                            tweener(L"linear")));
+    transforms.apply();
+
+    return make_ready_future<std::wstring>(L"202 MIXER OK\r\n");
+}
+
+void mixer_mastercompressor_describer(core::help_sink& sink, const core::help_repository& repo)
+{
+    sink.short_description(L"Compress the audio of an entire channel.");
+    sink.syntax(L"MIXER [video_channel:int] MASTERCOMPRESSOR {[threshold:float] [ratio:float] "
+                L"{[attack:float] {[release:float] {[makeup:float]}}}|OFF}");
+    sink.para()
+        ->text(L"Same as ")
+        ->see(L"MIXER COMPRESSOR")
+        ->text(L" but applied to the mixed output of the channel, after the master volume. ")
+        ->text(L"The gain reduction is reported over OSC at ")
+        ->code(L"/channel/[video_channel]/mixer/audio/master/gain_reduction")
+        ->text(L".");
+    sink.para()->text(L"Examples:");
+    sink.example(L">> MIXER 1 MASTERCOMPRESSOR -12 2");
+    sink.example(L">> MIXER 1 MASTERCOMPRESSOR OFF");
+}
+
+std::wstring mixer_mastercompressor_command(command_context& ctx)
+{
+    if (ctx.parameters.empty()) {
+        auto dynamics = ctx.channel.raw_channel->mixer().get_master_compressor();
+        return L"201 MIXER OK\r\n" + print_compressor(dynamics) + L"\r\n";
+    }
+
+    ctx.channel.raw_channel->mixer().set_master_compressor(parse_compressor(ctx.parameters));
+
+    return L"202 MIXER OK\r\n";
+}
+
+void mixer_masterlimiter_describer(core::help_sink& sink, const core::help_repository& repo)
+{
+    sink.short_description(L"Limit the audio of an entire channel.");
+    sink.syntax(L"MIXER [video_channel:int] MASTERLIMITER {[ceiling:float] {[release:float] {[lookahead:float]}}|OFF}");
+    sink.para()
+        ->text(L"Same as ")
+        ->see(L"MIXER LIMITER")
+        ->text(L" but applied to the mixed output of the channel, after the master compressor. ")
+        ->text(L"The gain reduction is reported over OSC at ")
+        ->code(L"/channel/[video_channel]/mixer/audio/master/gain_reduction")
+        ->text(L".");
+    sink.para()->text(L"Examples:");
+    sink.example(L">> MIXER 1 MASTERLIMITER -1", L"to make sure the channel output never clips");
+    sink.example(L">> MIXER 1 MASTERLIMITER OFF");
+}
+
+std::wstring mixer_masterlimiter_command(command_context& ctx)
+{
+    if (ctx.parameters.empty()) {
+        auto dynamics = ctx.channel.raw_channel->mixer().get_master_limiter();
+        return L"201 MIXER OK\r\n" + print_limiter(dynamics) + L"\r\n";
+    }
+
+    ctx.channel.raw_channel->mixer().set_master_limiter(parse_limiter(ctx.parameters));
+
+    return L"202 MIXER OK\r\n";
+}
+
 void mixer_grid_describer(core::help_sink& sink, const core::help_repository& repo)
 {
     sink.short_description(L"Create a grid of video layers.");
@@ -2524,28 +3094,65 @@ void thumbnail_retrieve_describer(core::help_sink& sink, const core::help_reposi
                  L"<< ...base64 data...");
 }
 
+std::shared_ptr<const std::string> retrieve_thumbnail(const std::wstring& name)
+{
+    return thumbnail_cache::get_instance().get(env::thumbnail_folder() + name + L".png");
+}
+
 std::wstring thumbnail_retrieve_command(command_context& ctx)
 {
-    std::wstring filename = env::thumbnail_folder();
-    filename.append(ctx.parameters.at(0));
-    filename.append(L".png");
+    auto payload = retrieve_thumbnail(ctx.parameters.at(0));
 
-    std::wstring file_contents;
+    if (!payload)
+        CASPAR_THROW_EXCEPTION(file_not_found() << msg_info(env::thumbnail_folder() + ctx.parameters.at(0) +
+                                                            L".png not found"));
 
-    auto found_file = find_case_insensitive(filename);
+    reply_stream reply(ctx);
+    reply << L"201 THUMBNAIL RETRIEVE OK\r\n";
+    reply.write_utf8(*payload);
+    reply << L"\r\n";
 
-    if (found_file)
-        file_contents = read_file_base64(boost::filesystem::path(*found_file));
+    return reply.finish();
+}
 
-    if (file_contents.empty())
-        CASPAR_THROW_EXCEPTION(file_not_found() << msg_info(filename + L" not found"));
+void thumbnail_retrieve_multiple_describer(core::help_sink& sink, const core::help_repository& repo)
+{
+    sink.short_description(L"Retrieve several thumbnails.");
+    sink.syntax(L"THUMBNAIL RETRIEVE_MULTIPLE [filename:string] {[filename:string]...}");
+    sink.para()->text(L"Retrieves thumbnails as base64 encoded PNG-images.");
+    sink.para()->text(L"Every thumbnail found is returned on a line of its own, prefixed by its quoted file name. ")
+        ->text(L"Thumbnails not found are left out of the reply.");
+    sink.para()->text(L"Examples:");
+    sink.example(L">> THUMBNAIL RETRIEVE_MULTIPLE foo/bar foo/baz\n"
+                 L"<< 200 THUMBNAIL RETRIEVE_MULTIPLE OK\n"
+                 L"<< \"foo/bar\" ...base64 data...\n"
+                 L"<< \"foo/baz\" ...base64 data...\n"
+                 L"<<");
+}
 
-    std::wstringstream reply;
+std::wstring thumbnail_retrieve_multiple_command(command_context& ctx)
+{
+    std::vector<std::pair<std::wstring, std::shared_ptr<const std::string>>> payloads;
+
+    for (auto& name : ctx.parameters) {
+        auto payload = retrieve_thumbnail(name);
+
+        if (payload)
+            payloads.push_back(std::make_pair(name, payload));
+    }
+
+    reply_stream reply(ctx);
+    reply << L"200 THUMBNAIL RETRIEVE_MULTIPLE OK\r\n";
+
+    for (auto& payload : payloads) {
+        reply << L"\"" << payload.first << L"\" ";
+        reply.write_utf8(*payload.second);
+        reply << L"\r\n";
+    }
 
-    reply << L"201 THUMBNAIL RETRIEVE OK\r\n";
-    reply << file_contents;
     reply << L"\r\n";
-    return reply.str();
+
+    return reply.finish();
 }
 
 void thumbnail_generate_describer(core::help_sink& sink, const core::help_repository& repo)
@@ -2635,11 +3242,13 @@ std::wstring cls_command(command_context& ctx)
     if (!ctx.parameters.empty())
         sub_directory = ctx.parameters.at(0);
 
-    std::wstringstream replyString;
+    auto media_folder = get_sub_directory(env::media_folder(), sub_directory);
+
+    reply_stream replyString(ctx);
     replyString << L"200 CLS OK\r\n";
-    replyString << ListMedia(ctx.static_context->media_info_repo, sub_directory);
+    ListMedia(replyString, ctx.static_context->media_info_repo, media_folder);
     replyString << L"\r\n";
-    return boost::to_upper_copy(replyString.str());
+    return replyString.finish();
 }
 
 void fls_describer(core::help_sink& sink, const core::help_repository& repo)
@@ -2659,16 +3268,18 @@ void fls_describer(core::help_sink& sink, const core::help_repository& repo)
 
 std::wstring fls_command(command_context& ctx)
 {
-    std::wstringstream replyString;
+    auto fonts = core::text::list_fonts();
+
+    reply_stream replyString(ctx);
     replyString << L"200 FLS OK\r\n";
 
-    for (auto& font : core::text::list_fonts())
+    for (auto& font : fonts)
         replyString << L"\"" << font.first << L"\" \"" << get_relative(font.second, env::font_folder()).wstring()
                     << L"\"\r\n";
 
     replyString << L"\r\n";
 
-    return replyString.str();
+    return replyString.finish();
 }
 
 void tls_describer(core::help_sink& sink, const core::help_repository& repo)
@@ -2696,13 +3307,15 @@ std::wstring tls_command(command_context& ctx)
     if (!ctx.parameters.empty())
         sub_directory = ctx.parameters.at(0);
 
-    std::wstringstream replyString;
+    auto template_folder = get_sub_directory(env::template_folder(), sub_directory);
+
+    reply_stream replyString(ctx);
     replyString << L"200 TLS OK\r\n";
 
-    replyString << ListTemplates(ctx.static_context->cg_registry, sub_directory);
+    ListTemplates(replyString, ctx.static_context->cg_registry, template_folder);
     replyString << L"\r\n";
 
-    return replyString.str();
+    return replyString.finish();
 }
 
 void version_describer(core::help_sink& sink, const core::help_repository& repo)
@@ -2752,18 +3365,19 @@ void info_describer(core::help_sink& sink, const core::help_repository& repo)
 
 std::wstring info_command(command_context& ctx)
 {
-    std::wstringstream replyString;
+    reply_stream replyString(ctx);
     // This is needed for backwards compatibility with old clients
     replyString << L"200 INFO OK\r\n";
     for (size_t n = 0; n < ctx.channels.size(); ++n)
         replyString << n + 1 << L" " << ctx.channels.at(n).raw_channel->video_format_desc().name << L" PLAYING\r\n";
     replyString << L"\r\n";
-    return replyString.str();
+    return replyString.finish();
 }
 
-std::wstring create_info_xml_reply(const boost::property_tree::wptree& info, std::wstring command = L"")
+std::wstring
+create_info_xml_reply(const command_context& ctx, const boost::property_tree::wptree& info, std::wstring command = L"")
 {
-    std::wstringstream replyString;
+    reply_stream replyString(ctx);
 
     if (command.empty())
         replyString << L"201 INFO OK\r\n";
@@ -2773,7 +3387,7 @@ std::wstring create_info_xml_reply(const boost::property_tree::wptree& info, std
     boost::property_tree::xml_writer_settings<std::wstring> w(' ', 3);
     boost::property_tree::xml_parser::write_xml(replyString, info, w);
     replyString << L"\r\n";
-    return replyString.str();
+    return replyString.finish();
 }
 
 void info_channel_describer(core::help_sink& sink, const core::help_repository& repo)
@@ -2791,7 +3405,7 @@ std::future<std::wstring> info_channel_command(command_context& ctx)
     if (layer == std::numeric_limits<int>::min()) {
         boost::property_tree::wptree info;
         info.add_child(L"channel", ctx.channel.raw_channel->info()).add(L"index", ctx.channel_index);
-        return make_ready_future(create_info_xml_reply(info));
+        return make_ready_future(create_info_xml_reply(ctx, info));
     } else {
         if (ctx.parameters.size() >= 1) {
             std::shared_future<std::shared_ptr<frame_producer>> producer;
@@ -2801,20 +3415,20 @@ std::future<std::wstring> info_channel_command(command_context& ctx)
             else
                 producer = ctx.channel.stage->foreground(layer).share();
 
-            return std::async(std::launch::deferred, [producer]() -> std::wstring {
+            return std::async(std::launch::deferred, [ctx, producer]() -> std::wstring {
                 boost::property_tree::wptree info;
                 info.add_child(L"producer", producer.get()->info());
 
-                return create_info_xml_reply(info);
+                return create_info_xml_reply(ctx, info);
             });
         } else {
             auto linfo = ctx.channel.stage->info(layer).share();
 
-            return std::async(std::launch::deferred, [linfo, layer]() -> std::wstring {
+            return std::async(std::launch::deferred, [ctx, linfo, layer]() -> std::wstring {
                 boost::property_tree::wptree info;
                 info.add_child(L"layer", linfo.get()).add(L"index", layer);
 
-                return create_info_xml_reply(info);
+                return create_info_xml_reply(ctx, info);
             });
         }
     }
@@ -2837,7 +3451,7 @@ std::wstring info_template_command(command_context& ctx)
     boost::property_tree::xml_parser::read_xml(
         str, info, boost::property_tree::xml_parser::trim_whitespace | boost::property_tree::xml_parser::no_comments);
 
-    return create_info_xml_reply(info, L"TEMPLATE");
+    return create_info_xml_reply(ctx, info, L"TEMPLATE");
 }
 
 void info_config_describer(core::help_sink& sink, const core::help_repository& repo)
@@ -2849,7 +3463,7 @@ void info_config_describer(core::help_sink& sink, const core::help_repository& r
 
 std::wstring info_config_command(command_context& ctx)
 {
-    return create_info_xml_reply(caspar::env::properties(), L"CONFIG");
+    return create_info_xml_reply(ctx, caspar::env::properties(), L"CONFIG");
 }
 
 void info_paths_describer(core::help_sink& sink, const core::help_repository& repo)
@@ -2871,7 +3485,7 @@ std::wstring info_paths_command(command_context& ctx)
     info.add(L"paths.font-path", caspar::env::font_folder());
     info.add(L"paths.initial-path", caspar::env::initial_folder() + L"/");
 
-    return create_info_xml_reply(info, L"PATHS");
+    return create_info_xml_reply(ctx, info, L"PATHS");
 }
 
 void info_system_describer(core::help_sink& sink, const core::help_repository& repo)
@@ -2891,7 +3505,7 @@ std::wstring info_system_command(command_context& ctx)
 
     ctx.static_context->system_info_provider_repo->fill_information(info);
 
-    return create_info_xml_reply(info, L"SYSTEM");
+    return create_info_xml_reply(ctx, info, L"SYSTEM");
 }
 
 void info_server_describer(core::help_sink& sink, const core::help_repository& repo)
@@ -2909,7 +3523,7 @@ std::wstring info_server_command(command_context& ctx)
     for (auto& channel : ctx.channels)
         info.add_child(L"channels.channel", channel.raw_channel->info()).add(L"index", ++index);
 
-    return create_info_xml_reply(info, L"SERVER");
+    return create_info_xml_reply(ctx, info, L"SERVER");
 }
 
 void info_threads_describer(core::help_sink& sink, const core::help_repository& repo)
@@ -2932,11 +3546,70 @@ std::wstring info_threads_command(command_context& ctx)
     return replyString.str();
 }
 
+void info_memory_describer(core::help_sink& sink, const core::help_repository& repo)
+{
+    sink.short_description(L"Get information about memory usage and budgets.");
+    sink.syntax(L"INFO MEMORY");
+    sink.para()->text(
+        L"Gets the frame and packet buffer memory currently held by each producer and mixer together with the configured "
+        L"budgets.");
+    sink.para()->text(L"While a budget is exceeded new producers are refused and read-ahead buffers are shrunk.");
+    sink.para()->text(L"When huge pages are enabled the number of bytes mapped, in use and kept for reuse are included as well.");
+}
+
+std::wstring info_memory_command(command_context& ctx)
+{
+    boost::property_tree::wptree info;
+
+    info.add(L"memory.budget", global_memory_budget());
+    info.add(L"memory.usage", total_memory_usage());
+
+    for (size_t n = 0; n < ctx.channels.size(); ++n) {
+        auto index = ctx.channels.at(n).raw_channel->index();
+        auto& channel = info.add(L"memory.channels.channel", L"");
+
+        channel.add(L"index", index);
+        channel.add(L"budget", channel_memory_budget(index));
+        channel.add(L"usage", channel_memory_usage(index));
+    }
+
+    auto accounts = get_memory_accounts();
+    std::sort(accounts.begin(), accounts.end(), [](const spl::shared_ptr<memory_account>& lhs, const spl::shared_ptr<memory_account>& rhs) {
+        return lhs->usage() > rhs->usage();
+    });
+
+    auto huge_pages = get_huge_page_usage();
+
+    info.add(L"memory.huge-pages.mode", huge_pages.mode == huge_page_mode::hugetlb ? L"hugetlb" : huge_pages.mode == huge_page_mode::transparent ? L"transparent" : L"off");
+    info.add(L"memory.huge-pages.page-size", huge_pages.page_size);
+    info.add(L"memory.huge-pages.mapped", huge_pages.mapped);
+    info.add(L"memory.huge-pages.in-use", huge_pages.in_use);
+    info.add(L"memory.huge-pages.cached", huge_pages.cached);
+    info.add(L"memory.huge-pages.hugetlb", huge_pages.hugetlb);
+    info.add(L"memory.huge-pages.reused", huge_pages.reused);
+    info.add(L"memory.huge-pages.fallbacks", huge_pages.fallbacks);
+
+    for (auto& account : accounts) {
+        auto& owner = info.add(L"memory.owners.owner", L"");
+
+        owner.add(L"name", account->owner());
+        owner.add(L"channel", account->video_channel());
+        owner.add(L"layer", account->layer());
+        owner.add(L"usage", account->usage());
+        owner.add(L"peak", account->peak());
+    }
+
+    return create_info_xml_reply(ctx, info, L"MEMORY");
+}
+
 void info_delay_describer(core::help_sink& sink, const core::help_repository& repo)
 {
     sink.short_description(L"Get the current delay on a channel or a layer.");
     sink.syntax(L"INFO [video_channel:int]{-[layer:int]} DELAY");
     sink.para()->text(L"Get the current delay on the specified channel or layer.");
+    sink.para()
+        ->text(L"For each consumer of a channel the distribution of the latency from the production of a frame ")
+        ->text(L"to its presentation over the last 512 frames is reported in milliseconds and in frames.");
 }
 
 std::future<std::wstring> info_delay_command(command_context& ctx)
@@ -2946,16 +3619,16 @@ std::future<std::wstring> info_delay_command(command_context& ctx)
     if (layer == std::numeric_limits<int>::min()) {
         boost::property_tree::wptree info;
         info.add_child(L"channel-delay", ctx.channel.raw_channel->delay_info());
-        return make_ready_future(create_info_xml_reply(info, L"DELAY"));
+        return make_ready_future(create_info_xml_reply(ctx, info, L"DELAY"));
     }
 
     auto layer_info = ctx.channel.stage->delay_info(layer).share();
-    return std::async(std::launch::deferred, [layer_info, layer]() {
+    return std::async(std::launch::deferred, [ctx, layer_info, layer]() {
         boost::property_tree::wptree info;
 
         info.add_child(L"layer-delay", layer_info.get()).add(L"index", layer);
 
-        return create_info_xml_reply(info, L"DELAY");
+        return create_info_xml_reply(ctx, info, L"DELAY");
     });
 }
 
@@ -3030,10 +3703,10 @@ struct max_width_sink : public core::help_sink
 
 struct short_description_sink : public core::help_sink
 {
-    std::size_t         width;
-    std::wstringstream& out;
+    std::size_t    width;
+    std::wostream& out;
 
-    short_description_sink(std::size_t width, std::wstringstream& out)
+    short_description_sink(std::size_t width, std::wostream& out)
         : width(width)
         , out(out)
     {
@@ -3047,9 +3720,9 @@ struct short_description_sink : public core::help_sink
 struct simple_paragraph_builder : core::paragraph_builder
 {
     std::wostringstream out;
-    std::wstringstream& commit_to;
+    std::wostream&      commit_to;
 
-    simple_paragraph_builder(std::wstringstream& out)
+    simple_paragraph_builder(std::wostream& out)
         : commit_to(out)
     {
     }
@@ -3073,9 +3746,9 @@ struct simple_paragraph_builder : core::paragraph_builder
 
 struct simple_definition_list_builder : core::definition_list_builder
 {
-    std::wstringstream& out;
+    std::wostream& out;
 
-    simple_definition_list_builder(std::wstringstream& out)
+    simple_definition_list_builder(std::wostream& out)
         : out(out)
     {
     }
@@ -3091,9 +3764,9 @@ struct simple_definition_list_builder : core::definition_list_builder
 
 struct long_description_sink : public core::help_sink
 {
-    std::wstringstream& out;
+    std::wostream& out;
 
-    long_description_sink(std::wstringstream& out)
+    long_description_sink(std::wostream& out)
         : out(out)
     {
     }
@@ -3127,7 +3800,7 @@ struct long_description_sink : public core::help_sink
 
 std::wstring create_help_list(const std::wstring& help_command, const command_context& ctx, std::set<std::wstring> tags)
 {
-    std::wstringstream result;
+    reply_stream result(ctx);
     result << L"200 " << help_command << L" OK\r\n";
     max_width_sink width;
     ctx.static_context->help_repo->help(tags, width);
@@ -3135,19 +3808,19 @@ std::wstring create_help_list(const std::wstring& help_command, const command_co
     sink.width = width.max_width;
     ctx.static_context->help_repo->help(tags, sink);
     result << L"\r\n";
-    return result.str();
+    return result.finish();
 }
 
 std::wstring
 create_help_details(const std::wstring& help_command, const command_context& ctx, std::set<std::wstring> tags)
 {
-    std::wstringstream result;
+    reply_stream result(ctx);
     result << L"201 " << help_command << L" OK\r\n";
     auto                  joined = boost::join(ctx.parameters, L" ");
     long_description_sink sink(result);
     ctx.static_context->help_repo->help(tags, joined, sink);
     result << L"\r\n";
-    return result.str();
+    return result.finish();
 }
 
 void help_describer(core::help_sink& sink, const core::help_repository& repository)
@@ -3330,6 +4003,7 @@ void register_commands(std::shared_ptr<amcp_command_repository_wrapper>& repo)
     repo->register_channel_command(L"Basic Commands", L"SWAP", swap_describer, swap_command, 1);
     repo->register_channel_command(L"Basic Commands", L"ADD", add_describer, add_command, 1);
     repo->register_channel_command(L"Basic Commands", L"REMOVE", remove_describer, remove_command, 0);
+    repo->register_channel_command(L"Basic Commands", L"SYNCOFFSET", syncoffset_describer, syncoffset_command, 0);
     repo->register_channel_command(L"Basic Commands", L"PRINT", print_describer, print_command, 0);
     repo->register_command(L"Basic Commands", L"LOG LEVEL", log_level_describer, log_level_command, 1);
     repo->register_command(L"Basic Commands", L"LOG CATEGORY", log_category_describer, log_category_command, 2);
@@ -3355,6 +4029,9 @@ void register_commands(std::shared_ptr<amcp_command_repository_wrapper>& repo)
     repo->register_channel_command(L"Mixer Commands", L"MIXER INVERT", mixer_invert_describer, mixer_invert_command, 0);
     repo->register_channel_command(L"Mixer Commands", L"MIXER CHROMA", mixer_chroma_describer, mixer_chroma_command, 0);
     repo->register_channel_command(L"Mixer Commands", L"MIXER BLEND", mixer_blend_describer, mixer_blend_command, 0);
+    repo->register_channel_command(
+        L"Mixer Commands", L"MIXER COLORSPACE", mixer_colorspace_describer, mixer_colorspace_command, 0);
+    repo->register_channel_command(L"Mixer Commands", L"MIXER LUT", mixer_lut_describer, mixer_lut_command, 0);
     repo->register_channel_command(
         L"Mixer Commands", L"MIXER OPACITY", mixer_opacity_describer, mixer_opacity_command, 0);
     repo->register_channel_command(
@@ -3374,8 +4051,20 @@ void register_commands(std::shared_ptr<amcp_command_repository_wrapper>& repo)
         L"Mixer Commands", L"MIXER PERSPECTIVE", mixer_perspective_describer, mixer_perspective_command, 0);
     repo->register_channel_command(L"Mixer Commands", L"MIXER MIPMAP", mixer_mipmap_describer, mixer_mipmap_command, 0);
     repo->register_channel_command(L"Mixer Commands", L"MIXER VOLUME", mixer_volume_describer, mixer_volume_command, 0);
+    repo->register_channel_command(
+        L"Mixer Commands", L"MIXER SYNCOFFSET", mixer_syncoffset_describer, mixer_syncoffset_command, 0);
     repo->register_channel_command(
         L"Mixer Commands", L"MIXER MASTERVOLUME", mixer_mastervolume_describer, mixer_mastervolume_command, 0);
+    repo->register_channel_command(
+        L"Mixer Commands", L"MIXER COMPRESSOR", mixer_compressor_describer, mixer_compressor_command, 0);
+    repo->register_channel_command(L"Mixer Commands", L"MIXER LIMITER", mixer_limiter_describer, mixer_limiter_command, 0);
+    repo->register_channel_command(L"Mixer Commands",
+                                   L"MIXER MASTERCOMPRESSOR",
+                                   mixer_mastercompressor_describer,
+                                   mixer_mastercompressor_command,
+                                   0);
+    repo->register_channel_command(
+        L"Mixer Commands", L"MIXER MASTERLIMITER", mixer_masterlimiter_describer, mixer_masterlimiter_command, 0);
     repo->register_channel_command(L"Mixer Commands",
                                    L"MIXER STRAIGHT_ALPHA_OUTPUT",
                                    mixer_straight_alpha_describer,
@@ -3390,6 +4079,11 @@ void register_commands(std::shared_ptr<amcp_command_repository_wrapper>& repo)
         L"Thumbnail Commands", L"THUMBNAIL LIST", thumbnail_list_describer, thumbnail_list_command, 0);
     repo->register_command(
         L"Thumbnail Commands", L"THUMBNAIL RETRIEVE", thumbnail_retrieve_describer, thumbnail_retrieve_command, 1);
+    repo->register_command(L"Thumbnail Commands",
+                           L"THUMBNAIL RETRIEVE_MULTIPLE",
+                           thumbnail_retrieve_multiple_describer,
+                           thumbnail_retrieve_multiple_command,
+                           1);
     repo->register_command(
         L"Thumbnail Commands", L"THUMBNAIL GENERATE", thumbnail_generate_describer, thumbnail_generate_command, 1);
     repo->register_command(L"Thumbnail Commands",
@@ -3411,6 +4105,7 @@ void register_commands(std::shared_ptr<amcp_command_repository_wrapper>& repo)
     repo->register_command(L"Query Commands", L"INFO SYSTEM", info_system_describer, info_system_command, 0);
     repo->register_command(L"Query Commands", L"INFO SERVER", info_server_describer, info_server_command, 0);
     repo->register_command(L"Query Commands", L"INFO THREADS", info_threads_describer, info_threads_command, 0);
+    repo->register_command(L"Query Commands", L"INFO MEMORY", info_memory_describer, info_memory_command, 0);
     repo->register_channel_command(L"Query Commands", L"INFO DELAY", info_delay_describer, info_delay_command, 0);
     repo->register_command(L"Query Commands", L"DIAG", diag_describer, diag_command, 0);
     repo->register_command(L"Query Commands", L"GL INFO", gl_info_describer, gl_info_command, 0);
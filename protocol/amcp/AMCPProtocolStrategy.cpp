@@ -26,6 +26,7 @@
 #include "AMCPCommandScheduler.h"
 #include "AMCPProtocolStrategy.h"
 #include "amcp_command_repository.h"
+#include "amcp_journal.h"
 #include "amcp_shared.h"
 #include "../util/tokenize.h"
 
@@ -37,6 +38,8 @@
 
 #include <common/diagnostics/graph.h>
 
+#include <tbb/atomic.h>
+
 #include "amcp_command_context.h"
 #include "protocol/util/strategy_adapters.h"
 
@@ -95,13 +98,16 @@ class AMCPProtocolStrategy
     spl::shared_ptr<amcp_command_repository> repo_;
     spl::shared_ptr<AMCPCommandScheduler>    scheduler_;
     std::vector<std::shared_ptr<void>>       schedule_ops_;
+    std::shared_ptr<amcp_journal>            journal_;
 
   public:
     AMCPProtocolStrategy(const std::wstring&                             name,
                          const spl::shared_ptr<amcp_command_repository>& repo,
-                         const spl::shared_ptr<AMCPCommandScheduler>&    scheduler)
+                         const spl::shared_ptr<AMCPCommandScheduler>&    scheduler,
+                         const std::shared_ptr<amcp_journal>&            journal)
         : repo_(repo)
         , scheduler_(scheduler)
+        , journal_(journal)
     {
         commandQueues_.push_back(spl::make_shared<AMCPCommandQueue>(L"General Queue for " + name, repo_->channels()));
 
@@ -145,7 +151,10 @@ class AMCPProtocolStrategy
 
     // The paser method expects message to be complete messages with the delimiter stripped away.
     // Therefore the AMCPProtocolStrategy should be decorated with a delimiter_based_chunking_strategy
-    void parse(const std::wstring& message, ClientInfoPtr client, const std::shared_ptr<AMCPClientBatchInfo>& batch)
+    void parse(const std::wstring&                         message,
+               ClientInfoPtr                               client,
+               const std::wstring&                         client_id,
+               const std::shared_ptr<AMCPClientBatchInfo>& batch)
     {
         std::list<std::wstring> tokens;
         IO::tokenize(message, tokens);
@@ -167,7 +176,12 @@ class AMCPProtocolStrategy
 
         std::wstring request_id;
         std::wstring command_name;
-        error_state  err = parse_command_string(client, batch, tokens, request_id, command_name);
+        int          channel_index = -1;
+        error_state  err = parse_command_string(client, batch, tokens, request_id, command_name, channel_index);
+
+        if (journal_)
+            journal_->record(client_id, channel_index + 1, message);
+
         if (err != error_state::no_error) {
             std::wstringstream answer;
 
@@ -204,7 +218,8 @@ class AMCPProtocolStrategy
                                      const std::shared_ptr<AMCPClientBatchInfo>& batch,
                                      std::list<std::wstring>                     tokens,
                                      std::wstring&                               request_id,
-                                     std::wstring&                               command_name)
+                                     std::wstring&                               command_name,
+                                     int&                                        channel_index)
     {
         try {
             // Discard GetSwitch
@@ -231,7 +246,7 @@ class AMCPProtocolStrategy
                 return error_state::command_error;
             }
 
-            const int channel_index = command->channel_index();
+            channel_index = command->channel_index();
             if (!repo_->check_channel_lock(client, channel_index)) {
                 return error_state::access_error;
             }
@@ -319,6 +334,13 @@ class AMCPClientStrategy : public IO::protocol_strategy<wchar_t>
     const std::shared_ptr<AMCPProtocolStrategy> strategy_;
     const std::shared_ptr<AMCPClientBatchInfo>  batch_;
     ClientInfoPtr                               client_info_;
+    const std::wstring                          client_id_;
+
+    static std::wstring next_client_id(const IO::client_connection<wchar_t>::ptr& client_connection)
+    {
+        static tbb::atomic<int> counter;
+        return boost::lexical_cast<std::wstring>(++counter) + L"@" + client_connection->address();
+    }
 
   public:
     AMCPClientStrategy(const std::shared_ptr<AMCPProtocolStrategy>& strategy,
@@ -326,10 +348,14 @@ class AMCPClientStrategy : public IO::protocol_strategy<wchar_t>
         : strategy_(strategy)
         , batch_(std::make_shared<AMCPClientBatchInfo>(client_connection))
         , client_info_(client_connection)
+        , client_id_(next_client_id(client_connection))
     {
     }
 
-    void parse(const std::basic_string<wchar_t>& data) override { strategy_->parse(data, client_info_, batch_); }
+    void parse(const std::basic_string<wchar_t>& data) override
+    {
+        strategy_->parse(data, client_info_, client_id_, batch_);
+    }
 };
 
 class amcp_client_strategy_factory : public IO::protocol_strategy_factory<wchar_t>
@@ -352,9 +378,10 @@ class amcp_client_strategy_factory : public IO::protocol_strategy_factory<wchar_
 IO::protocol_strategy_factory<char>::ptr
 create_char_amcp_strategy_factory(const std::wstring&                             name,
                                   const spl::shared_ptr<amcp_command_repository>& repo,
-                                  const spl::shared_ptr<AMCPCommandScheduler>&    scheduler)
+                                  const spl::shared_ptr<AMCPCommandScheduler>&    scheduler,
+                                  const std::shared_ptr<amcp_journal>&            journal)
 {
-    auto amcp_strategy = spl::make_shared<AMCPProtocolStrategy>(std::move(name), repo, scheduler);
+    auto amcp_strategy = spl::make_shared<AMCPProtocolStrategy>(std::move(name), repo, scheduler, journal);
     auto amcp_client   = spl::make_shared<amcp_client_strategy_factory>(amcp_strategy);
     auto to_unicode    = spl::make_shared<IO::to_unicode_adapter_factory>("UTF-8", amcp_client);
     return spl::make_shared<IO::delimiter_based_chunking_strategy_factory<char>>("\r\n", to_unicode);
@@ -363,9 +390,10 @@ create_char_amcp_strategy_factory(const std::wstring&
 IO::protocol_strategy_factory<wchar_t>::ptr
 create_wchar_amcp_strategy_factory(const std::wstring&                             name,
                                    const spl::shared_ptr<amcp_command_repository>& repo,
-                                   const spl::shared_ptr<AMCPCommandScheduler>&    scheduler)
+                                   const spl::shared_ptr<AMCPCommandScheduler>&    scheduler,
+                                   const std::shared_ptr<amcp_journal>&            journal)
 {
-    auto amcp_strategy = spl::make_shared<AMCPProtocolStrategy>(std::move(name), repo, scheduler);
+    auto amcp_strategy = spl::make_shared<AMCPProtocolStrategy>(std::move(name), repo, scheduler, journal);
     auto amcp_client   = spl::make_shared<amcp_client_strategy_factory>(amcp_strategy);
     return spl::make_shared<IO::delimiter_based_chunking_strategy_factory<wchar_t>>(L"\r\n", amcp_client);
 }
@@ -32,14 +32,18 @@
 
 namespace caspar { namespace protocol { namespace amcp {
 
+class amcp_journal;
+
 IO::protocol_strategy_factory<char>::ptr
 create_char_amcp_strategy_factory(const std::wstring&                             name,
                                   const spl::shared_ptr<amcp_command_repository>& repo,
-                                  const spl::shared_ptr<AMCPCommandScheduler>&    scheduler);
+                                  const spl::shared_ptr<AMCPCommandScheduler>&    scheduler,
+                                  const std::shared_ptr<amcp_journal>&            journal = nullptr);
 
 IO::protocol_strategy_factory<wchar_t>::ptr
 create_wchar_amcp_strategy_factory(const std::wstring&                             name,
                                    const spl::shared_ptr<amcp_command_repository>& repo,
-                                   const spl::shared_ptr<AMCPCommandScheduler>&    scheduler);
+                                   const spl::shared_ptr<AMCPCommandScheduler>&    scheduler,
+                                   const std::shared_ptr<amcp_journal>&            journal = nullptr);
 
 }}} // namespace caspar::protocol::amcp
@@ -40,7 +40,9 @@ class command_context_factory
     {
         const channel_context channel = ctx2.channel_index >= 0 ? channels.at(ctx2.channel_index) : channel_context();
         auto ctx = command_context(static_context_, channels, ctx2.client, channel, ctx2.channel_index, ctx2.layer_id);
-        ctx.parameters = std::move(ctx2.parameters);
+        ctx.parameters   = std::move(ctx2.parameters);
+        ctx.request_id   = ctx2.request_id;
+        ctx.stream_reply = ctx2.stream_reply;
         return std::move(ctx);
     }
 
@@ -0,0 +1,354 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#include "../StdAfx.h"
+
+#include "amcp_journal.h"
+
+#include <common/except.h>
+#include <common/executor.h>
+#include <common/log.h>
+#include <common/utf.h>
+
+#include <boost/algorithm/string/predicate.hpp>
+#include <boost/chrono.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/thread.hpp>
+
+#include <map>
+#include <mutex>
+
+namespace caspar { namespace protocol { namespace amcp {
+
+// Records are line based but commands may contain line breaks (CG ADD data
+// for example), so backslash, line breaks and tabs are escaped.
+std::string escape_field(const std::string& field)
+{
+    std::string result;
+    result.reserve(field.size());
+
+    for (auto c : field) {
+        switch (c) {
+            case '\\':
+                result += "\\\\";
+                break;
+            case '\n':
+                result += "\\n";
+                break;
+            case '\r':
+                result += "\\r";
+                break;
+            case '\t':
+                result += "\\t";
+                break;
+            default:
+                result += c;
+        }
+    }
+
+    return result;
+}
+
+std::string unescape_field(const std::string& field)
+{
+    std::string result;
+    result.reserve(field.size());
+
+    for (std::size_t n = 0; n < field.size(); ++n) {
+        if (field[n] != '\\' || n + 1 == field.size()) {
+            result += field[n];
+            continue;
+        }
+
+        switch (field[++n]) {
+            case 'n':
+                result += '\n';
+                break;
+            case 'r':
+                result += '\r';
+                break;
+            case 't':
+                result += '\t';
+                break;
+            default:
+                result += field[n];
+        }
+    }
+
+    return result;
+}
+
+struct amcp_journal::impl
+{
+    const boost::filesystem::path                 path_;
+    const std::int64_t                            max_file_size_;
+    const int                                     max_files_;
+    const boost::chrono::steady_clock::time_point origin_ = boost::chrono::steady_clock::now();
+    boost::filesystem::ofstream                   file_;
+    std::int64_t                                  file_size_ = 0;
+    executor                                      executor_{L"amcp_journal"};
+
+    impl(const std::wstring& path, std::int64_t max_file_size, int max_files)
+        : path_(path)
+        , max_file_size_(max_file_size)
+        , max_files_(std::max(1, max_files))
+    {
+        if (path_.has_parent_path())
+            boost::filesystem::create_directories(path_.parent_path());
+
+        open();
+
+        CASPAR_LOG(info) << print() << L" Recording AMCP commands.";
+    }
+
+    void record(const std::wstring& client, int channel, const std::wstring& command)
+    {
+        auto micros = boost::chrono::duration_cast<boost::chrono::microseconds>(boost::chrono::steady_clock::now() - origin_).count();
+        auto line   = boost::lexical_cast<std::string>(micros) + "\t" + escape_field(u8(client)) + "\t" +
+                    boost::lexical_cast<std::string>(channel) + "\t" + escape_field(u8(command)) + "\n";
+
+        executor_.begin_invoke([=] {
+            if (file_size_ + static_cast<std::int64_t>(line.size()) > max_file_size_)
+                rotate();
+
+            file_.write(line.data(), line.size());
+            file_.flush();
+            file_size_ += line.size();
+        });
+    }
+
+    std::wstring print() const { return L"amcp_journal[" + path_.wstring() + L"]"; }
+
+  private:
+    boost::filesystem::path rotated_path(int index) const
+    {
+        return path_.parent_path() /
+               (path_.stem().wstring() + L"." + boost::lexical_cast<std::wstring>(index) + path_.extension().wstring());
+    }
+
+    void open()
+    {
+        file_.open(path_, std::ios::out | std::ios::trunc | std::ios::binary);
+
+        if (!file_)
+            CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Could not open AMCP journal " + path_.wstring()));
+
+        auto header = "# CasparCG AMCP journal, opened " +
+                      boost::posix_time::to_iso_extended_string(boost::posix_time::microsec_clock::local_time()) + "\n";
+
+        file_.write(header.data(), header.size());
+        file_size_ = header.size();
+    }
+
+    void rotate()
+    {
+        file_.close();
+
+        boost::system::error_code ignored;
+        boost::filesystem::remove(rotated_path(max_files_ - 1), ignored);
+
+        for (int n = max_files_ - 2; n >= 1; --n)
+            boost::filesystem::rename(rotated_path(n), rotated_path(n + 1), ignored);
+
+        if (max_files_ > 1)
+            boost::filesystem::rename(path_, rotated_path(1), ignored);
+
+        open();
+    }
+};
+
+amcp_journal::amcp_journal(const std::wstring& path, std::int64_t max_file_size, int max_files)
+    : impl_(new impl(path, max_file_size, max_files))
+{
+}
+amcp_journal::~amcp_journal() {}
+void amcp_journal::record(const std::wstring& client, int channel, const std::wstring& command)
+{
+    impl_->record(client, channel, command);
+}
+std::wstring amcp_journal::print() const { return impl_->print(); }
+
+namespace {
+
+struct replay_replies
+{
+    tbb::atomic<std::int64_t> count;
+    tbb::atomic<std::int64_t> errors;
+
+    replay_replies()
+    {
+        count  = 0;
+        errors = 0;
+    }
+};
+
+class replay_client : public IO::client_connection<wchar_t>
+{
+    const std::wstring                            id_;
+    const std::shared_ptr<replay_replies>         replies_;
+    std::mutex                                    mutex_;
+    std::map<std::wstring, std::shared_ptr<void>> lifecycle_bound_objects_;
+
+  public:
+    replay_client(const std::wstring& id, const std::shared_ptr<replay_replies>& replies)
+        : id_(id)
+        , replies_(replies)
+    {
+    }
+
+    void send(std::wstring&& data, bool skip_log) override
+    {
+        auto reply = data;
+
+        if (boost::starts_with(reply, L"RES ")) {
+            auto code = reply.find(L' ', 4);
+            reply     = code == std::wstring::npos ? L"" : reply.substr(code + 1);
+        }
+
+        if (reply.size() >= 3 && (reply[0] == L'4' || reply[0] == L'5'))
+            ++replies_->errors;
+
+        ++replies_->count;
+
+        if (!skip_log)
+            CASPAR_LOG(trace) << L"Replay reply to " << id_ << L": " << data;
+    }
+
+    void send_utf8(std::string&& data, bool skip_log) override { send(u16(data), skip_log); }
+
+    void disconnect() override {}
+
+    std::wstring address() const override { return id_; }
+
+    void add_lifecycle_bound_object(const std::wstring& key, const std::shared_ptr<void>& lifecycle_bound) override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        lifecycle_bound_objects_[key] = lifecycle_bound;
+    }
+
+    std::shared_ptr<void> remove_lifecycle_bound_object(const std::wstring& key) override
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto                        it = lifecycle_bound_objects_.find(key);
+
+        if (it == lifecycle_bound_objects_.end())
+            return nullptr;
+
+        auto object = it->second;
+        lifecycle_bound_objects_.erase(it);
+        return object;
+    }
+};
+
+} // namespace
+
+amcp_replay_result replay_amcp_journal(const std::wstring&                                path,
+                                       double                                             speed,
+                                       const IO::protocol_strategy_factory<wchar_t>::ptr& factory,
+                                       const tbb::atomic<bool>&                           running)
+{
+    using namespace boost::chrono;
+
+    boost::filesystem::ifstream file(boost::filesystem::path(path), std::ios::binary);
+
+    if (!file)
+        CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Could not open AMCP journal " + path));
+
+    auto replies = std::make_shared<replay_replies>();
+
+    std::map<std::wstring, std::shared_ptr<IO::protocol_strategy<wchar_t>>> clients;
+    amcp_replay_result                                                       result;
+    std::int64_t                                                             first_micros = -1;
+    auto                                                                     start        = steady_clock::now();
+    std::string                                                              line;
+
+    while (running && std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+
+        if (line.empty() || line[0] == '#')
+            continue;
+
+        auto client_start  = line.find('\t');
+        auto channel_start = client_start == std::string::npos ? client_start : line.find('\t', client_start + 1);
+        auto command_start = channel_start == std::string::npos ? channel_start : line.find('\t', channel_start + 1);
+
+        if (command_start == std::string::npos) {
+            CASPAR_LOG(warning) << L"Skipping malformed AMCP journal line: " << u16(line);
+            continue;
+        }
+
+        std::int64_t micros;
+
+        try {
+            micros = boost::lexical_cast<std::int64_t>(line.substr(0, client_start));
+        } catch (const boost::bad_lexical_cast&) {
+            CASPAR_LOG(warning) << L"Skipping AMCP journal line with malformed timestamp: " << u16(line);
+            continue;
+        }
+
+        auto client  = u16(unescape_field(line.substr(client_start + 1, channel_start - client_start - 1)));
+        auto command = u16(unescape_field(line.substr(command_start + 1)));
+
+        if (first_micros < 0)
+            first_micros = micros;
+
+        if (speed > 0.0) {
+            auto due = start + microseconds(static_cast<std::int64_t>((micros - first_micros) / speed));
+
+            // Sleep in slices so that a shutdown does not wait out a long idle gap.
+            while (running && steady_clock::now() < due)
+                boost::this_thread::sleep_until(std::min(due, steady_clock::now() + milliseconds(100)));
+
+            if (!running)
+                break;
+
+            auto lag = duration_cast<duration<double, boost::milli>>(steady_clock::now() - due).count();
+            result.max_lag_millis = std::max(result.max_lag_millis, lag);
+        }
+
+        auto& strategy = clients[client];
+
+        if (!strategy)
+            strategy = factory->create(spl::make_shared<replay_client>(client, replies));
+
+        strategy->parse(command + L"\r\n");
+        ++result.commands;
+    }
+
+    result.seconds = duration_cast<duration<double>>(steady_clock::now() - start).count();
+
+    // Commands execute asynchronously, give the last ones a moment to reply.
+    for (auto count = replies->count.load(); running; count = replies->count.load()) {
+        boost::this_thread::sleep_for(milliseconds(500));
+
+        if (replies->count == count)
+            break;
+    }
+
+    result.errors = replies->errors;
+
+    return result;
+}
+
+}}} // namespace caspar::protocol::amcp
@@ -0,0 +1,84 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+#pragma once
+
+#include "../util/protocol_strategy.h"
+
+#include <common/memory.h>
+
+#include <tbb/atomic.h>
+
+#include <cstdint>
+#include <string>
+
+namespace caspar { namespace protocol { namespace amcp {
+
+/**
+ * Records every received AMCP command as one UTF-8 line:
+ *
+ *     <microseconds since the journal was opened>\t<client>\t<channel>\t<command>
+ *
+ * Backslashes, line breaks and tabs in client and command are written as \\,
+ * \n, \r and \t. The channel is 1-based and 0 for commands that do not
+ * target one. When a
+ * file grows past max_file_size it is renamed to name.1.ext, older files
+ * moving up to at most name.<max_files - 1>.ext. All files share the same
+ * time origin, so they can be concatenated oldest first and replayed.
+ */
+class amcp_journal
+{
+  public:
+    amcp_journal(const std::wstring& path, std::int64_t max_file_size, int max_files);
+    ~amcp_journal();
+
+    void record(const std::wstring& client, int channel, const std::wstring& command);
+
+    std::wstring print() const;
+
+  private:
+    struct impl;
+    spl::unique_ptr<impl> impl_;
+};
+
+// Escaping of the client and command fields of a journal record.
+std::string escape_field(const std::string& field);
+std::string unescape_field(const std::string& field);
+
+struct amcp_replay_result
+{
+    std::int64_t commands       = 0;
+    std::int64_t errors         = 0;
+    double       max_lag_millis = 0.0;
+    double       seconds        = 0.0;
+};
+
+/**
+ * Feeds the commands of a journal to AMCP strategies from factory, one per
+ * recorded client, at the recorded times divided by speed. A speed of 0 sends
+ * them back to back. Replies are only inspected for error codes. Blocks until
+ * the last command has been handed over or running is cleared.
+ */
+amcp_replay_result replay_amcp_journal(const std::wstring&                                path,
+                                       double                                             speed,
+                                       const IO::protocol_strategy_factory<wchar_t>::ptr& factory,
+                                       const tbb::atomic<bool>&                           running);
+
+}}} // namespace caspar::protocol::amcp
@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+ *
+ * This file is part of CasparCG (www.casparcg.com).
+ *
+ * CasparCG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CasparCG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../StdAfx.h"
+
+#include "amcp_reply_stream.h"
+
+#include <common/log.h>
+
+#include <boost/locale/encoding_utf.hpp>
+
+#include <array>
+#include <streambuf>
+
+namespace caspar { namespace protocol { namespace amcp {
+
+struct reply_stream::impl : public std::wstreambuf
+{
+    static const std::size_t CHUNK_SIZE = 16384;
+
+    const IO::ClientInfoPtr              client_;
+    const std::wstring                   request_id_;
+    const bool                           streamed_;
+    std::array<wchar_t, CHUNK_SIZE>      buffer_;
+    std::wstring                         collected_;
+    std::shared_ptr<void>                stream_;
+    bool                                 started_        = false;
+    bool                                 finished_       = false;
+    bool                                 ends_with_crlf_ = false;
+    std::size_t                          sent_           = 0;
+
+    impl(IO::ClientInfoPtr client, std::wstring request_id, bool streamed)
+        : client_(std::move(client))
+        , request_id_(std::move(request_id))
+        , streamed_(streamed)
+    {
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+    }
+
+    ~impl()
+    {
+        if (!started_ || finished_)
+            return;
+
+        // The command failed half way. Terminate the reply so that the error
+        // reply that follows is read as a reply of its own.
+        try {
+            send(ends_with_crlf_ ? "\r\n" : "\r\n\r\n");
+            CASPAR_LOG(warning) << L"Streamed reply to " << client_->address() << L" was cut short after " << sent_
+                                << L" bytes.";
+        } catch (...) {
+            CASPAR_LOG_CURRENT_EXCEPTION();
+        }
+    }
+
+    int_type overflow(int_type c) override
+    {
+        flush(false);
+
+        if (!traits_type::eq_int_type(c, traits_type::eof())) {
+            *pptr() = traits_type::to_char_type(c);
+            pbump(1);
+        }
+
+        return traits_type::not_eof(c);
+    }
+
+    // Only full chunks are sent, so that a short reply is all or nothing.
+    int sync() override { return 0; }
+
+    void flush(bool final)
+    {
+        auto begin = pbase();
+        auto end   = pptr();
+
+        // Never split a surrogate pair between two chunks.
+        if (!final && end != begin && sizeof(wchar_t) == 2 && end[-1] >= 0xD800 && end[-1] <= 0xDBFF)
+            --end;
+
+        if (streamed_) {
+            if (end != begin)
+                send(boost::locale::conv::utf_to_utf<char>(begin, end));
+        } else
+            collected_.append(begin, end);
+
+        auto carried = pptr() - end;
+
+        std::copy(end, pptr(), buffer_.data());
+        setp(buffer_.data(), buffer_.data() + buffer_.size());
+        pbump(static_cast<int>(carried));
+    }
+
+    void send(std::string&& data)
+    {
+        if (data.empty())
+            return;
+
+        if (!started_) {
+            started_ = true;
+            stream_  = client_->lock_sends();
+
+            if (!request_id_.empty())
+                data.insert(0, boost::locale::conv::utf_to_utf<char>(L"RES " + request_id_ + L" "));
+        }
+
+        ends_with_crlf_ = data.size() >= 2 && data[data.size() - 2] == '\r' && data[data.size() - 1] == '\n';
+        sent_ += data.size();
+        client_->send_utf8(std::move(data), true);
+    }
+
+    void write_utf8(const std::string& text)
+    {
+        flush(true);
+
+        if (streamed_)
+            send(std::string(text));
+        else
+            collected_.append(boost::locale::conv::utf_to_utf<wchar_t>(text));
+    }
+
+    std::wstring finish()
+    {
+        flush(true);
+
+        if (!streamed_)
+            return std::move(collected_);
+
+        finished_ = true;
+
+        if (started_)
+            CASPAR_LOG_COMMUNICATION(info) << L"Sent " << sent_ << L" bytes to " << client_->address();
+
+        stream_.reset();
+
+        return L"";
+    }
+};
+
+reply_stream::reply_stream(const command_context& ctx)
+    : reply_stream(ctx.client, ctx.request_id, ctx.stream_reply)
+{
+}
+
+reply_stream::reply_stream(IO::ClientInfoPtr client, std::wstring request_id, bool streamed)
+    : std::wostream(nullptr)
+    , impl_(new impl(std::move(client), std::move(request_id), streamed))
+{
+    rdbuf(impl_.get());
+}
+
+reply_stream::~reply_stream() {}
+
+void reply_stream::write_utf8(const std::string& text) { impl_->write_utf8(text); }
+
+std::wstring reply_stream::finish() { return impl_->finish(); }
+
+}}} // namespace caspar::protocol::amcp
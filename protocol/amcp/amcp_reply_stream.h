@@ -0,0 +1,59 @@
+/*
+ * Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+ *
+ * This file is part of CasparCG (www.casparcg.com).
+ *
+ * CasparCG is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CasparCG is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "amcp_command_context.h"
+
+#include <memory>
+#include <ostream>
+#include <string>
+
+namespace caspar { namespace protocol { namespace amcp {
+
+/**
+ * An output stream for large replies. When the command context allows it the
+ * reply is converted to UTF-8 and sent to the client in chunks while it is
+ * being written, instead of being built as one string. Otherwise the reply is
+ * collected and returned by finish() to be sent the usual way.
+ *
+ * A reply shorter than one chunk is only sent by finish(), so a command that
+ * fails while writing it only sends its error reply. A longer reply that is
+ * cut short by a failure is terminated with an empty line before the error
+ * reply follows.
+ */
+class reply_stream : public std::wostream
+{
+  public:
+    explicit reply_stream(const command_context& ctx);
+    reply_stream(IO::ClientInfoPtr client, std::wstring request_id, bool streamed);
+    ~reply_stream();
+
+    // Writes already UTF-8 encoded text, which is passed through unconverted.
+    void write_utf8(const std::string& text);
+
+    // Returns the reply to send, or an empty string if it has already been sent.
+    std::wstring finish();
+
+  private:
+    struct impl;
+    std::unique_ptr<impl> impl_;
+};
+
+}}} // namespace caspar::protocol::amcp
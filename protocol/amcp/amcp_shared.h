@@ -33,6 +33,8 @@ struct command_context_simple
     const int                       channel_index;
     const int                       layer_id;
     const std::vector<std::wstring> parameters;
+    std::wstring                    request_id;
+    bool                            stream_reply = false;
 
     int layer_index(int default_ = 0) const { return layer_id == -1 ? default_ : layer_id; }
 
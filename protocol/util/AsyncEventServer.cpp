@@ -77,6 +77,11 @@ class connection : public spl::enable_shared_from_this<connection>
 				conn->send(std::move(data));
 		}
 
+		void send_utf8(std::string&& data, bool skip_log) override
+		{
+			send(std::move(data), skip_log);
+		}
+
 		void disconnect() override
 		{
 			auto conn = connection_.lock();
@@ -26,6 +26,9 @@
 #include <iostream>
 
 #include <common/log.h>
+
+#include <boost/locale/encoding_utf.hpp>
+
 #include "protocol_strategy.h"
 
 namespace caspar { namespace IO {
@@ -39,6 +42,10 @@ struct ConsoleClientInfo : public client_connection<wchar_t>
 	{
 		std::wcout << (L"#" + caspar::log::replace_nonprintable_copy(data, L'?')) << std::flush;
 	}
+	void send_utf8(std::string&& data, bool skip_log) override
+	{
+		send(boost::locale::conv::utf_to_utf<wchar_t>(data), skip_log);
+	}
 	void disconnect() override {}
 	std::wstring address() const override { return L"Console"; }
 	void add_lifecycle_bound_object(const std::wstring& key, const std::shared_ptr<void>& lifecycle_bound) override {}
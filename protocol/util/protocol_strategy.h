@@ -63,6 +63,20 @@ public:
 	virtual ~client_connection() { }
 
 	virtual void send(std::basic_string<CharT>&& data, bool skip_log = false) = 0;
+
+	/**
+	 * Send UTF-8 encoded data, only converting it if the client uses another
+	 * encoding.
+	 */
+	virtual void send_utf8(std::string&& data, bool skip_log = false) = 0;
+
+	/**
+	 * Start a reply sent in several chunks by the calling thread. Until the
+	 * returned handle is released, data sent by other threads is held back
+	 * and sent afterwards, so that the reply reaches the client unbroken
+	 * without blocking the other senders.
+	 */
+	virtual std::shared_ptr<void> lock_sends() { return nullptr; }
 	virtual void disconnect() = 0;
 	virtual std::wstring address() const = 0;
 
@@ -24,8 +24,15 @@
 #include "strategy_adapters.h"
 
 #include <boost/locale.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/algorithm/string/replace.hpp>
 
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
 namespace caspar { namespace IO {
 
 class to_unicode_adapter : public protocol_strategy<char>
@@ -53,11 +60,18 @@ class from_unicode_client_connection : public client_connection<wchar_t>
 {
 	client_connection<char>::ptr client_;
 	std::string codepage_;
+	bool is_utf8_;
+	std::mutex mutex_;
+	std::condition_variable stream_ended_;
+	bool streaming_ = false;
+	std::thread::id stream_thread_;
+	std::vector<std::pair<std::string, bool>> held_back_;
 public:
 	from_unicode_client_connection(
 			const client_connection<char>::ptr& client, const std::string& codepage)
 		: client_(client)
 		, codepage_(codepage)
+		, is_utf8_(boost::iequals(codepage, "UTF-8"))
 	{
 	}
 	~from_unicode_client_connection()
@@ -68,7 +82,7 @@ public:
 	{
 		auto str = boost::locale::conv::from_utf<wchar_t>(data, codepage_);
 
-		client_->send(std::move(str), skip_log);
+		send_or_hold_back(std::move(str), skip_log);
 
 		if (skip_log)
 			return;
@@ -83,10 +97,60 @@ public:
 			CASPAR_LOG_COMMUNICATION(info) << L"Sent more than 512 bytes to " << client_->address();
 	}
 
+	void send_utf8(std::string&& data, bool skip_log) override
+	{
+		auto length = data.length();
+
+		if (is_utf8_)
+			send_or_hold_back(std::move(data), skip_log);
+		else
+			send_or_hold_back(boost::locale::conv::between(data, codepage_, "UTF-8"), skip_log);
+
+		if (!skip_log)
+			CASPAR_LOG_COMMUNICATION(info) << L"Sent " << length << L" bytes to " << client_->address();
+	}
+
+	std::shared_ptr<void> lock_sends() override
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+
+		if (streaming_ && stream_thread_ == std::this_thread::get_id())
+			return nullptr;
+
+		// Only another streamed reply waits, ordinary replies are held back.
+		stream_ended_.wait(lock, [this] { return !streaming_; });
+
+		streaming_		= true;
+		stream_thread_	= std::this_thread::get_id();
+
+		return std::shared_ptr<void>(nullptr, [this](void*)
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+
+			for (auto& data : held_back_)
+				client_->send(std::move(data.first), data.second);
+
+			held_back_.clear();
+			streaming_ = false;
+			stream_ended_.notify_one();
+		});
+	}
+
 	void disconnect() override
 	{
 		client_->disconnect();
 	}
+private:
+	void send_or_hold_back(std::string&& data, bool skip_log)
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+
+		if (streaming_ && stream_thread_ != std::this_thread::get_id())
+			held_back_.push_back(std::make_pair(std::move(data), skip_log));
+		else
+			client_->send(std::move(data), skip_log);
+	}
+public:
 
 	std::wstring address() const override
 	{
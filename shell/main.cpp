@@ -42,6 +42,7 @@
 #include "server.h"
 
 #include <protocol/amcp/AMCPProtocolStrategy.h>
+#include <protocol/amcp/amcp_journal.h>
 #include <protocol/util/strategy_adapters.h>
 
 #include <common/env.h>
@@ -138,7 +139,40 @@ void do_run(std::weak_ptr<caspar::IO::protocol_strategy<wchar_t>> amcp,
     }
 };
 
-bool run(const std::wstring& config_file_name, tbb::atomic<bool>& should_wait_for_keypress)
+// Replays an AMCP journal against the running server and shuts it down when done.
+void do_replay(const std::wstring&      replay_file,
+               double                   replay_speed,
+               server&                  caspar_server,
+               std::promise<bool>&      shutdown_server_now,
+               const tbb::atomic<bool>& running)
+{
+    ensure_gpf_handler_installed_for_thread("AMCP replay thread");
+
+    try {
+        CASPAR_LOG(info) << L"Replaying AMCP journal " << replay_file << L" at speed " << replay_speed;
+
+        auto factory = protocol::amcp::create_wchar_amcp_strategy_factory(
+            L"Replay", caspar_server.get_amcp_command_repository(), caspar_server.get_amcp_command_scheduler());
+        auto result = protocol::amcp::replay_amcp_journal(replay_file, replay_speed, factory, running);
+
+        CASPAR_LOG(info) << L"Replayed " << result.commands << L" AMCP commands in " << result.seconds << L" s, "
+                         << result.errors << L" failed, max lag " << result.max_lag_millis << L" ms.";
+    } catch (...) {
+        CASPAR_LOG_CURRENT_EXCEPTION();
+    }
+
+    try {
+        if (running)
+            shutdown_server_now.set_value(false);
+    } catch (const std::future_error&) {
+        // Already shutting down from the console.
+    }
+}
+
+bool run(const std::wstring& config_file_name,
+         const std::wstring& replay_file,
+         double              replay_speed,
+         tbb::atomic<bool>&  should_wait_for_keypress)
 {
     std::promise<bool> shutdown_server_now;
     std::future<bool>  shutdown_server = shutdown_server_now.get_future();
@@ -187,7 +221,24 @@ bool run(const std::wstring& config_file_name, tbb::atomic<bool>& should_wait_fo
                       std::ref(shutdown_server_now),
                       std::ref(should_wait_for_keypress))); // compiler didn't like lambda here...
         stdin_thread.detach();
+
+        tbb::atomic<bool> replaying;
+        replaying = true;
+        boost::thread replay_thread;
+
+        if (!replay_file.empty())
+            replay_thread = boost::thread(std::bind(do_replay,
+                                                    replay_file,
+                                                    replay_speed,
+                                                    std::ref(*caspar_server),
+                                                    std::ref(shutdown_server_now),
+                                                    std::cref(replaying)));
+
         should_restart = shutdown_server.get();
+
+        replaying = false;
+        if (replay_thread.joinable())
+            replay_thread.join();
     }
 
     caspar_server.reset();
@@ -198,6 +249,34 @@ bool run(const std::wstring& config_file_name, tbb::atomic<bool>& should_wait_fo
     return should_restart;
 }
 
+// Runs a single producer for a host_producer in the parent process. Logs go
+// to the console the child inherited from the parent.
+int run_producer_host(int argc, char** argv)
+{
+    ensure_gpf_handler_installed_for_thread("producer host main thread");
+
+    tbb::task_scheduler_init init;
+
+    try {
+        env::configure(caspar::u16(argv[2]));
+        log::set_log_level(env::properties().get(L"configuration.log-level", L"info"));
+
+        std::vector<std::wstring> args;
+        for (int i = 3; i < argc; ++i)
+            args.push_back(caspar::u16(argv[i]));
+
+        std::promise<bool> shutdown_server_now;
+        server             caspar_server(shutdown_server_now);
+
+        setup_global_locale();
+
+        return caspar_server.run_producer_host(args);
+    } catch (...) {
+        CASPAR_LOG_CURRENT_EXCEPTION();
+        return 1;
+    }
+}
+
 void on_abort(int) { CASPAR_THROW_EXCEPTION(invalid_operation() << msg_info("abort called")); }
 
 int main(int argc, char** argv)
@@ -211,6 +290,9 @@ int main(int argc, char** argv)
 
     setup_global_locale();
 
+    if (argc >= 3 && std::string(argv[1]) == "--producer-host")
+        return run_producer_host(argc, argv);
+
     std::wcout << L"Type \"q\" to close application." << std::endl;
 
     // Set debug mode.
@@ -234,14 +316,31 @@ int main(int argc, char** argv)
 
     tbb::task_scheduler_init init;
     std::wstring             config_file_name(L"casparcg.config");
+    std::wstring             replay_file;
+    double                   replay_speed = 1.0;
 
     try {
         // Configure environment properties from configuration.
-        if (argc >= 2)
-            config_file_name = caspar::u16(argv[1]);
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
+
+            if (arg == "--replay" && i + 1 < argc)
+                replay_file = caspar::u16(argv[++i]);
+            else if (arg == "--replay-speed" && i + 1 < argc)
+                replay_speed = boost::lexical_cast<double>(argv[++i]);
+            else
+                config_file_name = caspar::u16(arg);
+        }
 
         env::configure(config_file_name);
 
+        // Replays run on the cpu accelerator so that they behave the same on any machine, and must not journal over
+        // the file being replayed.
+        if (!replay_file.empty()) {
+            env::set_property(L"configuration.accelerator", L"cpu");
+            env::set_property(L"configuration.amcp-journal.enabled", L"false");
+        }
+
         log::set_log_level(env::properties().get(L"configuration.log-level", L"info"));
         auto log_categories_str = env::properties().get(L"configuration.log-categories", L"communication");
         std::set<std::wstring> log_categories;
@@ -270,7 +369,7 @@ int main(int argc, char** argv)
 
         tbb::atomic<bool> should_wait_for_keypress;
         should_wait_for_keypress = false;
-        auto should_restart      = run(config_file_name, should_wait_for_keypress);
+        auto should_restart      = run(config_file_name, replay_file, replay_speed, should_wait_for_keypress);
         return_code              = should_restart ? 5 : 0;
 
         for (auto& thread : get_thread_infos()) {
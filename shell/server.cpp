@@ -31,10 +31,13 @@
 #include <common/env.h>
 #include <common/except.h>
 #include <common/memory.h>
+#include <common/memory_accounting.h>
+#include <common/os/threading.h>
 #include <common/polling_filesystem_monitor.h>
 #include <common/ptree.h>
 #include <common/utf.h>
 
+#include <core/consumer/hash/hash_consumer.h>
 #include <core/consumer/output.h>
 #include <core/consumer/syncto/syncto_consumer.h>
 #include <core/diagnostics/call_context.h>
@@ -42,12 +45,15 @@
 #include <core/diagnostics/osd_graph.h>
 #include <core/diagnostics/subject_diagnostics.h>
 #include <core/frame/audio_channel_layout.h>
+#include <core/frame/color_space.h>
 #include <core/help/help_repository.h>
+#include <core/latency.h>
 #include <core/mixer/image/image_mixer.h>
 #include <core/mixer/mixer.h>
 #include <core/producer/cg_proxy.h>
 #include <core/producer/color/color_producer.h>
 #include <core/producer/frame_producer.h>
+#include <core/producer/host/host_producer.h>
 #include <core/producer/media_info/in_memory_media_info_repository.h>
 #include <core/producer/media_info/media_info.h>
 #include <core/producer/media_info/media_info_repository.h>
@@ -66,6 +72,7 @@
 #include <protocol/amcp/AMCPCommandsImpl.h>
 #include <protocol/amcp/AMCPProtocolStrategy.h>
 #include <protocol/amcp/amcp_command_repository.h>
+#include <protocol/amcp/amcp_journal.h>
 #include <protocol/cii/CIIProtocolStrategy.h>
 #include <protocol/clk/CLKProtocolStrategy.h>
 #include <protocol/log/tcp_logger_protocol_strategy.h>
@@ -135,6 +142,7 @@ struct server::impl : boost::noncopyable
     std::shared_ptr<amcp::amcp_command_repository_wrapper> amcp_command_repo_wrapper_;
     std::shared_ptr<amcp::command_context_factory>         amcp_context_factory_;
     std::shared_ptr<amcp::AMCPCommandScheduler>            amcp_command_scheduler_;
+    std::shared_ptr<amcp::amcp_journal>                    amcp_journal_;
     std::vector<spl::shared_ptr<IO::AsyncEventServer>>     async_servers_;
     std::shared_ptr<IO::AsyncEventServer>                  primary_amcp_server_;
     std::shared_ptr<osc::client>                           osc_client_ = std::make_shared<osc::client>(io_service_);
@@ -171,9 +179,39 @@ struct server::impl : boost::noncopyable
         core::init_cg_proxy_as_producer(dependencies);
         core::scene::init(dependencies);
         core::syncto::init(dependencies);
+        core::hash::init(dependencies);
+        core::host::init(dependencies);
         help_repo_->register_item({L"producer"}, L"Color Producer", &core::describe_color_producer);
     }
 
+    void setup_huge_pages(const boost::property_tree::wptree& pt)
+    {
+        auto mode      = pt.get(L"configuration.huge-pages", L"off");
+        auto cache_mb  = pt.get(L"configuration.huge-page-cache-mb", 256ll);
+
+        if (boost::iequals(mode, L"off"))
+            return;
+        else if (boost::iequals(mode, L"transparent"))
+            configure_huge_pages(huge_page_mode::transparent, cache_mb * 1024 * 1024);
+        else if (boost::iequals(mode, L"hugetlb"))
+            configure_huge_pages(huge_page_mode::hugetlb, cache_mb * 1024 * 1024);
+        else
+            CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Invalid huge-pages mode " + mode));
+
+        CASPAR_LOG(info) << L"Using " << mode << L" huge pages for frame memory.";
+    }
+
+    void setup_thread_priorities(const boost::property_tree::wptree& pt)
+    {
+        auto realtime    = pt.get(L"configuration.realtime-scheduling", false);
+        auto lock_memory = pt.get(L"configuration.lock-memory", false);
+
+        configure_thread_priorities(realtime, lock_memory);
+
+        if (realtime)
+            CASPAR_LOG(info) << L"Using real-time scheduling for channel threads.";
+    }
+
     void start()
     {
         running_ = true;
@@ -184,6 +222,10 @@ struct server::impl : boost::noncopyable
         setup_audio_config(env::properties());
         CASPAR_LOG(info) << L"Initialized audio config.";
 
+        set_global_memory_budget(env::properties().get(L"configuration.memory-budget-mb", 0ll) * 1024 * 1024);
+        setup_huge_pages(env::properties());
+        setup_thread_priorities(env::properties());
+
         auto xml_channels = setup_channels(env::properties());
         CASPAR_LOG(info) << L"Initialized channels.";
 
@@ -208,6 +250,15 @@ struct server::impl : boost::noncopyable
         CASPAR_LOG(info) << L"Started initial media information retrieval.";
     }
 
+    int run_producer_host(const std::vector<std::wstring>& args)
+    {
+        setup_video_modes(env::properties());
+        setup_audio_config(env::properties());
+
+        return core::host::run_producer_host(
+            args, producer_registry_, cg_registry_, video_format_repository_, accelerator_.create_image_mixer(0));
+    }
+
     ~impl()
     {
         if (running_) {
@@ -225,6 +276,7 @@ struct server::impl : boost::noncopyable
         amcp_command_scheduler_.reset();
         primary_amcp_server_.reset();
         async_servers_.clear();
+        amcp_journal_.reset();
         destroy_producers_synchronously();
         destroy_consumers_synchronously();
         channels_.clear();
@@ -383,9 +435,25 @@ struct server::impl : boost::noncopyable
             if (!channel_layout)
                 CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Unknown channel-layout: " + channel_layout_str));
 
+            auto color_space_str = xml_channel.second.get(L"color-space", L"");
+            auto color_space     = core::get_color_space(color_space_str);
+            if (!color_space_str.empty() && color_space == core::color_space::unspecified)
+                CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Invalid color-space: " + color_space_str));
+
+            auto color_transfer_str = xml_channel.second.get(L"color-transfer", L"");
+            auto color_transfer     = core::get_color_transfer(color_transfer_str);
+            if (!color_transfer_str.empty() && color_transfer == core::color_transfer::unspecified)
+                CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Invalid color-transfer: " + color_transfer_str));
+
             auto channel_id = static_cast<int>(channels_.size() + 1);
+            set_channel_memory_budget(channel_id, xml_channel.second.get(L"memory-budget-mb", 0ll) * 1024 * 1024);
+            core::set_channel_latency_profile(channel_id, core::get_latency_profile(xml_channel.second.get(L"latency", L"normal")));
+
             auto channel    = spl::make_shared<video_channel>(
-                channel_id, format_desc, *channel_layout, accelerator_.create_image_mixer(channel_id));
+                channel_id,
+                format_desc,
+                *channel_layout,
+                accelerator_.create_image_mixer(channel_id, color_space, color_transfer));
 
             channel->monitor_output().attach_parent(monitor_subject_);
             channel->mixer().set_straight_alpha_output(xml_channel.second.get(L"straight-alpha-output", false));
@@ -401,9 +469,21 @@ struct server::impl : boost::noncopyable
                 auto name = xml_consumer.first;
 
                 try {
-                    if (name != L"<xmlcomment>")
-                        channel->output().add(consumer_registry_->create_consumer(
-                            name, xml_consumer.second, channel->stage().get(), channels_));
+                    if (name != L"<xmlcomment>") {
+                        auto consumer = consumer_registry_->create_consumer(
+                            name, xml_consumer.second, channel->stage().get(), channels_);
+                        auto video_mode = xml_consumer.second.get(L"video-mode", L"");
+
+                        if (video_mode.empty()) {
+                            channel->output().add(consumer);
+                        } else {
+                            auto format_desc = video_format_repository_.find(video_mode);
+                            if (format_desc.format == video_format::invalid)
+                                CASPAR_THROW_EXCEPTION(user_error() << msg_info(L"Invalid video-mode: " + video_mode));
+
+                            channel->output().add(consumer->index(), consumer, format_desc);
+                        }
+                    }
                 } catch (const user_error& e) {
                     CASPAR_LOG_CURRENT_EXCEPTION_AT_LEVEL(debug);
                     CASPAR_LOG(error) << get_message_and_context(e) << " Turn on log level debug for stacktrace.";
@@ -531,7 +611,7 @@ struct server::impl : boost::noncopyable
                         IO::tokenize(command, tokens);
                         auto cmd = amcp_command_repo_->parse_command(console_client, tokens, L"");
 
-                        std::wstring res = cmd->Execute(amcp_command_repo_->channels()).get();
+                        std::wstring res = cmd->Execute(amcp_command_repo_->channels(), false).get();
                         console_client->send(std::move(res), false);
                     } catch (const user_error& e) {
                         CASPAR_LOG_CURRENT_EXCEPTION_AT_LEVEL(debug);
@@ -589,6 +669,16 @@ struct server::impl : boost::noncopyable
             std::make_shared<amcp::amcp_command_repository_wrapper>(amcp_command_repo_, amcp_context_factory_);
 
         amcp::register_commands(amcp_command_repo_wrapper_);
+
+        if (env::properties().get(L"configuration.amcp-journal.enabled", false)) {
+            auto& pt        = env::properties();
+            auto  path      = pt.get(L"configuration.amcp-journal.path", env::log_folder() + L"amcp.journal");
+            auto  max_size  = pt.get(L"configuration.amcp-journal.max-size-mb", 64);
+            auto  max_files = pt.get(L"configuration.amcp-journal.max-files", 10);
+
+            amcp_journal_ = std::make_shared<amcp::amcp_journal>(
+                path, static_cast<std::int64_t>(max_size) * 1024 * 1024, max_files);
+        }
     }
 
     void setup_controllers(const boost::property_tree::wptree& pt)
@@ -621,7 +711,8 @@ struct server::impl : boost::noncopyable
         if (boost::iequals(name, L"AMCP"))
             return amcp::create_char_amcp_strategy_factory(port_description,
                                                            spl::make_shared_ptr(amcp_command_repo_),
-                                                           spl::make_shared_ptr(amcp_command_scheduler_));
+                                                           spl::make_shared_ptr(amcp_command_scheduler_),
+                                                           amcp_journal_);
         else if (boost::iequals(name, L"CII"))
             return wrap_legacy_protocol(
                 "\r\n", spl::make_shared<cii::CIIProtocolStrategy>(video_format_repository_, channels_, cg_registry_, producer_registry_));
@@ -667,6 +758,7 @@ server::server(std::promise<bool>& shutdown_server_now)
 {
 }
 void                                                   server::start() { impl_->start(); }
+int server::run_producer_host(const std::vector<std::wstring>& args) { return impl_->run_producer_host(args); }
 spl::shared_ptr<core::system_info_provider_repository> server::get_system_info_provider_repo() const
 {
     return impl_->system_info_provider_repo_;
@@ -41,6 +41,7 @@ class server final : public boost::noncopyable
 public:
 	explicit server(std::promise<bool>& shutdown_server_now);
 	void start();
+	int run_producer_host(const std::vector<std::wstring>& args);
         spl::shared_ptr<core::system_info_provider_repository>   get_system_info_provider_repo() const;
         spl::shared_ptr<protocol::amcp::amcp_command_repository> get_amcp_command_repository() const;
         spl::shared_ptr<protocol::amcp::AMCPCommandScheduler>    get_amcp_command_scheduler() const;
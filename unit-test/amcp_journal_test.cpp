@@ -0,0 +1,65 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <protocol/amcp/amcp_journal.h>
+
+#include <string>
+#include <vector>
+
+namespace caspar { namespace protocol { namespace amcp {
+
+TEST(AmcpJournalTest, EscapesLineBreaksTabsAndBackslashes)
+{
+	EXPECT_EQ("CG 1-1 ADD 1 t 1 \"a\\\\b\\r\\nc\\td\"", escape_field("CG 1-1 ADD 1 t 1 \"a\\b\r\nc\td\""));
+	EXPECT_EQ("PLAY 1-1 AMB", escape_field("PLAY 1-1 AMB"));
+	EXPECT_EQ("", escape_field(""));
+}
+
+TEST(AmcpJournalTest, EscapedFieldsRoundTrip)
+{
+	const std::vector<std::string> fields =
+	{
+		"",
+		"PLAY 1-1 AMB LOOP",
+		"CG 1-1 ADD 1 template 1 \"<templateData>\r\n\t<componentData id=\\\"f0\\\"/>\r\n</templateData>\"",
+		"\\n is not a line break",
+		"\\\\\\",
+		"ends with a backslash\\",
+		"\t\t\r\n\n\r",
+		"MIXER 1-1 LUT \"gr\xc3\xa4""de/teal\"",
+	};
+
+	for (auto& field : fields)
+	{
+		auto escaped = escape_field(field);
+
+		EXPECT_EQ(std::string::npos, escaped.find_first_of("\r\n\t")) << escaped;
+		EXPECT_EQ(field, unescape_field(escaped));
+	}
+}
+
+TEST(AmcpJournalTest, UnescapeKeepsUnknownAndTrailingBackslashes)
+{
+	EXPECT_EQ("a\\", unescape_field("a\\"));
+	EXPECT_EQ("ax", unescape_field("a\\x"));
+}
+
+}}}
@@ -0,0 +1,161 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <core/mixer/audio/audio_delay_line.h>
+
+#include <vector>
+
+namespace caspar { namespace core {
+
+namespace {
+
+const int SAMPLE_RATE	= 1000;
+const int BLOCK			= 40;
+
+// Stereo block where the left channel counts the sample frames from first and
+// the right channel holds the negated count.
+std::vector<double> ramp(int first)
+{
+	std::vector<double> block;
+
+	for (int n = 0; n < BLOCK; ++n)
+	{
+		block.push_back(first + n);
+		block.push_back(-(first + n));
+	}
+
+	return block;
+}
+
+double delayed(int frame, int delay)
+{
+	return frame - delay < 0 ? 0.0 : frame - delay;
+}
+
+}
+
+TEST(AudioDelayLineTest, PassesThroughWithoutDelay)
+{
+	audio_delay_line<double> line;
+	line.configure(SAMPLE_RATE, 2);
+
+	auto block = ramp(0);
+	line.process(block.data(), BLOCK, 0);
+
+	EXPECT_EQ(ramp(0), block);
+	EXPECT_TRUE(line.idle());
+}
+
+TEST(AudioDelayLineTest, DelaysBySampleFrames)
+{
+	audio_delay_line<double> line;
+	line.configure(SAMPLE_RATE, 2);
+
+	// The first block fades in from the old zero delay.
+	auto first = ramp(0);
+	line.process(first.data(), BLOCK, 10);
+	EXPECT_FALSE(line.idle());
+
+	auto second = ramp(BLOCK);
+	line.process(second.data(), BLOCK, 10);
+
+	for (int n = 0; n < BLOCK; ++n)
+	{
+		EXPECT_DOUBLE_EQ(delayed(BLOCK + n, 10), second[n * 2]);
+		EXPECT_DOUBLE_EQ(-delayed(BLOCK + n, 10), second[n * 2 + 1]);
+	}
+}
+
+TEST(AudioDelayLineTest, CrossfadesToNewDelay)
+{
+	audio_delay_line<double> line;
+	line.configure(SAMPLE_RATE, 2);
+
+	for (int block = 0; block < 2; ++block)
+	{
+		auto samples = ramp(block * BLOCK);
+		line.process(samples.data(), BLOCK, 10);
+	}
+
+	auto samples = ramp(2 * BLOCK);
+	line.process(samples.data(), BLOCK, 30);
+
+	for (int n = 0; n < BLOCK; ++n)
+	{
+		auto frame		= 2 * BLOCK + n;
+		auto weight		= (n + 1) / static_cast<double>(BLOCK);
+		auto expected	= delayed(frame, 10) * (1.0 - weight) + delayed(frame, 30) * weight;
+
+		EXPECT_NEAR(expected, samples[n * 2], 1e-9);
+		EXPECT_NEAR(-expected, samples[n * 2 + 1], 1e-9);
+	}
+
+	// The block ends on the new read position.
+	EXPECT_NEAR(delayed(3 * BLOCK - 1, 30), samples[(BLOCK - 1) * 2], 1e-9);
+}
+
+TEST(AudioDelayLineTest, StartsFromSilenceAfterReturningToZero)
+{
+	audio_delay_line<double> line;
+	line.configure(SAMPLE_RATE, 2);
+
+	for (int block = 0; block < 2; ++block)
+	{
+		auto samples = ramp(block * BLOCK);
+		line.process(samples.data(), BLOCK, 10);
+	}
+
+	auto samples = ramp(2 * BLOCK);
+	line.process(samples.data(), BLOCK, 0);
+	EXPECT_TRUE(line.idle());
+
+	// Stale audio from before the pause must not come back, the new delay
+	// fades in from silence.
+	samples = ramp(3 * BLOCK);
+	line.process(samples.data(), BLOCK, 20);
+
+	for (int n = 0; n < 20; ++n)
+	{
+		auto weight = (n + 1) / static_cast<double>(BLOCK);
+
+		EXPECT_NEAR((3 * BLOCK + n) * (1.0 - weight), samples[n * 2], 1e-9);
+	}
+}
+
+TEST(AudioDelayLineTest, SplitsNegativeSyncOffsetIntoFramesAndSamples)
+{
+	auto delays = split_sync_offset(-50.0, 25.0, 48000);
+
+	EXPECT_EQ(2, delays.video_frames);
+	EXPECT_EQ(1440, delays.audio_samples);
+
+	delays = split_sync_offset(40.0, 25.0, 48000);
+
+	EXPECT_EQ(0, delays.video_frames);
+	EXPECT_EQ(1920, delays.audio_samples);
+
+	delays = split_sync_offset(-5000.0, 50.0, 48000);
+
+	EXPECT_EQ(100, delays.video_frames);
+	EXPECT_EQ(0, delays.audio_samples);
+}
+
+}}
@@ -0,0 +1,144 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <core/mixer/audio/audio_dynamics.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace caspar { namespace core {
+
+namespace {
+
+const double	FULL_SCALE	= 2147483648.0;
+const int		SAMPLE_RATE	= 48000;
+
+double to_level(double dbfs)
+{
+	return FULL_SCALE * std::pow(10.0, dbfs / 20.0);
+}
+
+double to_dbfs(double level)
+{
+	return 20.0 * std::log10(std::abs(level) / FULL_SCALE);
+}
+
+// Stereo frames at a constant level with alternating sign.
+std::vector<double> tone(double dbfs, std::size_t frames)
+{
+	std::vector<double> samples;
+
+	for (std::size_t n = 0; n < frames; ++n)
+	{
+		auto value = n % 2 == 0 ? to_level(dbfs) : -to_level(dbfs);
+		samples.push_back(value);
+		samples.push_back(value);
+	}
+
+	return samples;
+}
+
+// Output level of a steady tone through an instantly reacting compressor.
+double compressed_dbfs(double input_dbfs, double threshold, double ratio, double makeup = 0.0)
+{
+	audio_dynamics_processor processor;
+	processor.configure(audio_dynamics::compressor(threshold, ratio, 0.0, 0.0, makeup), SAMPLE_RATE, 2);
+
+	auto samples = tone(input_dbfs, 256);
+	processor.process(samples.data(), 256);
+
+	return to_dbfs(samples.back());
+}
+
+}
+
+TEST(AudioDynamicsTest, FollowsStaticGainCurve)
+{
+	// Below the threshold the level is left alone.
+	EXPECT_NEAR(-30.0, compressed_dbfs(-30.0, -20.0, 4.0), 1e-6);
+
+	// Above it the overshoot is divided by the ratio.
+	EXPECT_NEAR(-17.0, compressed_dbfs(-8.0, -20.0, 4.0), 1e-6);
+	EXPECT_NEAR(-18.0, compressed_dbfs(-16.0, -20.0, 2.0), 1e-6);
+	EXPECT_NEAR(-20.0 + 20.0 / 10.0, compressed_dbfs(0.0, -20.0, 10.0), 1e-6);
+
+	// Makeup gain applies to the whole curve.
+	EXPECT_NEAR(-24.0, compressed_dbfs(-30.0, -20.0, 4.0, 6.0), 1e-6);
+	EXPECT_NEAR(-11.0, compressed_dbfs(-8.0, -20.0, 4.0, 6.0), 1e-6);
+}
+
+TEST(AudioDynamicsTest, ReportsLargestGainReduction)
+{
+	audio_dynamics_processor processor;
+	processor.configure(audio_dynamics::compressor(-20.0, 4.0, 0.0, 0.0), SAMPLE_RATE, 2);
+
+	auto samples = tone(-8.0, 256);
+	processor.process(samples.data(), 256);
+
+	EXPECT_NEAR(9.0, processor.take_gain_reduction(), 1e-6);
+	EXPECT_EQ(0.0, processor.take_gain_reduction());
+}
+
+TEST(AudioDynamicsTest, DisabledPassesThrough)
+{
+	audio_dynamics_processor processor;
+	processor.configure(audio_dynamics(), SAMPLE_RATE, 2);
+
+	auto samples = tone(0.0, 256);
+	processor.process(samples.data(), 256);
+
+	EXPECT_EQ(tone(0.0, 256), samples);
+}
+
+TEST(AudioDynamicsTest, LimiterHoldsCeilingAndDelaysByLookahead)
+{
+	const std::size_t LOOKAHEAD_FRAMES = SAMPLE_RATE * 5 / 1000;
+
+	audio_dynamics_processor processor;
+	processor.configure(audio_dynamics::limiter(-6.0, 50.0, 5.0), SAMPLE_RATE, 2);
+
+	// A quiet tone that jumps to full scale, in blocks of a typical size.
+	auto samples = tone(-30.0, 1000);
+	auto loud = tone(0.0, 2000);
+	samples.insert(samples.end(), loud.begin(), loud.end());
+
+	for (std::size_t offset = 0; offset < 3000; offset += 960)
+		processor.process(samples.data() + offset * 2, std::min<std::size_t>(960, 3000 - offset));
+
+	double peak = 0.0;
+
+	for (auto sample : samples)
+		peak = std::max(peak, std::abs(sample));
+
+	EXPECT_LE(to_dbfs(peak), -6.0 + 1e-9);
+
+	// The first frames are the silence that filled the delay line, followed
+	// by the quiet tone untouched.
+	EXPECT_EQ(0.0, samples[0]);
+	EXPECT_EQ(0.0, samples[(LOOKAHEAD_FRAMES - 1) * 2]);
+	EXPECT_NEAR(-30.0, to_dbfs(samples[LOOKAHEAD_FRAMES * 2]), 1e-6);
+
+	// Once settled the full scale tone sits at the ceiling.
+	EXPECT_NEAR(-6.0, to_dbfs(samples.back()), 0.01);
+}
+
+}}
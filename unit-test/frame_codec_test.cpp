@@ -0,0 +1,115 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <modules/remote/util/frame_codec.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace caspar { namespace remote {
+
+namespace {
+
+std::vector<std::uint8_t> noise_image(int width, int height)
+{
+	std::mt19937 generator(1234);
+	std::uniform_int_distribution<int> distribution(0, 255);
+	std::vector<std::uint8_t> image(width * height * 4);
+
+	for (auto& value : image)
+		value = static_cast<std::uint8_t>(distribution(generator));
+
+	return image;
+}
+
+std::vector<std::uint8_t> gradient_image(int width, int height)
+{
+	std::vector<std::uint8_t> image(width * height * 4);
+
+	for (int y = 0; y < height; ++y)
+	{
+		for (int x = 0; x < width; ++x)
+		{
+			auto pixel = &image[(y * width + x) * 4];
+			pixel[0] = static_cast<std::uint8_t>(x);
+			pixel[1] = static_cast<std::uint8_t>(y);
+			pixel[2] = static_cast<std::uint8_t>(x + y);
+			pixel[3] = 255;
+		}
+	}
+
+	return image;
+}
+
+std::vector<std::uint8_t> round_trip(const std::vector<std::uint8_t>& image, int width, int height, std::size_t* encoded_size = nullptr)
+{
+	std::vector<std::uint8_t> encoded;
+	encode_image(image.data(), width, height, encoded);
+
+	if (encoded_size)
+		*encoded_size = encoded.size();
+
+	std::vector<std::uint8_t> decoded(image.size());
+	EXPECT_TRUE(decode_image(encoded.data(), encoded.size(), width, height, decoded.data()));
+
+	return decoded;
+}
+
+}
+
+TEST(FrameCodecTest, NoiseRoundTripsExactly)
+{
+	// Sizes that are not multiples of the band and block sizes.
+	auto image = noise_image(173, 45);
+
+	EXPECT_EQ(image, round_trip(image, 173, 45));
+}
+
+TEST(FrameCodecTest, GradientRoundTripsExactlyAndCompresses)
+{
+	auto image = gradient_image(320, 64);
+	std::size_t encoded_size = 0;
+
+	EXPECT_EQ(image, round_trip(image, 320, 64, &encoded_size));
+	EXPECT_LT(encoded_size, image.size() / 4);
+}
+
+TEST(FrameCodecTest, SinglePixelRoundTrips)
+{
+	auto image = noise_image(1, 1);
+
+	EXPECT_EQ(image, round_trip(image, 1, 1));
+}
+
+TEST(FrameCodecTest, RejectsTruncatedData)
+{
+	auto image = noise_image(64, 32);
+	std::vector<std::uint8_t> encoded;
+	encode_image(image.data(), 64, 32, encoded);
+
+	std::vector<std::uint8_t> decoded(image.size());
+
+	EXPECT_FALSE(decode_image(encoded.data(), encoded.size() / 2, 64, 32, decoded.data()));
+	EXPECT_FALSE(decode_image(encoded.data(), 0, 64, 32, decoded.data()));
+}
+
+}}
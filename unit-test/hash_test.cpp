@@ -0,0 +1,107 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <common/hash.h>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace caspar {
+
+namespace {
+
+std::uint64_t hash_string(const std::string& str, std::uint64_t seed = 0)
+{
+	return xxhash64(str.data(), str.size(), seed);
+}
+
+std::vector<std::uint8_t> pattern(std::size_t size)
+{
+	std::vector<std::uint8_t> data(size);
+
+	for (std::size_t i = 0; i < size; ++i)
+		data[i] = static_cast<std::uint8_t>(i * 7 + 3);
+
+	return data;
+}
+
+struct reference
+{
+	std::size_t		size;
+	std::uint64_t	unseeded;
+	std::uint64_t	seeded;
+};
+
+const std::uint64_t SEED = 0x9E3779B97F4A7C15ull;
+
+// Sizes around the 4, 8 and 32 byte steps of the algorithm, computed with an
+// independent implementation of the XXH64 specification that reproduces the
+// published vectors below.
+const reference REFERENCES[] =
+{
+	{    1, 0x1f25c8d0bc1f4bb6ull, 0x79826bcd749d267aull },
+	{    3, 0x31d2363f52e564c9ull, 0x78efd77575e26575ull },
+	{    4, 0x9bb64b7d66ee9fdaull, 0x6f0a6c97d68bf353ull },
+	{    7, 0x9a7b149959ce60d8ull, 0xd97ede93c9d66a0dull },
+	{    8, 0xdab99d95c6f90092ull, 0xa2f1e28437a78a1bull },
+	{   31, 0xa2aa5f33cc4a6119ull, 0x755437271d1d0a84ull },
+	{   32, 0x23c3c17ef790fd97ull, 0xbf624b932c090428ull },
+	{   33, 0x50a7cfc7ba588784ull, 0x7aceaf1e9d34ea35ull },
+	{   63, 0x5e3e54b431c7493cull, 0x2c8ddce5c85d0d9dull },
+	{   64, 0x0eb64b3ef6eeb01full, 0x4af341f14e3a6fc9ull },
+	{  100, 0xa61f8d4c170fe531ull, 0xf6d8f65c625abb4full },
+	{ 1000, 0x5f235fa033f1a3fbull, 0x442acd0a822e86f6ull },
+};
+
+}
+
+TEST(HashTest, MatchesPublishedVectors)
+{
+	EXPECT_EQ(0xef46db3751d8e999ull, hash_string(""));
+	EXPECT_EQ(0xd24ec4f1a98c6e5bull, hash_string("a"));
+	EXPECT_EQ(0x44bc2cf5ad770999ull, hash_string("abc"));
+	EXPECT_EQ(0xfbcea83c8a378bf1ull, hash_string("Nobody inspects the spammish repetition"));
+}
+
+TEST(HashTest, MatchesReferenceForAllTailLengths)
+{
+	auto data = pattern(1000);
+
+	for (auto& ref : REFERENCES)
+	{
+		EXPECT_EQ(ref.unseeded, xxhash64(data.data(), ref.size)) << "size " << ref.size;
+		EXPECT_EQ(ref.seeded, xxhash64(data.data(), ref.size, SEED)) << "size " << ref.size;
+	}
+}
+
+TEST(HashTest, DoesNotDependOnAlignment)
+{
+	auto data = pattern(1000);
+	std::vector<std::uint8_t> shifted(data.size() + 1);
+
+	std::memcpy(shifted.data() + 1, data.data(), data.size());
+
+	EXPECT_EQ(0x5f235fa033f1a3fbull, xxhash64(shifted.data() + 1, data.size()));
+}
+
+}
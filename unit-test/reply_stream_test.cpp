@@ -0,0 +1,210 @@
+/*
+* Copyright (c) 2011 Sveriges Television AB <info@casparcg.com>
+*
+* This file is part of CasparCG (www.casparcg.com).
+*
+* CasparCG is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* CasparCG is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with CasparCG. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <gtest/gtest.h>
+
+#include <protocol/amcp/amcp_reply_stream.h>
+#include <protocol/util/strategy_adapters.h>
+
+#include <common/utf.h>
+
+#include <boost/chrono.hpp>
+#include <boost/lexical_cast.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace caspar { namespace protocol { namespace amcp {
+
+namespace {
+
+template<typename CharT>
+class recording_client : public IO::client_connection<CharT>
+{
+public:
+	std::vector<std::string> sent;
+
+	void send(std::basic_string<CharT>&& data, bool skip_log) override	{ sent.push_back(u8(data)); }
+	void send_utf8(std::string&& data, bool skip_log) override			{ sent.push_back(std::move(data)); }
+	void disconnect() override											{ }
+	std::wstring address() const override								{ return L"test"; }
+	void add_lifecycle_bound_object(const std::wstring& key, const std::shared_ptr<void>& lifecycle_bound) override { }
+	std::shared_ptr<void> remove_lifecycle_bound_object(const std::wstring& key) override { return nullptr; }
+
+	std::string joined() const
+	{
+		std::string result;
+
+		for (auto& data : sent)
+			result += data;
+
+		return result;
+	}
+};
+
+struct client_capturing_factory : public IO::protocol_strategy_factory<wchar_t>
+{
+	std::shared_ptr<IO::client_connection<wchar_t>> client;
+
+	struct ignoring_strategy : public IO::protocol_strategy<wchar_t>
+	{
+		void parse(const std::wstring& data) override { }
+	};
+
+	IO::protocol_strategy<wchar_t>::ptr create(const IO::client_connection<wchar_t>::ptr& client_connection) override
+	{
+		client = client_connection;
+
+		return spl::make_shared<ignoring_strategy>();
+	}
+};
+
+std::wstring cls_line(int n)
+{
+	return L"\"MEDIA/CLIP_" + boost::lexical_cast<std::wstring>(n) + L"\" MOVIE 6445960 20170726140014 268 1/25\r\n";
+}
+
+}
+
+TEST(ReplyStreamTest, StreamsLargeReplyWhileWriting)
+{
+	using namespace boost::chrono;
+
+	const int ENTRIES = 100000;
+
+	auto client	= spl::make_shared<recording_client<wchar_t>>();
+	auto start	= steady_clock::now();
+	int entries_before_first_byte = -1;
+	steady_clock::duration time_to_first_byte;
+	std::string expected = "RES 7 200 CLS OK\r\n";
+
+	{
+		reply_stream reply(client, L"7", true);
+		reply << L"200 CLS OK\r\n";
+
+		for (int n = 0; n < ENTRIES; ++n)
+		{
+			reply << cls_line(n);
+			expected += u8(cls_line(n));
+
+			if (entries_before_first_byte < 0 && !client->sent.empty())
+			{
+				entries_before_first_byte	= n;
+				time_to_first_byte			= steady_clock::now() - start;
+			}
+		}
+
+		reply << L"\r\n";
+		expected += "\r\n";
+
+		EXPECT_EQ(L"", reply.finish());
+	}
+
+	auto total = steady_clock::now() - start;
+
+	RecordProperty("entries", ENTRIES);
+	RecordProperty("time_to_first_byte_us", static_cast<int>(duration_cast<microseconds>(time_to_first_byte).count()));
+	RecordProperty("total_us", static_cast<int>(duration_cast<microseconds>(total).count()));
+
+	// The first chunk goes out after 16k characters, about 270 entries.
+	ASSERT_GE(entries_before_first_byte, 0);
+	EXPECT_LT(entries_before_first_byte, 1000);
+
+	std::size_t largest_chunk = 0;
+
+	for (auto& data : client->sent)
+		largest_chunk = std::max(largest_chunk, data.size());
+
+	EXPECT_LE(largest_chunk, 16384u + 16u);
+	EXPECT_EQ(expected, client->joined());
+}
+
+TEST(ReplyStreamTest, SendsShortReplyOnFinish)
+{
+	auto client = spl::make_shared<recording_client<wchar_t>>();
+
+	reply_stream reply(client, L"", true);
+	reply << L"200 TLS OK\r\n" << L"\"TEMPLATE\" 1234 20170726140014\r\n" << L"\r\n";
+
+	EXPECT_TRUE(client->sent.empty());
+	EXPECT_EQ(L"", reply.finish());
+	EXPECT_EQ("200 TLS OK\r\n\"TEMPLATE\" 1234 20170726140014\r\n\r\n", client->joined());
+}
+
+TEST(ReplyStreamTest, CollectsReplyWhenNotStreamed)
+{
+	auto client = spl::make_shared<recording_client<wchar_t>>();
+
+	reply_stream reply(client, L"", false);
+
+	for (int n = 0; n < 1000; ++n)
+		reply << cls_line(n);
+
+	auto collected = reply.finish();
+
+	EXPECT_TRUE(client->sent.empty());
+	EXPECT_EQ(cls_line(0) + cls_line(1), collected.substr(0, cls_line(0).size() + cls_line(1).size()));
+	EXPECT_EQ(cls_line(999), collected.substr(collected.size() - cls_line(999).size()));
+}
+
+TEST(ReplyStreamTest, TerminatesReplyCutShort)
+{
+	auto client = spl::make_shared<recording_client<wchar_t>>();
+
+	{
+		reply_stream reply(client, L"", true);
+		reply << L"200 CLS OK\r\n";
+
+		for (int n = 0; n < 1000; ++n)
+			reply << cls_line(n);
+
+		reply << L"\"MEDIA/UNFINISHED";
+	}
+
+	auto joined = client->joined();
+
+	ASSERT_GE(joined.size(), 4u);
+	EXPECT_EQ("\r\n\r\n", joined.substr(joined.size() - 4));
+	EXPECT_EQ(std::string::npos, joined.find("UNFINISHED"));
+}
+
+TEST(ReplyStreamTest, HoldsBackOtherRepliesDuringStream)
+{
+	auto char_client	= spl::make_shared<recording_client<char>>();
+	auto factory		= spl::make_shared<client_capturing_factory>();
+	auto strategy		= IO::to_unicode_adapter_factory("UTF-8", factory).create(char_client);
+	auto client			= factory->client;
+
+	ASSERT_TRUE(static_cast<bool>(client));
+
+	auto stream = client->lock_sends();
+
+	client->send_utf8("200 CLS OK\r\n");
+	std::thread([&] { client->send(L"202 PLAY OK\r\n"); }).join();
+	client->send_utf8("\r\n");
+
+	EXPECT_EQ("200 CLS OK\r\n\r\n", char_client->joined());
+
+	stream.reset();
+
+	EXPECT_EQ("200 CLS OK\r\n\r\n202 PLAY OK\r\n", char_client->joined());
+}
+
+}}}
@@ -0,0 +1,6 @@
+#define CASPAR_GEN 2
+#define CASPAR_MAYOR 1
+#define CASPAR_MINOR 0
+#define CASPAR_TAG "NRK"
+#define CASPAR_REV 26
+#define CASPAR_HASH "5fca5bc"